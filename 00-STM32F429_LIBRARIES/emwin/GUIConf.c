@@ -63,7 +63,9 @@ Purpose     : Display controller initialization
 // Define the available number of bytes available for the GUI
 //
 
-#if TM_EMWIN_ROTATE_LCD == 1
+#if EMWIN_MEMORY_SDRAM == 1
+	#define GUI_NUMBYTES	EMWIN_MEMORY_SIZE
+#elif TM_EMWIN_ROTATE_LCD == 1
 	#define GUI_NUMBYTES	(1024 * 128 * 4)
 #else
 	#define GUI_NUMBYTES  	(1024 * 100)    // x KByte
@@ -83,7 +85,10 @@ Purpose     : Display controller initialization
 	U32 HeapMem[1024 * 1024] __attribute__((section(".HeapMemSection")));
 #endif
 
-#if TM_EMWIN_ROTATE_LCD == 1
+#if EMWIN_MEMORY_SDRAM == 1
+	/* emWin memory and memory devices are in SDRAM, after frame buffers */
+	#define extMem HeapMem
+#elif TM_EMWIN_ROTATE_LCD == 1
 	#if defined ( __CC_ARM   ) 
 		U32 extMem[GUI_NUMBYTES / 4] __attribute__((at(0xD0080000)));
 	#elif defined ( __ICCARM__ ) 
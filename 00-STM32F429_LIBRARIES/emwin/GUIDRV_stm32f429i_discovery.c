@@ -66,6 +66,7 @@ can be set here.
 #include "GUI_Private.h"
 #include "GUIDRV_Lin.h"
 #include "global_includes.h"
+#include "tm_stm32f4_emwin.h"
 
 /* External variable, declared in tm_stm32f4_emwin.c file */
 extern uint32_t EMWIN_LCD_DRIVER_CB_CALLED;
@@ -96,7 +97,7 @@ extern uint32_t EMWIN_LCD_DRIVER_CB_CALLED;
 //
 // Buffers / VScreens
 //
-#define NUM_BUFFERS  1 // Number of multiple buffers to be used
+#define NUM_BUFFERS  EMWIN_NUM_BUFFERS // Number of multiple buffers to be used, set in tm_stm32f4_emwin.h
 #define NUM_VSCREENS 1 // Number of virtual screens to be used
 
 //
@@ -965,8 +966,10 @@ static void _LCD_InitController(int LayerIndex) {
 
     //LCD_Init();
     //
-    // Enable line interrupt
+    // Enable line interrupt at first line of vertical blanking, buffers are changed there
     //
+    LTDC_LIPConfig(YSIZE_PHYS + VBP + 1);
+    LTDC->ICR = (U32)LTDC_IER_LIE;
     LTDC_ITConfig(LTDC_IER_LIE, ENABLE);
     NVIC_SetPriority(LTDC_IRQn, 0);
     NVIC_EnableIRQ(LTDC_IRQn);
@@ -1122,6 +1125,10 @@ static void _LCD_CopyBuffer(int LayerIndex, int IndexSrc, int IndexDst) {
   AddrSrc    = _aAddr[LayerIndex] + BufferSize * IndexSrc;
   AddrDst    = _aAddr[LayerIndex] + BufferSize * IndexDst;
   _DMA_Copy(LayerIndex, (void *)AddrSrc, (void *)AddrDst, _axSize[LayerIndex], _aySize[LayerIndex], 0, 0);
+  //
+  // emWin copies front buffer to new back buffer, all next drawings go to this buffer
+  //
+  _aBufferIndex[LayerIndex] = IndexDst;
 }
 
 /*********************************************************************
@@ -1137,7 +1144,7 @@ static void _LCD_CopyRect(int LayerIndex, int x0, int y0, int x1, int y1, int xS
   BufferSize = _GetBufferSize(LayerIndex);
   AddrSrc = _aAddr[LayerIndex] + BufferSize * _aBufferIndex[LayerIndex] + (y0 * _axSize[LayerIndex] + x0) * _aBytesPerPixels[LayerIndex];
   AddrDst = _aAddr[LayerIndex] + BufferSize * _aBufferIndex[LayerIndex] + (y1 * _axSize[LayerIndex] + x1) * _aBytesPerPixels[LayerIndex];
-  _DMA_Copy(LayerIndex, (void *)AddrSrc, (void *)AddrDst, xSize, ySize, _axSize[LayerIndex] - xSize, 0);
+  _DMA_Copy(LayerIndex, (void *)AddrSrc, (void *)AddrDst, xSize, ySize, _axSize[LayerIndex] - xSize, _axSize[LayerIndex] - xSize);
 }
 
 /*********************************************************************
@@ -1177,7 +1184,7 @@ static void _LCD_DrawBitmap16bpp(int LayerIndex, int x, int y, U16 const * p, in
 
   BufferSize = _GetBufferSize(LayerIndex);
   AddrDst = _aAddr[LayerIndex] + BufferSize * _aBufferIndex[LayerIndex] + (y * _axSize[LayerIndex] + x) * _aBytesPerPixels[LayerIndex];
-  OffLineSrc = 240/*(BytesPerLine / 2)*/ - xSize;
+  OffLineSrc = (BytesPerLine / 2) - xSize;
   OffLineDst = _axSize[LayerIndex] - xSize;
   _DMA_Copy(LayerIndex, (void *)p, (void *)AddrDst, xSize, ySize, OffLineSrc, OffLineDst);
 }
@@ -1249,9 +1256,8 @@ void LTDC_ISR_Handler(void) {
       //
       GUI_MULTIBUF_ConfirmEx(i, _aPendingBuffer[i]);
       //
-      // Clear pending buffer flag of layer
+      // Clear pending buffer flag of layer, drawing buffer is set in _LCD_CopyBuffer
       //
-      _aBufferIndex[i] = _aPendingBuffer[i];
       _aPendingBuffer[i] = -1;
     }
   }
@@ -117,6 +117,54 @@ DISKIO_LowLevelDriver_t FATFS_LowLevelDrivers[_VOLUMES] = {
 	}
 };
 
+#if FATFS_USE_CACHE == 1
+#include "string.h"
+
+/* Number of sets in cache */
+#define FATFS_CACHE_SETS		(FATFS_CACHE_SECTORS / FATFS_CACHE_WAYS)
+
+/* Cache line flags */
+#define FATFS_CACHE_VALID		0x01
+#define FATFS_CACHE_DIRTY		0x02
+
+/* Cache line */
+typedef struct {
+	DWORD Sector;	/* Sector number on drive */
+	DWORD Used;		/* Time of last use for LRU replacement */
+	BYTE Drive;		/* Physical drive number */
+	BYTE Flags;		/* Valid and dirty flags */
+} FATFS_CacheLine_t;
+
+/* Cache lines, sector of line i is at CacheData + i * _MAX_SS */
+static FATFS_CacheLine_t CacheLines[FATFS_CACHE_SECTORS];
+#ifdef FATFS_CACHE_ADDR
+#if FATFS_USE_SDRAM == 1
+#error "FATFS_CACHE_ADDR can not be used together with SDRAM drive, which uses whole SDRAM. Remove it and cache will be in internal RAM"
+#endif
+#define CacheData				((BYTE *)(FATFS_CACHE_ADDR))
+#define CacheBounce				((BYTE *)(FATFS_CACHE_ADDR + FATFS_CACHE_SECTORS * _MAX_SS))
+#else
+/* Word aligned for DMA drivers */
+static DWORD CacheDataWords[FATFS_CACHE_SECTORS * _MAX_SS / 4];
+static DWORD CacheBounceWords[FATFS_CACHE_COALESCE * _MAX_SS / 4];
+#define CacheData				((BYTE *)CacheDataWords)
+#define CacheBounce				((BYTE *)CacheBounceWords)
+#endif
+#define CACHE_LINE_DATA(i)		(CacheData + (DWORD)(i) * _MAX_SS)
+
+/* LRU time and statistics */
+static DWORD CacheTime;
+static TM_FATFS_CacheStats_t CacheStats[_VOLUMES];
+
+/* Private functions */
+static int TM_FATFS_INT_CacheFind(BYTE pdrv, DWORD sector);
+static int TM_FATFS_INT_CacheAlloc(BYTE pdrv, DWORD sector, DRESULT* res);
+static DRESULT TM_FATFS_INT_CacheWriteBack(int index);
+static void TM_FATFS_INT_CacheInvalidate(BYTE pdrv, DWORD start, DWORD end);
+static DRESULT TM_FATFS_INT_CacheRead(BYTE pdrv, BYTE* buff, DWORD sector, UINT count);
+static DRESULT TM_FATFS_INT_CacheWrite(BYTE pdrv, const BYTE* buff, DWORD sector, UINT count);
+#endif
+
 void TM_FATFS_AddDriver(DISKIO_LowLevelDriver_t* Driver, TM_FATFS_Driver_t DriverName) {
 	if (
 		DriverName != TM_FATFS_Driver_USER1 &&
@@ -143,6 +191,10 @@ DSTATUS disk_initialize (
 {
 	/* Return low level status */
 	if (FATFS_LowLevelDrivers[pdrv].disk_initialize) {
+#if FATFS_USE_CACHE == 1
+		/* Medium may be changed, drop cached sectors */
+		TM_FATFS_INT_CacheInvalidate(pdrv, 0, 0xFFFFFFFF);
+#endif
 		return FATFS_LowLevelDrivers[pdrv].disk_initialize();
 	}
 	
@@ -183,6 +235,10 @@ DRESULT disk_read (
 	
 	/* Return low level status */
 	if (FATFS_LowLevelDrivers[pdrv].disk_read) {
+#if FATFS_USE_CACHE == 1
+		/* Read through sector cache */
+		return TM_FATFS_INT_CacheRead(pdrv, buff, sector, count);
+#endif
 		return FATFS_LowLevelDrivers[pdrv].disk_read(buff, sector, count);
 	}
 	
@@ -210,6 +266,10 @@ DRESULT disk_write (
 	
 	/* Return low level status */
 	if (FATFS_LowLevelDrivers[pdrv].disk_write) {
+#if FATFS_USE_CACHE == 1
+		/* Write to sector cache */
+		return TM_FATFS_INT_CacheWrite(pdrv, buff, sector, count);
+#endif
 		return FATFS_LowLevelDrivers[pdrv].disk_write(buff, sector, count);
 	}
 	
@@ -231,6 +291,17 @@ DRESULT disk_ioctl (
 {
 	/* Return low level status */
 	if (FATFS_LowLevelDrivers[pdrv].disk_ioctl) {
+#if FATFS_USE_CACHE == 1
+		if (cmd == CTRL_SYNC) {
+			/* Write dirty sectors first */
+			if (TM_FATFS_CacheFlush(pdrv) != RES_OK) {
+				return RES_ERROR;
+			}
+		} else if (cmd == CTRL_ERASE_SECTOR && buff) {
+			/* Erased sectors are not valid anymore */
+			TM_FATFS_INT_CacheInvalidate(pdrv, ((DWORD *)buff)[0], ((DWORD *)buff)[1]);
+		}
+#endif
 		return FATFS_LowLevelDrivers[pdrv].disk_ioctl(cmd, buff);
 	}
 	
@@ -239,6 +310,287 @@ DRESULT disk_ioctl (
 }
 #endif
 
+#if FATFS_USE_CACHE == 1
+/*-----------------------------------------------------------------------*/
+/* Sector cache                                                          */
+/*-----------------------------------------------------------------------*/
+DRESULT TM_FATFS_CacheFlush(BYTE pdrv) {
+	DRESULT res;
+	int i;
+	
+	/* Write back all dirty lines of drive, each write back can clean more lines */
+	for (i = 0; i < FATFS_CACHE_SECTORS; i++) {
+		if (
+			(CacheLines[i].Flags & FATFS_CACHE_DIRTY) &&
+			CacheLines[i].Drive == pdrv
+		) {
+			res = TM_FATFS_INT_CacheWriteBack(i);
+			if (res != RES_OK) {
+				return res;
+			}
+		}
+	}
+	
+	/* Return OK */
+	return RES_OK;
+}
+
+void TM_FATFS_CacheGetStats(BYTE pdrv, TM_FATFS_CacheStats_t* Stats) {
+	/* Copy statistics */
+	if (pdrv < _VOLUMES) {
+		memcpy(Stats, &CacheStats[pdrv], sizeof(TM_FATFS_CacheStats_t));
+	}
+}
+
+void TM_FATFS_CacheResetStats(BYTE pdrv) {
+	/* Clear statistics */
+	if (pdrv < _VOLUMES) {
+		memset(&CacheStats[pdrv], 0, sizeof(TM_FATFS_CacheStats_t));
+	}
+}
+
+static int TM_FATFS_INT_CacheFind(BYTE pdrv, DWORD sector) {
+	int i, end;
+	
+	/* Consecutive sectors are in consecutive sets */
+	i = ((sector + pdrv) % FATFS_CACHE_SETS) * FATFS_CACHE_WAYS;
+	end = i + FATFS_CACHE_WAYS;
+	
+	/* Check all lines in set */
+	for (; i < end; i++) {
+		if (
+			(CacheLines[i].Flags & FATFS_CACHE_VALID) &&
+			CacheLines[i].Sector == sector &&
+			CacheLines[i].Drive == pdrv
+		) {
+			return i;
+		}
+	}
+	
+	/* Not cached */
+	return -1;
+}
+
+static int TM_FATFS_INT_CacheAlloc(BYTE pdrv, DWORD sector, DRESULT* res) {
+	int i, end, victim;
+	
+	/* Find empty or least recently used line in set */
+	i = ((sector + pdrv) % FATFS_CACHE_SETS) * FATFS_CACHE_WAYS;
+	end = i + FATFS_CACHE_WAYS;
+	victim = i;
+	for (; i < end; i++) {
+		if (!(CacheLines[i].Flags & FATFS_CACHE_VALID)) {
+			victim = i;
+			break;
+		}
+		if (CacheLines[i].Used < CacheLines[victim].Used) {
+			victim = i;
+		}
+	}
+	
+	/* Write back old content first */
+	if (CacheLines[victim].Flags & FATFS_CACHE_DIRTY) {
+		*res = TM_FATFS_INT_CacheWriteBack(victim);
+		if (*res != RES_OK) {
+			return -1;
+		}
+	}
+	
+	/* Set new sector, data are filled by caller */
+	CacheLines[victim].Sector = sector;
+	CacheLines[victim].Drive = pdrv;
+	CacheLines[victim].Flags = FATFS_CACHE_VALID;
+	CacheLines[victim].Used = ++CacheTime;
+	
+	/* Return line */
+	*res = RES_OK;
+	return victim;
+}
+
+static DRESULT TM_FATFS_INT_CacheWriteBack(int index) {
+	BYTE pdrv = CacheLines[index].Drive;
+	DWORD start = CacheLines[index].Sector;
+	int lines[FATFS_CACHE_COALESCE];
+	UINT n, back = 0;
+	DRESULT res;
+	int i;
+	
+	/* Find first sector of dirty run before this sector */
+	while (start > 0 && back < FATFS_CACHE_COALESCE - 1) {
+		i = TM_FATFS_INT_CacheFind(pdrv, start - 1);
+		if (i < 0 || !(CacheLines[i].Flags & FATFS_CACHE_DIRTY)) {
+			break;
+		}
+		start--;
+		back++;
+	}
+	
+	/* Copy consecutive dirty sectors to bounce buffer */
+	for (n = 0; n < FATFS_CACHE_COALESCE; n++) {
+		i = TM_FATFS_INT_CacheFind(pdrv, start + n);
+		if (i < 0 || !(CacheLines[i].Flags & FATFS_CACHE_DIRTY)) {
+			break;
+		}
+		lines[n] = i;
+		memcpy(CacheBounce + n * _MAX_SS, CACHE_LINE_DATA(i), _MAX_SS);
+	}
+	
+	/* Write all sectors with one call */
+	res = FATFS_LowLevelDrivers[pdrv].disk_write(CacheBounce, start, n);
+	CacheStats[pdrv].DriverWrites++;
+	if (res != RES_OK) {
+		return res;
+	}
+	CacheStats[pdrv].SectorsWritten += n;
+	
+	/* Lines are clean now */
+	while (n--) {
+		CacheLines[lines[n]].Flags &= ~FATFS_CACHE_DIRTY;
+	}
+	
+	/* Return OK */
+	return RES_OK;
+}
+
+static void TM_FATFS_INT_CacheInvalidate(BYTE pdrv, DWORD start, DWORD end) {
+	int i;
+	
+	/* Drop lines in range, dirty data are lost */
+	for (i = 0; i < FATFS_CACHE_SECTORS; i++) {
+		if (
+			CacheLines[i].Drive == pdrv &&
+			CacheLines[i].Sector >= start &&
+			CacheLines[i].Sector <= end
+		) {
+			CacheLines[i].Flags = 0;
+		}
+	}
+}
+
+static DRESULT TM_FATFS_INT_CacheRead(BYTE pdrv, BYTE* buff, DWORD sector, UINT count) {
+	DRESULT res;
+	UINT i, k, n;
+	int line;
+	
+	/* Large reads go directly to driver */
+	if (count >= FATFS_CACHE_BYPASS) {
+		res = FATFS_LowLevelDrivers[pdrv].disk_read(buff, sector, count);
+		CacheStats[pdrv].DriverReads++;
+		CacheStats[pdrv].ReadMisses += count;
+		if (res != RES_OK) {
+			return res;
+		}
+		
+		/* Dirty cached sectors are newer than sectors on drive */
+		for (i = 0; i < FATFS_CACHE_SECTORS; i++) {
+			if (
+				(CacheLines[i].Flags & FATFS_CACHE_DIRTY) &&
+				CacheLines[i].Drive == pdrv &&
+				CacheLines[i].Sector >= sector &&
+				CacheLines[i].Sector < sector + count
+			) {
+				memcpy(buff + (CacheLines[i].Sector - sector) * _MAX_SS, CACHE_LINE_DATA(i), _MAX_SS);
+			}
+		}
+		
+		/* Return OK */
+		return RES_OK;
+	}
+	
+	/* Read sector by sector */
+	i = 0;
+	while (i < count) {
+		/* Check cache first */
+		line = TM_FATFS_INT_CacheFind(pdrv, sector + i);
+		if (line >= 0) {
+			memcpy(buff + i * _MAX_SS, CACHE_LINE_DATA(line), _MAX_SS);
+			CacheLines[line].Used = ++CacheTime;
+			CacheStats[pdrv].ReadHits++;
+			i++;
+			continue;
+		}
+		
+		/* Read all next missing sectors with one call */
+		n = 1;
+		while (i + n < count && TM_FATFS_INT_CacheFind(pdrv, sector + i + n) < 0) {
+			n++;
+		}
+		res = FATFS_LowLevelDrivers[pdrv].disk_read(buff + i * _MAX_SS, sector + i, n);
+		CacheStats[pdrv].DriverReads++;
+		CacheStats[pdrv].ReadMisses += n;
+		if (res != RES_OK) {
+			return res;
+		}
+		
+		/* Put sectors to cache */
+		for (k = 0; k < n; k++) {
+			line = TM_FATFS_INT_CacheAlloc(pdrv, sector + i + k, &res);
+			if (line < 0) {
+				return res;
+			}
+			memcpy(CACHE_LINE_DATA(line), buff + (i + k) * _MAX_SS, _MAX_SS);
+		}
+		i += n;
+	}
+	
+	/* Return OK */
+	return RES_OK;
+}
+
+static DRESULT TM_FATFS_INT_CacheWrite(BYTE pdrv, const BYTE* buff, DWORD sector, UINT count) {
+	DRESULT res;
+	UINT i;
+	int line;
+	
+	/* Large writes go directly to driver */
+	if (count >= FATFS_CACHE_BYPASS) {
+		res = FATFS_LowLevelDrivers[pdrv].disk_write(buff, sector, count);
+		CacheStats[pdrv].DriverWrites++;
+		CacheStats[pdrv].WriteMisses += count;
+		if (res != RES_OK) {
+			return res;
+		}
+		CacheStats[pdrv].SectorsWritten += count;
+		
+		/* Update cached copies, they are the same as on drive now */
+		for (i = 0; i < FATFS_CACHE_SECTORS; i++) {
+			if (
+				(CacheLines[i].Flags & FATFS_CACHE_VALID) &&
+				CacheLines[i].Drive == pdrv &&
+				CacheLines[i].Sector >= sector &&
+				CacheLines[i].Sector < sector + count
+			) {
+				memcpy(CACHE_LINE_DATA(i), buff + (CacheLines[i].Sector - sector) * _MAX_SS, _MAX_SS);
+				CacheLines[i].Flags &= ~FATFS_CACHE_DIRTY;
+			}
+		}
+		
+		/* Return OK */
+		return RES_OK;
+	}
+	
+	/* Write sectors to cache, they are written to driver later */
+	for (i = 0; i < count; i++) {
+		line = TM_FATFS_INT_CacheFind(pdrv, sector + i);
+		if (line >= 0) {
+			CacheStats[pdrv].WriteHits++;
+		} else {
+			line = TM_FATFS_INT_CacheAlloc(pdrv, sector + i, &res);
+			if (line < 0) {
+				return res;
+			}
+			CacheStats[pdrv].WriteMisses++;
+		}
+		memcpy(CACHE_LINE_DATA(line), buff + i * _MAX_SS, _MAX_SS);
+		CacheLines[line].Flags |= FATFS_CACHE_DIRTY;
+		CacheLines[line].Used = ++CacheTime;
+	}
+	
+	/* Return OK */
+	return RES_OK;
+}
+#endif
+
 /*-----------------------------------------------------------------------*/
 /* Get time for fatfs for files                                          */
 /*-----------------------------------------------------------------------*/
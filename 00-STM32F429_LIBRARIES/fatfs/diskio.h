@@ -24,6 +24,37 @@ typedef enum {
 	RES_PARERR		/* 4: Invalid Parameter */
 } DRESULT;
 
+/* Sector cache between FatFs and low level drivers, disabled by default */
+/* Set to 1 in defines.h to enable it */
+#ifndef FATFS_USE_CACHE
+#define FATFS_USE_CACHE			0
+#endif
+
+/* Number of cached sectors for all drives together */
+#ifndef FATFS_CACHE_SECTORS
+#define FATFS_CACHE_SECTORS		64
+#endif
+
+/* Number of sectors in one set, FATFS_CACHE_SECTORS must be multiple of this value */
+#ifndef FATFS_CACHE_WAYS
+#define FATFS_CACHE_WAYS		4
+#endif
+
+/* Maximal number of consecutive dirty sectors written back with one multi-block write */
+#ifndef FATFS_CACHE_COALESCE
+#define FATFS_CACHE_COALESCE	16
+#endif
+
+/* Reads and writes with at least this number of sectors go directly to driver */
+#ifndef FATFS_CACHE_BYPASS
+#define FATFS_CACHE_BYPASS		16
+#endif
+
+/* Cache memory address, for example in SDRAM. If not defined, cache is in internal RAM */
+/* It needs (FATFS_CACHE_SECTORS + FATFS_CACHE_COALESCE) * 512 bytes */
+/* It can not be used with FATFS_USE_SDRAM, SDRAM drive uses whole SDRAM */
+//#define FATFS_CACHE_ADDR		0xD0600000
+
 //#define FATFS_DEBUG_SEND_USART(x)	TM_USART_Puts(USART6, x); TM_USART_Puts(USART6, "\n");
 #define FATFS_DEBUG_SEND_USART(x)
 
@@ -46,6 +77,19 @@ typedef struct {
 	DRESULT (*disk_read)(BYTE *, DWORD, UINT);
 } DISKIO_LowLevelDriver_t;
 
+/**
+ * @brief  Sector cache statistics for one drive
+ */
+typedef struct {
+	DWORD ReadHits;       /*!< Number of sectors read from cache */
+	DWORD ReadMisses;     /*!< Number of sectors read from driver */
+	DWORD WriteHits;      /*!< Number of sectors written to already cached sectors */
+	DWORD WriteMisses;    /*!< Number of sectors written to new cache sectors or directly to driver */
+	DWORD DriverReads;    /*!< Number of read calls to driver */
+	DWORD DriverWrites;   /*!< Number of write calls to driver */
+	DWORD SectorsWritten; /*!< Number of sectors written to driver */
+} TM_FATFS_CacheStats_t;
+
 /**
  * @brief  Custom drivers for fatfs
  */
@@ -66,6 +110,7 @@ typedef enum {
 #define GET_SECTOR_SIZE		2	/* Get sector size (for multiple sector size (_MAX_SS >= 1024)) */
 #define GET_BLOCK_SIZE		3	/* Get erase block size (for only f_mkfs()) */
 #define CTRL_ERASE_SECTOR	4	/* Force erased a block of sectors (for only _USE_ERASE) */
+#define CTRL_TRIM			4	/* Inform device that the data on the block of sectors is no longer used (for only _USE_TRIM) */
 
 /* Generic command (not used by FatFs) */
 #define CTRL_POWER			5	/* Get/Set power status */
@@ -100,6 +145,31 @@ typedef enum {
  */
 void TM_FATFS_AddDriver(DISKIO_LowLevelDriver_t* Driver, TM_FATFS_Driver_t DriverName);
 
+#if FATFS_USE_CACHE == 1
+/**
+ * @brief  Writes all dirty cached sectors of drive to driver
+ * @note   Called also by FatFs with CTRL_SYNC, for example on f_sync() and f_close()
+ * @param  pdrv: Physical drive number
+ * @retval Member of @ref DRESULT enumeration
+ */
+DRESULT TM_FATFS_CacheFlush(BYTE pdrv);
+
+/**
+ * @brief  Gets sector cache statistics for drive
+ * @param  pdrv: Physical drive number
+ * @param  *Stats: Pointer to @ref TM_FATFS_CacheStats_t structure to store statistics to
+ * @retval None
+ */
+void TM_FATFS_CacheGetStats(BYTE pdrv, TM_FATFS_CacheStats_t* Stats);
+
+/**
+ * @brief  Resets sector cache statistics for drive
+ * @param  pdrv: Physical drive number
+ * @retval None
+ */
+void TM_FATFS_CacheResetStats(BYTE pdrv);
+#endif
+
 /* Drivers function declarations */
 DSTATUS TM_FATFS_SD_SDIO_disk_initialize(void);
 DSTATUS TM_FATFS_SD_disk_initialize(void);
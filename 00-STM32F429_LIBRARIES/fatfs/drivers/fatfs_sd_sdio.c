@@ -267,6 +267,42 @@ static volatile DSTATUS TM_FATFS_SD_SDIO_Stat = STA_NOINIT;	/* Physical drive st
 
 #define BLOCK_SIZE            512
 
+/* Aligned bounce buffer for unaligned FatFs buffers */
+#ifdef FATFS_SDIO_BOUNCE_ADDR
+#define SDIO_Bounce           ((BYTE *)(FATFS_SDIO_BOUNCE_ADDR))
+#else
+static DWORD SDIO_BounceWords[FATFS_SDIO_BOUNCE_SECTORS * BLOCK_SIZE / 4];
+#define SDIO_Bounce           ((BYTE *)SDIO_BounceWords)
+#endif
+
+/* Transfer statistics */
+static TM_FATFS_SDIO_Stats_t SDIO_Stats;
+
+static DRESULT TM_FATFS_SDIO_INT_Read(BYTE *buff, DWORD sector, UINT count);
+static DRESULT TM_FATFS_SDIO_INT_Write(BYTE *buff, DWORD sector, UINT count);
+
+#if FATFS_SDIO_ASYNC == 1
+/* Asynchronous state */
+#define SDIO_ASYNC_IDLE       0	/* No request */
+#define SDIO_ASYNC_START      1	/* Request is being started */
+#define SDIO_ASYNC_DATA       2	/* Data transfer in progress */
+#define SDIO_ASYNC_BUSY       3	/* Card is programming, polled by timer */
+#define SDIO_ASYNC_STOP       4	/* Request is being finished */
+
+static TM_FATFS_SDIO_Request_t* volatile AsyncHead = NULL;
+static TM_FATFS_SDIO_Request_t* volatile AsyncTail = NULL;
+static volatile uint8_t AsyncState = SDIO_ASYNC_IDLE;
+static volatile uint32_t AsyncTime = 0;
+static TM_DELAY_Timer_t* AsyncTimer = NULL;
+
+static void TM_FATFS_SDIO_INT_Start(void);
+static void TM_FATFS_SDIO_INT_Finish(DRESULT res);
+static void TM_FATFS_SDIO_INT_CheckCard(void);
+static void TM_FATFS_SDIO_INT_DataDone(void);
+static void TM_FATFS_SDIO_INT_Timer(void* UserParameters);
+static DRESULT TM_FATFS_SDIO_INT_Wait(BYTE *buff, DWORD sector, UINT count, uint8_t write);
+#endif
+
 uint8_t TM_FATFS_SDIO_WriteEnabled(void) {
 #if FATFS_USE_WRITEPROTECT_PIN > 0
 	return !TM_GPIO_GetInputPinValue(FATFS_USE_WRITEPROTECT_PIN_PORT, FATFS_USE_WRITEPROTECT_PIN_PIN);
@@ -302,6 +338,13 @@ DSTATUS TM_FATFS_SD_SDIO_disk_initialize(void) {
 	SD_LowLevel_DeInit();
 	SD_LowLevel_Init();
 	
+#if FATFS_SDIO_ASYNC == 1
+	/* Card busy polling and timeout */
+	if (AsyncTimer == NULL) {
+		AsyncTimer = TM_DELAY_TimerCreate(1, 1, 1, TM_FATFS_SDIO_INT_Timer, NULL);
+	}
+#endif
+	
 	//Check disk initialized
 	if (SD_Init() == SD_OK) {
 		TM_FATFS_SD_SDIO_Stat &= ~STA_NOINIT;	/* Clear STA_NOINIT flag */
@@ -333,31 +376,94 @@ DSTATUS TM_FATFS_SD_SDIO_disk_status(void) {
 }
 
 DRESULT TM_FATFS_SD_SDIO_disk_read(BYTE *buff, DWORD sector, UINT count) {
-	SD_Error Status = SD_OK;
+	DRESULT res = RES_OK;
+	UINT n;
 
 	if ((TM_FATFS_SD_SDIO_Stat & STA_NOINIT)) {
 		return RES_NOTRDY;
 	}
 	
 	if ((DWORD)buff & 3) {
-		DRESULT res = RES_OK;
-		DWORD scratch[BLOCK_SIZE / 4];
+		/* DMA needs aligned buffer, read as many sectors as possible to bounce buffer with one command */
+		SDIO_Stats.UnalignedReads++;
+		while (count) {
+			n = count > FATFS_SDIO_BOUNCE_SECTORS ? FATFS_SDIO_BOUNCE_SECTORS : count;
+			
+			res = TM_FATFS_SDIO_INT_Read(SDIO_Bounce, sector, n);
+			if (res != RES_OK) {
+				break;
+			}
+
+			memcpy(buff, SDIO_Bounce, n * BLOCK_SIZE);
+			SDIO_Stats.BounceSectors += n;
+
+			buff += n * BLOCK_SIZE;
+			sector += n;
+			count -= n;
+		}
+
+		return res;
+	}
+
+	/* Read directly to buffer */
+	SDIO_Stats.AlignedReads++;
+	return TM_FATFS_SDIO_INT_Read(buff, sector, count);
+}
+
+DRESULT TM_FATFS_SD_SDIO_disk_write(const BYTE *buff, DWORD sector, UINT count) {
+	DRESULT res = RES_OK;
+	UINT n;
+
+	if (!TM_FATFS_SDIO_WriteEnabled()) {
+		return RES_WRPRT;
+	}
 
-		while (count--) {
-			res = TM_FATFS_SD_SDIO_disk_read((void *)scratch, sector++, 1);
+	if (SD_Detect() != SD_PRESENT) {
+		return RES_NOTRDY;
+	}
 
+	if ((DWORD)buff & 3) {
+		/* DMA needs aligned buffer, write as many sectors as possible from bounce buffer with one command */
+		SDIO_Stats.UnalignedWrites++;
+		while (count) {
+			n = count > FATFS_SDIO_BOUNCE_SECTORS ? FATFS_SDIO_BOUNCE_SECTORS : count;
+			
+			memcpy(SDIO_Bounce, buff, n * BLOCK_SIZE);
+			SDIO_Stats.BounceSectors += n;
+
+			res = TM_FATFS_SDIO_INT_Write(SDIO_Bounce, sector, n);
 			if (res != RES_OK) {
 				break;
 			}
 
-			memcpy(buff, scratch, BLOCK_SIZE);
-
-			buff += BLOCK_SIZE;
+			buff += n * BLOCK_SIZE;
+			sector += n;
+			count -= n;
 		}
 
 		return res;
 	}
 
+	/* Write directly from buffer */
+	SDIO_Stats.AlignedWrites++;
+	return TM_FATFS_SDIO_INT_Write((BYTE *)buff, sector, count);
+}
+
+void TM_FATFS_SDIO_GetStats(TM_FATFS_SDIO_Stats_t* Stats) {
+	memcpy(Stats, &SDIO_Stats, sizeof(TM_FATFS_SDIO_Stats_t));
+}
+
+void TM_FATFS_SDIO_ResetStats(void) {
+	memset(&SDIO_Stats, 0, sizeof(TM_FATFS_SDIO_Stats_t));
+}
+
+static DRESULT TM_FATFS_SDIO_INT_Read(BYTE *buff, DWORD sector, UINT count) {
+#if FATFS_SDIO_ASYNC == 1
+	/* Use request queue and wait */
+	return TM_FATFS_SDIO_INT_Wait(buff, sector, count, 0);
+#else
+	SD_Error Status = SD_OK;
+
 	Status = SD_ReadMultiBlocks(buff, sector << 9, BLOCK_SIZE, count);
 
 	if (Status == SD_OK) {
@@ -375,37 +481,16 @@ DRESULT TM_FATFS_SD_SDIO_disk_read(BYTE *buff, DWORD sector, UINT count) {
 	} else {
 		return RES_ERROR;
 	}
+#endif
 }
 
-DRESULT TM_FATFS_SD_SDIO_disk_write(const BYTE *buff, DWORD sector, UINT count) {
+static DRESULT TM_FATFS_SDIO_INT_Write(BYTE *buff, DWORD sector, UINT count) {
+#if FATFS_SDIO_ASYNC == 1
+	/* Use request queue and wait */
+	return TM_FATFS_SDIO_INT_Wait(buff, sector, count, 1);
+#else
 	SD_Error Status = SD_OK;
 
-	if (!TM_FATFS_SDIO_WriteEnabled()) {
-		return RES_WRPRT;
-	}
-
-	if (SD_Detect() != SD_PRESENT) {
-		return RES_NOTRDY;
-	}
-
-	if ((DWORD)buff & 3) {
-		DRESULT res = RES_OK;
-		DWORD scratch[BLOCK_SIZE / 4];
-
-		while (count--) {
-			memcpy(scratch, buff, BLOCK_SIZE);
-			res = TM_FATFS_SD_SDIO_disk_write((void *)scratch, sector++, 1);
-
-			if (res != RES_OK) {
-				break;
-			}
-
-			buff += BLOCK_SIZE;
-		}
-
-		return(res);
-	}
-
 	Status = SD_WriteMultiBlocks((uint8_t *)buff, sector << 9, BLOCK_SIZE, count); // 4GB Compliant
 
 	if (Status == SD_OK) {
@@ -423,6 +508,7 @@ DRESULT TM_FATFS_SD_SDIO_disk_write(const BYTE *buff, DWORD sector, UINT count)
 	} else {
 		return RES_ERROR;
 	}
+#endif
 }
 
 DRESULT TM_FATFS_SD_SDIO_disk_ioctl(BYTE cmd, void *buff) {
@@ -443,17 +529,267 @@ DRESULT TM_FATFS_SD_SDIO_disk_ioctl(BYTE cmd, void *buff) {
 
 void SDIO_IRQHandler(void) {
 	SD_ProcessIRQSrc();
+#if FATFS_SDIO_ASYNC == 1
+	TM_FATFS_SDIO_INT_DataDone();
+#endif
 }
 
 #ifdef SD_SDIO_DMA_STREAM3
 void DMA2_Stream3_IRQHandler(void) {
 	SD_ProcessDMAIRQ();
+#if FATFS_SDIO_ASYNC == 1
+	TM_FATFS_SDIO_INT_DataDone();
+#endif
 }
 #endif
 
 #ifdef SD_SDIO_DMA_STREAM6
 void DMA2_Stream6_IRQHandler(void) {
 	SD_ProcessDMAIRQ();
+#if FATFS_SDIO_ASYNC == 1
+	TM_FATFS_SDIO_INT_DataDone();
+#endif
+}
+#endif
+
+#if FATFS_SDIO_ASYNC == 1
+DRESULT TM_FATFS_SDIO_Submit(TM_FATFS_SDIO_Request_t* Request) {
+	uint8_t start = 0;
+	
+	/* Check card */
+	if (TM_FATFS_SD_SDIO_Stat & STA_NOINIT) {
+		return RES_NOTRDY;
+	}
+	if (Request->Write && !TM_FATFS_SDIO_WriteEnabled()) {
+		return RES_WRPRT;
+	}
+	
+	/* DMA needs aligned buffer */
+	if (Request->Count == 0 || ((uint32_t)Request->Buffer & 3)) {
+		return RES_PARERR;
+	}
+	
+	/* Reset request */
+	Request->Done = 0;
+	Request->Result = RES_OK;
+	Request->Next = NULL;
+	
+	/* Add to the end of queue */
+	__disable_irq();
+	if (AsyncTail) {
+		AsyncTail->Next = Request;
+	} else {
+		AsyncHead = Request;
+	}
+	AsyncTail = Request;
+	
+	/* Start it if SDIO is free */
+	if (AsyncState == SDIO_ASYNC_IDLE) {
+		AsyncState = SDIO_ASYNC_START;
+		start = 1;
+	}
+	__enable_irq();
+	
+	/* Start request */
+	if (start) {
+		TM_FATFS_SDIO_INT_Start();
+	}
+	
+	/* Return OK */
+	return RES_OK;
+}
+
+uint8_t TM_FATFS_SDIO_Busy(void) {
+	return AsyncState != SDIO_ASYNC_IDLE;
+}
+
+static void TM_FATFS_SDIO_INT_Start(void) {
+	TM_FATFS_SDIO_Request_t* req = AsyncHead;
+	SD_Error Status;
+	
+	/* Card removed */
+	if (SD_Detect() != SD_PRESENT) {
+		TM_FATFS_SDIO_INT_Finish(RES_NOTRDY);
+		return;
+	}
+	
+	/* Data phase is finished in SDIO and DMA interrupts */
+	AsyncTime = 0;
+	DMAEndOfTransfer = 0;
+	AsyncState = SDIO_ASYNC_DATA;
+	
+	/* Send commands and start DMA */
+	if (req->Write) {
+		Status = SD_WriteMultiBlocks(req->Buffer, (uint64_t)req->Sector << 9, BLOCK_SIZE, req->Count);
+	} else {
+		Status = SD_ReadMultiBlocks(req->Buffer, (uint64_t)req->Sector << 9, BLOCK_SIZE, req->Count);
+	}
+	
+	/* Command failed, data will not come */
+	if (Status != SD_OK) {
+		__disable_irq();
+		if (AsyncState != SDIO_ASYNC_DATA) {
+			/* Already handled in interrupt */
+			__enable_irq();
+			return;
+		}
+		AsyncState = SDIO_ASYNC_STOP;
+		__enable_irq();
+		
+		/* Stop DMA */
+		SDIO->MASK = 0;
+		SDIO->DCTRL = 0;
+		DMA_Cmd(SD_SDIO_DMA_STREAM, DISABLE);
+		SDIO->ICR = SDIO_STATIC_FLAGS;
+		TM_FATFS_SDIO_INT_Finish(RES_ERROR);
+	}
+}
+
+static void TM_FATFS_SDIO_INT_Finish(DRESULT res) {
+	TM_FATFS_SDIO_Request_t* req;
+	uint8_t start = 0;
+	
+	/* Remove request from queue */
+	__disable_irq();
+	req = AsyncHead;
+	AsyncHead = req->Next;
+	if (AsyncHead == NULL) {
+		AsyncTail = NULL;
+		AsyncState = SDIO_ASYNC_IDLE;
+	} else {
+		/* Next request is started by us */
+		AsyncState = SDIO_ASYNC_START;
+		start = 1;
+	}
+	__enable_irq();
+	
+	/* Request is done */
+	req->Result = res;
+	req->Done = 1;
+	if (req->Callback) {
+		req->Callback(req);
+	}
+	
+	/* Start next request */
+	if (start) {
+		TM_FATFS_SDIO_INT_Start();
+	}
+}
+
+static void TM_FATFS_SDIO_INT_CheckCard(void) {
+	SDTransferState State;
+	
+	/* Check if card finished programming */
+	State = SD_GetStatus();
+	if (State == SD_TRANSFER_OK) {
+		TM_FATFS_SDIO_INT_Finish(RES_OK);
+	} else if (State == SD_TRANSFER_ERROR) {
+		TM_FATFS_SDIO_INT_Finish(RES_ERROR);
+	} else {
+		/* Timer will check again */
+		AsyncState = SDIO_ASYNC_BUSY;
+	}
+}
+
+static void TM_FATFS_SDIO_INT_DataDone(void) {
+	SD_Error Status;
+	
+	/* Wait for SDIO data end and DMA end, or error */
+	__disable_irq();
+	if (
+		AsyncState != SDIO_ASYNC_DATA ||
+		(TransferError == SD_OK && (!TransferEnd || !DMAEndOfTransfer))
+	) {
+		__enable_irq();
+		return;
+	}
+	AsyncState = SDIO_ASYNC_STOP;
+	__enable_irq();
+	
+	/* Data phase done */
+	Status = TransferError;
+	TransferEnd = 0;
+	DMAEndOfTransfer = 0;
+	
+	/* Send CMD12 */
+	if (StopCondition == 1) {
+		if (SD_StopTransfer() != SD_OK && Status == SD_OK) {
+			Status = SD_ERROR;
+		}
+		StopCondition = 0;
+	}
+	
+	/* Clear all the static flags */
+	SDIO->ICR = SDIO_STATIC_FLAGS;
+	
+	/* Check error */
+	if (Status != SD_OK) {
+		DMA_Cmd(SD_SDIO_DMA_STREAM, DISABLE);
+		TM_FATFS_SDIO_INT_Finish(RES_ERROR);
+		return;
+	}
+	
+	/* Check card state */
+	TM_FATFS_SDIO_INT_CheckCard();
+}
+
+static void TM_FATFS_SDIO_INT_Timer(void* UserParameters) {
+	/* Called every 1 ms from SysTick */
+	if (AsyncState == SDIO_ASYNC_BUSY) {
+		/* Poll card state */
+		AsyncState = SDIO_ASYNC_STOP;
+		if (++AsyncTime > FATFS_SDIO_ASYNC_TIMEOUT) {
+			TM_FATFS_SDIO_INT_Finish(RES_ERROR);
+		} else {
+			TM_FATFS_SDIO_INT_CheckCard();
+		}
+	} else if (AsyncState == SDIO_ASYNC_DATA) {
+		/* Check data timeout */
+		if (++AsyncTime <= FATFS_SDIO_ASYNC_TIMEOUT) {
+			return;
+		}
+		__disable_irq();
+		if (AsyncState != SDIO_ASYNC_DATA) {
+			__enable_irq();
+			return;
+		}
+		AsyncState = SDIO_ASYNC_STOP;
+		__enable_irq();
+		
+		/* Abort transfer */
+		SDIO->MASK = 0;
+		SDIO->DCTRL = 0;
+		DMA_Cmd(SD_SDIO_DMA_STREAM, DISABLE);
+		SD_StopTransfer();
+		StopCondition = 0;
+		SDIO->ICR = SDIO_STATIC_FLAGS;
+		TM_FATFS_SDIO_INT_Finish(RES_ERROR);
+	}
+}
+
+static DRESULT TM_FATFS_SDIO_INT_Wait(BYTE *buff, DWORD sector, UINT count, uint8_t write) {
+	TM_FATFS_SDIO_Request_t req;
+	DRESULT res;
+	
+	/* Fill request */
+	req.Buffer = buff;
+	req.Sector = sector;
+	req.Count = count;
+	req.Write = write;
+	req.Callback = NULL;
+	req.UserParameters = NULL;
+	
+	/* Add to queue */
+	res = TM_FATFS_SDIO_Submit(&req);
+	if (res != RES_OK) {
+		return res;
+	}
+	
+	/* Wait till done */
+	while (!req.Done);
+	
+	/* Return result */
+	return req.Result;
 }
 #endif
 
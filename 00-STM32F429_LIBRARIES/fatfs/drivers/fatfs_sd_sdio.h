@@ -57,6 +57,25 @@
 #define FATFS_SDIO_4BIT						1
 #endif
 
+/* Number of sectors in aligned bounce buffer for unaligned buffers, 32 sectors = 16kB */
+#ifndef FATFS_SDIO_BOUNCE_SECTORS
+#define FATFS_SDIO_BOUNCE_SECTORS			8
+#endif
+
+/* Set bounce buffer address if you want it outside of internal SRAM, CCM RAM can not be used with DMA */
+/* Check SDRAM memory map in TM SDRAM library for free area */
+//#define FATFS_SDIO_BOUNCE_ADDR			0xD0780000
+
+/* Asynchronous transfers with request queue, TM DELAY must be initialized */
+#ifndef FATFS_SDIO_ASYNC
+#define FATFS_SDIO_ASYNC					0
+#endif
+
+/* Maximal time for one request in units of milliseconds */
+#ifndef FATFS_SDIO_ASYNC_TIMEOUT
+#define FATFS_SDIO_ASYNC_TIMEOUT			1000
+#endif
+
 #if FATFS_USE_DETECT_PIN > 0
 #ifndef FATFS_USE_DETECT_PIN_PIN		
 #define FATFS_USE_DETECT_PIN_PORT			GPIOB
@@ -515,6 +534,65 @@ extern SD_Error SD_WaitReadOperation (void);
 extern SD_Error SD_WaitWriteOperation (void);
 extern SD_Error SD_HighSpeed (void);
 
+/**
+ * @brief  SDIO transfer statistics, counted for FatFs disk_read and disk_write calls
+ */
+typedef struct {
+	uint32_t AlignedReads;    /*!< Number of reads directly to FatFs buffer */
+	uint32_t AlignedWrites;   /*!< Number of writes directly from FatFs buffer */
+	uint32_t UnalignedReads;  /*!< Number of reads through bounce buffer */
+	uint32_t UnalignedWrites; /*!< Number of writes through bounce buffer */
+	uint32_t BounceSectors;   /*!< Number of sectors copied through bounce buffer */
+} TM_FATFS_SDIO_Stats_t;
+
+/**
+ * @brief  Gets SDIO transfer statistics
+ * @param  *Stats: Pointer to @ref TM_FATFS_SDIO_Stats_t structure to store statistics to
+ * @retval None
+ */
+void TM_FATFS_SDIO_GetStats(TM_FATFS_SDIO_Stats_t* Stats);
+
+/**
+ * @brief  Resets SDIO transfer statistics
+ * @param  None
+ * @retval None
+ */
+void TM_FATFS_SDIO_ResetStats(void);
+
+#if FATFS_SDIO_ASYNC == 1
+/**
+ * @brief  Asynchronous SDIO block request
+ * @note   Structure must stay valid until request is done
+ */
+typedef struct _TM_FATFS_SDIO_Request_t {
+	uint8_t* Buffer;          /*!< Pointer to data, must be 4-bytes aligned */
+	DWORD Sector;             /*!< First sector on card */
+	UINT Count;               /*!< Number of sectors */
+	uint8_t Write;            /*!< Set to 1 for write request or 0 for read request */
+	void (*Callback)(struct _TM_FATFS_SDIO_Request_t* Request); /*!< Called from interrupt when request is done. Set to NULL if not used */
+	void* UserParameters;     /*!< Pointer to user parameters for callback */
+	volatile DRESULT Result;  /*!< Request result, valid when Done is set */
+	volatile uint8_t Done;    /*!< Set to 1 when request is done */
+	struct _TM_FATFS_SDIO_Request_t* Next; /*!< Internal, next request in queue */
+} TM_FATFS_SDIO_Request_t;
+
+/**
+ * @brief  Adds request to queue, requests are executed in order of submission
+ * @note   Function returns immediately. Data transfer is done by SDIO and DMA interrupts,
+ *         card busy state after write is checked every 1 ms with TM DELAY timer
+ * @param  *Request: Pointer to @ref TM_FATFS_SDIO_Request_t request with Buffer, Sector, Count, Write and Callback filled
+ * @retval RES_OK if request is queued, otherwise request is not queued and callback is not called
+ */
+DRESULT TM_FATFS_SDIO_Submit(TM_FATFS_SDIO_Request_t* Request);
+
+/**
+ * @brief  Checks if any request is in queue or in progress
+ * @param  None
+ * @retval 1 if busy, 0 otherwise
+ */
+uint8_t TM_FATFS_SDIO_Busy(void);
+#endif
+
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
 
 #endif
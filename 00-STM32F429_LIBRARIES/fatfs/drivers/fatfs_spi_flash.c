@@ -1,30 +1,122 @@
-/**	
+/**
  * |----------------------------------------------------------------------
  * | Copyright (C) Tilen MAJERLE, 2015
- * | 
+ * |
  * | This program is free software: you can redistribute it and/or modify
  * | it under the terms of the GNU General Public License as published by
  * | the Free Software Foundation, either version 3 of the License, or
  * | any later version.
- * |  
+ * |
  * | This program is distributed in the hope that it will be useful,
  * | but WITHOUT ANY WARRANTY; without even the implied warranty of
  * | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
  * | GNU General Public License for more details.
- * | 
+ * |
  * | You should have received a copy of the GNU General Public License
  * | along with this program.  If not, see <http://www.gnu.org/licenses/>.
  * |----------------------------------------------------------------------
  */
 #include "fatfs_spi_flash.h"
 
+/* Flash commands */
+#define SPI_FLASH_CMD_WRITE_ENABLE		0x06
+#define SPI_FLASH_CMD_READ_STATUS		0x05
+#define SPI_FLASH_CMD_FAST_READ			0x0B
+#define SPI_FLASH_CMD_PAGE_PROGRAM		0x02
+#define SPI_FLASH_CMD_SECTOR_ERASE		0x20
+#define SPI_FLASH_CMD_JEDEC_ID			0x9F
+#define SPI_FLASH_CMD_RELEASE_PD		0xAB
+
+/* Status register bits */
+#define SPI_FLASH_STATUS_BUSY			0x01
+
+/* Page size for page program command */
+#define SPI_FLASH_PAGE_SIZE				256
+
+/* Maximal size with 3-byte addresses */
+#define SPI_FLASH_MAX_SIZE				(16 * 1024 * 1024)
+
 /* Status for SPIFLASH */
 static volatile DSTATUS SPI_FLASH_Status = STA_NOINIT;
 
+/* JEDEC ID */
+static uint32_t SPI_FLASH_ID;
+
+/* Private functions */
+static void TM_FATFS_SPI_FLASH_INT_Command(uint8_t cmd, uint32_t address);
+static void TM_FATFS_SPI_FLASH_INT_Transfer(uint8_t* tx, uint8_t* rx, uint32_t count);
+static DRESULT TM_FATFS_SPI_FLASH_INT_WaitReady(uint32_t timeout);
+static DRESULT TM_FATFS_SPI_FLASH_INT_Read(uint32_t address, uint8_t* data, uint32_t count);
+static DRESULT TM_FATFS_SPI_FLASH_INT_Program(uint32_t address, const uint8_t* data, uint32_t count);
+static DRESULT TM_FATFS_SPI_FLASH_INT_Erase(uint32_t address);
+
+/* Flash functions for FTL */
+static TM_FATFS_FTL_Flash_t SPI_FLASH_Flash = {
+	TM_FATFS_SPI_FLASH_INT_Read,
+	TM_FATFS_SPI_FLASH_INT_Program,
+	TM_FATFS_SPI_FLASH_INT_Erase,
+	0
+};
+
 DSTATUS TM_FATFS_SPI_FLASH_disk_initialize(void) {
-	/* Clear NOINIT flag */
-	//SPI_FLASH_Status &= ~STA_NOINIT;
-	
+	uint8_t id[3];
+
+	/* Already initialized */
+	if (!(SPI_FLASH_Status & STA_NOINIT)) {
+		return SPI_FLASH_Status;
+	}
+
+	/* Init delay functions */
+	TM_DELAY_Init();
+
+	/* Init CS pin */
+	TM_GPIO_Init(FATFS_SPI_FLASH_CS_PORT, FATFS_SPI_FLASH_CS_PIN, TM_GPIO_Mode_OUT, TM_GPIO_OType_PP, TM_GPIO_PuPd_NOPULL, TM_GPIO_Speed_High);
+	FATFS_SPI_FLASH_CS_HIGH;
+
+	/* Init SPI, mode 0 */
+	TM_SPI_InitFull(
+		FATFS_SPI_FLASH_SPI,
+		FATFS_SPI_FLASH_SPI_PINSPACK,
+		TM_SPI_GetPrescalerFromMaxFrequency(FATFS_SPI_FLASH_SPI, FATFS_SPI_FLASH_SPI_FREQUENCY),
+		TM_SPI_Mode_0,
+		SPI_Mode_Master,
+		SPI_FirstBit_MSB
+	);
+#if FATFS_SPI_FLASH_USE_DMA == 1
+	TM_SPI_DMA_Init(FATFS_SPI_FLASH_SPI);
+#endif
+
+	/* Wake up from deep power down */
+	FATFS_SPI_FLASH_CS_LOW;
+	TM_SPI_Send(FATFS_SPI_FLASH_SPI, SPI_FLASH_CMD_RELEASE_PD);
+	FATFS_SPI_FLASH_CS_HIGH;
+	Delayms(1);
+
+	/* Read JEDEC ID */
+	FATFS_SPI_FLASH_CS_LOW;
+	TM_SPI_Send(FATFS_SPI_FLASH_SPI, SPI_FLASH_CMD_JEDEC_ID);
+	TM_SPI_ReadMulti(FATFS_SPI_FLASH_SPI, id, 0xFF, 3);
+	FATFS_SPI_FLASH_CS_HIGH;
+	SPI_FLASH_ID = (uint32_t)id[0] << 16 | (uint32_t)id[1] << 8 | id[2];
+
+	/* Check if flash responds, capacity byte is log2 of size */
+	if (id[0] == 0x00 || id[0] == 0xFF || id[2] < 16 || id[2] > 31) {
+		return SPI_FLASH_Status;
+	}
+	SPI_FLASH_Flash.Size = (uint32_t)1 << id[2];
+	if (SPI_FLASH_Flash.Size > SPI_FLASH_MAX_SIZE) {
+		SPI_FLASH_Flash.Size = SPI_FLASH_MAX_SIZE;
+	}
+
+	/* Wait for previous operation and mount FTL */
+	if (
+		TM_FATFS_SPI_FLASH_INT_WaitReady(FATFS_SPI_FLASH_ERASE_TIMEOUT) == RES_OK &&
+		TM_FATFS_FTL_Init(&SPI_FLASH_Flash) == RES_OK
+	) {
+		/* Clear NOINIT flag */
+		SPI_FLASH_Status &= ~STA_NOINIT;
+	}
+
 	/* Return status */
 	return SPI_FLASH_Status;
 }
@@ -35,31 +127,174 @@ DSTATUS TM_FATFS_SPI_FLASH_disk_status(void) {
 }
 
 DRESULT TM_FATFS_SPI_FLASH_disk_ioctl(BYTE cmd, void *buff) {
+	/* Check status */
+	if (SPI_FLASH_Status & STA_NOINIT) {
+		return RES_NOTRDY;
+	}
+
 	/* Get command */
 	switch (cmd) {
 		case GET_SECTOR_COUNT:	/* Get drive capacity in unit of sector (DWORD) */
-			//*(WORD *)buff = SPI_FLASH_MEMORY_SIZE / FATFS_SPI_FLASH_SECTOR_SIZE;
+			*(DWORD *)buff = TM_FATFS_FTL_GetSectorCount();
+			break;
+		case GET_SECTOR_SIZE:	/* Get sector size in unit of bytes (WORD) */
+			*(WORD *)buff = FATFS_SPI_FLASH_SECTOR_SIZE;
 			break;
 		case GET_BLOCK_SIZE:	/* Get erase block size in unit of sector (DWORD) */
-			//*(DWORD *)buff = 32;
+			/* FTL maps each sector separately, no alignment needed */
+			*(DWORD *)buff = 1;
 			break;
-		case CTRL_SYNC:
-		case CTRL_ERASE_SECTOR:
+		case CTRL_SYNC:			/* Data is on flash when write returns */
 			break;
+		case CTRL_ERASE_SECTOR:	/* Trim, sectors are not used anymore */
+			return TM_FATFS_FTL_Trim(((DWORD *)buff)[0], ((DWORD *)buff)[1]);
 		default:
-			break;
+			return RES_PARERR;
 	}
-	
-	/* Return ERROR */
-	return RES_ERROR;
+
+	/* Return OK */
+	return RES_OK;
 }
 
 DRESULT TM_FATFS_SPI_FLASH_disk_read(BYTE *buff, DWORD sector, UINT count) {
-	/* Future use */
-	return RES_ERROR;
+	/* Check status */
+	if (SPI_FLASH_Status & STA_NOINIT) {
+		return RES_NOTRDY;
+	}
+
+	/* Read through FTL */
+	return TM_FATFS_FTL_Read(buff, sector, count);
 }
 
 DRESULT TM_FATFS_SPI_FLASH_disk_write(const BYTE *buff, DWORD sector, UINT count) {
-	/* Future use */
-	return RES_ERROR;
+	/* Check status */
+	if (SPI_FLASH_Status & STA_NOINIT) {
+		return RES_NOTRDY;
+	}
+
+	/* Write through FTL */
+	return TM_FATFS_FTL_Write(buff, sector, count);
+}
+
+uint32_t TM_FATFS_SPI_FLASH_GetID(void) {
+	/* Return JEDEC ID */
+	return SPI_FLASH_ID;
+}
+
+/*******************************************************************/
+/*                   SPI FLASH INTERNAL FUNCTIONS                  */
+/*******************************************************************/
+static void TM_FATFS_SPI_FLASH_INT_Command(uint8_t cmd, uint32_t address) {
+	/* Send command and 3-byte address */
+	TM_SPI_Send(FATFS_SPI_FLASH_SPI, cmd);
+	TM_SPI_Send(FATFS_SPI_FLASH_SPI, (address >> 16) & 0xFF);
+	TM_SPI_Send(FATFS_SPI_FLASH_SPI, (address >> 8) & 0xFF);
+	TM_SPI_Send(FATFS_SPI_FLASH_SPI, address & 0xFF);
+}
+
+static void TM_FATFS_SPI_FLASH_INT_Transfer(uint8_t* tx, uint8_t* rx, uint32_t count) {
+#if FATFS_SPI_FLASH_USE_DMA == 1
+	/* DMA can not access CCM RAM */
+	if (
+		count >= FATFS_SPI_FLASH_DMA_MIN &&
+		((uint32_t)tx & 0xFFFF0000) != CCMDATARAM_BASE &&
+		((uint32_t)rx & 0xFFFF0000) != CCMDATARAM_BASE
+	) {
+		/* Start DMA and wait to finish */
+		if (TM_SPI_DMA_Transmit(FATFS_SPI_FLASH_SPI, tx, rx, count)) {
+			while (TM_SPI_DMA_Working(FATFS_SPI_FLASH_SPI));
+			return;
+		}
+	}
+#endif
+
+	/* Transfer with CPU */
+	if (rx) {
+		TM_SPI_ReadMulti(FATFS_SPI_FLASH_SPI, rx, 0xFF, count);
+	} else {
+		TM_SPI_WriteMulti(FATFS_SPI_FLASH_SPI, tx, count);
+	}
+}
+
+static DRESULT TM_FATFS_SPI_FLASH_INT_WaitReady(uint32_t timeout) {
+	uint32_t start = TM_DELAY_Time();
+	uint8_t status;
+
+	/* Read status register until flash is not busy */
+	FATFS_SPI_FLASH_CS_LOW;
+	TM_SPI_Send(FATFS_SPI_FLASH_SPI, SPI_FLASH_CMD_READ_STATUS);
+	do {
+		status = TM_SPI_Send(FATFS_SPI_FLASH_SPI, 0xFF);
+	} while ((status & SPI_FLASH_STATUS_BUSY) && (TM_DELAY_Time() - start) <= timeout);
+	FATFS_SPI_FLASH_CS_HIGH;
+
+	/* Check status */
+	if (status & SPI_FLASH_STATUS_BUSY) {
+		return RES_ERROR;
+	}
+
+	/* Return OK */
+	return RES_OK;
+}
+
+static DRESULT TM_FATFS_SPI_FLASH_INT_Read(uint32_t address, uint8_t* data, uint32_t count) {
+	/* Fast read, 1 dummy byte after address */
+	FATFS_SPI_FLASH_CS_LOW;
+	TM_FATFS_SPI_FLASH_INT_Command(SPI_FLASH_CMD_FAST_READ, address);
+	TM_SPI_Send(FATFS_SPI_FLASH_SPI, 0xFF);
+	TM_FATFS_SPI_FLASH_INT_Transfer(NULL, data, count);
+	FATFS_SPI_FLASH_CS_HIGH;
+
+	/* Return OK */
+	return RES_OK;
+}
+
+static DRESULT TM_FATFS_SPI_FLASH_INT_Program(uint32_t address, const uint8_t* data, uint32_t count) {
+	uint32_t n;
+
+	while (count) {
+		/* Program can not cross page boundary */
+		n = SPI_FLASH_PAGE_SIZE - (address % SPI_FLASH_PAGE_SIZE);
+		if (n > count) {
+			n = count;
+		}
+
+		/* Enable write */
+		FATFS_SPI_FLASH_CS_LOW;
+		TM_SPI_Send(FATFS_SPI_FLASH_SPI, SPI_FLASH_CMD_WRITE_ENABLE);
+		FATFS_SPI_FLASH_CS_HIGH;
+
+		/* Program page */
+		FATFS_SPI_FLASH_CS_LOW;
+		TM_FATFS_SPI_FLASH_INT_Command(SPI_FLASH_CMD_PAGE_PROGRAM, address);
+		TM_FATFS_SPI_FLASH_INT_Transfer((uint8_t *)data, NULL, n);
+		FATFS_SPI_FLASH_CS_HIGH;
+
+		/* Wait to finish */
+		if (TM_FATFS_SPI_FLASH_INT_WaitReady(FATFS_SPI_FLASH_PROGRAM_TIMEOUT) != RES_OK) {
+			return RES_ERROR;
+		}
+
+		address += n;
+		data += n;
+		count -= n;
+	}
+
+	/* Return OK */
+	return RES_OK;
+}
+
+static DRESULT TM_FATFS_SPI_FLASH_INT_Erase(uint32_t address) {
+	/* Enable write */
+	FATFS_SPI_FLASH_CS_LOW;
+	TM_SPI_Send(FATFS_SPI_FLASH_SPI, SPI_FLASH_CMD_WRITE_ENABLE);
+	FATFS_SPI_FLASH_CS_HIGH;
+
+	/* Erase 4kB sector */
+	FATFS_SPI_FLASH_CS_LOW;
+	TM_FATFS_SPI_FLASH_INT_Command(SPI_FLASH_CMD_SECTOR_ERASE, address);
+	FATFS_SPI_FLASH_CS_HIGH;
+
+	/* Wait to finish */
+	return TM_FATFS_SPI_FLASH_INT_WaitReady(FATFS_SPI_FLASH_ERASE_TIMEOUT);
 }
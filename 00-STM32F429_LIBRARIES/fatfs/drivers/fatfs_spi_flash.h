@@ -2,37 +2,37 @@
  * @author  Tilen MAJERLE
  * @email   tilen@majerle.eu
  * @website http://stm32f4-discovery.net
- * @link    
- * @version v1.0
+ * @link
+ * @version v1.1
  * @ide     Keil uVision
  * @license GNU GPL v3
  * @brief   SPI based flash low level implementation for FATFS
- *	
+ *
 @verbatim
    ----------------------------------------------------------------------
     Copyright (C) Tilen MAJERLE, 2015
-    
+
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU General Public License as published by
     the Free Software Foundation, either version 3 of the License, or
     any later version.
-     
+
     This program is distributed in the hope that it will be useful,
     but WITHOUT ANY WARRANTY; without even the implied warranty of
     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
     GNU General Public License for more details.
-    
+
     You should have received a copy of the GNU General Public License
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
    ----------------------------------------------------------------------
 @endverbatim
  */
 #ifndef TM_FATFS_SPI_FLASH_H
-#define TM_FATFS_SPI_FLASH_H 100
+#define TM_FATFS_SPI_FLASH_H 110
 
 /* C++ detection */
 #ifdef __cplusplus
-extern C {
+extern "C" {
 #endif
 
 /**
@@ -42,12 +42,61 @@ extern C {
 
 /**
  * @defgroup TM_FATFS_SPI_FLASH
- * @brief    Library description here
+ * @brief    SPI based flash low level implementation for FATFS
  * @{
+ *
+ * Driver works with serial NOR flash with standard commands (Winbond W25Qxx, Macronix MX25Lxx, Spansion S25FLxxxK, ...)
+ * with 256-byte pages and 4kB sector erase.
+ *
+ * Flash size is detected from JEDEC ID (command 0x9F), 3rd byte is log2 of size in bytes.
+ * Up to 16MB is used, because of 3-byte addresses.
+ *
+ * Data is read with fast read command (0x0B) and pages are programmed with page program command (0x02).
+ * Transfers longer than @ref FATFS_SPI_FLASH_DMA_MIN bytes use @ref TM_SPI_DMA library, if enabled.
+ *
+ * @note   STM32F429 has no QUADSPI peripheral, so quad modes of flash are not used.
+ *
+ * 512-byte FATFS sectors are mapped to 4kB erase blocks with @ref TM_FATFS_SPI_FLASH_FTL flash translation layer.
+ * It takes care of wear levelling, garbage collection, power fail safety and trim.
+ *
+ * \par Pinout
+ *
+@verbatim
+FLASH PIN    STM32F4xx         DESCRIPTION
+
+CS           PE4               Chip select, can be changed in defines.h file
+SCK          PE2               SPI4 clock, can be changed in defines.h file
+MISO (DO)    PE5               SPI4 MISO, can be changed in defines.h file
+MOSI (DI)    PE6               SPI4 MOSI, can be changed in defines.h file
+WP, HOLD     3.3V              Must be high
+@endverbatim
+ *
+ * Change settings in defines.h file:
+ *
+@verbatim
+//Select SPI and pins
+#define FATFS_SPI_FLASH_SPI              SPI4
+#define FATFS_SPI_FLASH_SPI_PINSPACK     TM_SPI_PinsPack_1
+
+//Select CS pin
+#define FATFS_SPI_FLASH_CS_PORT          GPIOE
+#define FATFS_SPI_FLASH_CS_PIN           GPIO_PIN_4
+
+//Maximal SPI clock
+#define FATFS_SPI_FLASH_SPI_FREQUENCY    45000000
+
+//Disable DMA for SPI transfers
+#define FATFS_SPI_FLASH_USE_DMA          0
+@endverbatim
  *
  * \par Changelog
  *
 @verbatim
+ Version 1.1
+  - October 19, 2026
+  - Implemented SPI NOR driver with JEDEC ID detection, fast read and page program with DMA
+  - Added flash translation layer with wear levelling, garbage collection and trim
+
  Version 1.0
   - First release
 @endverbatim
@@ -57,13 +106,22 @@ extern C {
 @verbatim
  - STM32F4xx
  - defines.h
- - TM SDRAM
+ - TM SPI
+ - TM SPI DMA
+ - TM GPIO
+ - TM DELAY
+ - fatfs_spi_flash_ftl.h
 @endverbatim
  */
 
 #include "stm32f4xx.h"
 #include "defines.h"
 #include "diskio.h"
+#include "tm_stm32f4_spi.h"
+#include "tm_stm32f4_spi_dma.h"
+#include "tm_stm32f4_gpio.h"
+#include "tm_stm32f4_delay.h"
+#include "fatfs_spi_flash_ftl.h"
 
 /**
  * @defgroup TM_FATFS_SPI_FLASH_Macros
@@ -76,20 +134,48 @@ extern C {
 #define FATFS_SPI_FLASH_SECTOR_SIZE    512
 #endif
 
-/* Memory size on flash */
-#ifndef FATFS_SPI_FLASH_MEMORY_SIZE
-#define FATFS_SPI_FLASH_MEMORY_SIZE    512
+#if FATFS_SPI_FLASH_SECTOR_SIZE != 512
+#error "FATFS_SPI_FLASH_SECTOR_SIZE must be 512 bytes"
 #endif
-/**
- * @}
- */
- 
-/**
- * @defgroup TM_FATFS_SPI_FLASH_Typedefs
- * @brief    Library Typedefs
- * @{
- */
-/* Typedefs here */
+
+/* SPI settings */
+#ifndef FATFS_SPI_FLASH_SPI
+#define FATFS_SPI_FLASH_SPI            SPI4
+#define FATFS_SPI_FLASH_SPI_PINSPACK   TM_SPI_PinsPack_1
+#endif
+
+/* Maximal SPI clock in Hz */
+#ifndef FATFS_SPI_FLASH_SPI_FREQUENCY
+#define FATFS_SPI_FLASH_SPI_FREQUENCY  45000000
+#endif
+
+/* CS pin */
+#ifndef FATFS_SPI_FLASH_CS_PIN
+#define FATFS_SPI_FLASH_CS_PORT        GPIOE
+#define FATFS_SPI_FLASH_CS_PIN         GPIO_PIN_4
+#endif
+
+/* Use DMA for long transfers */
+#ifndef FATFS_SPI_FLASH_USE_DMA
+#define FATFS_SPI_FLASH_USE_DMA        1
+#endif
+
+/* Minimal number of bytes transferred with DMA */
+#ifndef FATFS_SPI_FLASH_DMA_MIN
+#define FATFS_SPI_FLASH_DMA_MIN        32
+#endif
+
+/* Timeouts in milliseconds */
+#ifndef FATFS_SPI_FLASH_PROGRAM_TIMEOUT
+#define FATFS_SPI_FLASH_PROGRAM_TIMEOUT    10
+#endif
+#ifndef FATFS_SPI_FLASH_ERASE_TIMEOUT
+#define FATFS_SPI_FLASH_ERASE_TIMEOUT      500
+#endif
+
+#define FATFS_SPI_FLASH_CS_LOW         TM_GPIO_SetPinLow(FATFS_SPI_FLASH_CS_PORT, FATFS_SPI_FLASH_CS_PIN)
+#define FATFS_SPI_FLASH_CS_HIGH        TM_GPIO_SetPinHigh(FATFS_SPI_FLASH_CS_PORT, FATFS_SPI_FLASH_CS_PIN)
+
 /**
  * @}
  */
@@ -104,14 +190,22 @@ DSTATUS TM_FATFS_SPI_FLASH_disk_status(void);
 DRESULT TM_FATFS_SPI_FLASH_disk_ioctl(BYTE cmd, void *buff);
 DRESULT TM_FATFS_SPI_FLASH_disk_read(BYTE *buff, DWORD sector, UINT count);
 DRESULT TM_FATFS_SPI_FLASH_disk_write(const BYTE *buff, DWORD sector, UINT count);
+
+/**
+ * @brief  Gets JEDEC ID of flash, read in @ref TM_FATFS_SPI_FLASH_disk_initialize
+ * @param  None
+ * @retval Manufacturer ID in bits 23..16, memory type in bits 15..8 and capacity in bits 7..0
+ */
+uint32_t TM_FATFS_SPI_FLASH_GetID(void);
+
 /**
  * @}
  */
- 
+
 /**
  * @}
  */
- 
+
 /**
  * @}
  */
@@ -122,3 +216,4 @@ DRESULT TM_FATFS_SPI_FLASH_disk_write(const BYTE *buff, DWORD sector, UINT count
 #endif
 
 #endif
+
@@ -0,0 +1,594 @@
+/**
+ * |----------------------------------------------------------------------
+ * | Copyright (C) Tilen MAJERLE, 2015
+ * |
+ * | This program is free software: you can redistribute it and/or modify
+ * | it under the terms of the GNU General Public License as published by
+ * | the Free Software Foundation, either version 3 of the License, or
+ * | any later version.
+ * |
+ * | This program is distributed in the hope that it will be useful,
+ * | but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * | GNU General Public License for more details.
+ * |
+ * | You should have received a copy of the GNU General Public License
+ * | along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * |----------------------------------------------------------------------
+ */
+#include "fatfs_spi_flash_ftl.h"
+#include "string.h"
+#include "stddef.h"
+
+/* Block header magic number, "MFTL" */
+#define FTL_MAGIC				0x4C54464D
+
+/* Slot size, the same as FATFS sector */
+#define FTL_SLOT_SIZE			512
+
+/* Value in map for sector without data */
+#define FTL_UNMAPPED			0xFFFF
+
+/* No block */
+#define FTL_NONE				0xFFFF
+
+/* Values in valid counter array for blocks without valid count */
+#define FTL_FREE				0xFF
+#define FTL_DAMAGED				0xFE
+
+/* Static wear levelling is checked after this number of opened blocks */
+#define FTL_WEAR_INTERVAL		32
+
+/* Addresses on flash */
+#define FTL_BLOCK_ADDR(b)		((uint32_t)(b) * FATFS_SPI_FLASH_FTL_BLOCK_SIZE)
+#define FTL_TAG_ADDR(b, s)		(FTL_BLOCK_ADDR(b) + sizeof(TM_FATFS_FTL_INT_Header_t) + (s) * sizeof(TM_FATFS_FTL_INT_Tag_t))
+#define FTL_DATA_ADDR(b, s)		(FTL_BLOCK_ADDR(b) + ((s) + 1) * FTL_SLOT_SIZE)
+
+/* Block header, programmed after erase. Sequence is programmed when block is opened for writing */
+typedef struct {
+	uint32_t Magic;
+	uint32_t EraseCount;
+	uint32_t Check;
+	uint32_t Sequence;
+} TM_FATFS_FTL_INT_Header_t;
+
+/* Tag of data slot, each field is programmed once */
+typedef struct {
+	uint32_t Sector;
+	uint8_t Commit;
+	uint8_t Obsolete;
+	uint16_t Reserved;
+} TM_FATFS_FTL_INT_Tag_t;
+
+/* Metadata at the beginning of block */
+typedef struct {
+	TM_FATFS_FTL_INT_Header_t Header;
+	TM_FATFS_FTL_INT_Tag_t Tags[FATFS_SPI_FLASH_FTL_SLOTS];
+} TM_FATFS_FTL_INT_Meta_t;
+
+/* Flash functions */
+static const TM_FATFS_FTL_Flash_t* FTL_Flash;
+
+/* Map from sector to slot number, block * FATFS_SPI_FLASH_FTL_SLOTS + slot */
+static uint16_t FTL_Map[FATFS_SPI_FLASH_FTL_MAX_BLOCKS * FATFS_SPI_FLASH_FTL_SLOTS];
+
+/* Block information */
+static uint32_t FTL_EraseCount[FATFS_SPI_FLASH_FTL_MAX_BLOCKS];
+static uint8_t FTL_Valid[FATFS_SPI_FLASH_FTL_MAX_BLOCKS];
+
+/* FTL state */
+static uint32_t FTL_Blocks;
+static uint32_t FTL_Sectors;
+static uint32_t FTL_Free;
+static uint32_t FTL_Sequence;
+static uint32_t FTL_MaxErase;
+static uint16_t FTL_Current = FTL_NONE;
+static uint8_t FTL_CurrentSlot;
+static uint8_t FTL_Opens;
+static uint8_t FTL_InGC;
+
+/* Buffer for garbage collection */
+static uint8_t FTL_Buffer[FTL_SLOT_SIZE];
+
+/* Statistics */
+static TM_FATFS_FTL_Stats_t FTL_Stats;
+
+/* Private functions */
+static DRESULT TM_FATFS_FTL_INT_Program8(uint32_t address, uint8_t value);
+static uint8_t TM_FATFS_FTL_INT_IsErased(uint32_t address, uint32_t count);
+static DRESULT TM_FATFS_FTL_INT_EraseBlock(uint16_t block, uint32_t count, uint8_t erase);
+static DRESULT TM_FATFS_FTL_INT_OpenBlock(void);
+static DRESULT TM_FATFS_FTL_INT_Prepare(void);
+static DRESULT TM_FATFS_FTL_INT_Append(DWORD sector, const BYTE* data, uint8_t obsolete);
+static DRESULT TM_FATFS_FTL_INT_Collect(uint16_t block);
+static DRESULT TM_FATFS_FTL_INT_AddSlot(uint16_t block, uint8_t slot, DWORD sector, uint32_t sequence);
+
+DRESULT TM_FATFS_FTL_Init(const TM_FATFS_FTL_Flash_t* Flash) {
+	TM_FATFS_FTL_INT_Meta_t meta;
+	uint32_t b, s, spare, total = 0, good = 0, last_seq = 0;
+	uint16_t last = FTL_NONE;
+
+	/* Save flash functions */
+	FTL_Flash = Flash;
+
+	/* Calculate sizes */
+	FTL_Blocks = Flash->Size / FATFS_SPI_FLASH_FTL_BLOCK_SIZE;
+	if (FTL_Blocks > FATFS_SPI_FLASH_FTL_MAX_BLOCKS) {
+		FTL_Blocks = FATFS_SPI_FLASH_FTL_MAX_BLOCKS;
+	}
+	spare = FTL_Blocks * FATFS_SPI_FLASH_FTL_SPARE / 100 + 3;
+	if (FTL_Blocks <= spare) {
+		return RES_ERROR;
+	}
+	FTL_Sectors = (FTL_Blocks - spare) * FATFS_SPI_FLASH_FTL_SLOTS;
+
+	/* Reset state */
+	memset(FTL_Map, 0xFF, sizeof(FTL_Map));
+	FTL_Free = 0;
+	FTL_Sequence = 0;
+	FTL_MaxErase = 0;
+	FTL_Current = FTL_NONE;
+	FTL_CurrentSlot = 0;
+	FTL_Opens = 0;
+	FTL_InGC = 0;
+
+	/* Scan metadata of all blocks */
+	for (b = 0; b < FTL_Blocks; b++) {
+		if (FTL_Flash->Read(FTL_BLOCK_ADDR(b), (uint8_t *)&meta, sizeof(meta)) != RES_OK) {
+			return RES_ERROR;
+		}
+
+		/* Never formatted or erase was interrupted */
+		if (meta.Header.Magic != FTL_MAGIC || meta.Header.Check != (FTL_MAGIC ^ meta.Header.EraseCount)) {
+			FTL_Valid[b] = FTL_DAMAGED;
+			FTL_EraseCount[b] = 0;
+			continue;
+		}
+
+		/* Erase counts */
+		FTL_EraseCount[b] = meta.Header.EraseCount;
+		if (meta.Header.EraseCount > FTL_MaxErase) {
+			FTL_MaxErase = meta.Header.EraseCount;
+		}
+		total += meta.Header.EraseCount;
+		good++;
+
+		/* Block was not opened yet */
+		if (meta.Header.Sequence == 0xFFFFFFFF) {
+			FTL_Valid[b] = FTL_FREE;
+			FTL_Free++;
+			continue;
+		}
+
+		/* Used block, remember newest one */
+		FTL_Valid[b] = 0;
+		if (meta.Header.Sequence >= FTL_Sequence) {
+			FTL_Sequence = meta.Header.Sequence + 1;
+		}
+		if (last == FTL_NONE || meta.Header.Sequence > last_seq) {
+			last = b;
+			last_seq = meta.Header.Sequence;
+		}
+
+		/* Add committed slots to map */
+		for (s = 0; s < FATFS_SPI_FLASH_FTL_SLOTS; s++) {
+			if (
+				meta.Tags[s].Sector < FTL_Sectors &&
+				meta.Tags[s].Commit != 0xFF &&
+				meta.Tags[s].Obsolete == 0xFF
+			) {
+				if (TM_FATFS_FTL_INT_AddSlot(b, s, meta.Tags[s].Sector, meta.Header.Sequence) != RES_OK) {
+					return RES_ERROR;
+				}
+			}
+		}
+	}
+
+	/* Format damaged blocks, lost erase count is replaced with average */
+	for (b = 0; b < FTL_Blocks; b++) {
+		if (FTL_Valid[b] == FTL_DAMAGED) {
+			if (TM_FATFS_FTL_INT_EraseBlock(b, good ? (total / good) : 0, !TM_FATFS_FTL_INT_IsErased(FTL_BLOCK_ADDR(b), FATFS_SPI_FLASH_FTL_BLOCK_SIZE)) != RES_OK) {
+				return RES_ERROR;
+			}
+		}
+	}
+
+	/* Continue writing to newest block if it has empty slots */
+	if (last != FTL_NONE) {
+		/* Find first slot after last used tag */
+		for (s = FATFS_SPI_FLASH_FTL_SLOTS; s > 0; s--) {
+			if (!TM_FATFS_FTL_INT_IsErased(FTL_TAG_ADDR(last, s - 1), sizeof(TM_FATFS_FTL_INT_Tag_t))) {
+				break;
+			}
+		}
+
+		/* Skip slots with partially programmed data */
+		while (s < FATFS_SPI_FLASH_FTL_SLOTS && !TM_FATFS_FTL_INT_IsErased(FTL_DATA_ADDR(last, s), FTL_SLOT_SIZE)) {
+			s++;
+		}
+		if (s < FATFS_SPI_FLASH_FTL_SLOTS) {
+			FTL_Current = last;
+			FTL_CurrentSlot = s;
+		}
+	}
+
+	/* Return OK */
+	return RES_OK;
+}
+
+DWORD TM_FATFS_FTL_GetSectorCount(void) {
+	/* Return number of sectors */
+	return FTL_Sectors;
+}
+
+DRESULT TM_FATFS_FTL_Read(BYTE* buff, DWORD sector, UINT count) {
+	uint16_t slot;
+	UINT n;
+
+	/* Check sectors */
+	if (sector + count > FTL_Sectors) {
+		return RES_PARERR;
+	}
+
+	FTL_Stats.HostReads += count;
+	while (count) {
+		slot = FTL_Map[sector];
+		n = 1;
+
+		if (slot == FTL_UNMAPPED) {
+			/* Sector without data */
+			memset(buff, 0xFF, FTL_SLOT_SIZE);
+		} else {
+			/* Read following sectors in the same block at once */
+			while (
+				n < count &&
+				FTL_Map[sector + n] == slot + n &&
+				(slot + n) % FATFS_SPI_FLASH_FTL_SLOTS != 0
+			) {
+				n++;
+			}
+			if (FTL_Flash->Read(FTL_DATA_ADDR(slot / FATFS_SPI_FLASH_FTL_SLOTS, slot % FATFS_SPI_FLASH_FTL_SLOTS), buff, n * FTL_SLOT_SIZE) != RES_OK) {
+				return RES_ERROR;
+			}
+		}
+
+		buff += n * FTL_SLOT_SIZE;
+		sector += n;
+		count -= n;
+	}
+
+	/* Return OK */
+	return RES_OK;
+}
+
+DRESULT TM_FATFS_FTL_Write(const BYTE* buff, DWORD sector, UINT count) {
+	/* Check sectors */
+	if (sector + count > FTL_Sectors) {
+		return RES_PARERR;
+	}
+
+	while (count--) {
+		/* Write sector to new place */
+		if (TM_FATFS_FTL_INT_Append(sector++, buff, 1) != RES_OK) {
+			return RES_ERROR;
+		}
+		buff += FTL_SLOT_SIZE;
+		FTL_Stats.HostWrites++;
+	}
+
+	/* Return OK */
+	return RES_OK;
+}
+
+DRESULT TM_FATFS_FTL_Trim(DWORD start, DWORD end) {
+	uint16_t slot;
+
+	/* Check sectors */
+	if (end >= FTL_Sectors) {
+		end = FTL_Sectors - 1;
+	}
+
+	for (; start <= end; start++) {
+		slot = FTL_Map[start];
+		if (slot == FTL_UNMAPPED) {
+			continue;
+		}
+
+		/* Remove from map and mark obsolete on flash */
+		FTL_Map[start] = FTL_UNMAPPED;
+		FTL_Valid[slot / FATFS_SPI_FLASH_FTL_SLOTS]--;
+		FTL_Stats.Trimmed++;
+		if (TM_FATFS_FTL_INT_Program8(FTL_TAG_ADDR(slot / FATFS_SPI_FLASH_FTL_SLOTS, slot % FATFS_SPI_FLASH_FTL_SLOTS) + offsetof(TM_FATFS_FTL_INT_Tag_t, Obsolete), 0x00) != RES_OK) {
+			return RES_ERROR;
+		}
+	}
+
+	/* Return OK */
+	return RES_OK;
+}
+
+void TM_FATFS_FTL_GetStats(TM_FATFS_FTL_Stats_t* Stats) {
+	uint32_t b;
+
+	/* Copy counters */
+	*Stats = FTL_Stats;
+
+	/* Block information */
+	Stats->Blocks = FTL_Blocks;
+	Stats->FreeBlocks = FTL_Free;
+	Stats->MinErase = 0xFFFFFFFF;
+	Stats->MaxErase = 0;
+	for (b = 0; b < FTL_Blocks; b++) {
+		if (FTL_EraseCount[b] < Stats->MinErase) {
+			Stats->MinErase = FTL_EraseCount[b];
+		}
+		if (FTL_EraseCount[b] > Stats->MaxErase) {
+			Stats->MaxErase = FTL_EraseCount[b];
+		}
+	}
+}
+
+void TM_FATFS_FTL_ResetStats(void) {
+	/* Clear counters */
+	memset(&FTL_Stats, 0, sizeof(FTL_Stats));
+}
+
+/*******************************************************************/
+/*                      FTL INTERNAL FUNCTIONS                     */
+/*******************************************************************/
+static DRESULT TM_FATFS_FTL_INT_Program8(uint32_t address, uint8_t value) {
+	/* Program single byte */
+	return FTL_Flash->Program(address, &value, 1);
+}
+
+static uint8_t TM_FATFS_FTL_INT_IsErased(uint32_t address, uint32_t count) {
+	uint32_t i, n;
+
+	while (count) {
+		n = count > FTL_SLOT_SIZE ? FTL_SLOT_SIZE : count;
+		if (FTL_Flash->Read(address, FTL_Buffer, n) != RES_OK) {
+			return 0;
+		}
+
+		/* Check for programmed bits */
+		for (i = 0; i < n; i++) {
+			if (FTL_Buffer[i] != 0xFF) {
+				return 0;
+			}
+		}
+
+		address += n;
+		count -= n;
+	}
+
+	/* All bytes are erased */
+	return 1;
+}
+
+static DRESULT TM_FATFS_FTL_INT_EraseBlock(uint16_t block, uint32_t count, uint8_t erase) {
+	TM_FATFS_FTL_INT_Header_t header;
+
+	/* Erase block */
+	if (erase) {
+		if (FTL_Flash->Erase(FTL_BLOCK_ADDR(block)) != RES_OK) {
+			return RES_ERROR;
+		}
+		FTL_Stats.Erases++;
+	}
+
+	/* Program header without sequence number */
+	header.Magic = FTL_MAGIC;
+	header.EraseCount = count;
+	header.Check = FTL_MAGIC ^ count;
+	if (FTL_Flash->Program(FTL_BLOCK_ADDR(block), (uint8_t *)&header, offsetof(TM_FATFS_FTL_INT_Header_t, Sequence)) != RES_OK) {
+		return RES_ERROR;
+	}
+
+	/* Block is free now */
+	FTL_EraseCount[block] = count;
+	if (count > FTL_MaxErase) {
+		FTL_MaxErase = count;
+	}
+	FTL_Valid[block] = FTL_FREE;
+	FTL_Free++;
+
+	/* Return OK */
+	return RES_OK;
+}
+
+static DRESULT TM_FATFS_FTL_INT_OpenBlock(void) {
+	uint32_t b;
+	uint16_t block = FTL_NONE;
+
+	/* Dynamic wear levelling, use free block with lowest erase count */
+	for (b = 0; b < FTL_Blocks; b++) {
+		if (FTL_Valid[b] == FTL_FREE && (block == FTL_NONE || FTL_EraseCount[b] < FTL_EraseCount[block])) {
+			block = b;
+		}
+	}
+	if (block == FTL_NONE) {
+		return RES_ERROR;
+	}
+
+	/* Program sequence number, block is in use from now */
+	if (FTL_Flash->Program(FTL_BLOCK_ADDR(block) + offsetof(TM_FATFS_FTL_INT_Header_t, Sequence), (uint8_t *)&FTL_Sequence, 4) != RES_OK) {
+		return RES_ERROR;
+	}
+	FTL_Sequence++;
+
+	/* Set as current block */
+	FTL_Valid[block] = 0;
+	FTL_Free--;
+	FTL_Current = block;
+	FTL_CurrentSlot = 0;
+	FTL_Opens++;
+
+	/* Return OK */
+	return RES_OK;
+}
+
+static DRESULT TM_FATFS_FTL_INT_Prepare(void) {
+	uint32_t b;
+	uint16_t block;
+
+	/* Current block has empty slot */
+	if (FTL_Current != FTL_NONE && FTL_CurrentSlot < FATFS_SPI_FLASH_FTL_SLOTS) {
+		return RES_OK;
+	}
+
+	/* Garbage collection writes to current block too, do not start it again */
+	if (!FTL_InGC) {
+		FTL_InGC = 1;
+
+		/* Keep 1 free block for garbage collection */
+		while (FTL_Free <= 1) {
+			/* Find block with least valid sectors */
+			block = FTL_NONE;
+			for (b = 0; b < FTL_Blocks; b++) {
+				if (
+					b != FTL_Current && FTL_Valid[b] <= FATFS_SPI_FLASH_FTL_SLOTS &&
+					(
+						block == FTL_NONE ||
+						FTL_Valid[b] < FTL_Valid[block] ||
+						(FTL_Valid[b] == FTL_Valid[block] && FTL_EraseCount[b] < FTL_EraseCount[block])
+					)
+				) {
+					block = b;
+				}
+			}
+
+			/* Nothing to collect */
+			if (block == FTL_NONE || FTL_Valid[block] == FATFS_SPI_FLASH_FTL_SLOTS || TM_FATFS_FTL_INT_Collect(block) != RES_OK) {
+				FTL_InGC = 0;
+				return RES_ERROR;
+			}
+		}
+
+		/* Static wear levelling, move data from least erased block */
+		if (FTL_Opens >= FTL_WEAR_INTERVAL) {
+			FTL_Opens = 0;
+
+			block = FTL_NONE;
+			for (b = 0; b < FTL_Blocks; b++) {
+				if (b != FTL_Current && FTL_Valid[b] <= FATFS_SPI_FLASH_FTL_SLOTS && (block == FTL_NONE || FTL_EraseCount[b] < FTL_EraseCount[block])) {
+					block = b;
+				}
+			}
+			if (block != FTL_NONE && FTL_MaxErase - FTL_EraseCount[block] > FATFS_SPI_FLASH_FTL_WEAR_LIMIT) {
+				FTL_Stats.WearMoves++;
+				if (TM_FATFS_FTL_INT_Collect(block) != RES_OK) {
+					FTL_InGC = 0;
+					return RES_ERROR;
+				}
+			}
+		}
+
+		FTL_InGC = 0;
+
+		/* Garbage collection opened block with empty slots */
+		if (FTL_Current != FTL_NONE && FTL_CurrentSlot < FATFS_SPI_FLASH_FTL_SLOTS) {
+			return RES_OK;
+		}
+	}
+
+	/* Open new block */
+	return TM_FATFS_FTL_INT_OpenBlock();
+}
+
+static DRESULT TM_FATFS_FTL_INT_Append(DWORD sector, const BYTE* data, uint8_t obsolete) {
+	uint16_t slot, old;
+
+	/* Get empty slot */
+	if (TM_FATFS_FTL_INT_Prepare() != RES_OK) {
+		return RES_ERROR;
+	}
+
+	/* Sector number first, then data, then commit byte */
+	if (
+		FTL_Flash->Program(FTL_TAG_ADDR(FTL_Current, FTL_CurrentSlot) + offsetof(TM_FATFS_FTL_INT_Tag_t, Sector), (uint8_t *)&sector, 4) != RES_OK ||
+		FTL_Flash->Program(FTL_DATA_ADDR(FTL_Current, FTL_CurrentSlot), data, FTL_SLOT_SIZE) != RES_OK ||
+		TM_FATFS_FTL_INT_Program8(FTL_TAG_ADDR(FTL_Current, FTL_CurrentSlot) + offsetof(TM_FATFS_FTL_INT_Tag_t, Commit), 0x00) != RES_OK
+	) {
+		/* Slot is lost, old data stays valid */
+		FTL_CurrentSlot++;
+		return RES_ERROR;
+	}
+
+	/* Update map */
+	slot = FTL_Current * FATFS_SPI_FLASH_FTL_SLOTS + FTL_CurrentSlot++;
+	old = FTL_Map[sector];
+	FTL_Map[sector] = slot;
+	FTL_Valid[FTL_Current]++;
+	FTL_Stats.FlashWrites++;
+
+	/* Release old copy */
+	if (old != FTL_UNMAPPED) {
+		FTL_Valid[old / FATFS_SPI_FLASH_FTL_SLOTS]--;
+
+		/* Garbage collection erases block with old copy anyway */
+		if (obsolete) {
+			return TM_FATFS_FTL_INT_Program8(FTL_TAG_ADDR(old / FATFS_SPI_FLASH_FTL_SLOTS, old % FATFS_SPI_FLASH_FTL_SLOTS) + offsetof(TM_FATFS_FTL_INT_Tag_t, Obsolete), 0x00);
+		}
+	}
+
+	/* Return OK */
+	return RES_OK;
+}
+
+static DRESULT TM_FATFS_FTL_INT_Collect(uint16_t block) {
+	TM_FATFS_FTL_INT_Tag_t tags[FATFS_SPI_FLASH_FTL_SLOTS];
+	uint32_t s;
+
+	/* Read tags */
+	if (FTL_Flash->Read(FTL_TAG_ADDR(block, 0), (uint8_t *)tags, sizeof(tags)) != RES_OK) {
+		return RES_ERROR;
+	}
+
+	/* Copy valid sectors */
+	for (s = 0; s < FATFS_SPI_FLASH_FTL_SLOTS; s++) {
+		if (tags[s].Sector < FTL_Sectors && FTL_Map[tags[s].Sector] == block * FATFS_SPI_FLASH_FTL_SLOTS + s) {
+			if (
+				FTL_Flash->Read(FTL_DATA_ADDR(block, s), FTL_Buffer, FTL_SLOT_SIZE) != RES_OK ||
+				TM_FATFS_FTL_INT_Append(tags[s].Sector, FTL_Buffer, 0) != RES_OK
+			) {
+				return RES_ERROR;
+			}
+			FTL_Stats.Relocations++;
+		}
+	}
+
+	/* Erase block */
+	return TM_FATFS_FTL_INT_EraseBlock(block, FTL_EraseCount[block] + 1, 1);
+}
+
+static DRESULT TM_FATFS_FTL_INT_AddSlot(uint16_t block, uint8_t slot, DWORD sector, uint32_t sequence) {
+	uint16_t old = FTL_Map[sector];
+	uint32_t old_sequence;
+
+	/* 2 copies after power fail, newer one wins */
+	if (old != FTL_UNMAPPED) {
+		if (old / FATFS_SPI_FLASH_FTL_SLOTS != block) {
+			if (FTL_Flash->Read(FTL_BLOCK_ADDR(old / FATFS_SPI_FLASH_FTL_SLOTS) + offsetof(TM_FATFS_FTL_INT_Header_t, Sequence), (uint8_t *)&old_sequence, 4) != RES_OK) {
+				return RES_ERROR;
+			}
+
+			/* This copy is older */
+			if (old_sequence > sequence) {
+				return TM_FATFS_FTL_INT_Program8(FTL_TAG_ADDR(block, slot) + offsetof(TM_FATFS_FTL_INT_Tag_t, Obsolete), 0x00);
+			}
+		}
+
+		/* Old copy is obsolete */
+		FTL_Valid[old / FATFS_SPI_FLASH_FTL_SLOTS]--;
+		if (TM_FATFS_FTL_INT_Program8(FTL_TAG_ADDR(old / FATFS_SPI_FLASH_FTL_SLOTS, old % FATFS_SPI_FLASH_FTL_SLOTS) + offsetof(TM_FATFS_FTL_INT_Tag_t, Obsolete), 0x00) != RES_OK) {
+			return RES_ERROR;
+		}
+	}
+
+	/* Add to map */
+	FTL_Map[sector] = block * FATFS_SPI_FLASH_FTL_SLOTS + slot;
+	FTL_Valid[block]++;
+
+	/* Return OK */
+	return RES_OK;
+}
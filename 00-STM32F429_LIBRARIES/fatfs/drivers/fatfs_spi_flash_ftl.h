@@ -0,0 +1,291 @@
+/**
+ * @author  Tilen MAJERLE
+ * @email   tilen@majerle.eu
+ * @website http://stm32f4-discovery.net
+ * @link
+ * @version v1.0
+ * @ide     Keil uVision
+ * @license GNU GPL v3
+ * @brief   Flash translation layer for FATFS on NOR flash with 4kB erase blocks
+ *
+@verbatim
+   ----------------------------------------------------------------------
+    Copyright (C) Tilen MAJERLE, 2015
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+   ----------------------------------------------------------------------
+@endverbatim
+ */
+#ifndef TM_FATFS_SPI_FLASH_FTL_H
+#define TM_FATFS_SPI_FLASH_FTL_H 100
+
+/* C++ detection */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup TM_STM32F4xx_Libraries
+ * @{
+ */
+
+/**
+ * @defgroup TM_FATFS_SPI_FLASH_FTL
+ * @brief    Flash translation layer for FATFS on NOR flash with 4kB erase blocks
+ * @{
+ *
+ * NOR flash can only change bits from 1 to 0 and only whole 4kB blocks can be erased back to 1.
+ * FATFS writes the same 512-byte sectors (FAT, directories) again and again, so sectors can not be
+ * written in place. FTL writes each sector to next free place and keeps map from FATFS sector to flash.
+ *
+ * \par Flash layout
+ *
+ * Each 4kB erase block has 8 slots of 512 bytes:
+ *  - Slot 0 is metadata: block header (magic, erase count, sequence number) and tag for each data slot
+ *  - Slots 1 to 7 hold data of FATFS sectors
+ *
+ * Tag of data slot has FATFS sector number, commit byte and obsolete byte.
+ * Sectors are always appended to currently open block, in order of slots.
+ *
+ * \par Power fail safety
+ *
+ * Each field in metadata is programmed only once after erase, so write can be interrupted at any time:
+ *  - Sector number in tag is programmed first, then data, then commit byte.
+ *    Slots without commit byte are ignored on mount, old copy of sector stays valid
+ *  - Old copy is marked obsolete only after new one is committed.
+ *    If 2 committed copies are found on mount, the one in block with higher sequence number wins
+ *  - Garbage collection copies valid sectors to new place before it erases block
+ *  - Blocks with damaged header (power fail during erase) are erased again on mount
+ *
+ * Map is kept in RAM only and is built by scanning metadata of all blocks in @ref TM_FATFS_FTL_Init.
+ * It takes 2 bytes per data slot and 5 bytes per erase block, about 38kB for 8MB flash.
+ *
+ * \par Garbage collection and wear levelling
+ *
+ * When only 1 free block is left, block with least valid sectors is chosen, its valid sectors are copied
+ * to open block and block is erased. Some blocks are always kept as spare (see @ref FATFS_SPI_FLASH_FTL_SPARE)
+ * so there is always a block with free space to collect.
+ *
+ * Wear levelling works in 2 ways:
+ *  - Dynamic: new block is always free block with lowest erase count
+ *  - Static: when difference between most and least erased block is more than @ref FATFS_SPI_FLASH_FTL_WEAR_LIMIT,
+ *    data from least erased block (usually data which never changes) is moved away, so block is used again
+ *
+ * \par Trim
+ *
+ * FATFS informs driver about free clusters with CTRL_TRIM (the same as CTRL_ERASE_SECTOR) command when
+ * _USE_TRIM is set to 1 in ffconf.h. FTL marks these sectors obsolete, so garbage collection does not copy them anymore.
+ * Without trim, deleted files are kept by FTL forever and write amplification is much higher on full flash.
+ *
+ * \par Flash access
+ *
+ * FTL does not know anything about SPI. Flash is accessed through @ref TM_FATFS_FTL_Flash_t functions,
+ * so the same code runs on simulated flash on computer, see tools/spi_flash_ftl_bench folder.
+ *
+ * \par Changelog
+ *
+@verbatim
+ Version 1.0
+  - First release
+@endverbatim
+ *
+ * \par Dependencies
+ *
+@verbatim
+ - stdint.h
+ - defines.h
+ - diskio.h
+ - string.h
+ - stddef.h
+@endverbatim
+ */
+
+#include "stdint.h"
+#include "defines.h"
+#include "diskio.h"
+
+/**
+ * @defgroup TM_FATFS_SPI_FLASH_FTL_Macros
+ * @brief    Library defines
+ * @{
+ */
+
+/**
+ * @brief  Maximal size of flash in bytes, sets size of map in RAM. Bigger flash is used only up to this size
+ */
+#ifndef FATFS_SPI_FLASH_MEMORY_SIZE
+#define FATFS_SPI_FLASH_MEMORY_SIZE         (8 * 1024 * 1024)
+#endif
+
+/**
+ * @brief  Percent of blocks kept as spare for garbage collection. 3 more blocks are always added
+ * @note   More spare blocks means less copying on full flash but less space for files.
+ *         Do not change it after flash is formatted, number of sectors reported to FATFS depends on it
+ */
+#ifndef FATFS_SPI_FLASH_FTL_SPARE
+#define FATFS_SPI_FLASH_FTL_SPARE           3
+#endif
+
+/**
+ * @brief  Difference in erase counts when static wear levelling moves data from least erased block
+ */
+#ifndef FATFS_SPI_FLASH_FTL_WEAR_LIMIT
+#define FATFS_SPI_FLASH_FTL_WEAR_LIMIT      64
+#endif
+
+/**
+ * @brief  Erase block size in bytes
+ */
+#define FATFS_SPI_FLASH_FTL_BLOCK_SIZE      4096
+
+/**
+ * @brief  Number of data slots in each erase block
+ */
+#define FATFS_SPI_FLASH_FTL_SLOTS           7
+
+/**
+ * @brief  Maximal number of erase blocks
+ */
+#define FATFS_SPI_FLASH_FTL_MAX_BLOCKS      (FATFS_SPI_FLASH_MEMORY_SIZE / FATFS_SPI_FLASH_FTL_BLOCK_SIZE)
+
+#if FATFS_SPI_FLASH_FTL_MAX_BLOCKS * FATFS_SPI_FLASH_FTL_SLOTS >= 0xFFFF
+#error "FATFS_SPI_FLASH_MEMORY_SIZE too big, maximal supported size is 32MB"
+#endif
+
+/**
+ * @}
+ */
+
+/**
+ * @defgroup TM_FATFS_SPI_FLASH_FTL_Typedefs
+ * @brief    Library Typedefs
+ * @{
+ */
+
+/**
+ * @brief  Flash access functions
+ * @note   All functions return RES_OK on success. Program function must handle page boundaries
+ *         and wait until flash is ready. Erase function erases 4kB block at given address
+ */
+typedef struct {
+	DRESULT (*Read)(uint32_t address, uint8_t* data, uint32_t count);          /*!< Read count bytes from address */
+	DRESULT (*Program)(uint32_t address, const uint8_t* data, uint32_t count); /*!< Program count bytes to address */
+	DRESULT (*Erase)(uint32_t address);                                        /*!< Erase 4kB block at address */
+	uint32_t Size;                                                             /*!< Flash size in bytes */
+} TM_FATFS_FTL_Flash_t;
+
+/**
+ * @brief  FTL statistics
+ * @note   Write amplification is FlashWrites / HostWrites
+ */
+typedef struct {
+	uint32_t HostWrites;   /*!< Number of sectors written by FATFS */
+	uint32_t HostReads;    /*!< Number of sectors read by FATFS */
+	uint32_t FlashWrites;  /*!< Number of sectors programmed to flash, including garbage collection */
+	uint32_t Relocations;  /*!< Number of sectors copied by garbage collection and wear levelling */
+	uint32_t Erases;       /*!< Number of erased blocks */
+	uint32_t WearMoves;    /*!< Number of blocks moved by static wear levelling */
+	uint32_t Trimmed;      /*!< Number of sectors released with trim */
+	uint32_t Blocks;       /*!< Number of erase blocks in use by FTL */
+	uint32_t FreeBlocks;   /*!< Number of erased blocks ready for writing */
+	uint32_t MinErase;     /*!< Lowest erase count of all blocks */
+	uint32_t MaxErase;     /*!< Highest erase count of all blocks */
+} TM_FATFS_FTL_Stats_t;
+
+/**
+ * @}
+ */
+
+/**
+ * @defgroup TM_FATFS_SPI_FLASH_FTL_Functions
+ * @brief    Library Functions
+ * @{
+ */
+
+/**
+ * @brief  Mounts FTL on flash, flash is formatted on first use
+ * @note   Metadata of all blocks is read to build map. Blocks damaged by power fail are erased
+ * @param  *Flash: Pointer to @ref TM_FATFS_FTL_Flash_t flash functions. Structure must stay valid
+ * @retval RES_OK on success
+ */
+DRESULT TM_FATFS_FTL_Init(const TM_FATFS_FTL_Flash_t* Flash);
+
+/**
+ * @brief  Gets number of sectors available to FATFS
+ * @param  None
+ * @retval Number of 512-byte sectors
+ */
+DWORD TM_FATFS_FTL_GetSectorCount(void);
+
+/**
+ * @brief  Reads sectors
+ * @note   Sectors which were never written or were trimmed are read as 0xFF
+ * @param  *buff: Pointer to buffer for count * 512 bytes
+ * @param  sector: First sector number
+ * @param  count: Number of sectors
+ * @retval RES_OK on success
+ */
+DRESULT TM_FATFS_FTL_Read(BYTE* buff, DWORD sector, UINT count);
+
+/**
+ * @brief  Writes sectors
+ * @note   Data is on flash when function returns, there is nothing to sync
+ * @param  *buff: Pointer to count * 512 bytes of data
+ * @param  sector: First sector number
+ * @param  count: Number of sectors
+ * @retval RES_OK on success
+ */
+DRESULT TM_FATFS_FTL_Write(const BYTE* buff, DWORD sector, UINT count);
+
+/**
+ * @brief  Releases sectors, their content is not needed anymore
+ * @param  start: First sector number
+ * @param  end: Last sector number, included
+ * @retval RES_OK on success
+ */
+DRESULT TM_FATFS_FTL_Trim(DWORD start, DWORD end);
+
+/**
+ * @brief  Gets FTL statistics
+ * @param  *Stats: Pointer to @ref TM_FATFS_FTL_Stats_t structure to be filled
+ * @retval None
+ */
+void TM_FATFS_FTL_GetStats(TM_FATFS_FTL_Stats_t* Stats);
+
+/**
+ * @brief  Resets counters in FTL statistics
+ * @param  None
+ * @retval None
+ */
+void TM_FATFS_FTL_ResetStats(void);
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+
+/* C++ detection */
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
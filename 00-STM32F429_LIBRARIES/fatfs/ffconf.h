@@ -169,7 +169,9 @@
 /  disk_ioctl() function. */
 
 
+#ifndef _USE_TRIM
 #define	_USE_TRIM	0
+#endif
 /* This option switches ATA-TRIM feature. (0:Disable or 1:Enable)
 /  To enable Trim feature, also CTRL_TRIM command should be implemented to the
 /  disk_ioctl() function. */
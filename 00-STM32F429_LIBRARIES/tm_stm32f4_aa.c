@@ -0,0 +1,546 @@
+/**
+ * |----------------------------------------------------------------------
+ * | Copyright (C) Tilen MAJERLE, 2015
+ * |
+ * | This program is free software: you can redistribute it and/or modify
+ * | it under the terms of the GNU General Public License as published by
+ * | the Free Software Foundation, either version 3 of the License, or
+ * | any later version.
+ * |
+ * | This program is distributed in the hope that it will be useful,
+ * | but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * | GNU General Public License for more details.
+ * |
+ * | You should have received a copy of the GNU General Public License
+ * | along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * |----------------------------------------------------------------------
+ */
+#include "tm_stm32f4_aa.h"
+
+/* RGB565 expanded to 32-bit word, green in upper half, red and blue in lower half */
+#define AA_MASK                 0x07E0F81F
+#define AA_EXPAND(c)            (((uint32_t)(c) | ((uint32_t)(c) << 16)) & AA_MASK)
+
+/* 2 signed 16-bit values in one word for DSP instructions, X in lower half */
+#define AA_PACK(x, y)           ((uint32_t)(uint16_t)(x) | ((uint32_t)(uint16_t)(y) << 16))
+
+/* Fixed point scale of arc direction vectors */
+#define AA_ARC_SCALE            1024
+
+/* Private structure for rings, circles and arcs */
+typedef struct {
+	int16_t X0;      /* Center */
+	int16_t Y0;
+	float Radius;    /* Radius of middle line */
+	float Outer2;    /* Square of distance where coverage is 0 on outer side */
+	float Inner2;    /* Square of distance where coverage is 0 on inner side, -1 if none */
+	float FullIn2;   /* Square of distance range where coverage is 1 */
+	float FullOut2;
+	float Half;      /* Half of width */
+	uint8_t Filled;  /* Ring is filled to center */
+	uint8_t Arc;     /* 0 = full ring, 1 = arc up to 180 degrees, 2 = arc over 180 degrees */
+	uint32_t Start;  /* Packed direction vectors of arc start and end */
+	uint32_t End;
+} TM_AA_INT_Ring_t;
+
+/* Private variables */
+static const TM_SPAN_Target_t* AA_Target;
+static uint16_t* AA_Buffer;
+static uint32_t AA_Color;
+static uint16_t AA_Color16;
+static uint32_t AA_Pixels = 0;
+
+/* Private functions */
+static void TM_INT_AA_Begin(const TM_SPAN_Target_t* Target, uint16_t color);
+static void TM_INT_AA_Plot(int16_t x, int16_t y, uint8_t alpha);
+static void TM_INT_AA_Ring(TM_AA_INT_Ring_t* Ring);
+static void TM_INT_AA_RingSegment(TM_AA_INT_Ring_t* Ring, int16_t dy, int16_t dxa, int16_t dxb);
+static float TM_INT_AA_ArcCoverage(TM_AA_INT_Ring_t* Ring, uint32_t P);
+
+/* Blends color to pixel, alpha 0 to 255 */
+static __INLINE void TM_INT_AA_Blend(uint16_t* ptr, uint8_t alpha) {
+	uint32_t bg, a;
+
+	/* Count pixels */
+	AA_Pixels++;
+
+	/* Full coverage */
+	if (alpha == 0xFF) {
+		*ptr = AA_Color16;
+		return;
+	}
+
+	/* Alpha from 0 to 32 */
+	a = ((uint32_t)alpha + 4) >> 3;
+
+	/* All 3 components with one multiplication */
+	bg = AA_EXPAND(*ptr);
+	bg = (bg + (((AA_Color - bg) * a) >> 5)) & AA_MASK;
+	*ptr = (uint16_t)(bg | (bg >> 16));
+}
+
+void TM_AA_DrawLine(const TM_SPAN_Target_t* Target, int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+	int16_t dx, dy, xdir, tmp;
+	uint16_t erracc, erradj, acctmp, w;
+
+	TM_INT_AA_Begin(Target, color);
+
+	/* Always draw from top to bottom */
+	if (y0 > y1) {
+		tmp = y0; y0 = y1; y1 = tmp;
+		tmp = x0; x0 = x1; x1 = tmp;
+	}
+
+	/* First pixel is exact */
+	TM_INT_AA_Plot(x0, y0, 0xFF);
+
+	dx = x1 - x0;
+	dy = y1 - y0;
+	if (dx >= 0) {
+		xdir = 1;
+	} else {
+		xdir = -1;
+		dx = -dx;
+	}
+
+	/* Horizontal, vertical and diagonal lines do not need anti-aliasing */
+	if (dy == 0) {
+		while (dx--) {
+			x0 += xdir;
+			TM_INT_AA_Plot(x0, y0, 0xFF);
+		}
+		return;
+	}
+	if (dx == 0 || dx == dy) {
+		while (dy--) {
+			if (dx) {
+				x0 += xdir;
+			}
+			y0++;
+			TM_INT_AA_Plot(x0, y0, 0xFF);
+		}
+		return;
+	}
+
+	/* Error accumulator is 16-bit fraction, overflow means step in minor direction */
+	erracc = 0;
+	if (dy > dx) {
+		/* Y major line */
+		erradj = ((uint32_t)dx << 16) / (uint32_t)dy;
+		while (--dy) {
+			acctmp = erracc;
+			erracc += erradj;
+			if (erracc <= acctmp) {
+				x0 += xdir;
+			}
+			y0++;
+
+			/* Upper 8 bits of error are intensity of second pixel */
+			w = erracc >> 8;
+			TM_INT_AA_Plot(x0, y0, 0xFF - w);
+			TM_INT_AA_Plot(x0 + xdir, y0, w);
+		}
+	} else {
+		/* X major line */
+		erradj = ((uint32_t)dy << 16) / (uint32_t)dx;
+		while (--dx) {
+			acctmp = erracc;
+			erracc += erradj;
+			if (erracc <= acctmp) {
+				y0++;
+			}
+			x0 += xdir;
+
+			/* Upper 8 bits of error are intensity of second pixel */
+			w = erracc >> 8;
+			TM_INT_AA_Plot(x0, y0, 0xFF - w);
+			TM_INT_AA_Plot(x0, y0 + 1, w);
+		}
+	}
+
+	/* Last pixel is exact */
+	TM_INT_AA_Plot(x1, y1, 0xFF);
+}
+
+void TM_AA_DrawThickLine(const TM_SPAN_Target_t* Target, int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint8_t width, uint16_t color) {
+	int16_t x, y, ymin, ymax, xmin, xmax, ext;
+	int32_t dx, dy, len2, t, c;
+	uint32_t D, P, Q;
+	uint16_t* ptr;
+	float outer, outer2, full2, inv, d2, ta, tb, xa, xb;
+
+	/* Thin line */
+	if (width <= 1) {
+		TM_AA_DrawLine(Target, x0, y0, x1, y1, color);
+		return;
+	}
+
+	TM_INT_AA_Begin(Target, color);
+
+	/* Distance from line where coverage is 0 and where it is 1 */
+	outer = (float)width * 0.5f + 0.5f;
+	outer2 = outer * outer;
+	full2 = (outer - 1.0f) * (outer - 1.0f);
+	ext = (int16_t)outer + 1;
+
+	/* Line direction packed for dot and cross products */
+	dx = x1 - x0;
+	dy = y1 - y0;
+	D = AA_PACK(dx, dy);
+	len2 = dx * dx + dy * dy;
+	inv = len2 ? 1.0f / (float)len2 : 0;
+
+	/* Vertical range, clipped to LCD */
+	ymin = (y0 < y1 ? y0 : y1) - ext;
+	ymax = (y0 > y1 ? y0 : y1) + ext;
+	if (ymin < 0) {
+		ymin = 0;
+	}
+	if (ymax >= (int16_t)Target->Height) {
+		ymax = Target->Height - 1;
+	}
+
+	for (y = ymin; y <= ymax; y++) {
+		/* Part of line which is closer than outer distance to this row */
+		if (dy == 0) {
+			ta = 0;
+			tb = 1;
+		} else {
+			ta = ((float)(y - y0) - outer) / (float)dy;
+			tb = ((float)(y - y0) + outer) / (float)dy;
+			if (ta > tb) {
+				xa = ta; ta = tb; tb = xa;
+			}
+			if (ta < 0) {
+				ta = 0;
+			}
+			if (tb > 1) {
+				tb = 1;
+			}
+		}
+
+		/* Horizontal range of pixels which can be covered */
+		xa = (float)x0 + ta * (float)dx;
+		xb = (float)x0 + tb * (float)dx;
+		if (xa > xb) {
+			d2 = xa; xa = xb; xb = d2;
+		}
+		xmin = (int16_t)(xa - outer);
+		xmax = (int16_t)(xb + outer) + 1;
+		if (xmin < 0) {
+			xmin = 0;
+		}
+		if (xmax >= (int16_t)Target->Width) {
+			xmax = Target->Width - 1;
+		}
+		if (xmin > xmax) {
+			continue;
+		}
+
+		/* Go through pixels, vector from line start to pixel is moved with one SIMD add */
+		ptr = AA_Buffer + Target->Base + xmin * Target->StepX + y * Target->StepY;
+		P = AA_PACK(xmin - x0, y - y0);
+		for (x = xmin; x <= xmax; x++, ptr += Target->StepX, P = __SADD16(P, 1)) {
+			/* Projection of pixel to line, dot product */
+			t = (int32_t)__SMLAD(P, D, 0);
+
+			/* Square of distance to line or to the nearest end for round caps */
+			if (t <= 0) {
+				d2 = (float)(int32_t)__SMLAD(P, P, 0);
+			} else if (t >= len2) {
+				Q = __SSUB16(P, D);
+				d2 = (float)(int32_t)__SMLAD(Q, Q, 0);
+			} else {
+				c = (int32_t)__SMUSDX(P, D);
+				d2 = (float)c * (float)c * inv;
+			}
+
+			/* Outside, inside or on the edge */
+			if (d2 >= outer2) {
+				continue;
+			}
+			if (d2 <= full2) {
+				TM_INT_AA_Blend(ptr, 0xFF);
+			} else {
+				TM_INT_AA_Blend(ptr, (uint8_t)((outer - sqrtf(d2)) * 255.0f));
+			}
+		}
+	}
+}
+
+void TM_AA_DrawCircle(const TM_SPAN_Target_t* Target, int16_t x0, int16_t y0, uint16_t r, uint16_t color) {
+	TM_AA_INT_Ring_t Ring;
+
+	TM_INT_AA_Begin(Target, color);
+
+	/* 1 pixel wide full ring */
+	Ring.X0 = x0;
+	Ring.Y0 = y0;
+	Ring.Radius = r;
+	Ring.Half = 0.5f;
+	Ring.Filled = 0;
+	Ring.Arc = 0;
+	TM_INT_AA_Ring(&Ring);
+}
+
+void TM_AA_DrawFilledCircle(const TM_SPAN_Target_t* Target, int16_t x0, int16_t y0, uint16_t r, uint16_t color) {
+	TM_AA_INT_Ring_t Ring;
+
+	TM_INT_AA_Begin(Target, color);
+
+	/* Ring with edge only on outer side */
+	Ring.X0 = x0;
+	Ring.Y0 = y0;
+	Ring.Radius = r;
+	Ring.Half = 0;
+	Ring.Filled = 1;
+	Ring.Arc = 0;
+	TM_INT_AA_Ring(&Ring);
+}
+
+void TM_AA_DrawArc(const TM_SPAN_Target_t* Target, int16_t x0, int16_t y0, uint16_t r, uint8_t width, uint16_t start, uint16_t end, uint16_t color) {
+	TM_AA_INT_Ring_t Ring;
+	float a;
+	uint16_t sweep;
+
+	TM_INT_AA_Begin(Target, color);
+
+	Ring.X0 = x0;
+	Ring.Y0 = y0;
+	Ring.Radius = r;
+	Ring.Half = (float)(width ? width : 1) * 0.5f;
+	Ring.Filled = 0;
+
+	/* Angle range */
+	start %= 360;
+	end %= 360;
+	sweep = (end + 360 - start) % 360;
+	if (sweep == 0) {
+		Ring.Arc = 0;
+	} else {
+		Ring.Arc = sweep <= 180 ? 1 : 2;
+
+		/* Direction vectors, on LCD Y goes down so angles go clockwise */
+		a = (float)start * 0.0174532925f;
+		Ring.Start = AA_PACK((int16_t)(cosf(a) * AA_ARC_SCALE), (int16_t)(sinf(a) * AA_ARC_SCALE));
+		a = (float)end * 0.0174532925f;
+		Ring.End = AA_PACK((int16_t)(cosf(a) * AA_ARC_SCALE), (int16_t)(sinf(a) * AA_ARC_SCALE));
+	}
+
+	TM_INT_AA_Ring(&Ring);
+}
+
+void TM_AA_DrawPolygon(const TM_SPAN_Target_t* Target, const TM_SPAN_Point_t* Points, uint16_t count, uint16_t color) {
+	uint16_t i, next;
+
+	/* Connect all points with lines */
+	for (i = 0; i < count; i++) {
+		next = (i + 1) < count ? (i + 1) : 0;
+		TM_AA_DrawLine(Target, Points[i].X, Points[i].Y, Points[next].X, Points[next].Y, color);
+	}
+}
+
+void TM_AA_DrawAlphaMask(const TM_SPAN_Target_t* Target, int16_t x, int16_t y, const uint8_t* Mask, uint16_t width, uint16_t height, uint16_t color) {
+	int16_t i, j, xa, xb, ya, yb;
+	uint16_t* ptr;
+	const uint8_t* m;
+
+	TM_INT_AA_Begin(Target, color);
+
+	/* Clip mask to LCD */
+	xa = x < 0 ? -x : 0;
+	ya = y < 0 ? -y : 0;
+	xb = (x + (int16_t)width) > (int16_t)Target->Width ? (int16_t)Target->Width - x : (int16_t)width;
+	yb = (y + (int16_t)height) > (int16_t)Target->Height ? (int16_t)Target->Height - y : (int16_t)height;
+
+	for (j = ya; j < yb; j++) {
+		ptr = AA_Buffer + Target->Base + (x + xa) * Target->StepX + (y + j) * Target->StepY;
+		m = &Mask[(uint32_t)j * width + xa];
+		for (i = xa; i < xb; i++, ptr += Target->StepX, m++) {
+			/* Skip transparent pixels */
+			if (*m) {
+				TM_INT_AA_Blend(ptr, *m);
+			}
+		}
+	}
+}
+
+uint32_t TM_AA_GetPixelCount(void) {
+	/* Return pixels */
+	return AA_Pixels;
+}
+
+void TM_AA_ResetPixelCount(void) {
+	/* Reset counter */
+	AA_Pixels = 0;
+}
+
+/* Private functions */
+static void TM_INT_AA_Begin(const TM_SPAN_Target_t* Target, uint16_t color) {
+	/* Framebuffer is read by CPU, DMA2D must finish first */
+	DMA2D_WAIT;
+
+	/* Save target and colour */
+	AA_Target = Target;
+	AA_Buffer = (uint16_t *)Target->Address;
+	AA_Color16 = color;
+	AA_Color = AA_EXPAND(color);
+}
+
+static void TM_INT_AA_Plot(int16_t x, int16_t y, uint8_t alpha) {
+	/* Check if pixel is on LCD and visible */
+	if (
+		x < 0 || y < 0 ||
+		x >= (int16_t)AA_Target->Width ||
+		y >= (int16_t)AA_Target->Height ||
+		alpha == 0
+	) {
+		return;
+	}
+
+	/* Blend pixel */
+	TM_INT_AA_Blend(&AA_Buffer[AA_Target->Base + x * AA_Target->StepX + y * AA_Target->StepY], alpha);
+}
+
+static void TM_INT_AA_Ring(TM_AA_INT_Ring_t* Ring) {
+	int16_t dy, dymin, dymax, k, xmax, dx, xl, xr;
+	uint16_t* ptr;
+	float outer, inner, full, y2;
+
+	/* Coverage is 1 for distances from middle line up to half width - 0.5, and 0 after half width + 0.5 */
+	outer = Ring->Radius + Ring->Half + 0.5f;
+	Ring->Outer2 = outer * outer;
+	if (Ring->Filled) {
+		Ring->Inner2 = -1.0f;
+		Ring->FullIn2 = 0;
+		full = Ring->Radius - 0.5f;
+	} else {
+		inner = Ring->Radius - Ring->Half - 0.5f;
+		Ring->Inner2 = inner > 0 ? inner * inner : -1.0f;
+		inner = Ring->Radius - Ring->Half + 0.5f;
+		Ring->FullIn2 = inner > 0 ? inner * inner : 0;
+		full = Ring->Radius + Ring->Half - 0.5f;
+	}
+	Ring->FullOut2 = full > 0 ? full * full : -1.0f;
+
+	/* Visible lines */
+	dymin = -(int16_t)outer;
+	dymax = (int16_t)outer;
+	if (Ring->Y0 + dymin < 0) {
+		dymin = -Ring->Y0;
+	}
+	if (Ring->Y0 + dymax >= (int16_t)AA_Target->Height) {
+		dymax = AA_Target->Height - 1 - Ring->Y0;
+	}
+
+	/* Visible columns relative to center */
+	xl = -Ring->X0;
+	xr = AA_Target->Width - 1 - Ring->X0;
+
+	for (dy = dymin; dy <= dymax; dy++) {
+		y2 = (float)dy * (float)dy;
+		if (y2 >= Ring->Outer2) {
+			continue;
+		}
+
+		/* Outermost pixel which can be covered */
+		xmax = (int16_t)sqrtf(Ring->Outer2 - y2);
+
+		/* Inner part, pixels up to k are either fully covered for filled circle or not covered for ring */
+		k = -1;
+		if (Ring->Filled) {
+			if (Ring->FullOut2 > y2) {
+				k = (int16_t)sqrtf(Ring->FullOut2 - y2);
+
+				/* Fill inner part directly, no need to calculate distance */
+				dx = -k < xl ? xl : -k;
+				ptr = AA_Buffer + AA_Target->Base + (Ring->X0 + dx) * AA_Target->StepX + (Ring->Y0 + dy) * AA_Target->StepY;
+				for (; dx <= k && dx <= xr; dx++, ptr += AA_Target->StepX) {
+					TM_INT_AA_Blend(ptr, 0xFF);
+				}
+			}
+		} else if (Ring->Inner2 > y2) {
+			k = (int16_t)sqrtf(Ring->Inner2 - y2);
+		}
+
+		/* Left and right part of line */
+		TM_INT_AA_RingSegment(Ring, dy, -xmax < xl ? xl : -xmax, -(k + 1) > xr ? xr : -(k + 1));
+		TM_INT_AA_RingSegment(Ring, dy, k >= 0 ? (k + 1 < xl ? xl : k + 1) : (1 < xl ? xl : 1), xmax > xr ? xr : xmax);
+	}
+}
+
+static void TM_INT_AA_RingSegment(TM_AA_INT_Ring_t* Ring, int16_t dy, int16_t dxa, int16_t dxb) {
+	int16_t dx;
+	uint32_t P;
+	uint16_t* ptr;
+	float d2, cover;
+
+	/* Check range */
+	if (dxa > dxb) {
+		return;
+	}
+
+	/* Vector from center to pixel is moved with one SIMD add */
+	ptr = AA_Buffer + AA_Target->Base + (Ring->X0 + dxa) * AA_Target->StepX + (Ring->Y0 + dy) * AA_Target->StepY;
+	P = AA_PACK(dxa, dy);
+	for (dx = dxa; dx <= dxb; dx++, ptr += AA_Target->StepX, P = __SADD16(P, 1)) {
+		/* Square of distance from center with one multiply-accumulate */
+		d2 = (float)(int32_t)__SMLAD(P, P, 0);
+
+		/* Outside of ring */
+		if (d2 >= Ring->Outer2 || d2 <= Ring->Inner2) {
+			continue;
+		}
+
+		/* Coverage from distance, square root only on edges */
+		if (d2 >= Ring->FullIn2 && d2 <= Ring->FullOut2) {
+			cover = 1.0f;
+		} else if (Ring->Filled) {
+			cover = Ring->Radius + 0.5f - sqrtf(d2);
+		} else {
+			cover = Ring->Half + 0.5f - fabsf(sqrtf(d2) - Ring->Radius);
+		}
+		if (cover > 1.0f) {
+			cover = 1.0f;
+		}
+
+		/* Cut by arc angles */
+		if (Ring->Arc) {
+			cover *= TM_INT_AA_ArcCoverage(Ring, P);
+		}
+
+		/* Blend */
+		if (cover > 0) {
+			TM_INT_AA_Blend(ptr, (uint8_t)(cover * 255.0f));
+		}
+	}
+}
+
+static float TM_INT_AA_ArcCoverage(TM_AA_INT_Ring_t* Ring, uint32_t P) {
+	float a, b;
+
+	/* Distances from start and end radius, cross products with one DSP instruction */
+	if (Ring->Arc == 1) {
+		/* Pixel must be after start and before end */
+		a = (float)(int32_t)__SMUSDX(Ring->Start, P) * (1.0f / AA_ARC_SCALE) + 0.5f;
+		b = (float)(int32_t)__SMUSDX(P, Ring->End) * (1.0f / AA_ARC_SCALE) + 0.5f;
+	} else {
+		/* Pixel must not be after end and before start */
+		a = 0.5f - (float)(int32_t)__SMUSDX(Ring->End, P) * (1.0f / AA_ARC_SCALE);
+		b = 0.5f - (float)(int32_t)__SMUSDX(P, Ring->Start) * (1.0f / AA_ARC_SCALE);
+		a = a > b ? a : b;
+		b = 1.0f;
+	}
+
+	/* Clamp and combine */
+	if (a > b) {
+		a = b;
+	}
+	if (a < 0) {
+		a = 0;
+	} else if (a > 1.0f) {
+		a = 1.0f;
+	}
+	return a;
+}
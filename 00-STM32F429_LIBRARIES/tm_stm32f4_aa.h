@@ -0,0 +1,236 @@
+/**
+ * @author  Tilen MAJERLE
+ * @email   tilen@majerle.eu
+ * @website http://stm32f4-discovery.net
+ * @link
+ * @version v1.1
+ * @ide     Keil uVision
+ * @license GNU GPL v3
+ * @brief   Anti-aliased lines, circles, arcs and polygons for RGB565 framebuffers
+ *
+@verbatim
+   ----------------------------------------------------------------------
+    Copyright (C) Tilen MAJERLE, 2015
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+   ----------------------------------------------------------------------
+@endverbatim
+ */
+#ifndef TM_AA_H
+#define TM_AA_H 110
+
+/* C++ detection */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup TM_STM32F4xx_Libraries
+ * @{
+ */
+
+/**
+ * @defgroup TM_AA
+ * @brief    Anti-aliased lines, circles, arcs and polygons for RGB565 framebuffers
+ * @{
+ *
+ * Library is shared between LCD libraries which draw to framebuffer in memory (@ref TM_ILI9341_LTDC and @ref TM_DMA2D_GRAPHIC).
+ * Framebuffer is described with @ref TM_SPAN_Target_t structure from @ref TM_SPAN library, so all 4 LCD orientations are supported.
+ *
+ * \par How it works
+ *
+ * Each pixel on the edge of shape gets coverage from 0 to 255, how much of pixel is inside shape.
+ * Pixel in framebuffer is then read and blended with shape colour:
+ *
+@verbatim
+new = old + (color - old) * coverage
+@endverbatim
+ *
+ * RGB565 pixel is expanded to 32-bit word as <code>00000GGGGGG00000RRRRR000000BBBBB</code>,
+ * so all 3 colour components are blended with one multiplication.
+ *
+ * \par Supported shapes
+ *
+ *  - 1 pixel wide lines with Xiaolin Wu's algorithm, integer only
+ *  - Thick lines with round caps
+ *  - Circles, filled circles and arcs with any width
+ *  - Polygon outlines, made of Wu lines
+ *  - 8-bit alpha masks, for example anti-aliased characters of proportional fonts
+ *
+ * Thick lines, circles and arcs calculate distance of each pixel to the shape.
+ * X and Y distances are kept packed in one 32-bit word as 2 16-bit values, so Cortex-M4 DSP instructions
+ * (<code>__SMLAD</code>, <code>__SMUSDX</code>, <code>__SADD16</code>) calculate dot product, cross product
+ * and move to next pixel with one instruction. Square root with FPU is only calculated for pixels
+ * on the edge, pixels inside shape are written without it.
+ *
+ * \par DMA2D
+ *
+ * Framebuffer is read by CPU, so @ref TM_DMA2D_GRAPHIC command queue is flushed before each shape.
+ *
+ * \par Benchmark
+ *
+ * Library counts all pixels it writes. Use @ref TM_AA_GetPixelCount together with DWT cycle counter
+ * to calculate how many pixels per second each shape is drawn with.
+ *
+ * \par Changelog
+ *
+@verbatim
+ Version 1.1
+  - Added TM_AA_DrawAlphaMask function
+
+ Version 1.0
+  - First release
+@endverbatim
+ *
+ * \par Dependencies
+ *
+@verbatim
+ - STM32F4xx
+ - defines.h
+ - TM SPAN
+ - TM DMA2D GRAPHIC
+ - math.h
+@endverbatim
+ */
+
+#include "stm32f4xx.h"
+#include "defines.h"
+#include "tm_stm32f4_span.h"
+#include "tm_stm32f4_dma2d_graphic.h"
+#include "math.h"
+
+/**
+ * @defgroup TM_AA_Functions
+ * @brief    Library Functions
+ * @{
+ */
+
+/**
+ * @brief  Draws 1 pixel wide anti-aliased line
+ * @param  *Target: Pointer to @ref TM_SPAN_Target_t framebuffer description
+ * @param  x0: Line start X coordinate
+ * @param  y0: Line start Y coordinate
+ * @param  x1: Line end X coordinate
+ * @param  y1: Line end Y coordinate
+ * @param  color: Color in RGB565 format
+ * @retval None
+ */
+void TM_AA_DrawLine(const TM_SPAN_Target_t* Target, int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color);
+
+/**
+ * @brief  Draws anti-aliased line with width and round caps
+ * @param  *Target: Pointer to @ref TM_SPAN_Target_t framebuffer description
+ * @param  x0: Line start X coordinate
+ * @param  y0: Line start Y coordinate
+ * @param  x1: Line end X coordinate
+ * @param  y1: Line end Y coordinate
+ * @param  width: Line width in units of pixels
+ * @param  color: Color in RGB565 format
+ * @retval None
+ */
+void TM_AA_DrawThickLine(const TM_SPAN_Target_t* Target, int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint8_t width, uint16_t color);
+
+/**
+ * @brief  Draws 1 pixel wide anti-aliased circle
+ * @param  *Target: Pointer to @ref TM_SPAN_Target_t framebuffer description
+ * @param  x0: X coordinate of center
+ * @param  y0: Y coordinate of center
+ * @param  r: Circle radius
+ * @param  color: Color in RGB565 format
+ * @retval None
+ */
+void TM_AA_DrawCircle(const TM_SPAN_Target_t* Target, int16_t x0, int16_t y0, uint16_t r, uint16_t color);
+
+/**
+ * @brief  Draws filled circle with anti-aliased edge
+ * @param  *Target: Pointer to @ref TM_SPAN_Target_t framebuffer description
+ * @param  x0: X coordinate of center
+ * @param  y0: Y coordinate of center
+ * @param  r: Circle radius
+ * @param  color: Color in RGB565 format
+ * @retval None
+ */
+void TM_AA_DrawFilledCircle(const TM_SPAN_Target_t* Target, int16_t x0, int16_t y0, uint16_t r, uint16_t color);
+
+/**
+ * @brief  Draws anti-aliased arc
+ * @note   Angles are in degrees, 0 is on the right side of center and they go clockwise on LCD.
+ *         Arc is drawn from start to end angle, if end is smaller than start it goes over 0 degrees
+ * @param  *Target: Pointer to @ref TM_SPAN_Target_t framebuffer description
+ * @param  x0: X coordinate of center
+ * @param  y0: Y coordinate of center
+ * @param  r: Radius of arc middle line
+ * @param  width: Arc width in units of pixels
+ * @param  start: Start angle, 0 to 359
+ * @param  end: End angle, 0 to 359. If it is equal to start, full ring is drawn
+ * @param  color: Color in RGB565 format
+ * @retval None
+ */
+void TM_AA_DrawArc(const TM_SPAN_Target_t* Target, int16_t x0, int16_t y0, uint16_t r, uint8_t width, uint16_t start, uint16_t end, uint16_t color);
+
+/**
+ * @brief  Draws anti-aliased polygon outline
+ * @param  *Target: Pointer to @ref TM_SPAN_Target_t framebuffer description
+ * @param  *Points: Pointer to @ref TM_SPAN_Point_t array of polygon points
+ * @param  count: Number of points, last point is connected with first one
+ * @param  color: Color in RGB565 format
+ * @retval None
+ */
+void TM_AA_DrawPolygon(const TM_SPAN_Target_t* Target, const TM_SPAN_Point_t* Points, uint16_t count, uint16_t color);
+
+/**
+ * @brief  Blends colour to framebuffer through 8-bit alpha mask
+ * @param  *Target: Pointer to @ref TM_SPAN_Target_t framebuffer description
+ * @param  x: Left X coordinate of mask
+ * @param  y: Top Y coordinate of mask
+ * @param  *Mask: Pointer to mask, width * height bytes, 0x00 is transparent and 0xFF is colour
+ * @param  width: Mask width in units of pixels
+ * @param  height: Mask height in units of pixels
+ * @param  color: Color in RGB565 format
+ * @retval None
+ */
+void TM_AA_DrawAlphaMask(const TM_SPAN_Target_t* Target, int16_t x, int16_t y, const uint8_t* Mask, uint16_t width, uint16_t height, uint16_t color);
+
+/**
+ * @brief  Gets number of pixels written by library since last reset
+ * @param  None
+ * @retval Number of pixels written
+ */
+uint32_t TM_AA_GetPixelCount(void);
+
+/**
+ * @brief  Resets pixel counter
+ * @param  None
+ * @retval None
+ */
+void TM_AA_ResetPixelCount(void);
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+
+/* C++ detection */
+#ifdef __cplusplus
+}
+#endif
+
+#endif
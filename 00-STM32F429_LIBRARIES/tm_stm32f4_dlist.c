@@ -0,0 +1,759 @@
+/**
+ * |----------------------------------------------------------------------
+ * | Copyright (C) Tilen MAJERLE, 2015
+ * |
+ * | This program is free software: you can redistribute it and/or modify
+ * | it under the terms of the GNU General Public License as published by
+ * | the Free Software Foundation, either version 3 of the License, or
+ * | any later version.
+ * |
+ * | This program is distributed in the hope that it will be useful,
+ * | but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * | GNU General Public License for more details.
+ * |
+ * | You should have received a copy of the GNU General Public License
+ * | along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * |----------------------------------------------------------------------
+ */
+#include "tm_stm32f4_dlist.h"
+
+/* Primitive types */
+#define DLIST_TYPE_FILL         0x00
+#define DLIST_TYPE_FRAME        0x01
+#define DLIST_TYPE_ROUNDED      0x02
+#define DLIST_TYPE_CIRCLE       0x03
+#define DLIST_TYPE_LINE         0x04
+#define DLIST_TYPE_TEXT         0x05
+#define DLIST_TYPE_PROP         0x06
+
+/* Private structure for rectangle, right and bottom coordinates are not included */
+typedef struct {
+	int16_t X0;
+	int16_t Y0;
+	int16_t X1;
+	int16_t Y1;
+} TM_DLIST_INT_Rect_t;
+
+/* Private structure for recorded primitive */
+typedef struct {
+	TM_DLIST_INT_Rect_t Bounds;
+	const void* Font;
+	uint32_t Background;
+	int16_t X0;
+	int16_t Y0;
+	int16_t X1;
+	int16_t Y1;
+	uint16_t R;
+	uint16_t Color;
+	uint16_t Text;
+	uint8_t Type;
+	uint8_t Width;
+} TM_DLIST_INT_Command_t;
+
+/* Private structure for widget */
+typedef struct {
+	TM_DLIST_INT_Rect_t Bounds;
+	uint32_t Hash;
+	uint16_t Id;
+	uint16_t Count;
+	uint8_t Used;
+} TM_DLIST_INT_Widget_t;
+
+/* Private variables */
+static TM_DLIST_INT_Command_t DLIST_Commands[DLIST_MAX_COMMANDS];
+static TM_DLIST_INT_Widget_t DLIST_Widgets[DLIST_MAX_WIDGETS];
+static TM_DLIST_INT_Widget_t DLIST_Previous[DLIST_MAX_WIDGETS];
+static TM_DLIST_INT_Rect_t DLIST_Regions[DLIST_MAX_REGIONS];
+static char DLIST_Text[DLIST_TEXT_SIZE];
+static uint8_t DLIST_PropMask[DLIST_PROP_MAX_PIXELS];
+static TM_SPAN_Target_t DLIST_LastTarget;
+static TM_DLIST_Stats_t DLIST_Stats;
+static uint16_t DLIST_CommandCount = 0;
+static uint16_t DLIST_WidgetCount = 0;
+static uint16_t DLIST_PreviousCount = 0;
+static uint16_t DLIST_TextCount = 0;
+static uint16_t DLIST_RegionCount = 0;
+static uint16_t DLIST_Background = 0x0000;
+static uint8_t DLIST_Invalid = 1;
+static uint8_t DLIST_Overflow = 0;
+
+/* Private functions */
+static TM_DLIST_INT_Command_t* TM_INT_DLIST_Add(uint8_t type, int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color);
+static uint16_t TM_INT_DLIST_CopyText(const char* str);
+static void TM_INT_DLIST_Commit(TM_DLIST_INT_Command_t* Cmd);
+static uint32_t TM_INT_DLIST_Hash(uint32_t hash, uint32_t value);
+static void TM_INT_DLIST_Union(TM_DLIST_INT_Rect_t* Rect, const TM_DLIST_INT_Rect_t* Other);
+static uint32_t TM_INT_DLIST_Area(const TM_DLIST_INT_Rect_t* Rect);
+static uint8_t TM_INT_DLIST_Overlaps(const TM_DLIST_INT_Rect_t* a, const TM_DLIST_INT_Rect_t* b);
+static void TM_INT_DLIST_AddRegion(TM_DLIST_INT_Rect_t Rect, const TM_DLIST_INT_Rect_t* Screen);
+static void TM_INT_DLIST_Fill(const TM_SPAN_Target_t* Target, int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color);
+static void TM_INT_DLIST_Draw(const TM_SPAN_Target_t* Target, const TM_DLIST_INT_Command_t* Cmd, int16_t ox, int16_t oy);
+static void TM_INT_DLIST_DrawText(const TM_SPAN_Target_t* Target, const TM_DLIST_INT_Command_t* Cmd, int16_t x, int16_t y);
+static void TM_INT_DLIST_DrawProp(const TM_SPAN_Target_t* Target, const TM_DLIST_INT_Command_t* Cmd, int16_t x, int16_t y);
+
+void TM_DLIST_Begin(void) {
+	/* Clear list */
+	DLIST_CommandCount = 0;
+	DLIST_WidgetCount = 0;
+	DLIST_TextCount = 0;
+	DLIST_Overflow = 0;
+
+	/* Primitives before first widget belong to widget 0 */
+	TM_DLIST_Widget(0);
+}
+
+void TM_DLIST_Widget(uint16_t id) {
+	TM_DLIST_INT_Widget_t* Widget;
+
+	/* Empty widget is replaced */
+	if (DLIST_WidgetCount && DLIST_Widgets[DLIST_WidgetCount - 1].Count == 0) {
+		DLIST_WidgetCount--;
+	}
+
+	/* Check space */
+	if (DLIST_WidgetCount >= DLIST_MAX_WIDGETS) {
+		DLIST_Overflow = 1;
+		return;
+	}
+
+	/* Start new widget */
+	Widget = &DLIST_Widgets[DLIST_WidgetCount++];
+	Widget->Id = id;
+	Widget->Count = 0;
+	Widget->Hash = 2166136261UL;
+	Widget->Bounds.X0 = Widget->Bounds.X1 = 0;
+	Widget->Bounds.Y0 = Widget->Bounds.Y1 = 0;
+}
+
+void TM_DLIST_FillRectangle(int16_t x, int16_t y, uint16_t width, uint16_t height, uint16_t color) {
+	TM_DLIST_INT_Command_t* Cmd;
+
+	Cmd = TM_INT_DLIST_Add(DLIST_TYPE_FILL, x, y, x + width, y + height, color);
+	if (Cmd) {
+		TM_INT_DLIST_Commit(Cmd);
+	}
+}
+
+void TM_DLIST_DrawRectangle(int16_t x, int16_t y, uint16_t width, uint16_t height, uint16_t color) {
+	TM_DLIST_INT_Command_t* Cmd;
+
+	Cmd = TM_INT_DLIST_Add(DLIST_TYPE_FRAME, x, y, x + width, y + height, color);
+	if (Cmd) {
+		TM_INT_DLIST_Commit(Cmd);
+	}
+}
+
+void TM_DLIST_FillRoundedRectangle(int16_t x, int16_t y, uint16_t width, uint16_t height, uint16_t r, uint16_t color) {
+	TM_DLIST_INT_Command_t* Cmd;
+
+	Cmd = TM_INT_DLIST_Add(DLIST_TYPE_ROUNDED, x, y, x + width, y + height, color);
+	if (Cmd) {
+		Cmd->R = r;
+		TM_INT_DLIST_Commit(Cmd);
+	}
+}
+
+void TM_DLIST_FillCircle(int16_t x0, int16_t y0, uint16_t r, uint16_t color) {
+	TM_DLIST_INT_Command_t* Cmd;
+
+	Cmd = TM_INT_DLIST_Add(DLIST_TYPE_CIRCLE, x0 - r, y0 - r, x0 + r + 1, y0 + r + 1, color);
+	if (Cmd) {
+		Cmd->X0 = x0;
+		Cmd->Y0 = y0;
+		Cmd->R = r;
+		TM_INT_DLIST_Commit(Cmd);
+	}
+}
+
+void TM_DLIST_DrawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint8_t width, uint16_t color) {
+	TM_DLIST_INT_Command_t* Cmd;
+	int16_t m;
+
+	/* Anti-aliased edge and round caps go over end points */
+	m = width / 2 + 2;
+	Cmd = TM_INT_DLIST_Add(
+		DLIST_TYPE_LINE,
+		(x0 < x1 ? x0 : x1) - m, (y0 < y1 ? y0 : y1) - m,
+		(x0 > x1 ? x0 : x1) + m + 1, (y0 > y1 ? y0 : y1) + m + 1,
+		color
+	);
+	if (Cmd) {
+		Cmd->X0 = x0;
+		Cmd->Y0 = y0;
+		Cmd->X1 = x1;
+		Cmd->Y1 = y1;
+		Cmd->Width = width;
+		TM_INT_DLIST_Commit(Cmd);
+	}
+}
+
+void TM_DLIST_Puts(int16_t x, int16_t y, const char* str, TM_FontDef_t* font, uint16_t foreground, uint32_t background) {
+	TM_DLIST_INT_Command_t* Cmd;
+	uint16_t lines = 1, length = 0, max = 0;
+	const char* s;
+
+	/* Size of text, lines are separated with '\n' */
+	for (s = str; *s; s++) {
+		if (*s == '\n') {
+			lines++;
+			length = 0;
+		} else if (*s != '\r') {
+			length++;
+		}
+		if (length > max) {
+			max = length;
+		}
+	}
+
+	Cmd = TM_INT_DLIST_Add(DLIST_TYPE_TEXT, x, y, x + max * font->FontWidth, y + lines * font->FontHeight, foreground);
+	if (Cmd) {
+		Cmd->Text = TM_INT_DLIST_CopyText(str);
+		Cmd->Font = font;
+		Cmd->Background = background;
+		TM_INT_DLIST_Commit(Cmd);
+	}
+}
+
+void TM_DLIST_PutsProp(int16_t x, int16_t y, const char* str, const TM_FONTS_PropFont_t* font, uint16_t foreground) {
+	TM_DLIST_INT_Command_t* Cmd;
+	TM_DLIST_INT_Rect_t glyphRect;
+	const TM_FONTS_PropGlyph_t* glyph;
+	int16_t cx = x, cy = y;
+	const char* s;
+
+	Cmd = TM_INT_DLIST_Add(DLIST_TYPE_PROP, x, y, x, y, foreground);
+	if (!Cmd) {
+		return;
+	}
+
+	/* Bounds are union of all character bitmaps, the same way as they are drawn */
+	for (s = str; *s; s++) {
+		if (*s == '\n') {
+			cy += font->Height;
+			cx = x;
+			continue;
+		}
+		glyph = TM_FONTS_GetPropGlyph(font, *s);
+		if (glyph) {
+			if (glyph->Width && glyph->Height) {
+				glyphRect.X0 = cx + glyph->OffsetX;
+				glyphRect.Y0 = cy + glyph->OffsetY;
+				glyphRect.X1 = glyphRect.X0 + glyph->Width;
+				glyphRect.Y1 = glyphRect.Y0 + glyph->Height;
+				TM_INT_DLIST_Union(&Cmd->Bounds, &glyphRect);
+			}
+			cx += glyph->Advance;
+			if (font->KerningCount && *(s + 1)) {
+				cx += TM_FONTS_GetKerning(font, *s, *(s + 1));
+			}
+		}
+	}
+
+	Cmd->Text = TM_INT_DLIST_CopyText(str);
+	Cmd->Font = font;
+	TM_INT_DLIST_Commit(Cmd);
+}
+
+TM_DLIST_Result_t TM_DLIST_End(const TM_SPAN_Target_t* Target) {
+	TM_DLIST_INT_Rect_t Screen;
+	TM_DLIST_INT_Rect_t tmp;
+	TM_SPAN_Target_t Region;
+	uint32_t start;
+	uint16_t i, j, changed = 0;
+	uint8_t overflow;
+
+	/* Enable DWT cycle counter for statistics */
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	start = DWT->CYCCNT;
+
+	/* Remove last empty widget */
+	if (DLIST_WidgetCount && DLIST_Widgets[DLIST_WidgetCount - 1].Count == 0) {
+		DLIST_WidgetCount--;
+	}
+
+	/* Whole screen */
+	Screen.X0 = 0;
+	Screen.Y0 = 0;
+	Screen.X1 = Target->Width;
+	Screen.Y1 = Target->Height;
+	DLIST_RegionCount = 0;
+
+	/* Different layer or orientation than in previous frame */
+	if (
+		Target->Address != DLIST_LastTarget.Address ||
+		Target->Pitch != DLIST_LastTarget.Pitch ||
+		Target->Width != DLIST_LastTarget.Width ||
+		Target->Height != DLIST_LastTarget.Height ||
+		Target->Base != DLIST_LastTarget.Base ||
+		Target->StepX != DLIST_LastTarget.StepX ||
+		Target->StepY != DLIST_LastTarget.StepY
+	) {
+		DLIST_Invalid = 1;
+	}
+
+	if (DLIST_Invalid || DLIST_Overflow) {
+		/* Draw everything */
+		TM_INT_DLIST_AddRegion(Screen, &Screen);
+		changed = DLIST_WidgetCount;
+	} else {
+		/* Compare widgets with previous frame */
+		for (j = 0; j < DLIST_PreviousCount; j++) {
+			DLIST_Previous[j].Used = 0;
+		}
+		for (i = 0; i < DLIST_WidgetCount; i++) {
+			/* Widget is usually on the same position in list */
+			j = i;
+			if (j >= DLIST_PreviousCount || DLIST_Previous[j].Id != DLIST_Widgets[i].Id || DLIST_Previous[j].Used) {
+				for (j = 0; j < DLIST_PreviousCount; j++) {
+					if (DLIST_Previous[j].Id == DLIST_Widgets[i].Id && !DLIST_Previous[j].Used) {
+						break;
+					}
+				}
+			}
+
+			if (j < DLIST_PreviousCount) {
+				DLIST_Previous[j].Used = 1;
+
+				/* Unchanged widget */
+				if (
+					DLIST_Previous[j].Hash == DLIST_Widgets[i].Hash &&
+					DLIST_Previous[j].Bounds.X0 == DLIST_Widgets[i].Bounds.X0 &&
+					DLIST_Previous[j].Bounds.Y0 == DLIST_Widgets[i].Bounds.Y0 &&
+					DLIST_Previous[j].Bounds.X1 == DLIST_Widgets[i].Bounds.X1 &&
+					DLIST_Previous[j].Bounds.Y1 == DLIST_Widgets[i].Bounds.Y1
+				) {
+					continue;
+				}
+
+				/* Old position must be cleared */
+				TM_INT_DLIST_AddRegion(DLIST_Previous[j].Bounds, &Screen);
+			}
+
+			/* New or changed widget */
+			TM_INT_DLIST_AddRegion(DLIST_Widgets[i].Bounds, &Screen);
+			changed++;
+		}
+
+		/* Removed widgets */
+		for (j = 0; j < DLIST_PreviousCount; j++) {
+			if (!DLIST_Previous[j].Used) {
+				TM_INT_DLIST_AddRegion(DLIST_Previous[j].Bounds, &Screen);
+				changed++;
+			}
+		}
+	}
+
+	/* Sort regions from top to bottom */
+	for (i = 1; i < DLIST_RegionCount; i++) {
+		tmp = DLIST_Regions[i];
+		for (j = i; j > 0 && (
+			DLIST_Regions[j - 1].Y0 > tmp.Y0 ||
+			(DLIST_Regions[j - 1].Y0 == tmp.Y0 && DLIST_Regions[j - 1].X0 > tmp.X0)
+		); j--) {
+			DLIST_Regions[j] = DLIST_Regions[j - 1];
+		}
+		DLIST_Regions[j] = tmp;
+	}
+
+	/* Clear all regions, fills go one after another to DMA2D queue */
+	DLIST_Stats.DamagedPixels = 0;
+	for (i = 0; i < DLIST_RegionCount; i++) {
+		TM_INT_DLIST_Fill(Target, DLIST_Regions[i].X0, DLIST_Regions[i].Y0, DLIST_Regions[i].X1 - 1, DLIST_Regions[i].Y1 - 1, DLIST_Background);
+		DLIST_Stats.DamagedPixels += TM_INT_DLIST_Area(&DLIST_Regions[i]);
+	}
+
+	/* Draw primitives in recorded order, each one to all regions it overlaps */
+	DLIST_Stats.DrawCalls = 0;
+	for (i = 0; i < DLIST_CommandCount; i++) {
+		for (j = 0; j < DLIST_RegionCount; j++) {
+			if (!TM_INT_DLIST_Overlaps(&DLIST_Commands[i].Bounds, &DLIST_Regions[j])) {
+				continue;
+			}
+
+			/* Region is target with start in region corner, primitives are clipped to it */
+			Region = *Target;
+			Region.Base += DLIST_Regions[j].X0 * Target->StepX + DLIST_Regions[j].Y0 * Target->StepY;
+			Region.Width = DLIST_Regions[j].X1 - DLIST_Regions[j].X0;
+			Region.Height = DLIST_Regions[j].Y1 - DLIST_Regions[j].Y0;
+
+			TM_INT_DLIST_Draw(&Region, &DLIST_Commands[i], DLIST_Regions[j].X0, DLIST_Regions[j].Y0);
+			DLIST_Stats.DrawCalls++;
+		}
+	}
+
+	/* Frame is complete when function returns */
+	TM_DMA2DGRAPHIC_Flush();
+
+	/* Save widgets for next frame */
+	for (i = 0; i < DLIST_WidgetCount; i++) {
+		DLIST_Previous[i] = DLIST_Widgets[i];
+	}
+	DLIST_PreviousCount = DLIST_WidgetCount;
+	DLIST_LastTarget = *Target;
+	DLIST_Invalid = 0;
+
+	/* Statistics */
+	DLIST_Stats.Commands = DLIST_CommandCount;
+	DLIST_Stats.Widgets = DLIST_WidgetCount;
+	DLIST_Stats.ChangedWidgets = changed;
+	DLIST_Stats.Regions = DLIST_RegionCount;
+	DLIST_Stats.Time = DWT->CYCCNT - start;
+
+	/* Start with empty list */
+	overflow = DLIST_Overflow;
+	TM_DLIST_Begin();
+
+	return overflow ? TM_DLIST_Result_Overflow : TM_DLIST_Result_Ok;
+}
+
+void TM_DLIST_SetBackground(uint16_t color) {
+	/* Save colour and draw everything */
+	DLIST_Background = color;
+	DLIST_Invalid = 1;
+}
+
+void TM_DLIST_Invalidate(void) {
+	/* Draw everything on next frame */
+	DLIST_Invalid = 1;
+}
+
+void TM_DLIST_GetStats(TM_DLIST_Stats_t* Stats) {
+	/* Copy statistics */
+	*Stats = DLIST_Stats;
+}
+
+/* Private functions */
+static TM_DLIST_INT_Command_t* TM_INT_DLIST_Add(uint8_t type, int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+	TM_DLIST_INT_Command_t* Cmd;
+
+	/* Check space, widget must exist */
+	if (DLIST_CommandCount >= DLIST_MAX_COMMANDS || DLIST_WidgetCount == 0 || DLIST_Overflow) {
+		DLIST_Overflow = 1;
+		return 0;
+	}
+
+	/* Fill common parameters */
+	Cmd = &DLIST_Commands[DLIST_CommandCount];
+	Cmd->Type = type;
+	Cmd->X0 = Cmd->Bounds.X0 = x0;
+	Cmd->Y0 = Cmd->Bounds.Y0 = y0;
+	Cmd->X1 = Cmd->Bounds.X1 = x1;
+	Cmd->Y1 = Cmd->Bounds.Y1 = y1;
+	Cmd->Color = color;
+	Cmd->R = 0;
+	Cmd->Width = 0;
+	Cmd->Text = 0;
+	Cmd->Font = 0;
+	Cmd->Background = DLIST_TRANSPARENT;
+
+	return Cmd;
+}
+
+static uint16_t TM_INT_DLIST_CopyText(const char* str) {
+	uint16_t index = DLIST_TextCount;
+
+	/* Copy with terminating zero */
+	do {
+		if (DLIST_TextCount >= DLIST_TEXT_SIZE) {
+			/* Empty string at the end of buffer */
+			DLIST_Text[DLIST_TEXT_SIZE - 1] = 0;
+			DLIST_Overflow = 1;
+			return DLIST_TEXT_SIZE - 1;
+		}
+		DLIST_Text[DLIST_TextCount++] = *str;
+	} while (*str++);
+
+	return index;
+}
+
+static void TM_INT_DLIST_Commit(TM_DLIST_INT_Command_t* Cmd) {
+	TM_DLIST_INT_Widget_t* Widget = &DLIST_Widgets[DLIST_WidgetCount - 1];
+	uint32_t hash = Widget->Hash;
+	const char* s;
+
+	/* Checksum of all parameters which change look of primitive */
+	hash = TM_INT_DLIST_Hash(hash, Cmd->Type | ((uint32_t)Cmd->Width << 8) | ((uint32_t)Cmd->R << 16));
+	hash = TM_INT_DLIST_Hash(hash, (uint16_t)Cmd->X0 | ((uint32_t)(uint16_t)Cmd->Y0 << 16));
+	hash = TM_INT_DLIST_Hash(hash, (uint16_t)Cmd->X1 | ((uint32_t)(uint16_t)Cmd->Y1 << 16));
+	hash = TM_INT_DLIST_Hash(hash, Cmd->Color);
+	hash = TM_INT_DLIST_Hash(hash, Cmd->Background);
+	hash = TM_INT_DLIST_Hash(hash, (uint32_t)Cmd->Font);
+	if (Cmd->Type == DLIST_TYPE_TEXT || Cmd->Type == DLIST_TYPE_PROP) {
+		for (s = &DLIST_Text[Cmd->Text]; *s; s++) {
+			hash = TM_INT_DLIST_Hash(hash, *s);
+		}
+	}
+
+	/* Add to widget */
+	Widget->Hash = hash;
+	if (Widget->Count == 0) {
+		Widget->Bounds = Cmd->Bounds;
+	} else {
+		TM_INT_DLIST_Union(&Widget->Bounds, &Cmd->Bounds);
+	}
+	Widget->Count++;
+	DLIST_CommandCount++;
+}
+
+static uint32_t TM_INT_DLIST_Hash(uint32_t hash, uint32_t value) {
+	/* FNV-1a on 32-bit words */
+	return (hash ^ value) * 16777619UL;
+}
+
+static void TM_INT_DLIST_Union(TM_DLIST_INT_Rect_t* Rect, const TM_DLIST_INT_Rect_t* Other) {
+	/* Empty rectangle does not change union */
+	if (Other->X0 >= Other->X1 || Other->Y0 >= Other->Y1) {
+		return;
+	}
+	if (Rect->X0 >= Rect->X1 || Rect->Y0 >= Rect->Y1) {
+		*Rect = *Other;
+		return;
+	}
+
+	if (Other->X0 < Rect->X0) {
+		Rect->X0 = Other->X0;
+	}
+	if (Other->Y0 < Rect->Y0) {
+		Rect->Y0 = Other->Y0;
+	}
+	if (Other->X1 > Rect->X1) {
+		Rect->X1 = Other->X1;
+	}
+	if (Other->Y1 > Rect->Y1) {
+		Rect->Y1 = Other->Y1;
+	}
+}
+
+static uint32_t TM_INT_DLIST_Area(const TM_DLIST_INT_Rect_t* Rect) {
+	return (uint32_t)(Rect->X1 - Rect->X0) * (uint32_t)(Rect->Y1 - Rect->Y0);
+}
+
+static uint8_t TM_INT_DLIST_Overlaps(const TM_DLIST_INT_Rect_t* a, const TM_DLIST_INT_Rect_t* b) {
+	return a->X0 < b->X1 && b->X0 < a->X1 && a->Y0 < b->Y1 && b->Y0 < a->Y1;
+}
+
+static void TM_INT_DLIST_AddRegion(TM_DLIST_INT_Rect_t Rect, const TM_DLIST_INT_Rect_t* Screen) {
+	TM_DLIST_INT_Rect_t u;
+	uint32_t cost, best;
+	uint16_t i, index;
+
+	/* Clip to screen */
+	if (Rect.X0 < Screen->X0) {
+		Rect.X0 = Screen->X0;
+	}
+	if (Rect.Y0 < Screen->Y0) {
+		Rect.Y0 = Screen->Y0;
+	}
+	if (Rect.X1 > Screen->X1) {
+		Rect.X1 = Screen->X1;
+	}
+	if (Rect.Y1 > Screen->Y1) {
+		Rect.Y1 = Screen->Y1;
+	}
+	if (Rect.X0 >= Rect.X1 || Rect.Y0 >= Rect.Y1) {
+		return;
+	}
+
+	i = 0;
+	while (i < DLIST_RegionCount) {
+		/* Merge when union has no more pixels than both regions together */
+		u = DLIST_Regions[i];
+		TM_INT_DLIST_Union(&u, &Rect);
+		if (TM_INT_DLIST_Area(&u) <= TM_INT_DLIST_Area(&DLIST_Regions[i]) + TM_INT_DLIST_Area(&Rect)) {
+			/* Remove merged region and check others again with bigger rectangle */
+			Rect = u;
+			DLIST_Regions[i] = DLIST_Regions[--DLIST_RegionCount];
+			i = 0;
+			continue;
+		}
+		i++;
+
+		/* No more space, merge with region which grows the least */
+		if (i == DLIST_RegionCount && DLIST_RegionCount == DLIST_MAX_REGIONS) {
+			best = 0xFFFFFFFF;
+			index = 0;
+			for (i = 0; i < DLIST_RegionCount; i++) {
+				u = DLIST_Regions[i];
+				TM_INT_DLIST_Union(&u, &Rect);
+				cost = TM_INT_DLIST_Area(&u) - TM_INT_DLIST_Area(&DLIST_Regions[i]);
+				if (cost < best) {
+					best = cost;
+					index = i;
+				}
+			}
+			TM_INT_DLIST_Union(&Rect, &DLIST_Regions[index]);
+			DLIST_Regions[index] = DLIST_Regions[--DLIST_RegionCount];
+			i = 0;
+		}
+	}
+
+	/* Add new region */
+	DLIST_Regions[DLIST_RegionCount++] = Rect;
+}
+
+static void TM_INT_DLIST_Fill(const TM_SPAN_Target_t* Target, int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+	int32_t first;
+	uint16_t pixels, lines;
+
+	/* Clip to target */
+	if (x0 < 0) {
+		x0 = 0;
+	}
+	if (y0 < 0) {
+		y0 = 0;
+	}
+	if (x1 >= (int16_t)Target->Width) {
+		x1 = Target->Width - 1;
+	}
+	if (y1 >= (int16_t)Target->Height) {
+		y1 = Target->Height - 1;
+	}
+	if (x0 > x1 || y0 > y1) {
+		return;
+	}
+
+	/* Memory index of corner with the lowest address */
+	first = Target->Base;
+	first += (Target->StepX > 0 ? x0 : x1) * Target->StepX;
+	first += (Target->StepY > 0 ? y0 : y1) * Target->StepY;
+
+	/* Rows are memory lines when X step is 1 pixel, otherwise they are memory columns */
+	if (Target->StepX == 1 || Target->StepX == -1) {
+		pixels = x1 - x0 + 1;
+		lines = y1 - y0 + 1;
+	} else {
+		pixels = y1 - y0 + 1;
+		lines = x1 - x0 + 1;
+	}
+
+	/* Put to DMA2D queue without waiting */
+	TM_DMA2DGRAPHIC_FillBufferIT((uint16_t *)Target->Address + first, pixels, lines, Target->Pitch - pixels, color);
+}
+
+static void TM_INT_DLIST_Draw(const TM_SPAN_Target_t* Target, const TM_DLIST_INT_Command_t* Cmd, int16_t ox, int16_t oy) {
+	int16_t x0 = Cmd->X0 - ox, y0 = Cmd->Y0 - oy, x1 = Cmd->X1 - ox, y1 = Cmd->Y1 - oy;
+
+	switch (Cmd->Type) {
+		case DLIST_TYPE_FILL:
+			TM_INT_DLIST_Fill(Target, x0, y0, x1 - 1, y1 - 1, Cmd->Color);
+			break;
+		case DLIST_TYPE_FRAME:
+			TM_INT_DLIST_Fill(Target, x0, y0, x1 - 1, y0, Cmd->Color);
+			TM_INT_DLIST_Fill(Target, x0, y1 - 1, x1 - 1, y1 - 1, Cmd->Color);
+			TM_INT_DLIST_Fill(Target, x0, y0 + 1, x0, y1 - 2, Cmd->Color);
+			TM_INT_DLIST_Fill(Target, x1 - 1, y0 + 1, x1 - 1, y1 - 2, Cmd->Color);
+			break;
+		case DLIST_TYPE_ROUNDED:
+			TM_SPAN_FillRoundedRectangle(Target, x0, y0, x1 - 1, y1 - 1, Cmd->R, Cmd->Color);
+			break;
+		case DLIST_TYPE_CIRCLE:
+			TM_SPAN_FillCircle(Target, x0, y0, Cmd->R, Cmd->Color);
+			break;
+		case DLIST_TYPE_LINE:
+			if (Cmd->Width > 1) {
+				TM_AA_DrawThickLine(Target, x0, y0, x1, y1, Cmd->Width, Cmd->Color);
+			} else {
+				TM_AA_DrawLine(Target, x0, y0, x1, y1, Cmd->Color);
+			}
+			break;
+		case DLIST_TYPE_TEXT:
+			TM_INT_DLIST_DrawText(Target, Cmd, x0, y0);
+			break;
+		case DLIST_TYPE_PROP:
+			TM_INT_DLIST_DrawProp(Target, Cmd, x0, y0);
+			break;
+		default:
+			break;
+	}
+}
+
+static void TM_INT_DLIST_DrawText(const TM_SPAN_Target_t* Target, const TM_DLIST_INT_Command_t* Cmd, int16_t x, int16_t y) {
+	TM_FontDef_t* font = (TM_FontDef_t *)Cmd->Font;
+	const char* s = &DLIST_Text[Cmd->Text];
+	uint16_t* fb = (uint16_t *)Target->Address;
+	int16_t startX = x, px, py;
+	uint16_t i, j, b;
+
+	/* Background is filled with DMA2D */
+	if (Cmd->Background != DLIST_TRANSPARENT) {
+		TM_INT_DLIST_Fill(
+			Target,
+			x, y,
+			x + (Cmd->Bounds.X1 - Cmd->Bounds.X0) - 1, y + (Cmd->Bounds.Y1 - Cmd->Bounds.Y0) - 1,
+			Cmd->Background
+		);
+	}
+
+	/* Characters are written by CPU */
+	TM_DMA2DGRAPHIC_Flush();
+
+	for (; *s; s++) {
+		/* New line */
+		if (*s == '\n') {
+			y += font->FontHeight;
+			x = startX;
+			continue;
+		} else if (*s == '\r') {
+			continue;
+		}
+
+		/* Draw only visible characters */
+		if (
+			*s >= ' ' && *s <= '~' &&
+			(x + font->FontWidth) > 0 && x < (int16_t)Target->Width &&
+			(y + font->FontHeight) > 0 && y < (int16_t)Target->Height
+		) {
+			for (i = 0; i < font->FontHeight; i++) {
+				py = y + i;
+				if (py < 0 || py >= (int16_t)Target->Height) {
+					continue;
+				}
+				b = font->data[(*s - 32) * font->FontHeight + i];
+				for (j = 0; j < font->FontWidth; j++) {
+					px = x + j;
+					if (((b << j) & 0x8000) && px >= 0 && px < (int16_t)Target->Width) {
+						fb[Target->Base + px * Target->StepX + py * Target->StepY] = Cmd->Color;
+					}
+				}
+			}
+		}
+		x += font->FontWidth;
+	}
+}
+
+static void TM_INT_DLIST_DrawProp(const TM_SPAN_Target_t* Target, const TM_DLIST_INT_Command_t* Cmd, int16_t x, int16_t y) {
+	const TM_FONTS_PropFont_t* font = (const TM_FONTS_PropFont_t *)Cmd->Font;
+	const TM_FONTS_PropGlyph_t* glyph;
+	const char* s = &DLIST_Text[Cmd->Text];
+	int16_t startX = x;
+
+	for (; *s; s++) {
+		/* New line */
+		if (*s == '\n') {
+			y += font->Height;
+			x = startX;
+			continue;
+		}
+
+		/* Decode character to mask and blend it */
+		glyph = TM_FONTS_GetPropGlyph(font, *s);
+		if (glyph) {
+			if (
+				glyph->Width && glyph->Height &&
+				(x + glyph->OffsetX + glyph->Width) > 0 && (x + glyph->OffsetX) < (int16_t)Target->Width &&
+				(y + glyph->OffsetY + glyph->Height) > 0 && (y + glyph->OffsetY) < (int16_t)Target->Height &&
+				TM_FONTS_DecodePropGlyph(font, glyph, DLIST_PropMask, DLIST_PROP_MAX_PIXELS) == 0
+			) {
+				TM_AA_DrawAlphaMask(Target, x + glyph->OffsetX, y + glyph->OffsetY, DLIST_PropMask, glyph->Width, glyph->Height, Cmd->Color);
+			}
+
+			/* Go to next character */
+			x += glyph->Advance;
+			if (font->KerningCount && *(s + 1)) {
+				x += TM_FONTS_GetKerning(font, *s, *(s + 1));
+			}
+		}
+	}
+}
@@ -0,0 +1,357 @@
+/**
+ * @author  Tilen MAJERLE
+ * @email   tilen@majerle.eu
+ * @website http://stm32f4-discovery.net
+ * @link
+ * @version v1.0
+ * @ide     Keil uVision
+ * @license GNU GPL v3
+ * @brief   Retained display list with damaged regions for RGB565 framebuffers
+ *
+@verbatim
+   ----------------------------------------------------------------------
+    Copyright (C) Tilen MAJERLE, 2015
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+   ----------------------------------------------------------------------
+@endverbatim
+ */
+#ifndef TM_DLIST_H
+#define TM_DLIST_H 100
+
+/* C++ detection */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup TM_STM32F4xx_Libraries
+ * @{
+ */
+
+/**
+ * @defgroup TM_DLIST
+ * @brief    Retained display list with damaged regions for RGB565 framebuffers
+ * @{
+ *
+ * User interface is usually drawn again each frame, even if only a few values on screen have changed.
+ * With this library, drawing functions are only recorded to display list. At the end of frame,
+ * list is compared with previous frame and only changed parts of screen are drawn to framebuffer.
+ *
+ * \par How it works
+ *
+ * Primitives are grouped to widgets with @ref TM_DLIST_Widget function. For each widget, library keeps
+ * checksum of all its primitives (including text) and rectangle around them.
+ *
+ * When frame ends with @ref TM_DLIST_End:
+ *  - Widgets with changed checksum or rectangle, new widgets and removed widgets mark their old and new rectangles as damaged
+ *  - Damaged rectangles are merged when this does not increase number of pixels to draw,
+ *    so there are at most @ref DLIST_MAX_REGIONS regions, sorted from top to bottom
+ *  - All regions are cleared with background colour first, one after another with DMA2D
+ *  - Each primitive which overlaps any region is drawn to all regions it overlaps, clipped to them.
+ *    Order of primitives is the same as they were recorded, so overlapping widgets look the same as without display list
+ *
+ * Rectangles are put to @ref TM_DMA2D_GRAPHIC command queue as register to memory fills without waiting,
+ * so long runs of rectangles are drawn by DMA2D while CPU prepares next ones.
+ * Other primitives use @ref TM_SPAN and @ref TM_AA libraries and text is drawn with CPU.
+ *
+ * Framebuffer is described with @ref TM_SPAN_Target_t structure, so all 4 LCD orientations are supported.
+ * Clipping to region is done by moving start of target to region corner.
+ *
+ * \par Example
+ *
+@verbatim
+TM_SPAN_Target_t Target;
+char str[20];
+
+while (1) {
+    TM_DLIST_Begin();
+
+    //Static frame, drawn only once
+    TM_DLIST_Widget(1);
+    TM_DLIST_FillRoundedRectangle(10, 10, 220, 60, 8, 0x2104);
+    TM_DLIST_Puts(20, 20, "Speed", &TM_Font_11x18, 0xFFFF, DLIST_TRANSPARENT);
+
+    //Value, drawn only when it changes
+    TM_DLIST_Widget(2);
+    sprintf(str, "%3d km/h", speed);
+    TM_DLIST_Puts(20, 45, str, &TM_Font_11x18, 0xFFE0, 0x2104);
+
+    //Draw changes
+    TM_ILI9341_GetTarget(&Target);
+    TM_DLIST_End(&Target);
+}
+@endverbatim
+ *
+ * @note   Library assumes framebuffer content stays the same between frames. When LCD library swaps
+ *         framebuffers (double buffering) or something else is drawn to framebuffer, call @ref TM_DLIST_Invalidate
+ *         and whole screen is drawn on next frame. Change of target (layer or orientation) is detected automatically.
+ *
+ * \par Changelog
+ *
+@verbatim
+ Version 1.0
+  - First release
+@endverbatim
+ *
+ * \par Dependencies
+ *
+@verbatim
+ - STM32F4xx
+ - defines.h
+ - TM FONTS
+ - TM SPAN
+ - TM AA
+ - TM DMA2D GRAPHIC
+@endverbatim
+ */
+
+#include "stm32f4xx.h"
+#include "defines.h"
+#include "tm_stm32f4_fonts.h"
+#include "tm_stm32f4_span.h"
+#include "tm_stm32f4_aa.h"
+#include "tm_stm32f4_dma2d_graphic.h"
+
+/**
+ * @defgroup TM_DLIST_Macros
+ * @brief    Library defines
+ * @{
+ */
+
+/**
+ * @brief  Maximal number of primitives in one frame
+ */
+#ifndef DLIST_MAX_COMMANDS
+#define DLIST_MAX_COMMANDS          128
+#endif
+
+/**
+ * @brief  Maximal number of widgets in one frame
+ */
+#ifndef DLIST_MAX_WIDGETS
+#define DLIST_MAX_WIDGETS           32
+#endif
+
+/**
+ * @brief  Number of bytes for all strings in one frame, including terminating zeros
+ */
+#ifndef DLIST_TEXT_SIZE
+#define DLIST_TEXT_SIZE             512
+#endif
+
+/**
+ * @brief  Maximal number of damaged regions, closest regions are merged when there are more
+ */
+#ifndef DLIST_MAX_REGIONS
+#define DLIST_MAX_REGIONS           8
+#endif
+
+/**
+ * @brief  Maximal number of pixels in one character of proportional font
+ */
+#ifndef DLIST_PROP_MAX_PIXELS
+#define DLIST_PROP_MAX_PIXELS       (32 * 32)
+#endif
+
+/**
+ * @brief  Background colour for text which is not filled
+ */
+#define DLIST_TRANSPARENT           0xFFFFFFFF
+
+/**
+ * @}
+ */
+
+/**
+ * @defgroup TM_DLIST_Typedefs
+ * @brief    Library Typedefs
+ * @{
+ */
+
+/**
+ * @brief  Result enumeration
+ */
+typedef enum {
+	TM_DLIST_Result_Ok = 0x00, /*!< Frame was drawn */
+	TM_DLIST_Result_Overflow   /*!< Too many primitives, widgets or text in frame. Primitives which did not fit were not drawn */
+} TM_DLIST_Result_t;
+
+/**
+ * @brief  Statistics of last frame
+ */
+typedef struct {
+	uint16_t Commands;       /*!< Number of recorded primitives */
+	uint16_t Widgets;        /*!< Number of widgets */
+	uint16_t ChangedWidgets; /*!< Number of new, changed or removed widgets */
+	uint16_t Regions;        /*!< Number of damaged regions */
+	uint32_t DamagedPixels;  /*!< Number of pixels in all damaged regions */
+	uint16_t DrawCalls;      /*!< Number of primitives drawn to regions */
+	uint32_t Time;           /*!< Time spent in @ref TM_DLIST_End in units of CPU cycles */
+} TM_DLIST_Stats_t;
+
+/**
+ * @}
+ */
+
+/**
+ * @defgroup TM_DLIST_Functions
+ * @brief    Library Functions
+ * @{
+ */
+
+/**
+ * @brief  Starts new frame, display list is cleared
+ * @note   Primitives before first @ref TM_DLIST_Widget call belong to widget with ID 0
+ * @param  None
+ * @retval None
+ */
+void TM_DLIST_Begin(void);
+
+/**
+ * @brief  Starts new widget, next primitives belong to it
+ * @param  id: Widget ID, must be unique in frame and the same in each frame for the same widget
+ * @retval None
+ */
+void TM_DLIST_Widget(uint16_t id);
+
+/**
+ * @brief  Records filled rectangle
+ * @param  x: Left X coordinate
+ * @param  y: Top Y coordinate
+ * @param  width: Rectangle width in units of pixels
+ * @param  height: Rectangle height in units of pixels
+ * @param  color: Color in RGB565 format
+ * @retval None
+ */
+void TM_DLIST_FillRectangle(int16_t x, int16_t y, uint16_t width, uint16_t height, uint16_t color);
+
+/**
+ * @brief  Records 1 pixel wide rectangle outline
+ * @param  x: Left X coordinate
+ * @param  y: Top Y coordinate
+ * @param  width: Rectangle width in units of pixels
+ * @param  height: Rectangle height in units of pixels
+ * @param  color: Color in RGB565 format
+ * @retval None
+ */
+void TM_DLIST_DrawRectangle(int16_t x, int16_t y, uint16_t width, uint16_t height, uint16_t color);
+
+/**
+ * @brief  Records filled rectangle with rounded corners
+ * @param  x: Left X coordinate
+ * @param  y: Top Y coordinate
+ * @param  width: Rectangle width in units of pixels
+ * @param  height: Rectangle height in units of pixels
+ * @param  r: Corner radius
+ * @param  color: Color in RGB565 format
+ * @retval None
+ */
+void TM_DLIST_FillRoundedRectangle(int16_t x, int16_t y, uint16_t width, uint16_t height, uint16_t r, uint16_t color);
+
+/**
+ * @brief  Records filled circle
+ * @param  x0: X coordinate of center
+ * @param  y0: Y coordinate of center
+ * @param  r: Circle radius
+ * @param  color: Color in RGB565 format
+ * @retval None
+ */
+void TM_DLIST_FillCircle(int16_t x0, int16_t y0, uint16_t r, uint16_t color);
+
+/**
+ * @brief  Records anti-aliased line
+ * @param  x0: Line start X coordinate
+ * @param  y0: Line start Y coordinate
+ * @param  x1: Line end X coordinate
+ * @param  y1: Line end Y coordinate
+ * @param  width: Line width in units of pixels
+ * @param  color: Color in RGB565 format
+ * @retval None
+ */
+void TM_DLIST_DrawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint8_t width, uint16_t color);
+
+/**
+ * @brief  Records string with fixed width font
+ * @note   String is copied to display list
+ * @param  x: Left X coordinate
+ * @param  y: Top Y coordinate
+ * @param  *str: Pointer to string
+ * @param  *font: Pointer to @ref TM_FontDef_t font
+ * @param  foreground: Text color in RGB565 format
+ * @param  background: Background color in RGB565 format, or @ref DLIST_TRANSPARENT
+ * @retval None
+ */
+void TM_DLIST_Puts(int16_t x, int16_t y, const char* str, TM_FontDef_t* font, uint16_t foreground, uint32_t background);
+
+/**
+ * @brief  Records anti-aliased string with proportional font
+ * @note   String is copied to display list
+ * @param  x: Left X coordinate
+ * @param  y: Top Y coordinate of line
+ * @param  *str: Pointer to string
+ * @param  *font: Pointer to @ref TM_FONTS_PropFont_t font
+ * @param  foreground: Text color in RGB565 format
+ * @retval None
+ */
+void TM_DLIST_PutsProp(int16_t x, int16_t y, const char* str, const TM_FONTS_PropFont_t* font, uint16_t foreground);
+
+/**
+ * @brief  Ends frame and draws all changes since previous frame
+ * @note   Framebuffer is complete when function returns
+ * @param  *Target: Pointer to @ref TM_SPAN_Target_t framebuffer description
+ * @retval Member of @ref TM_DLIST_Result_t enumeration
+ */
+TM_DLIST_Result_t TM_DLIST_End(const TM_SPAN_Target_t* Target);
+
+/**
+ * @brief  Sets colour of screen parts without widgets
+ * @note   Whole screen is drawn on next frame
+ * @param  color: Color in RGB565 format
+ * @retval None
+ */
+void TM_DLIST_SetBackground(uint16_t color);
+
+/**
+ * @brief  Marks whole screen as damaged, it is drawn on next frame
+ * @param  None
+ * @retval None
+ */
+void TM_DLIST_Invalidate(void);
+
+/**
+ * @brief  Gets statistics of last frame
+ * @param  *Stats: Pointer to @ref TM_DLIST_Stats_t structure to be filled
+ * @retval None
+ */
+void TM_DLIST_GetStats(TM_DLIST_Stats_t* Stats);
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+
+/* C++ detection */
+#ifdef __cplusplus
+}
+#endif
+
+#endif
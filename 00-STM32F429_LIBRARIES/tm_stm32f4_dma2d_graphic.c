@@ -17,17 +17,26 @@
  * |----------------------------------------------------------------------
  */
 #include "tm_stm32f4_dma2d_graphic.h"
+#include "tm_stm32f4_span.h"
+#include "tm_stm32f4_aa.h"
 
 /* Absolute number */
 #define ABS(X)	((X) > 0 ? (X) : -(X))    
 
+/* CPU cycles for busy time */
+#if DMA2D_GRAPHIC_USE_DWT == 1
+#define DMA2D_GRAPHIC_CYCLES()	(DWT->CYCCNT)
+#else
+#define DMA2D_GRAPHIC_CYCLES()	0
+#endif
+
 /* Internal structure */
 typedef struct {
 	uint16_t Width;
 	uint16_t Height;
 	uint16_t CurrentWidth;
 	uint16_t CurrentHeight;
-	uint32_t StartAddress;
+	uintptr_t StartAddress;
 	uint32_t LayerOffset;
 	uint32_t Offset;
 	uint32_t Pixels;
@@ -38,9 +47,19 @@ typedef struct {
 
 /* Private structures */
 static DMA2D_InitTypeDef GRAPHIC_DMA2D_InitStruct;
+static uintptr_t GRAPHIC_DMA2D_OutputAddress; /* DMA2D_OutputMemoryAdd is only 32-bit */
 //static DMA2D_FG_InitTypeDef GRAPHIC_DMA2D_FG_InitStruct;
 volatile TM_INT_DMA2D_t DIS;
 
+/* Command queue */
+static TM_DMA2DGRAPHIC_Command_t DMA2D_Queue[DMA2D_GRAPHIC_QUEUE_SIZE];
+static __IO uint16_t DMA2D_QueueHead = 0;
+static __IO uint16_t DMA2D_QueueTail = 0;
+static __IO uint8_t DMA2D_QueueRunning = 0;
+static uint8_t DMA2D_QueueInitialized = 0;
+static __IO uint32_t DMA2D_StartTime;
+static __IO TM_DMA2DGRAPHIC_Stats_t DMA2D_Stats;
+
 __STATIC_INLINE void DrawPixel(uint16_t x, uint16_t y, uint32_t color) {
 	TM_DMA2DGRAPHIC_DrawHorizontalLine(x, y, 1, color);
 }
@@ -49,7 +68,25 @@ __STATIC_INLINE void DrawPixel(uint16_t x, uint16_t y, uint32_t color) {
 void TM_INT_DMA2DGRAPHIC_InitAndTransfer(void);
 void TM_INT_DMA2DGRAPHIC_SetMemory(uint32_t MemoryAddress, uint32_t Offset, uint32_t NumberOfLine, uint32_t PixelPerLine);
 void TM_INT_DMA2DGRAPHIC_DrawCircleCorner(int16_t x0, int16_t y0, int16_t r, uint8_t corner, uint32_t color);
-void TM_INT_DMA2DGRAPHIC_DrawFilledCircleCorner(int16_t x0, int16_t y0, int16_t r, uint8_t corner, uint32_t color);
+void TM_INT_DMA2DGRAPHIC_GetTarget(TM_SPAN_Target_t* Target);
+static void TM_INT_DMA2DGRAPHIC_InitQueue(void);
+static void TM_INT_DMA2DGRAPHIC_Start(void);
+static void TM_INT_DMA2DGRAPHIC_Complete(void);
+static void TM_INT_DMA2DGRAPHIC_Poll(void);
+static __IO uint16_t* TM_INT_DMA2DGRAPHIC_PixelAddress(uint16_t x, uint16_t y);
+static uint8_t TM_INT_DMA2DGRAPHIC_Overlaps(const TM_DMA2DGRAPHIC_Command_t* Command, uintptr_t start, uintptr_t end);
+static uint8_t TM_INT_DMA2DGRAPHIC_BufferOverlaps(uintptr_t address, uint32_t offset, uint8_t bytes, uint32_t pixels, uint32_t lines, uintptr_t start, uintptr_t end);
+static uint8_t TM_INT_DMA2DGRAPHIC_PixelBytes(uint32_t format);
+static uint8_t TM_INT_DMA2DGRAPHIC_ClipImage(int16_t* x, int16_t* y, const TM_DMA2DGRAPHIC_Image_t* Image, uint16_t* sx, uint16_t* sy, uint16_t* w, uint16_t* h);
+static void TM_INT_DMA2DGRAPHIC_DrawImageCPU(int16_t x, int16_t y, const TM_DMA2DGRAPHIC_Image_t* Image, uint16_t sx, uint16_t sy, uint16_t w, uint16_t h, uint32_t key, uint8_t use_key);
+static uint16_t TM_INT_DMA2DGRAPHIC_BlendPixel(uint16_t bg, uint16_t fg, uint8_t alpha);
+#if DMA2D_GRAPHIC_SOFTWARE == 1
+static void TM_INT_DMA2DGRAPHIC_Execute(const TM_DMA2DGRAPHIC_Command_t* Command);
+static uint32_t TM_INT_DMA2DGRAPHIC_ReadPixel(uintptr_t address, uint32_t index, uint32_t pfccr, uint32_t color, uintptr_t clut);
+static void TM_INT_DMA2DGRAPHIC_WritePixel(uintptr_t address, uint32_t index, uint32_t format, uint32_t argb);
+static uint32_t TM_INT_DMA2DGRAPHIC_ReadRaw(uintptr_t address, uint32_t index, uint8_t bytes);
+static void TM_INT_DMA2DGRAPHIC_WriteRaw(uintptr_t address, uint32_t index, uint8_t bytes, uint32_t value);
+#endif
 
 void TM_DMA2DGRAPHIC_Init(void) {
 	/* Internal settings */
@@ -64,8 +101,13 @@ void TM_DMA2DGRAPHIC_Init(void) {
 	DIS.PixelSize = 2;
 	DIS.LayerOffset = DMA2D_GRAPHIC_LCD_WIDTH * DMA2D_GRAPHIC_LCD_HEIGHT * DIS.PixelSize;
 	
+#if DMA2D_GRAPHIC_SOFTWARE == 0
 	/* Enable DMA2D clock */
 	RCC->AHB1ENR |= RCC_AHB1ENR_DMA2DEN;
+#endif
+	
+	/* Prepare command queue */
+	TM_INT_DMA2DGRAPHIC_InitQueue();
 	
 	/* Initialized */
 	DIS.Initialized = 1;
@@ -77,28 +119,21 @@ void TM_DMA2DGRAPHIC_SetLayer(uint8_t layer_number) {
 }
 
 void TM_DMA2DGRAPHIC_DrawPixel(uint16_t x, uint16_t y, uint32_t color) {
-	if (DIS.Orientation == 1) { /* Normal */
-		*(__IO uint16_t *) (DIS.StartAddress + DIS.Offset + DIS.PixelSize * (y * DIS.Width + x)) = color;
-	} else if (DIS.Orientation == 0) { /* 180 */
-		*(__IO uint16_t *) (DIS.StartAddress + DIS.Offset + DIS.PixelSize * ((DIS.Height - y - 1) * DIS.Width + (DIS.Width - x - 1))) = color;
-	} else if (DIS.Orientation == 3) { /* 90 */ /* x + width * y */
-		*(__IO uint16_t *) (DIS.StartAddress + DIS.Offset + DIS.PixelSize * ((x) * DIS.Width + DIS.Width - y - 1)) = color;
-	} else if (DIS.Orientation == 2) { /* 270 */
-		*(__IO uint16_t *) (DIS.StartAddress + DIS.Offset + DIS.PixelSize * ((DIS.Height - x - 1) * DIS.Width + y)) = color;
-	}
+	__IO uint16_t* ptr = TM_INT_DMA2DGRAPHIC_PixelAddress(x, y);
+	
+	/* Queued operations may still write here */
+	TM_DMA2DGRAPHIC_WaitRegion((void *)ptr, 2);
+	
+	*ptr = color;
 }
 
 uint32_t TM_DMA2DGRAPHIC_GetPixel(uint16_t x, uint16_t y) {
-	if (DIS.Orientation == 1) { /* Normal */
-		return *(__IO uint16_t *) (DIS.StartAddress + DIS.Offset + DIS.PixelSize * (y * DIS.Width + x));
-	} else if (DIS.Orientation == 0) { /* 180 */
-		return *(__IO uint16_t *) (DIS.StartAddress + DIS.Offset + DIS.PixelSize * ((DIS.Height - y - 1) * DIS.Width + (DIS.Width - x - 1)));
-	} else if (DIS.Orientation == 3) { /* 90 */ /* x + width * y */
-		return *(__IO uint16_t *) (DIS.StartAddress + DIS.Offset + DIS.PixelSize * ((x) * DIS.Width + DIS.Width - y - 1));
-	} else if (DIS.Orientation == 2) { /* 270 */
-		return *(__IO uint16_t *) (DIS.StartAddress + DIS.Offset + DIS.PixelSize * ((DIS.Height - x - 1) * DIS.Width + y));
-	}
-	return 0;
+	__IO uint16_t* ptr = TM_INT_DMA2DGRAPHIC_PixelAddress(x, y);
+	
+	/* Queued operations may still write here */
+	TM_DMA2DGRAPHIC_WaitRegion((void *)ptr, 2);
+	
+	return *ptr;
 }
 
 void TM_DMA2DGRAPHIC_SetOrientation(uint8_t orientation) {
@@ -134,7 +169,7 @@ void TM_DMA2DGRAPHIC_Fill(uint32_t color) {
 	GRAPHIC_DMA2D_InitStruct.DMA2D_OutputRed = (0xF800 & color) >> 11;
 	
 	/* Set memory */
-	GRAPHIC_DMA2D_InitStruct.DMA2D_OutputMemoryAdd = DIS.StartAddress + DIS.Offset;
+	GRAPHIC_DMA2D_OutputAddress = DIS.StartAddress + DIS.Offset;
 	GRAPHIC_DMA2D_InitStruct.DMA2D_OutputOffset = 0;
 	GRAPHIC_DMA2D_InitStruct.DMA2D_NumberOfLine = DIS.Height;
 	GRAPHIC_DMA2D_InitStruct.DMA2D_PixelPerLine = DIS.Width;
@@ -248,41 +283,16 @@ void TM_DMA2DGRAPHIC_DrawRoundedRectangle(uint16_t x, uint16_t y, uint16_t width
 }
 
 void TM_DMA2DGRAPHIC_DrawFilledRoundedRectangle(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint16_t r, uint32_t color) {
+	TM_SPAN_Target_t Target;
+	
 	/* Check input parameters */
 	if (width == 0 || height == 0) {
 		return;
 	}
 	
-	/* Check max radius */
-	if (r > (width / 2)) {
-		r = width / 2 - 1;
-	}
-	if (r > (height / 2)) {
-		r = height / 2 - 1;
-	}
-	if (
-		r > (width / 2) || 
-		r > (height / 2)
-	) {
-		r = 0;
-	}
-	
-	/* No radius */
-	if (r == 0) {
-		TM_DMA2DGRAPHIC_DrawFilledRectangle(x, y, width, height, color);
-		return;
-	}
-	
-	/* Draw rectangles */
-	TM_DMA2DGRAPHIC_DrawFilledRectangle(x + r, y, width - 2 * r, height, color);
-	TM_DMA2DGRAPHIC_DrawFilledRectangle(x, y + r, r, height - 2 * r, color);
-	TM_DMA2DGRAPHIC_DrawFilledRectangle(x + width - r, y + r, r, height - 2 * r, color);
-	
-	/* Draw corners */
-	TM_INT_DMA2DGRAPHIC_DrawFilledCircleCorner(x + r, y + r, r, 0x01, color); /* Top left */
-	TM_INT_DMA2DGRAPHIC_DrawFilledCircleCorner(x + width - r - 1, y + r, r, 0x02, color); /* Top right */
-	TM_INT_DMA2DGRAPHIC_DrawFilledCircleCorner(x + width - r - 1, y + height - r - 1, r, 0x04, color); /* Bottom right */
-	TM_INT_DMA2DGRAPHIC_DrawFilledCircleCorner(x + r, y + height - r - 1, r, 0x08, color); /* Bottom left */
+	/* Draw with span rasterizer */
+	TM_INT_DMA2DGRAPHIC_GetTarget(&Target);
+	TM_SPAN_FillRoundedRectangle(&Target, x, y, x + width - 1, y + height - 1, r, color);
 }
 
 void TM_DMA2DGRAPHIC_DrawVerticalLine(int16_t x, int16_t y, uint16_t length, uint32_t color) {
@@ -499,34 +509,11 @@ void TM_DMA2DGRAPHIC_DrawCircle(uint16_t x0, uint16_t y0, uint16_t r, uint32_t c
 }
 
 void TM_DMA2DGRAPHIC_DrawFilledCircle(uint16_t x0, uint16_t y0, uint16_t r, uint32_t color) {
-	int16_t f = 1 - r;
-	int16_t ddF_x = 1;
-	int16_t ddF_y = -2 * r;
-	int16_t x = 0;
-	int16_t y = r;
-
-    TM_DMA2DGRAPHIC_DrawVerticalLine(x0, y0 + r, 1, color);
-    TM_DMA2DGRAPHIC_DrawVerticalLine(x0, y0 - r, 1, color);
-    TM_DMA2DGRAPHIC_DrawVerticalLine(x0 + r, y0, 1, color);
-    TM_DMA2DGRAPHIC_DrawVerticalLine(x0 - r, y0, 1, color);
-    TM_DMA2DGRAPHIC_DrawHorizontalLine(x0 - r, y0, 2 * r, color);
-
-    while (x < y) {
-        if (f >= 0) {
-            y--;
-            ddF_y += 2;
-            f += ddF_y;
-        }
-        x++;
-        ddF_x += 2;
-        f += ddF_x;
-
-        TM_DMA2DGRAPHIC_DrawHorizontalLine(x0 - x, y0 + y, 2 * x, color);
-		TM_DMA2DGRAPHIC_DrawHorizontalLine(x0 - x, y0 - y, 2 * x, color);
-
-        TM_DMA2DGRAPHIC_DrawHorizontalLine(x0 - y, y0 + x, 2 * y, color);
-        TM_DMA2DGRAPHIC_DrawHorizontalLine(x0 - y, y0 - x, 2 * y, color);
-    }
+	TM_SPAN_Target_t Target;
+	
+	/* Draw with span rasterizer */
+	TM_INT_DMA2DGRAPHIC_GetTarget(&Target);
+	TM_SPAN_FillCircle(&Target, x0, y0, r, color);
 }
 
 void TM_DMA2DGRAPHIC_DrawTriangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t x3, uint16_t y3, uint32_t color) {
@@ -538,94 +525,389 @@ void TM_DMA2DGRAPHIC_DrawTriangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_
 
 
 void TM_DMA2DGRAPHIC_DrawFilledTriangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t x3, uint16_t y3, uint32_t color) {
-	int16_t deltax = 0, deltay = 0, x = 0, y = 0, xinc1 = 0, xinc2 = 0, 
-	yinc1 = 0, yinc2 = 0, den = 0, num = 0, numadd = 0, numpixels = 0, 
-	curpixel = 0;
+	TM_SPAN_Target_t Target;
+	
+	/* Draw with span rasterizer */
+	TM_INT_DMA2DGRAPHIC_GetTarget(&Target);
+	TM_SPAN_FillTriangle(&Target, x1, y1, x2, y2, x3, y3, color);
+}
 
-	deltax = ABS(x2 - x1);
-	deltay = ABS(y2 - y1);
-	x = x1;
-	y = y1;
+void TM_DMA2DGRAPHIC_DrawFilledPolygon(TM_DMA2DRAPHIC_Poly_t* Coordinates, uint16_t count, uint32_t color) {
+	TM_SPAN_Target_t Target;
+	TM_SPAN_Point_t Points[DMA2D_GRAPHIC_POLYGON_MAX_POINTS];
+	uint16_t i;
+	
+	/* Check count */
+	if (count > DMA2D_GRAPHIC_POLYGON_MAX_POINTS) {
+		return;
+	}
+	
+	/* Copy coordinates */
+	for (i = 0; i < count; i++) {
+		Points[i].X = Coordinates[i].X;
+		Points[i].Y = Coordinates[i].Y;
+	}
+	
+	/* Draw with span rasterizer */
+	TM_INT_DMA2DGRAPHIC_GetTarget(&Target);
+	TM_SPAN_FillConvexPolygon(&Target, Points, count, color);
+}
 
-	if (x2 >= x1) {
-		xinc1 = 1;
-		xinc2 = 1;
-	} else {
-		xinc1 = -1;
-		xinc2 = -1;
+void TM_DMA2DGRAPHIC_DrawLineAA(int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint32_t color) {
+	TM_SPAN_Target_t Target;
+	
+	/* Draw with anti-aliasing */
+	TM_INT_DMA2DGRAPHIC_GetTarget(&Target);
+	TM_AA_DrawLine(&Target, x1, y1, x2, y2, color);
+}
+
+void TM_DMA2DGRAPHIC_DrawThickLineAA(int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint8_t width, uint32_t color) {
+	TM_SPAN_Target_t Target;
+	
+	/* Draw with anti-aliasing */
+	TM_INT_DMA2DGRAPHIC_GetTarget(&Target);
+	TM_AA_DrawThickLine(&Target, x1, y1, x2, y2, width, color);
+}
+
+void TM_DMA2DGRAPHIC_DrawCircleAA(uint16_t x0, uint16_t y0, uint16_t r, uint32_t color) {
+	TM_SPAN_Target_t Target;
+	
+	/* Draw with anti-aliasing */
+	TM_INT_DMA2DGRAPHIC_GetTarget(&Target);
+	TM_AA_DrawCircle(&Target, x0, y0, r, color);
+}
+
+void TM_DMA2DGRAPHIC_DrawFilledCircleAA(uint16_t x0, uint16_t y0, uint16_t r, uint32_t color) {
+	TM_SPAN_Target_t Target;
+	
+	/* Draw with anti-aliasing */
+	TM_INT_DMA2DGRAPHIC_GetTarget(&Target);
+	TM_AA_DrawFilledCircle(&Target, x0, y0, r, color);
+}
+
+void TM_DMA2DGRAPHIC_DrawArcAA(uint16_t x0, uint16_t y0, uint16_t r, uint8_t width, uint16_t start, uint16_t end, uint32_t color) {
+	TM_SPAN_Target_t Target;
+	
+	/* Draw with anti-aliasing */
+	TM_INT_DMA2DGRAPHIC_GetTarget(&Target);
+	TM_AA_DrawArc(&Target, x0, y0, r, width, start, end, color);
+}
+
+void TM_DMA2DGRAPHIC_DrawPolygonAA(TM_DMA2DRAPHIC_Poly_t* Coordinates, uint16_t count, uint32_t color) {
+	TM_SPAN_Target_t Target;
+	TM_SPAN_Point_t Points[DMA2D_GRAPHIC_POLYGON_MAX_POINTS];
+	uint16_t i;
+	
+	/* Check count */
+	if (count > DMA2D_GRAPHIC_POLYGON_MAX_POINTS) {
+		return;
+	}
+	
+	/* Copy coordinates */
+	for (i = 0; i < count; i++) {
+		Points[i].X = Coordinates[i].X;
+		Points[i].Y = Coordinates[i].Y;
 	}
+	
+	/* Draw with anti-aliasing */
+	TM_INT_DMA2DGRAPHIC_GetTarget(&Target);
+	TM_AA_DrawPolygon(&Target, Points, count, color);
+}
 
-	if (y2 >= y1) {
-		yinc1 = 1;
-		yinc2 = 1;
+void TM_DMA2DGRAPHIC_DrawImage(int16_t x, int16_t y, const TM_DMA2DGRAPHIC_Image_t* Image) {
+	TM_DMA2DGRAPHIC_Command_t Command = {0};
+	uint16_t sx, sy, w, h;
+	uint8_t bpp;
+	
+	/* Clip to LCD */
+	if (!TM_INT_DMA2DGRAPHIC_ClipImage(&x, &y, Image, &sx, &sy, &w, &h)) {
+		return;
+	}
+	
+	/* DMA2D can not rotate, draw with CPU */
+	if (DIS.Orientation != 1) {
+		TM_INT_DMA2DGRAPHIC_DrawImageCPU(x, y, Image, sx, sy, w, h, 0, 0);
+		return;
+	}
+	
+	/* Bytes per source pixel */
+	if (Image->Format == TM_DMA2DGRAPHIC_ImageFormat_ARGB8888) {
+		bpp = 4;
+	} else if (Image->Format == TM_DMA2DGRAPHIC_ImageFormat_RGB565 || Image->Format == TM_DMA2DGRAPHIC_ImageFormat_ARGB4444) {
+		bpp = 2;
 	} else {
-		yinc1 = -1;
-		yinc2 = -1;
+		bpp = 1;
 	}
-
-	if (deltax >= deltay){
-		xinc1 = 0;
-		yinc2 = 0;
-		den = deltax;
-		num = deltax / 2;
-		numadd = deltay;
-		numpixels = deltax;
+	
+	/* Visible part of image */
+	Command.FGMAR = (uintptr_t)Image->Data + ((uint32_t)sy * Image->Width + sx) * bpp;
+	Command.FGOR = Image->Width - w;
+	Command.FGPFCCR = Image->Format;
+	Command.OMAR = DIS.StartAddress + DIS.Offset + DIS.PixelSize * ((uint32_t)y * DIS.Width + x);
+	Command.OOR = DIS.Width - w;
+	Command.OPFCCR = CM_RGB565;
+	Command.NLR = ((uint32_t)w << 16) | h;
+	
+	if (Image->Format == TM_DMA2DGRAPHIC_ImageFormat_RGB565) {
+		/* Opaque image, copy only */
+		Command.Mode = DMA2D_M2M;
 	} else {
-		xinc2 = 0;
-		yinc1 = 0;
-		den = deltay;
-		num = deltay / 2;
-		numadd = deltax;
-		numpixels = deltay;
+		/* Convert and blend over LCD content in one pass */
+		Command.Mode = DMA2D_M2M_BLEND;
+		Command.BGMAR = Command.OMAR;
+		Command.BGOR = Command.OOR;
+		Command.BGPFCCR = CM_RGB565;
+		
+		if (Image->Format == TM_DMA2DGRAPHIC_ImageFormat_L8) {
+			/* ARGB8888 lookup table is loaded before transfer */
+			Command.FGPFCCR |= ((uint32_t)(Image->CLUTSize - 1) << 8) & DMA2D_FGPFCCR_CS;
+			Command.FGCMAR = (uintptr_t)Image->CLUT;
+		} else if (Image->Format == TM_DMA2DGRAPHIC_ImageFormat_A8) {
+			/* RGB565 to RGB888 colour */
+			Command.FGCOLR = 
+				((uint32_t)(((Image->Color >> 8) & 0xF8) | (Image->Color >> 13)) << 16) |
+				((uint32_t)(((Image->Color >> 3) & 0xFC) | ((Image->Color >> 9) & 0x03)) << 8) |
+				(((Image->Color << 3) & 0xF8) | ((Image->Color >> 2) & 0x07));
+		}
 	}
+	
+	/* Put to queue */
+	TM_DMA2DGRAPHIC_Enqueue(&Command);
+}
 
-	for (curpixel = 0; curpixel <= numpixels; curpixel++) {
-		TM_DMA2DGRAPHIC_DrawLine(x, y, x3, y3, color);
-
-		num += numadd;
-		if (num >= den) {
-			num -= den;
-			x += xinc1;
-			y += yinc1;
-		}
-		x += xinc2;
-		y += yinc2;
+void TM_DMA2DGRAPHIC_DrawSprite(int16_t x, int16_t y, const TM_DMA2DGRAPHIC_Image_t* Image, uint32_t key) {
+	uint16_t sx, sy, w, h;
+	
+	/* Clip to LCD */
+	if (!TM_INT_DMA2DGRAPHIC_ClipImage(&x, &y, Image, &sx, &sy, &w, &h)) {
+		return;
 	}
+	
+	/* Draw with CPU, DMA2D has no colour key */
+	TM_INT_DMA2DGRAPHIC_DrawImageCPU(x, y, Image, sx, sy, w, h, key, 1);
 }
 
 void TM_DMA2DGRAPHIC_CopyBuffer(void* pSrc, void* pDst, uint32_t xSize, uint32_t ySize, uint32_t OffLineSrc, uint32_t OffLineDst) {
-	/* Copy buffer using interrupt */
+	/* Put copy to queue */
 	TM_DMA2DGRAPHIC_CopyBufferIT(pSrc, pDst, xSize, ySize, OffLineSrc, OffLineDst);
 
 	/* Wait until transfer is done */
-	DMA2D_WAIT;
+	TM_DMA2DGRAPHIC_WaitFence(TM_DMA2DGRAPHIC_Fence());
 }
 
-
 void TM_DMA2DGRAPHIC_CopyBufferIT(void* pSrc, void* pDst, uint32_t xSize, uint32_t ySize, uint32_t OffLineSrc, uint32_t OffLineDst) {
-	/* Wait for previous operation to be done */
-	DMA2D_WAIT;
+	TM_DMA2DGRAPHIC_Command_t Command = {0};
+	
+	/* Memory to memory, RGB565 */
+	Command.Mode = DMA2D_M2M;
+	Command.FGMAR = (uintptr_t)pSrc;
+	Command.FGOR = OffLineSrc;
+	Command.FGPFCCR = CM_RGB565;
+	Command.OMAR = (uintptr_t)pDst;
+	Command.OOR = OffLineDst;
+	Command.OPFCCR = CM_RGB565;
+	Command.NLR = (uint32_t)(xSize << 16) | (uint16_t)ySize;
 	
-	/* DeInit DMA2D */
-	RCC->AHB1RSTR |= RCC_AHB1RSTR_DMA2DRST;
-	RCC->AHB1RSTR &= ~RCC_AHB1RSTR_DMA2DRST;
+	/* Put to queue */
+	TM_DMA2DGRAPHIC_Enqueue(&Command);
+}
+
+void TM_DMA2DGRAPHIC_FillBufferIT(void* pDst, uint32_t xSize, uint32_t ySize, uint32_t OffLineDst, uint32_t color) {
+	TM_DMA2DGRAPHIC_Command_t Command = {0};
 	
-	DMA2D->CR = 0x00000000UL | (1 << 9);
+	/* Register to memory, RGB565 */
+	Command.Mode = DMA2D_R2M;
+	Command.OMAR = (uintptr_t)pDst;
+	Command.OOR = OffLineDst;
+	Command.OPFCCR = CM_RGB565;
+	Command.OCOLR = color & 0xFFFF;
+	Command.NLR = (uint32_t)(xSize << 16) | (uint16_t)ySize;
 	
-	/* Set up pointers */
-	DMA2D->FGMAR = (uint32_t)pSrc;                       
-	DMA2D->OMAR = (uint32_t)pDst;                       
-	DMA2D->FGOR = OffLineSrc;                      
-	DMA2D->OOR = OffLineDst; 
+	/* Put to queue */
+	TM_DMA2DGRAPHIC_Enqueue(&Command);
+}
 
-	/* Set up pixel format */  
-	DMA2D->FGPFCCR = LTDC_Pixelformat_RGB565;  
+void TM_DMA2DGRAPHIC_ConvertBufferIT(void* pSrc, void* pDst, uint32_t xSize, uint32_t ySize, uint32_t OffLineSrc, uint32_t OffLineDst, uint32_t SrcColorMode, uint32_t DstColorMode) {
+	TM_DMA2DGRAPHIC_Command_t Command = {0};
+	
+	/* Memory to memory with pixel format conversion */
+	Command.Mode = DMA2D_M2M_PFC;
+	Command.FGMAR = (uintptr_t)pSrc;
+	Command.FGOR = OffLineSrc;
+	Command.FGPFCCR = SrcColorMode;
+	Command.OMAR = (uintptr_t)pDst;
+	Command.OOR = OffLineDst;
+	Command.OPFCCR = DstColorMode;
+	Command.NLR = (uint32_t)(xSize << 16) | (uint16_t)ySize;
+	
+	/* Put to queue */
+	TM_DMA2DGRAPHIC_Enqueue(&Command);
+}
 
-	/* Set up size */
-	DMA2D->NLR = (uint32_t)(xSize << 16) | (uint16_t)ySize; 
+void TM_DMA2DGRAPHIC_BlendBufferIT(void* pFg, void* pBg, void* pDst, uint32_t xSize, uint32_t ySize, uint32_t OffLineFg, uint32_t OffLineBg, uint32_t OffLineDst, uint32_t FgColorMode, uint32_t FgColor) {
+	TM_DMA2DGRAPHIC_Command_t Command = {0};
+	
+	/* Memory to memory with blending */
+	Command.Mode = DMA2D_M2M_BLEND;
+	Command.FGMAR = (uintptr_t)pFg;
+	Command.FGOR = OffLineFg;
+	Command.FGPFCCR = FgColorMode;
+	Command.FGCOLR = FgColor & 0x00FFFFFF;
+	Command.BGMAR = (uintptr_t)pBg;
+	Command.BGOR = OffLineBg;
+	Command.BGPFCCR = CM_RGB565;
+	Command.OMAR = (uintptr_t)pDst;
+	Command.OOR = OffLineDst;
+	Command.OPFCCR = CM_RGB565;
+	Command.NLR = (uint32_t)(xSize << 16) | (uint16_t)ySize;
+	
+	/* Put to queue */
+	TM_DMA2DGRAPHIC_Enqueue(&Command);
+}
 
-	/* Start DMA2D */
-	DMA2D->CR |= DMA2D_CR_START; 
+uint32_t TM_DMA2DGRAPHIC_Enqueue(TM_DMA2DGRAPHIC_Command_t* Command) {
+	uint16_t next, depth;
+	uint32_t irq, fence;
+	
+	/* Prepare queue on first use */
+	if (!DMA2D_QueueInitialized) {
+		TM_INT_DMA2DGRAPHIC_InitQueue();
+	}
+	
+	/* Wait for free entry */
+	next = (DMA2D_QueueHead + 1) % DMA2D_GRAPHIC_QUEUE_SIZE;
+	if (next == DMA2D_QueueTail) {
+		DMA2D_Stats.Stalls++;
+		while (next == DMA2D_QueueTail) {
+			TM_INT_DMA2DGRAPHIC_Poll();
+		}
+	}
+	
+	/* Copy operation, entry is not used by interrupt until head is moved */
+	DMA2D_Queue[DMA2D_QueueHead] = *Command;
+	
+	/* Get interrupt status */
+	irq = __get_PRIMASK();
+	
+	/* Disable interrupts, transfer complete interrupt may stop queue meanwhile */
+	__disable_irq();
+	
+	/* Move head */
+	DMA2D_QueueHead = next;
+	fence = ++DMA2D_Stats.Submitted;
+	
+	/* Update statistics */
+	depth = (DMA2D_QueueHead + DMA2D_GRAPHIC_QUEUE_SIZE - DMA2D_QueueTail) % DMA2D_GRAPHIC_QUEUE_SIZE;
+	if (depth > DMA2D_Stats.MaxDepth) {
+		DMA2D_Stats.MaxDepth = depth;
+	}
+	
+	/* Start if DMA2D is not working on queue */
+	if (!DMA2D_QueueRunning) {
+		TM_INT_DMA2DGRAPHIC_Start();
+	}
+	
+	/* Enable IRQ if necessary */
+	if (!irq) {
+		__enable_irq();
+	}
+	
+	/* Process queue when interrupt is not used */
+	TM_INT_DMA2DGRAPHIC_Poll();
+	
+	/* Return fence of this operation */
+	return fence;
+}
+
+uint32_t TM_DMA2DGRAPHIC_Fence(void) {
+	/* Number of last queued operation */
+	return DMA2D_Stats.Submitted;
+}
+
+uint8_t TM_DMA2DGRAPHIC_IsFenceDone(uint32_t fence) {
+	/* Process queue when interrupt is not used */
+	TM_INT_DMA2DGRAPHIC_Poll();
+	
+	/* Counters may overflow, compare difference */
+	return (int32_t)(DMA2D_Stats.Completed - fence) >= 0;
+}
+
+void TM_DMA2DGRAPHIC_WaitFence(uint32_t fence) {
+	/* Wait till operations are done */
+	while (!TM_DMA2DGRAPHIC_IsFenceDone(fence));
+}
+
+uint32_t TM_DMA2DGRAPHIC_RegionFence(const void* Address, uint32_t Size) {
+	uintptr_t start = (uintptr_t)Address;
+	uint32_t irq, completed;
+	uint16_t tail, count;
+	
+	/* Process queue when interrupt is not used */
+	TM_INT_DMA2DGRAPHIC_Poll();
+	
+	/* Get interrupt status */
+	irq = __get_PRIMASK();
+	
+	/* Disable interrupts, tail and completed counter must match */
+	__disable_irq();
+	tail = DMA2D_QueueTail;
+	count = (DMA2D_QueueHead + DMA2D_GRAPHIC_QUEUE_SIZE - tail) % DMA2D_GRAPHIC_QUEUE_SIZE;
+	completed = DMA2D_Stats.Completed;
+	
+	/* Enable IRQ if necessary */
+	if (!irq) {
+		__enable_irq();
+	}
+	
+	/* Search from newest operation, entries are not reused before next TM_DMA2DGRAPHIC_Enqueue call */
+	for (; count > 0; count--) {
+		if (TM_INT_DMA2DGRAPHIC_Overlaps(&DMA2D_Queue[(tail + count - 1) % DMA2D_GRAPHIC_QUEUE_SIZE], start, start + Size)) {
+			return completed + count;
+		}
+	}
+	
+	/* No queued operation uses this memory */
+	return completed;
+}
+
+void TM_DMA2DGRAPHIC_WaitRegion(const void* Address, uint32_t Size) {
+	/* Wait only for operations which use this memory */
+	TM_DMA2DGRAPHIC_WaitFence(TM_DMA2DGRAPHIC_RegionFence(Address, Size));
+	
+#if DMA2D_GRAPHIC_SOFTWARE == 0
+	/* Memory of operation started by other libraries directly is not known */
+	while (!DMA2D_QueueRunning && DMA2D_WORKING);
+#endif
+}
+
+void TM_DMA2DGRAPHIC_Flush(void) {
+	/* Wait for all queued operations */
+	TM_DMA2DGRAPHIC_WaitFence(TM_DMA2DGRAPHIC_Fence());
+	
+#if DMA2D_GRAPHIC_SOFTWARE == 0
+	/* Wait for operation started by other libraries directly */
+	while (DMA2D_WORKING);
+	DMA2D->IFCR = DMA2D_IFSR_CTCIF;
+#endif
+}
+
+void TM_DMA2DGRAPHIC_GetStats(TM_DMA2DGRAPHIC_Stats_t* Stats) {
+	/* Copy statistics */
+	Stats->Submitted = DMA2D_Stats.Submitted;
+	Stats->Completed = DMA2D_Stats.Completed;
+	Stats->Depth = (DMA2D_QueueHead + DMA2D_GRAPHIC_QUEUE_SIZE - DMA2D_QueueTail) % DMA2D_GRAPHIC_QUEUE_SIZE;
+	Stats->MaxDepth = DMA2D_Stats.MaxDepth;
+	Stats->Stalls = DMA2D_Stats.Stalls;
+	Stats->Errors = DMA2D_Stats.Errors;
+	Stats->BusyTime = DMA2D_Stats.BusyTime;
+}
+
+void TM_DMA2DGRAPHIC_ResetStats(void) {
+	/* Counters for fences are not reset */
+	DMA2D_Stats.MaxDepth = 0;
+	DMA2D_Stats.Stalls = 0;
+	DMA2D_Stats.Errors = 0;
+	DMA2D_Stats.BusyTime = 0;
 }
 
 /* Private functions */
@@ -644,26 +926,26 @@ void TM_INT_DMA2DGRAPHIC_SetConf(TM_DMA2DGRAPHIC_INT_Conf_t* Conf) {
 }
 
 void TM_INT_DMA2DGRAPHIC_InitAndTransfer(void) {
-	/* Wait until transfer is done first from other calls */
-	DMA2D_WAIT;
-	
-	/* DeInit DMA2D */
-	RCC->AHB1RSTR |= RCC_AHB1RSTR_DMA2DRST;
-	RCC->AHB1RSTR &= ~RCC_AHB1RSTR_DMA2DRST;
+	TM_DMA2DGRAPHIC_Command_t Command = {0};
 	
-	/* Initialize DMA2D */
-	DMA2D_Init(&GRAPHIC_DMA2D_InitStruct);
+	/* Register to memory operation from init structure */
+	Command.Mode = GRAPHIC_DMA2D_InitStruct.DMA2D_Mode;
+	Command.OPFCCR = GRAPHIC_DMA2D_InitStruct.DMA2D_CMode;
+	Command.OCOLR = 
+		(GRAPHIC_DMA2D_InitStruct.DMA2D_OutputRed << 11) |
+		(GRAPHIC_DMA2D_InitStruct.DMA2D_OutputGreen << 5) |
+		GRAPHIC_DMA2D_InitStruct.DMA2D_OutputBlue;
+	Command.OMAR = GRAPHIC_DMA2D_OutputAddress;
+	Command.OOR = GRAPHIC_DMA2D_InitStruct.DMA2D_OutputOffset;
+	Command.NLR = (GRAPHIC_DMA2D_InitStruct.DMA2D_PixelPerLine << 16) | GRAPHIC_DMA2D_InitStruct.DMA2D_NumberOfLine;
 	
-	/* Start transfer */
-	DMA2D->CR |= (uint32_t)DMA2D_CR_START;
-	
-	/* Wait till transfer ends */
-	DMA2D_WAIT;
+	/* Put to queue, do not wait */
+	TM_DMA2DGRAPHIC_Enqueue(&Command);
 }
 
 void TM_INT_DMA2DGRAPHIC_SetMemory(uint32_t MemoryAddress, uint32_t Offset, uint32_t NumberOfLine, uint32_t PixelPerLine) {	
 	/* Set memory settings */
-	GRAPHIC_DMA2D_InitStruct.DMA2D_OutputMemoryAdd = DIS.StartAddress + DIS.Offset + MemoryAddress;
+	GRAPHIC_DMA2D_OutputAddress = DIS.StartAddress + DIS.Offset + MemoryAddress;
 	GRAPHIC_DMA2D_InitStruct.DMA2D_OutputOffset = Offset;
 	GRAPHIC_DMA2D_InitStruct.DMA2D_NumberOfLine = NumberOfLine;
 	GRAPHIC_DMA2D_InitStruct.DMA2D_PixelPerLine = PixelPerLine;
@@ -708,41 +990,537 @@ void TM_INT_DMA2DGRAPHIC_DrawCircleCorner(int16_t x0, int16_t y0, int16_t r, uin
     }
 }
 
-void TM_INT_DMA2DGRAPHIC_DrawFilledCircleCorner(int16_t x0, int16_t y0, int16_t r, uint8_t corner, uint32_t color) {
-	int16_t f = 1 - r;
-	int16_t ddF_x = 1;
-	int16_t ddF_y = -2 * r;
-	int16_t x = 0;
-	int16_t y = r;
+void TM_INT_DMA2DGRAPHIC_GetTarget(TM_SPAN_Target_t* Target) {
+	/* Framebuffer of current layer */
+	Target->Address = DIS.StartAddress + DIS.Offset;
+	Target->Pitch = DIS.Width;
+	Target->Width = DIS.CurrentWidth;
+	Target->Height = DIS.CurrentHeight;
+	
+	/* Memory index of pixel for each orientation, same as in TM_DMA2DGRAPHIC_DrawPixel */
+	if (DIS.Orientation == 1) { /* Normal */
+		Target->Base = 0;
+		Target->StepX = 1;
+		Target->StepY = DIS.Width;
+	} else if (DIS.Orientation == 0) { /* 180 */
+		Target->Base = DIS.Height * DIS.Width - 1;
+		Target->StepX = -1;
+		Target->StepY = -(int32_t)DIS.Width;
+	} else if (DIS.Orientation == 3) { /* 90 */
+		Target->Base = DIS.Width - 1;
+		Target->StepX = DIS.Width;
+		Target->StepY = -1;
+	} else { /* 270 */
+		Target->Base = (DIS.Height - 1) * DIS.Width;
+		Target->StepX = -(int32_t)DIS.Width;
+		Target->StepY = 1;
+	}
+}
 
-    while (x < y) {
-        if (f >= 0) {
-            y--;
-            ddF_y += 2;
-            f += ddF_y;
-        }
-        x++;
-        ddF_x += 2;
-        f += ddF_x;
+static void TM_INT_DMA2DGRAPHIC_InitQueue(void) {
+#if DMA2D_GRAPHIC_USE_IRQ == 1 && DMA2D_GRAPHIC_SOFTWARE == 0
+	NVIC_InitTypeDef NVIC_InitStruct;
+#endif
+	
+#if DMA2D_GRAPHIC_SOFTWARE == 0
+	/* Enable DMA2D clock */
+	RCC->AHB1ENR |= RCC_AHB1ENR_DMA2DEN;
+#endif
+	
+#if DMA2D_GRAPHIC_USE_DWT == 1
+	/* Enable DWT cycle counter for busy time */
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+	
+#if DMA2D_GRAPHIC_USE_IRQ == 1 && DMA2D_GRAPHIC_SOFTWARE == 0
+	/* Set NVIC */
+	NVIC_InitStruct.NVIC_IRQChannel = DMA2D_IRQn;
+	NVIC_InitStruct.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_InitStruct.NVIC_IRQChannelPreemptionPriority = DMA2D_GRAPHIC_NVIC_PRIORITY;
+	NVIC_InitStruct.NVIC_IRQChannelSubPriority = DMA2D_GRAPHIC_NVIC_SUBPRIORITY;
+	NVIC_Init(&NVIC_InitStruct);
+#endif
+	
+	/* Initialized */
+	DMA2D_QueueInitialized = 1;
+}
 
-        if (corner & 0x01) {/* Top left */
-			TM_DMA2DGRAPHIC_DrawLine(x0, y0 - y, x0 - x, y0 - y, color);
-			TM_DMA2DGRAPHIC_DrawLine(x0, y0 - x, x0 - y, y0 - x, color);
-		}
+static void TM_INT_DMA2DGRAPHIC_Start(void) {
+	TM_DMA2DGRAPHIC_Command_t* Command = &DMA2D_Queue[DMA2D_QueueTail];
+	
+#if DMA2D_GRAPHIC_SOFTWARE == 1
+	/* Operation is done with CPU before function returns */
+	DMA2D_QueueRunning = 1;
+	DMA2D_StartTime = DMA2D_GRAPHIC_CYCLES();
+	TM_INT_DMA2DGRAPHIC_Execute(Command);
+	TM_INT_DMA2DGRAPHIC_Complete();
+#else
+	/* Other libraries may still use DMA2D directly */
+	while (DMA2D_WORKING);
+	DMA2D->IFCR = DMA2D_IFSR_CTCIF | DMA2D_IFSR_CTEIF | DMA2D_IFSR_CCEIF | DMA2D_IFSR_CCAEIF;
+	
+	/* Set registers */
+	DMA2D->FGMAR = Command->FGMAR;
+	DMA2D->FGOR = Command->FGOR;
+	DMA2D->FGPFCCR = Command->FGPFCCR;
+	DMA2D->FGCOLR = Command->FGCOLR;
+	
+	/* Load CLUT, it takes one cycle per colour */
+	if (Command->FGCMAR) {
+		DMA2D->FGCMAR = Command->FGCMAR;
+		DMA2D->FGPFCCR = Command->FGPFCCR | DMA2D_FGPFCCR_START;
+		while (DMA2D->FGPFCCR & DMA2D_FGPFCCR_START);
+	}
+	DMA2D->BGMAR = Command->BGMAR;
+	DMA2D->BGOR = Command->BGOR;
+	DMA2D->BGPFCCR = Command->BGPFCCR;
+	DMA2D->OMAR = Command->OMAR;
+	DMA2D->OOR = Command->OOR;
+	DMA2D->OPFCCR = Command->OPFCCR;
+	DMA2D->OCOLR = Command->OCOLR;
+	DMA2D->NLR = Command->NLR;
+	
+	/* Start */
+	DMA2D_QueueRunning = 1;
+	DMA2D_StartTime = DMA2D_GRAPHIC_CYCLES();
+#if DMA2D_GRAPHIC_USE_IRQ == 1
+	DMA2D->CR = Command->Mode | DMA2D_CR_TCIE | DMA2D_CR_TEIE | DMA2D_CR_CEIE | DMA2D_CR_START;
+#else
+	DMA2D->CR = Command->Mode | DMA2D_CR_START;
+#endif
+#endif
+}
+
+static void TM_INT_DMA2DGRAPHIC_Complete(void) {
+#if DMA2D_GRAPHIC_SOFTWARE == 0
+	/* Failed operation is completed too, so waiting for fence does not block */
+	if (DMA2D->ISR & (DMA2D_ISR_TEIF | DMA2D_ISR_CEIF | DMA2D_ISR_CAEIF)) {
+		DMA2D_Stats.Errors++;
+	}
+	
+	/* Clear flags */
+	DMA2D->IFCR = DMA2D_IFSR_CTCIF | DMA2D_IFSR_CTEIF | DMA2D_IFSR_CCEIF | DMA2D_IFSR_CCAEIF;
+#endif
+	
+	/* Operation done */
+	DMA2D_Stats.BusyTime += DMA2D_GRAPHIC_CYCLES() - DMA2D_StartTime;
+	DMA2D_Stats.Completed++;
+	DMA2D_QueueTail = (DMA2D_QueueTail + 1) % DMA2D_GRAPHIC_QUEUE_SIZE;
+	DMA2D_QueueRunning = 0;
+	
+	/* Start next operation */
+	if (DMA2D_QueueTail != DMA2D_QueueHead) {
+		TM_INT_DMA2DGRAPHIC_Start();
+	}
+}
+
+static void TM_INT_DMA2DGRAPHIC_Poll(void) {
+#if DMA2D_GRAPHIC_USE_IRQ == 0 && DMA2D_GRAPHIC_SOFTWARE == 0
+	uint32_t irq;
+	
+	/* Get interrupt status */
+	irq = __get_PRIMASK();
+	__disable_irq();
+	
+	/* Check if queued operation is done */
+	if (DMA2D_QueueRunning && !DMA2D_WORKING) {
+		TM_INT_DMA2DGRAPHIC_Complete();
+	}
+	
+	/* Enable IRQ if necessary */
+	if (!irq) {
+		__enable_irq();
+	}
+#endif
+}
+
+#if DMA2D_GRAPHIC_USE_IRQ == 1 && DMA2D_GRAPHIC_SOFTWARE == 0
+/* DMA2D IRQ Handler */
+void DMA2D_IRQHandler(void) {
+	/* Check transfer complete and error flags, error stops transfer without transfer complete flag */
+	if (DMA2D->ISR & (DMA2D_ISR_TCIF | DMA2D_ISR_TEIF | DMA2D_ISR_CEIF)) {
+		TM_INT_DMA2DGRAPHIC_Complete();
+	}
+}
+#endif
+
+static __IO uint16_t* TM_INT_DMA2DGRAPHIC_PixelAddress(uint16_t x, uint16_t y) {
+	uintptr_t address = DIS.StartAddress + DIS.Offset;
+	
+	if (DIS.Orientation == 1) { /* Normal */
+		return (__IO uint16_t *) (address + DIS.PixelSize * (y * DIS.Width + x));
+	} else if (DIS.Orientation == 0) { /* 180 */
+		return (__IO uint16_t *) (address + DIS.PixelSize * ((DIS.Height - y - 1) * DIS.Width + (DIS.Width - x - 1)));
+	} else if (DIS.Orientation == 3) { /* 90 */ /* x + width * y */
+		return (__IO uint16_t *) (address + DIS.PixelSize * ((x) * DIS.Width + DIS.Width - y - 1));
+	}
+	/* 270 */
+	return (__IO uint16_t *) (address + DIS.PixelSize * ((DIS.Height - x - 1) * DIS.Width + y));
+}
+
+static uint8_t TM_INT_DMA2DGRAPHIC_Overlaps(const TM_DMA2DGRAPHIC_Command_t* Command, uintptr_t start, uintptr_t end) {
+	uint32_t pixels = Command->NLR >> 16, lines = Command->NLR & 0xFFFF;
+	uint8_t fgBytes = TM_INT_DMA2DGRAPHIC_PixelBytes(Command->FGPFCCR & 0x0F);
+	
+	/* Output memory, copy without conversion has foreground pixel size */
+	if (TM_INT_DMA2DGRAPHIC_BufferOverlaps(Command->OMAR, Command->OOR, Command->Mode == DMA2D_M2M ? fgBytes : TM_INT_DMA2DGRAPHIC_PixelBytes(Command->OPFCCR & 0x07), pixels, lines, start, end)) {
+		return 1;
+	}
+	
+	/* Foreground is read in all memory to memory modes, CPU must not change it either */
+	if (Command->Mode != DMA2D_R2M && TM_INT_DMA2DGRAPHIC_BufferOverlaps(Command->FGMAR, Command->FGOR, fgBytes, pixels, lines, start, end)) {
+		return 1;
+	}
+	
+	/* Background is read only when blending */
+	if (Command->Mode == DMA2D_M2M_BLEND && TM_INT_DMA2DGRAPHIC_BufferOverlaps(Command->BGMAR, Command->BGOR, TM_INT_DMA2DGRAPHIC_PixelBytes(Command->BGPFCCR & 0x0F), pixels, lines, start, end)) {
+		return 1;
+	}
+	
+	return 0;
+}
+
+static uint8_t TM_INT_DMA2DGRAPHIC_BufferOverlaps(uintptr_t address, uint32_t offset, uint8_t bytes, uint32_t pixels, uint32_t lines, uintptr_t start, uintptr_t end) {
+	/* Nothing is transferred */
+	if (pixels == 0 || lines == 0) {
+		return 0;
+	}
+	
+	/* Memory from first to last pixel, line offsets in between are included */
+	return address < end && start < (address + ((lines - 1) * (pixels + offset) + pixels) * bytes);
+}
+
+static uint8_t TM_INT_DMA2DGRAPHIC_PixelBytes(uint32_t format) {
+	switch (format) {
+		case CM_ARGB8888:
+			return 4;
+		case CM_RGB888:
+			return 3;
+		case CM_L8:
+		case CM_AL44:
+		case CM_A8:
+		case CM_L4:
+		case CM_A4:
+			return 1;
+		default:
+			return 2;
+	}
+}
+
+static uint8_t TM_INT_DMA2DGRAPHIC_ClipImage(int16_t* x, int16_t* y, const TM_DMA2DGRAPHIC_Image_t* Image, uint16_t* sx, uint16_t* sy, uint16_t* w, uint16_t* h) {
+	int32_t x0 = *x, y0 = *y, x1, y1;
+	
+	/* L8 image needs lookup table, DMA2D CLUT has 1 to 256 colours */
+	if (
+		Image->Format == TM_DMA2DGRAPHIC_ImageFormat_L8 &&
+		(Image->CLUT == 0 || Image->CLUTSize == 0 || Image->CLUTSize > 256)
+	) {
+		return 0;
+	}
+	
+	/* Visible rectangle on LCD, right and bottom coordinates excluded */
+	x1 = x0 + Image->Width;
+	y1 = y0 + Image->Height;
+	if (x0 < 0) {
+		x0 = 0;
+	}
+	if (y0 < 0) {
+		y0 = 0;
+	}
+	if (x1 > DIS.CurrentWidth) {
+		x1 = DIS.CurrentWidth;
+	}
+	if (y1 > DIS.CurrentHeight) {
+		y1 = DIS.CurrentHeight;
+	}
+	if (x0 >= x1 || y0 >= y1) {
+		return 0;
+	}
+	
+	/* First visible image pixel */
+	*sx = x0 - *x;
+	*sy = y0 - *y;
+	*w = x1 - x0;
+	*h = y1 - y0;
+	*x = x0;
+	*y = y0;
+	
+	return 1;
+}
+
+static void TM_INT_DMA2DGRAPHIC_DrawImageCPU(int16_t x, int16_t y, const TM_DMA2DGRAPHIC_Image_t* Image, uint16_t sx, uint16_t sy, uint16_t w, uint16_t h, uint32_t key, uint8_t use_key) {
+	TM_SPAN_Target_t Target;
+	uint16_t* fb;
+	int32_t line;
+	uint32_t index, p, argb;
+	uint16_t i, j, color = 0;
+	uint8_t alpha = 0;
+	
+	/* Framebuffer is read by CPU */
+	DMA2D_WAIT;
+	
+	/* Memory index in current orientation */
+	TM_INT_DMA2DGRAPHIC_GetTarget(&Target);
+	fb = (uint16_t *)Target.Address;
+	
+	for (j = 0; j < h; j++) {
+		line = Target.Base + x * Target.StepX + (y + j) * Target.StepY;
+		index = (uint32_t)(sy + j) * Image->Width + sx;
 		
-        if (corner & 0x02) {/* Top right */
-			TM_DMA2DGRAPHIC_DrawLine(x0 + x, y0 - y, x0, y0 - y, color);
-			TM_DMA2DGRAPHIC_DrawLine(x0 + y, y0 - x, x0, y0 - x, color);
+		for (i = 0; i < w; i++, index++, line += Target.StepX) {
+			/* Read pixel and convert to RGB565 with alpha */
+			switch (Image->Format) {
+				case TM_DMA2DGRAPHIC_ImageFormat_RGB565:
+					p = ((const uint16_t *)Image->Data)[index];
+					color = p;
+					alpha = 0xFF;
+					break;
+				case TM_DMA2DGRAPHIC_ImageFormat_ARGB4444:
+					p = ((const uint16_t *)Image->Data)[index];
+					color = ((p & 0x0F00) << 4) | ((p & 0x0800) << 0) | ((p & 0x00F0) << 3) | ((p & 0x00C0) >> 1) | ((p & 0x000F) << 1) | ((p & 0x0008) >> 3);
+					alpha = (p >> 12) * 17;
+					break;
+				case TM_DMA2DGRAPHIC_ImageFormat_A8:
+					p = ((const uint8_t *)Image->Data)[index];
+					color = Image->Color;
+					alpha = p;
+					break;
+				default: /* ARGB8888 and L8 */
+					if (Image->Format == TM_DMA2DGRAPHIC_ImageFormat_L8) {
+						p = ((const uint8_t *)Image->Data)[index];
+						argb = p < Image->CLUTSize ? Image->CLUT[p] : 0;
+					} else {
+						p = ((const uint32_t *)Image->Data)[index];
+						argb = p;
+					}
+					color = ((argb >> 8) & 0xF800) | ((argb >> 5) & 0x07E0) | ((argb >> 3) & 0x001F);
+					alpha = argb >> 24;
+					break;
+			}
+			
+			/* Transparent pixels */
+			if ((use_key && p == key) || alpha == 0) {
+				continue;
+			}
+			
+			/* Write or blend */
+			if (alpha == 0xFF) {
+				fb[line] = color;
+			} else {
+				fb[line] = TM_INT_DMA2DGRAPHIC_BlendPixel(fb[line], color, alpha);
+			}
 		}
-		
-		if (corner & 0x04) {/* Bottom right */
-			TM_DMA2DGRAPHIC_DrawLine(x0, y0 + y, x0 + x, y0 + y, color);
-			TM_DMA2DGRAPHIC_DrawLine(x0 + y, y0 + x, x0, y0 + x, color);
+	}
+}
+
+static uint16_t TM_INT_DMA2DGRAPHIC_BlendPixel(uint16_t bg, uint16_t fg, uint8_t alpha) {
+	uint32_t b, f, a;
+	
+	/* Expand to 00000GGGGGG00000RRRRR000000BBBBB and blend all components with one multiplication */
+	a = ((uint32_t)alpha + 4) >> 3;
+	b = (bg | ((uint32_t)bg << 16)) & 0x07E0F81F;
+	f = (fg | ((uint32_t)fg << 16)) & 0x07E0F81F;
+	b = ((f * a + b * (32 - a)) >> 5) & 0x07E0F81F;
+	
+	return (uint16_t)(b | (b >> 16));
+}
+
+#if DMA2D_GRAPHIC_SOFTWARE == 1
+static void TM_INT_DMA2DGRAPHIC_Execute(const TM_DMA2DGRAPHIC_Command_t* Command) {
+	uint32_t pixels = Command->NLR >> 16, lines = Command->NLR & 0xFFFF;
+	uint32_t fgIndex = 0, bgIndex = 0, outIndex = 0;
+	uint32_t x, y, fg, bg, af, ab, am, ao;
+	uint8_t fgBytes, outBytes;
+	
+	fgBytes = TM_INT_DMA2DGRAPHIC_PixelBytes(Command->FGPFCCR & 0x0F);
+	outBytes = TM_INT_DMA2DGRAPHIC_PixelBytes(Command->OPFCCR & 0x07);
+	
+	for (y = 0; y < lines; y++) {
+		for (x = 0; x < pixels; x++) {
+			if (Command->Mode == DMA2D_R2M) {
+				/* Colour register is already in output format */
+				TM_INT_DMA2DGRAPHIC_WriteRaw(Command->OMAR, outIndex, outBytes, Command->OCOLR);
+			} else if (Command->Mode == DMA2D_M2M) {
+				/* Copy without conversion, foreground format gives pixel size */
+				TM_INT_DMA2DGRAPHIC_WriteRaw(Command->OMAR, outIndex, fgBytes, TM_INT_DMA2DGRAPHIC_ReadRaw(Command->FGMAR, fgIndex, fgBytes));
+			} else {
+				/* Foreground to ARGB8888 */
+				fg = TM_INT_DMA2DGRAPHIC_ReadPixel(Command->FGMAR, fgIndex, Command->FGPFCCR, Command->FGCOLR, Command->FGCMAR);
+				
+				if (Command->Mode == DMA2D_M2M_BLEND) {
+					bg = TM_INT_DMA2DGRAPHIC_ReadPixel(Command->BGMAR, bgIndex, Command->BGPFCCR, 0, 0);
+					
+					/* Blending formula from reference manual */
+					af = fg >> 24;
+					ab = bg >> 24;
+					am = af * ab / 255;
+					ao = af + ab - am;
+					if (ao) {
+						fg = 
+							(ao << 24) |
+							((((fg >> 16) & 0xFF) * af + ((bg >> 16) & 0xFF) * (ab - am)) / ao) << 16 |
+							((((fg >> 8) & 0xFF) * af + ((bg >> 8) & 0xFF) * (ab - am)) / ao) << 8 |
+							(((fg & 0xFF) * af + (bg & 0xFF) * (ab - am)) / ao);
+					} else {
+						fg = 0;
+					}
+					bgIndex++;
+				}
+				
+				/* ARGB8888 to output format */
+				TM_INT_DMA2DGRAPHIC_WritePixel(Command->OMAR, outIndex, Command->OPFCCR & 0x07, fg);
+			}
+			fgIndex++;
+			outIndex++;
 		}
 		
-        if (corner & 0x08) {/* Bottom left */
-			TM_DMA2DGRAPHIC_DrawLine(x0 - x, y0 + y, x0, y0 + y, color);
-			TM_DMA2DGRAPHIC_DrawLine(x0, y0 + x, x0 - y, y0 + x, color);
-		}
-    }
+		/* Go to next line */
+		fgIndex += Command->FGOR;
+		bgIndex += Command->BGOR;
+		outIndex += Command->OOR;
+	}
+}
+
+static uint32_t TM_INT_DMA2DGRAPHIC_ReadPixel(uintptr_t address, uint32_t index, uint32_t pfccr, uint32_t color, uintptr_t clut) {
+	uint32_t argb, v, alpha;
+	uint8_t* p;
+	
+	switch (pfccr & 0x0F) {
+		case CM_ARGB8888:
+			argb = *((uint32_t *)address + index);
+			break;
+		case CM_RGB888:
+			p = (uint8_t *)address + index * 3;
+			argb = 0xFF000000 | ((uint32_t)p[2] << 16) | ((uint32_t)p[1] << 8) | p[0];
+			break;
+		case CM_RGB565:
+			v = *((uint16_t *)address + index);
+			argb = 0xFF000000 |
+				((((v >> 8) & 0xF8) | (v >> 13)) << 16) |
+				((((v >> 3) & 0xFC) | ((v >> 9) & 0x03)) << 8) |
+				(((v << 3) & 0xF8) | ((v >> 2) & 0x07));
+			break;
+		case CM_ARGB1555:
+			v = *((uint16_t *)address + index);
+			argb = ((v & 0x8000) ? 0xFF000000 : 0) |
+				((((v >> 7) & 0xF8) | ((v >> 12) & 0x07)) << 16) |
+				((((v >> 2) & 0xF8) | ((v >> 7) & 0x07)) << 8) |
+				(((v << 3) & 0xF8) | ((v >> 2) & 0x07));
+			break;
+		case CM_ARGB4444:
+			v = *((uint16_t *)address + index);
+			argb = 
+				((v >> 12) * 0x11) << 24 |
+				(((v >> 8) & 0x0F) * 0x11) << 16 |
+				(((v >> 4) & 0x0F) * 0x11) << 8 |
+				((v & 0x0F) * 0x11);
+			break;
+		case CM_L8:
+		case CM_AL44:
+		case CM_AL88:
+		case CM_L4:
+			/* Index to colour lookup table, alpha only for AL44 and AL88 */
+			alpha = 0x100;
+			if ((pfccr & 0x0F) == CM_L8) {
+				v = *((uint8_t *)address + index);
+			} else if ((pfccr & 0x0F) == CM_AL44) {
+				v = *((uint8_t *)address + index);
+				alpha = (v >> 4) * 0x11;
+				v &= 0x0F;
+			} else if ((pfccr & 0x0F) == CM_AL88) {
+				v = *((uint16_t *)address + index);
+				alpha = v >> 8;
+				v &= 0xFF;
+			} else {
+				v = (*((uint8_t *)address + index / 2) >> ((index & 1) * 4)) & 0x0F;
+			}
+			if (pfccr & DMA2D_FGPFCCR_CCM) {
+				/* RGB888 table */
+				p = (uint8_t *)clut + v * 3;
+				argb = 0xFF000000 | ((uint32_t)p[2] << 16) | ((uint32_t)p[1] << 8) | p[0];
+			} else {
+				argb = *((uint32_t *)clut + v);
+			}
+			if (alpha != 0x100) {
+				argb = (argb & 0x00FFFFFF) | (alpha << 24);
+			}
+			break;
+		case CM_A8:
+			argb = ((uint32_t)*((uint8_t *)address + index) << 24) | (color & 0x00FFFFFF);
+			break;
+		case CM_A4:
+			v = (*((uint8_t *)address + index / 2) >> ((index & 1) * 4)) & 0x0F;
+			argb = ((v * 0x11) << 24) | (color & 0x00FFFFFF);
+			break;
+		default:
+			argb = 0;
+			break;
+	}
+	
+	/* Alpha mode, value is in upper 8 bits */
+	if ((pfccr & DMA2D_FGPFCCR_AM) == (1 << 16)) {
+		argb = (argb & 0x00FFFFFF) | (pfccr & 0xFF000000);
+	} else if ((pfccr & DMA2D_FGPFCCR_AM) == (2 << 16)) {
+		argb = (argb & 0x00FFFFFF) | (((argb >> 24) * (pfccr >> 24) / 255) << 24);
+	}
+	
+	return argb;
+}
+
+static void TM_INT_DMA2DGRAPHIC_WritePixel(uintptr_t address, uint32_t index, uint32_t format, uint32_t argb) {
+	uint32_t v;
+	
+	/* Colour channels are truncated */
+	switch (format) {
+		case CM_ARGB8888:
+			v = argb;
+			break;
+		case CM_RGB888:
+			v = argb & 0x00FFFFFF;
+			break;
+		case CM_RGB565:
+			v = ((argb >> 8) & 0xF800) | ((argb >> 5) & 0x07E0) | ((argb >> 3) & 0x001F);
+			break;
+		case CM_ARGB1555:
+			v = ((argb >> 16) & 0x8000) | ((argb >> 9) & 0x7C00) | ((argb >> 6) & 0x03E0) | ((argb >> 3) & 0x001F);
+			break;
+		default: /* CM_ARGB4444 */
+			v = ((argb >> 16) & 0xF000) | ((argb >> 12) & 0x0F00) | ((argb >> 8) & 0x00F0) | ((argb >> 4) & 0x000F);
+			break;
+	}
+	
+	TM_INT_DMA2DGRAPHIC_WriteRaw(address, index, TM_INT_DMA2DGRAPHIC_PixelBytes(format), v);
+}
+
+static uint32_t TM_INT_DMA2DGRAPHIC_ReadRaw(uintptr_t address, uint32_t index, uint8_t bytes) {
+	uint8_t* p;
+	
+	if (bytes == 4) {
+		return *((uint32_t *)address + index);
+	} else if (bytes == 3) {
+		p = (uint8_t *)address + index * 3;
+		return ((uint32_t)p[2] << 16) | ((uint32_t)p[1] << 8) | p[0];
+	} else if (bytes == 2) {
+		return *((uint16_t *)address + index);
+	}
+	return *((uint8_t *)address + index);
+}
+
+static void TM_INT_DMA2DGRAPHIC_WriteRaw(uintptr_t address, uint32_t index, uint8_t bytes, uint32_t value) {
+	uint8_t* p;
+	
+	if (bytes == 4) {
+		*((uint32_t *)address + index) = value;
+	} else if (bytes == 3) {
+		p = (uint8_t *)address + index * 3;
+		p[0] = value;
+		p[1] = value >> 8;
+		p[2] = value >> 16;
+	} else if (bytes == 2) {
+		*((uint16_t *)address + index) = value;
+	} else {
+		*((uint8_t *)address + index) = value;
+	}
 }
+#endif
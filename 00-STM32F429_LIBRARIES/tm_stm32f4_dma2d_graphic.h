@@ -3,7 +3,7 @@
  * @email   tilen@majerle.eu
  * @website http://stm32f4-discovery.net
  * @link    http://stm32f4-discovery.net/2015/01/library-51-chrom-art-accelerator-dma2d-graphic-library-on-stm32f429-discovery
- * @version v1.0
+ * @version v1.5
  * @ide     Keil uVision
  * @license GNU GPL v3
  * @brief   Graphic library for LCD using DMA2D for transferring graphic data to memory for LCD display
@@ -28,7 +28,7 @@
 @endverbatim
  */
 #ifndef TM_DMA2DGRAPHIC_H
-#define TM_DMA2DGRAPHIC_H 100
+#define TM_DMA2DGRAPHIC_H 150
 
 /* C++ detection */
 #ifdef __cplusplus
@@ -63,10 +63,94 @@ extern "C" {
  * Also, this library should be used for moving elements on screen, like playing movies.
  * Transmissions between memory is very fast which allows you to make smooth transmissions.
  *
+ * \par Command queue
+ *
+ * Drawing functions do not wait for DMA2D to finish. Each operation (fill, copy, pixel format conversion or blend)
+ * is stored to ring buffer of prepared register values and function returns immediately.
+ * When DMA2D finishes one operation, transfer complete interrupt starts next one from queue.
+ * If queue is full, function waits for free entry.
+ *
+ * Before CPU reads or writes memory which is also used by queued operations, queue must be finished:
+ *  - @ref TM_DMA2DGRAPHIC_Flush waits for all queued operations
+ *  - @ref TM_DMA2DGRAPHIC_Fence returns number of last queued operation,
+ *    which can later be checked with @ref TM_DMA2DGRAPHIC_IsFenceDone or waited with @ref TM_DMA2DGRAPHIC_WaitFence
+ *  - @ref TM_DMA2DGRAPHIC_WaitRegion waits only for queued operations which read or write selected memory,
+ *    other operations stay in queue. @ref TM_DMA2DGRAPHIC_DrawPixel, @ref TM_DMA2DGRAPHIC_GetPixel and TM SPAN CPU fills use it
+ *
+ * @ref DMA2D_WAIT macro, used by other libraries, flushes the queue.
+ *
+ * Queue depth and DMA2D busy time (in CPU cycles, measured with DWT counter) are available with @ref TM_DMA2DGRAPHIC_GetStats.
+ *
+ * \par DMA2D interrupt
+ *
+ * Library uses DMA2D_IRQHandler. If your project already uses DMA2D interrupt (for example emWin), add line below to defines.h file.
+ * Queue is then processed from library functions, each time they are called or wait for queue.
+ *
+@verbatim
+//Do not use DMA2D interrupt for command queue
+#define DMA2D_GRAPHIC_USE_IRQ      0
+@endverbatim
+ *
+ *
+ * \par Images
+ *
+ * Images and sprites are described with @ref TM_DMA2DGRAPHIC_Image_t structure and can be in
+ * RGB565, ARGB8888, ARGB4444, L8 (with ARGB8888 colour lookup table) or A8 format.
+ *
+ * @ref TM_DMA2DGRAPHIC_DrawImage puts one DMA2D operation per image to command queue:
+ *  - RGB565 images are copied
+ *  - Other formats are converted and blended over LCD content in the same pass. CLUT of L8 images is loaded to DMA2D before transfer
+ *
+ * Image is clipped to LCD and must stay in memory until queue is flushed.
+ * DMA2D can not mirror or rotate, so hardware is used only when LCD memory is not rotated (orientation 1).
+ * In other orientations and for colour keyed sprites (@ref TM_DMA2DGRAPHIC_DrawSprite), pixels are converted and blended with CPU.
+ *
+ * \par Software DMA2D
+ *
+ * With line below in defines.h file, queued operations are done by CPU instead of DMA2D.
+ * Register to memory, memory to memory, pixel format conversion (all input formats, including CLUT formats)
+ * and blending are done with the same formulas as in reference manual, so results are the same as with DMA2D.
+ *
+ * This can be used on STM32F40x/41x devices without DMA2D, to run the same drawing code on PC with framebuffer in RAM,
+ * or to check if wrong picture comes from DMA2D settings or from drawing code.
+ *
+@verbatim
+//Do DMA2D operations with CPU
+#define DMA2D_GRAPHIC_SOFTWARE     1
+@endverbatim
+ *
+ * Framebuffer content can be saved with debugger (for example <code>SAVE fb.hex 0xD0000000,0xD0025800</code> in Keil)
+ * and converted to PPM image with <code>tools/fb2ppm.py</code> script.
+ *
+ * Library with software DMA2D is built for PC in tools/graphic_sim folder, where drawing is checked against golden images
+ * and measured in primitives per second. Set DMA2D_GRAPHIC_USE_DWT to 0 there, PC has no DWT cycle counter.
  *
  * \par Changelog
  *
 @verbatim
+ Version 1.5
+  - Added DMA2D_GRAPHIC_SOFTWARE option, queued operations are done with CPU model of DMA2D
+  - DMA2D transfer and configuration errors end queued operation and are counted in TM_DMA2DGRAPHIC_Stats_t
+  - Addresses are stored as uintptr_t, so software DMA2D works with 64-bit pointers on PC
+  - Added DMA2D_GRAPHIC_USE_DWT option
+  - L8 images without lookup table are not drawn
+  - Added TM_DMA2DGRAPHIC_RegionFence and TM_DMA2DGRAPHIC_WaitRegion functions, pixel functions do not flush whole queue
+
+ Version 1.4
+  - Added TM_DMA2DGRAPHIC_DrawImage and TM_DMA2DGRAPHIC_DrawSprite functions for RGB565, ARGB8888, ARGB4444, L8 and A8 images
+  - L8 colour lookup table is loaded from command queue
+
+ Version 1.3
+  - Added anti-aliased lines, thick lines, circles, arcs and polygons with TM AA library
+
+ Version 1.2
+  - DMA2D operations are put to command queue and started from transfer complete interrupt, drawing functions do not wait anymore
+  - Added fill, copy, pixel format conversion and blend functions, fences and queue statistics
+
+ Version 1.1
+  - Filled circles, rounded rectangles and triangles are drawn with TM SPAN rasterizer
+  - Added TM_DMA2DGRAPHIC_DrawFilledPolygon function
+
  Version 1.0
   - First release
 @endverbatim
@@ -78,6 +162,8 @@ extern "C" {
  - STM32F4xx RCC
  - STM32F4xx DMA2D
  - defines.h
+ - TM SPAN
+ - TM AA
 @endverbatim
  */
  
@@ -132,6 +218,55 @@ extern "C" {
 #ifndef DMA2D_GRAPHIC_TIMEOUT
 #define DMA2D_GRAPHIC_TIMEOUT       (uint32_t)10000000
 #endif
+
+/**
+ * @brief  Number of entries in DMA2D command queue
+ */
+#ifndef DMA2D_GRAPHIC_QUEUE_SIZE
+#define DMA2D_GRAPHIC_QUEUE_SIZE            16
+#endif
+
+/**
+ * @brief  Use DMA2D transfer complete interrupt for command queue
+ */
+#ifndef DMA2D_GRAPHIC_USE_IRQ
+#define DMA2D_GRAPHIC_USE_IRQ               1
+#endif
+
+/**
+ * @brief  Do queued operations with CPU instead of DMA2D when set to 1
+ */
+#ifndef DMA2D_GRAPHIC_SOFTWARE
+#define DMA2D_GRAPHIC_SOFTWARE              0
+#endif
+
+/**
+ * @brief  Measure DMA2D busy time with DWT cycle counter. Set to 0 when there is no DWT, for example on PC
+ */
+#ifndef DMA2D_GRAPHIC_USE_DWT
+#define DMA2D_GRAPHIC_USE_DWT               1
+#endif
+
+/**
+ * @brief  DMA2D NVIC priority
+ */
+#ifndef DMA2D_GRAPHIC_NVIC_PRIORITY
+#define DMA2D_GRAPHIC_NVIC_PRIORITY         0x04
+#endif
+
+/**
+ * @brief  DMA2D NVIC subpriority
+ */
+#ifndef DMA2D_GRAPHIC_NVIC_SUBPRIORITY
+#define DMA2D_GRAPHIC_NVIC_SUBPRIORITY      0x00
+#endif
+
+/**
+ * @brief  Maximal number of points in filled polygon
+ */
+#ifndef DMA2D_GRAPHIC_POLYGON_MAX_POINTS
+#define DMA2D_GRAPHIC_POLYGON_MAX_POINTS    16
+#endif
 /**
  * @brief  Number of LCD pixels
  */
@@ -160,7 +295,7 @@ extern "C" {
 
 /* Waiting flags */
 #define DMA2D_WORKING               ((DMA2D->CR & DMA2D_CR_START))
-#define DMA2D_WAIT                  do { while (DMA2D_WORKING); DMA2D->IFCR = DMA2D_IFSR_CTCIF;} while (0);
+#define DMA2D_WAIT                  do { TM_DMA2DGRAPHIC_Flush(); } while (0);
 
 /**
  * @}
@@ -193,11 +328,69 @@ typedef struct {
 	uint16_t Width;
 	uint16_t Height;
 	uint8_t BytesPerPixel;
-	uint32_t BufferStart;
+	uintptr_t BufferStart;
 	uint32_t BufferOffset;
 	uint8_t Orientation;
 } TM_DMA2DGRAPHIC_INT_Conf_t;
 
+/**
+ * @brief  DMA2D operation for command queue, values are written directly to DMA2D registers
+ * @note   Only registers used by selected mode must be set
+ */
+typedef struct {
+	uint32_t Mode;    /*!< Operation mode. This parameter can be DMA2D_M2M, DMA2D_M2M_PFC, DMA2D_M2M_BLEND or DMA2D_R2M */
+	uintptr_t FGMAR;  /*!< Foreground memory address */
+	uint32_t FGOR;    /*!< Foreground line offset in units of pixels */
+	uint32_t FGPFCCR; /*!< Foreground pixel format, alpha mode and alpha value */
+	uint32_t FGCOLR;  /*!< Foreground colour for A8 and A4 formats, RGB888 */
+	uintptr_t FGCMAR; /*!< Foreground CLUT address for L8 and L4 formats, CLUT is loaded before transfer. Set to 0 when not used */
+	uintptr_t BGMAR;  /*!< Background memory address, used for blending */
+	uint32_t BGOR;    /*!< Background line offset in units of pixels */
+	uint32_t BGPFCCR; /*!< Background pixel format */
+	uintptr_t OMAR;   /*!< Output memory address */
+	uint32_t OOR;     /*!< Output line offset in units of pixels */
+	uint32_t OPFCCR;  /*!< Output pixel format */
+	uint32_t OCOLR;   /*!< Output colour for register to memory mode, in output pixel format */
+	uint32_t NLR;     /*!< Number of pixels per line in upper 16 bits and number of lines in lower 16 bits */
+} TM_DMA2DGRAPHIC_Command_t;
+
+/**
+ * @brief  Image pixel formats
+ */
+typedef enum {
+	TM_DMA2DGRAPHIC_ImageFormat_RGB565 = CM_RGB565,     /*!< 16-bit RGB565 pixels, image is opaque */
+	TM_DMA2DGRAPHIC_ImageFormat_ARGB8888 = CM_ARGB8888, /*!< 32-bit pixels with 8-bit alpha */
+	TM_DMA2DGRAPHIC_ImageFormat_ARGB4444 = CM_ARGB4444, /*!< 16-bit pixels with 4-bit alpha */
+	TM_DMA2DGRAPHIC_ImageFormat_L8 = CM_L8,             /*!< 8-bit indexes to ARGB8888 colour lookup table */
+	TM_DMA2DGRAPHIC_ImageFormat_A8 = CM_A8              /*!< 8-bit alpha values, image is drawn with one colour */
+} TM_DMA2DGRAPHIC_ImageFormat_t;
+
+/**
+ * @brief  Image or sprite in memory
+ */
+typedef struct {
+	const void* Data;                     /*!< Pointer to pixels, line after line without gaps */
+	uint16_t Width;                       /*!< Image width in units of pixels */
+	uint16_t Height;                      /*!< Image height in units of pixels */
+	TM_DMA2DGRAPHIC_ImageFormat_t Format; /*!< Pixel format. This parameter can be a value of @ref TM_DMA2DGRAPHIC_ImageFormat_t enumeration */
+	const uint32_t* CLUT;                 /*!< Pointer to ARGB8888 colour lookup table for L8 format */
+	uint16_t CLUTSize;                    /*!< Number of colours in lookup table, 1 to 256 */
+	uint16_t Color;                       /*!< Colour in RGB565 format for A8 format */
+} TM_DMA2DGRAPHIC_Image_t;
+
+/**
+ * @brief  Command queue statistics
+ */
+typedef struct {
+	uint32_t Submitted; /*!< Number of operations put to queue */
+	uint32_t Completed; /*!< Number of finished operations */
+	uint16_t Depth;     /*!< Number of operations currently in queue, including running one */
+	uint16_t MaxDepth;  /*!< Maximal number of operations in queue at the same time */
+	uint32_t Stalls;    /*!< Number of times queue was full and CPU had to wait */
+	uint32_t Errors;    /*!< Number of operations which ended with transfer, configuration or CLUT access error */
+	uint32_t BusyTime;  /*!< Time DMA2D was working on queued operations, in units of CPU cycles */
+} TM_DMA2DGRAPHIC_Stats_t;
+
 /**
  * @}
  */
@@ -397,9 +590,234 @@ void TM_DMA2DGRAPHIC_DrawTriangle(uint16_t x1, uint16_t y1,  uint16_t x2, uint16
  */
 void TM_DMA2DGRAPHIC_DrawFilledTriangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t x3, uint16_t y3, uint32_t color);
 
+/**
+ * @brief  Draws filled convex polygon on currently active layer
+ * @param  *Coordinates: Pointer to @ref TM_DMA2DRAPHIC_Poly_t array of polygon points
+ * @param  count: Number of points, maximal @ref DMA2D_GRAPHIC_POLYGON_MAX_POINTS
+ * @param  color: Color in RGB565 format
+ * @retval None
+ */
+void TM_DMA2DGRAPHIC_DrawFilledPolygon(TM_DMA2DRAPHIC_Poly_t* Coordinates, uint16_t count, uint32_t color);
+
+/**
+ * @brief  Draws anti-aliased line on currently active layer
+ * @param  x1: Line start X coordinate
+ * @param  y1: Line start Y coordinate
+ * @param  x2: Line end X coordinate
+ * @param  y2: Line end Y coordinate
+ * @param  color: Color in RGB565 format
+ * @retval None
+ */
+void TM_DMA2DGRAPHIC_DrawLineAA(int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint32_t color);
+
+/**
+ * @brief  Draws anti-aliased line with width and round caps on currently active layer
+ * @param  x1: Line start X coordinate
+ * @param  y1: Line start Y coordinate
+ * @param  x2: Line end X coordinate
+ * @param  y2: Line end Y coordinate
+ * @param  width: Line width in units of pixels
+ * @param  color: Color in RGB565 format
+ * @retval None
+ */
+void TM_DMA2DGRAPHIC_DrawThickLineAA(int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint8_t width, uint32_t color);
+
+/**
+ * @brief  Draws anti-aliased circle on currently active layer
+ * @param  x0: X coordinate of center
+ * @param  y0: Y coordinate of center
+ * @param  r: Circle radius
+ * @param  color: Color in RGB565 format
+ * @retval None
+ */
+void TM_DMA2DGRAPHIC_DrawCircleAA(uint16_t x0, uint16_t y0, uint16_t r, uint32_t color);
+
+/**
+ * @brief  Draws filled circle with anti-aliased edge on currently active layer
+ * @param  x0: X coordinate of center
+ * @param  y0: Y coordinate of center
+ * @param  r: Circle radius
+ * @param  color: Color in RGB565 format
+ * @retval None
+ */
+void TM_DMA2DGRAPHIC_DrawFilledCircleAA(uint16_t x0, uint16_t y0, uint16_t r, uint32_t color);
+
+/**
+ * @brief  Draws anti-aliased arc on currently active layer
+ * @param  x0: X coordinate of center
+ * @param  y0: Y coordinate of center
+ * @param  r: Radius of arc middle line
+ * @param  width: Arc width in units of pixels
+ * @param  start: Start angle in degrees, 0 is on the right side and angles go clockwise
+ * @param  end: End angle in degrees. If it is equal to start, full ring is drawn
+ * @param  color: Color in RGB565 format
+ * @retval None
+ */
+void TM_DMA2DGRAPHIC_DrawArcAA(uint16_t x0, uint16_t y0, uint16_t r, uint8_t width, uint16_t start, uint16_t end, uint32_t color);
+
+/**
+ * @brief  Draws anti-aliased polygon outline on currently active layer
+ * @param  *Coordinates: Pointer to @ref TM_DMA2DRAPHIC_Poly_t array of polygon points
+ * @param  count: Number of points, maximal @ref DMA2D_GRAPHIC_POLYGON_MAX_POINTS
+ * @param  color: Color in RGB565 format
+ * @retval None
+ */
+void TM_DMA2DGRAPHIC_DrawPolygonAA(TM_DMA2DRAPHIC_Poly_t* Coordinates, uint16_t count, uint32_t color);
+
+/**
+ * @brief  Draws image on currently active layer
+ * @note   When LCD memory is not rotated, image is drawn with one DMA2D operation from command queue,
+ *         so image data must stay in memory until @ref TM_DMA2DGRAPHIC_Flush is called
+ * @note   L8 image without lookup table or with more than 256 colours is not drawn
+ * @param  x: Left X coordinate of image, can be negative
+ * @param  y: Top Y coordinate of image, can be negative
+ * @param  *Image: Pointer to @ref TM_DMA2DGRAPHIC_Image_t image
+ * @retval None
+ */
+void TM_DMA2DGRAPHIC_DrawImage(int16_t x, int16_t y, const TM_DMA2DGRAPHIC_Image_t* Image);
+
+/**
+ * @brief  Draws image with transparent colour key on currently active layer
+ * @note   DMA2D does not support colour keying, sprite is drawn with CPU
+ * @param  x: Left X coordinate of sprite, can be negative
+ * @param  y: Top Y coordinate of sprite, can be negative
+ * @param  *Image: Pointer to @ref TM_DMA2DGRAPHIC_Image_t image
+ * @param  key: Pixel value in image format which is not drawn. For L8 format this is index and for A8 format alpha value
+ * @retval None
+ */
+void TM_DMA2DGRAPHIC_DrawSprite(int16_t x, int16_t y, const TM_DMA2DGRAPHIC_Image_t* Image, uint32_t key);
+
+/**
+ * @brief  Copies RGB565 buffer and waits for copy to finish
+ * @param  *pSrc: Pointer to source buffer
+ * @param  *pDst: Pointer to destination buffer
+ * @param  xSize: Number of pixels in one line
+ * @param  ySize: Number of lines
+ * @param  OffLineSrc: Number of pixels to skip at the end of each source line
+ * @param  OffLineDst: Number of pixels to skip at the end of each destination line
+ * @retval None
+ */
 void TM_DMA2DGRAPHIC_CopyBuffer(void* pSrc, void* pDst, uint32_t xSize, uint32_t ySize, uint32_t OffLineSrc, uint32_t OffLineDst);
+
+/**
+ * @brief  Puts RGB565 buffer copy to command queue
+ * @note   Parameters are the same as for @ref TM_DMA2DGRAPHIC_CopyBuffer
+ * @retval None
+ */
 void TM_DMA2DGRAPHIC_CopyBufferIT(void* pSrc, void* pDst, uint32_t xSize, uint32_t ySize, uint32_t OffLineSrc, uint32_t OffLineDst);
 
+/**
+ * @brief  Puts RGB565 buffer fill to command queue
+ * @param  *pDst: Pointer to destination buffer
+ * @param  xSize: Number of pixels in one line
+ * @param  ySize: Number of lines
+ * @param  OffLineDst: Number of pixels to skip at the end of each line
+ * @param  color: Color in RGB565 format
+ * @retval None
+ */
+void TM_DMA2DGRAPHIC_FillBufferIT(void* pDst, uint32_t xSize, uint32_t ySize, uint32_t OffLineDst, uint32_t color);
+
+/**
+ * @brief  Puts buffer copy with pixel format conversion to command queue
+ * @param  *pSrc: Pointer to source buffer
+ * @param  *pDst: Pointer to destination buffer
+ * @param  xSize: Number of pixels in one line
+ * @param  ySize: Number of lines
+ * @param  OffLineSrc: Number of pixels to skip at the end of each source line
+ * @param  OffLineDst: Number of pixels to skip at the end of each destination line
+ * @param  SrcColorMode: Source pixel format, CM_ARGB8888, CM_RGB888, CM_RGB565, CM_ARGB1555 or CM_ARGB4444
+ * @param  DstColorMode: Destination pixel format, CM_ARGB8888, CM_RGB888, CM_RGB565, CM_ARGB1555 or CM_ARGB4444
+ * @retval None
+ */
+void TM_DMA2DGRAPHIC_ConvertBufferIT(void* pSrc, void* pDst, uint32_t xSize, uint32_t ySize, uint32_t OffLineSrc, uint32_t OffLineDst, uint32_t SrcColorMode, uint32_t DstColorMode);
+
+/**
+ * @brief  Puts blending of foreground buffer over RGB565 background to command queue
+ * @param  *pFg: Pointer to foreground buffer
+ * @param  *pBg: Pointer to RGB565 background buffer
+ * @param  *pDst: Pointer to RGB565 destination buffer. It can be the same as background
+ * @param  xSize: Number of pixels in one line
+ * @param  ySize: Number of lines
+ * @param  OffLineFg: Number of pixels to skip at the end of each foreground line
+ * @param  OffLineBg: Number of pixels to skip at the end of each background line
+ * @param  OffLineDst: Number of pixels to skip at the end of each destination line
+ * @param  FgColorMode: Foreground pixel format, for example CM_ARGB8888, CM_ARGB4444 or CM_A8
+ * @param  FgColor: Foreground colour in RGB888 format, used only for CM_A8 and CM_A4 formats
+ * @retval None
+ */
+void TM_DMA2DGRAPHIC_BlendBufferIT(void* pFg, void* pBg, void* pDst, uint32_t xSize, uint32_t ySize, uint32_t OffLineFg, uint32_t OffLineBg, uint32_t OffLineDst, uint32_t FgColorMode, uint32_t FgColor);
+
+/**
+ * @brief  Puts custom DMA2D operation to command queue
+ * @note   If queue is full, function waits for free entry
+ * @param  *Command: Pointer to @ref TM_DMA2DGRAPHIC_Command_t operation. It is copied to queue
+ * @retval Fence of this operation, to be used with @ref TM_DMA2DGRAPHIC_WaitFence
+ */
+uint32_t TM_DMA2DGRAPHIC_Enqueue(TM_DMA2DGRAPHIC_Command_t* Command);
+
+/**
+ * @brief  Gets fence of last queued operation
+ * @param  None
+ * @retval Fence value
+ */
+uint32_t TM_DMA2DGRAPHIC_Fence(void);
+
+/**
+ * @brief  Checks if operation with selected fence and all before it are finished
+ * @param  fence: Fence value returned from @ref TM_DMA2DGRAPHIC_Fence or @ref TM_DMA2DGRAPHIC_Enqueue
+ * @retval Fence status:
+ *            - 0: Operations are still in queue
+ *            - > 0: Operations are finished
+ */
+uint8_t TM_DMA2DGRAPHIC_IsFenceDone(uint32_t fence);
+
+/**
+ * @brief  Waits for operation with selected fence and all before it to finish
+ * @param  fence: Fence value returned from @ref TM_DMA2DGRAPHIC_Fence or @ref TM_DMA2DGRAPHIC_Enqueue
+ * @retval None
+ */
+void TM_DMA2DGRAPHIC_WaitFence(uint32_t fence);
+
+/**
+ * @brief  Gets fence of last queued operation which reads or writes selected memory
+ * @note   Memory of each operation is checked from first to last pixel, line offsets in between are included
+ * @param  *Address: Start of memory to be used by CPU
+ * @param  Size: Number of bytes
+ * @retval Fence value. It is already done when no queued operation uses this memory
+ */
+uint32_t TM_DMA2DGRAPHIC_RegionFence(const void* Address, uint32_t Size);
+
+/**
+ * @brief  Waits for queued operations which read or write selected memory
+ * @note   Call this before CPU accesses part of memory, other queued operations are not waited for
+ * @param  *Address: Start of memory to be used by CPU
+ * @param  Size: Number of bytes
+ * @retval None
+ */
+void TM_DMA2DGRAPHIC_WaitRegion(const void* Address, uint32_t Size);
+
+/**
+ * @brief  Waits for all queued operations to finish and DMA2D to be idle
+ * @note   Call this before CPU accesses memory which is written by DMA2D
+ * @param  None
+ * @retval None
+ */
+void TM_DMA2DGRAPHIC_Flush(void);
+
+/**
+ * @brief  Gets command queue statistics
+ * @param  *Stats: Pointer to @ref TM_DMA2DGRAPHIC_Stats_t structure to be filled
+ * @retval None
+ */
+void TM_DMA2DGRAPHIC_GetStats(TM_DMA2DGRAPHIC_Stats_t* Stats);
+
+/**
+ * @brief  Resets command queue statistics
+ * @param  None
+ * @retval None
+ */
+void TM_DMA2DGRAPHIC_ResetStats(void);
+
 /* Private functions */
 void TM_INT_DMA2DGRAPHIC_SetConf(TM_DMA2DGRAPHIC_INT_Conf_t* Conf);
 
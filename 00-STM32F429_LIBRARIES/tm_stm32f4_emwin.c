@@ -17,6 +17,7 @@
  * |----------------------------------------------------------------------
  */
 #include "tm_stm32f4_emwin.h"
+#include "WM.h"
 
 /* Private variables */
 static TM_STMPE811_TouchData TS_Data;
@@ -38,8 +39,12 @@ TM_EMWIN_Result_t TM_EMWIN_Init(void) {
 	/* Initialize LCD */
 	TM_ILI9341_Init();
 	
-	/* Initialize touch screen */
+	/* Initialize touch screen, in interrupt mode if available */
+#if STMPE811_USE_IT == 1
+	if (TM_STMPE811_InitIT(TM_STMPE811_Orientation_Portrait_2) != TM_STMPE811_State_Ok) {
+#else
 	if (TM_STMPE811_Init() != TM_STMPE811_State_Ok) {
+#endif
 		/* Return touch error */
 		return TM_EMWIN_Result_TouchError;
 	}
@@ -50,6 +55,11 @@ TM_EMWIN_Result_t TM_EMWIN_Init(void) {
 		return TM_EMWIN_Result_GUIError;
 	}
 	
+#if EMWIN_NUM_BUFFERS > 1
+	/* Window manager draws to back buffer, buffers are changed in vertical blanking */
+	WM_MULTIBUF_Enable(1);
+#endif
+	
 	/* Set LCD default orientation */
 	TS_Data.orientation = TM_STMPE811_Orientation_Portrait_2;
 	
@@ -185,6 +195,90 @@ TM_EMWIN_Result_t TM_EMWIN_UpdateTouch(void) {
 	return TM_EMWIN_Result_Ok;
 }
 
+void TM_EMWIN_Benchmark(uint32_t time, TM_EMWIN_Benchmark_t* Result) {
+	int xSize, ySize, x, y, i;
+	uint32_t start, cycles = 0, c;
+	
+	/* Enable DWT cycle counter for drawing time */
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	
+	/* Get screen size */
+	xSize = LCD_GetXSize();
+	ySize = LCD_GetYSize();
+	
+	/* Reset result */
+	Result->Frames = 0;
+	start = GUI_GetTime();
+	
+	/* Draw frames */
+	while ((GUI_GetTime() - start) < time) {
+		/* Start frame, waits for free buffer */
+		GUI_MULTIBUF_Begin();
+		c = DWT->CYCCNT;
+		
+		/* Clear screen, DMA2D fill */
+		GUI_SetBkColor(GUI_BLACK);
+		GUI_Clear();
+		
+		/* Moving opaque rectangles, DMA2D fills */
+		for (i = 0; i < 8; i++) {
+			x = (Result->Frames * (i + 1) * 3) % (xSize - 40);
+			y = i * (ySize / 8);
+			GUI_SetColor(0x0000FF << (i % 3) * 8);
+			GUI_FillRect(x, y, x + 39, y + ySize / 8 - 5);
+		}
+		
+		/* Alpha blended rectangles, DMA2D blending */
+		GUI_EnableAlpha(1);
+		for (i = 0; i < 4; i++) {
+			x = (Result->Frames * 2 + i * 60) % (xSize - 60);
+			y = (Result->Frames + i * 80) % (ySize - 60);
+			GUI_SetColor(0x80000000 | (0x00FFFF << (i % 2) * 8));
+			GUI_FillRect(x, y, x + 59, y + 59);
+		}
+		GUI_EnableAlpha(0);
+		
+		/* Frame counter */
+		GUI_SetColor(GUI_WHITE);
+		GUI_SetTextMode(GUI_TM_TRANS);
+		GUI_SetFont(&GUI_Font24B_ASCII);
+		GUI_DispDecAt(Result->Frames, 10, 10, 5);
+		
+		/* Frame is ready */
+		cycles += DWT->CYCCNT - c;
+		GUI_MULTIBUF_End();
+		
+		/* Count frames */
+		Result->Frames++;
+	}
+	
+	/* Calculate result */
+	Result->Time = GUI_GetTime() - start;
+	Result->FPS = Result->Time ? Result->Frames * 10000 / Result->Time : 0;
+	Result->DrawTime = Result->Frames ? (cycles / Result->Frames) / (SystemCoreClock / 1000000) : 0;
+	
+	/* Show result */
+	GUI_MULTIBUF_Begin();
+	GUI_SetBkColor(GUI_DARKBLUE);
+	GUI_Clear();
+	GUI_SetColor(GUI_WHITE);
+	GUI_SetFont(&GUI_Font24B_ASCII);
+	GUI_DispStringHCenterAt("Benchmark", xSize / 2, 20);
+	GUI_SetFont(&GUI_Font20_ASCII);
+	GUI_DispStringAt("Frames:", 10, 70);
+	GUI_DispDecAt(Result->Frames, 120, 70, 6);
+	GUI_DispStringAt("FPS:", 10, 100);
+	GUI_DispDecAt(Result->FPS / 10, 120, 100, 3);
+	GUI_DispString(".");
+	GUI_DispDecMin(Result->FPS % 10);
+	GUI_DispStringAt("Draw us:", 10, 130);
+	GUI_DispDecAt(Result->DrawTime, 120, 130, 6);
+	GUI_DispStringAt("Buffers:", 10, 160);
+	GUI_DispDecAt(EMWIN_NUM_BUFFERS, 120, 160, 1);
+	GUI_MULTIBUF_End();
+}
+
 /* LTDC IRQ Handler */
 void LTDC_IRQHandler(void) {
 	LTDC_ISR_Handler();
@@ -3,7 +3,7 @@
  * @email   tilen@majerle.eu
  * @website http://stm32f4-discovery.net
  * @link    http://stm32f4-discovery.net/2015/01/library-50-stemwin-for-stm32f429-discovery
- * @version v1.0
+ * @version v1.2
  * @ide     Keil uVision
  * @license GNU GPL v3
  * @brief   STemWin implementation for STM32F429-Discovery
@@ -28,7 +28,7 @@
 @endverbatim
  */
 #ifndef TM_EMWIN_H
-#define TM_EMWIN_H 100
+#define TM_EMWIN_H 120
 
 /* C++ detection */
 #ifdef __cplusplus
@@ -49,9 +49,48 @@ extern "C" {
  *
  * To know how to write text and other stuff, you should take a look at emwin manual from segger.
  *
+ * \par Multiple buffering
+ *
+ * By default, emWin uses 3 frame buffers in SDRAM (triple buffering), set with @ref EMWIN_NUM_BUFFERS.
+ * Window manager draws each update to back buffer and new buffer is shown by LTDC line interrupt
+ * at the beginning of vertical blanking, so there is no tearing and flickering.
+ * Drawing can continue in third buffer while finished buffer waits for vertical blanking.
+ *
+ * When you draw without window manager, put drawings between GUI_MULTIBUF_Begin() and GUI_MULTIBUF_End() calls.
+ *
+ * @note   @ref TM_EMWIN_MemoryEnable is not needed with multiple buffering.
+ *
+ * \par DMA2D
+ *
+ * These emWin operations are done with DMA2D:
+ *  - Filling rectangles
+ *  - Copying buffers and rectangles (scrolling, multiple buffering)
+ *  - Drawing 8bpp and 16bpp bitmaps
+ *  - Colour conversion and alpha blending, used for alpha bitmaps and memory devices
+ *
+ * \par Memory devices
+ *
+ * emWin memory is placed in SDRAM, set with @ref EMWIN_MEMORY_SDRAM. Memory devices use a lot of memory
+ * and with this there is enough memory for full screen memory devices. Internal RAM is not used for emWin memory.
+ *
+ * \par Benchmark
+ *
+ * Use @ref TM_EMWIN_Benchmark to draw benchmark screen and measure frame rate.
+ *
  * \par Changelog
  *
 @verbatim
+ Version 1.2
+  - October 19, 2026
+  - Triple buffering synchronised to vertical blanking with LTDC line interrupt
+  - emWin memory and memory devices are in SDRAM
+  - Fixed source offsets for DMA2D rectangle copy and 16bpp bitmaps
+  - Added TM_EMWIN_Benchmark() function
+
+ Version 1.1
+  - October 19, 2026
+  - Touch screen is used in interrupt mode, I2C is not used when screen is not touched
+
  Version 1.0
   - First release
 @endverbatim
@@ -73,6 +112,8 @@ extern "C" {
  - TM I2C
  - TM SDRAM
  - TM SPI
+ - TM STMPE811
+ - TM EXTI
 @endverbatim
  */
 #include "stm32f4xx.h"
@@ -103,6 +144,27 @@ extern "C" {
 #define EMWIN_UPDATE_TOUCH_MILLIS		50
 #endif
 
+/**
+ * @brief Number of frame buffers for emWin, 1 to 3. Set to 1 to disable multiple buffering
+ */
+#ifndef EMWIN_NUM_BUFFERS
+#define EMWIN_NUM_BUFFERS				3
+#endif
+
+/**
+ * @brief Set to 1 to put emWin memory and memory devices to SDRAM or 0 to use internal RAM
+ */
+#ifndef EMWIN_MEMORY_SDRAM
+#define EMWIN_MEMORY_SDRAM				1
+#endif
+
+/**
+ * @brief Number of bytes of SDRAM for emWin memory, maximal 4MB
+ */
+#ifndef EMWIN_MEMORY_SIZE
+#define EMWIN_MEMORY_SIZE				(1024 * 1024 * 4)
+#endif
+
 /**
  * @}
  */
@@ -133,6 +195,16 @@ typedef enum {
 	TM_EMWIN_Rotate_270,   /*!< Rotate LCD 170 degrees */
 } TM_EMWIN_Rotate_t;
 
+/**
+ * @brief  Benchmark result
+ */
+typedef struct {
+	uint32_t Frames;     /*!< Number of frames drawn */
+	uint32_t Time;       /*!< Benchmark time in units of milliseconds */
+	uint32_t FPS;        /*!< Frames per second, multiplied by 10 */
+	uint32_t DrawTime;   /*!< Average time for drawing one frame in units of microseconds, without waiting for free buffer */
+} TM_EMWIN_Benchmark_t;
+
 /**
  * @}
  */
@@ -198,6 +270,18 @@ uint32_t TM_EMWIN_Exec(void);
  */
 TM_EMWIN_Result_t TM_EMWIN_UpdateTouch(void);
 
+/**
+ * @brief  Draws benchmark screen and measures frame rate
+ * @note   Each frame fills whole screen, draws moving opaque and alpha blended rectangles and text.
+ *         Result is shown on screen after benchmark.
+ *
+ * With multiple buffering, frame rate can not be higher than LCD refresh rate.
+ * @param  time: Benchmark time in units of milliseconds
+ * @param  *Result: Pointer to @ref TM_EMWIN_Benchmark_t structure to store result to
+ * @retval None
+ */
+void TM_EMWIN_Benchmark(uint32_t time, TM_EMWIN_Benchmark_t* Result);
+
 /**
  * @}
  */
@@ -20,6 +20,29 @@
 
 /* Private functions */
 static FRESULT scan_files(char* path, uint16_t tmp_buffer_size, TM_FATFS_Search_t* FindStructure);
+static FRESULT TM_FATFS_INT_AllocateContiguous(FIL* fil, DWORD clusters);
+static FRESULT TM_FATFS_INT_LogWriteSectors(TM_FATFS_Log_t* Log, UINT count);
+static FRESULT TM_FATFS_INT_RingAccess(TM_FATFS_Ring_t* Ring, uint32_t offset, void* data, uint32_t count, uint8_t write);
+
+/* Ring log header, stored alternately in first and second sector of file */
+#define RING_MAGIC			0x4C524D54	/* "TMRL" */
+#define RING_SECTOR_SIZE	512
+#define RING_HEADER_SIZE	(2 * RING_SECTOR_SIZE)
+
+typedef struct {
+	uint32_t Magic;
+	uint32_t Size;
+	uint32_t Tail;
+	uint32_t Count;
+	uint32_t Sequence;
+	uint32_t Check;
+} TM_FATFS_RingHeader_t;
+
+static uint8_t TM_FATFS_INT_RingReadHeader(TM_FATFS_Ring_t* Ring, uint8_t slot, TM_FATFS_RingHeader_t* Header);
+
+/* Hidden FatFs API from ff.c */
+DWORD clust2sect(FATFS* fs, DWORD clst);
+DWORD get_fat(FATFS* fs, DWORD clst);
 
 FRESULT TM_FATFS_GetDriveSize(char* str, TM_FATFS_Size_t* SizeStruct) {
 	FATFS *fs;
@@ -129,6 +152,331 @@ FRESULT TM_FATFS_TruncateBeginning(FIL* fil, uint32_t index) {
 	return f_lseek(fil, 0);									/* Move pointer to the beginning */
 }
 
+FRESULT TM_FATFS_LogOpen(TM_FATFS_Log_t* Log, const char* path, uint32_t size, uint8_t* buffer, uint32_t buffer_size) {
+	DWORD csize, clusters;
+	FRESULT fr;
+	
+	/* Check parameters */
+	if (buffer_size < 512 || (buffer_size % 512) || ((uint32_t)buffer & 3) || size == 0) {
+		return FR_INVALID_PARAMETER;
+	}
+	
+	/* Reset structure */
+	memset(Log, 0, sizeof(TM_FATFS_Log_t));
+	Log->Buffer = buffer;
+	Log->BufferSize = buffer_size;
+	
+	/* Create new file */
+	fr = f_open(&Log->File, path, FA_CREATE_ALWAYS | FA_WRITE);
+	if (fr) return fr;
+	
+	/* Number of clusters for requested size */
+	csize = (DWORD)Log->File.fs->csize * 512;
+	clusters = (size + csize - 1) / csize;
+	
+	/* Allocate contiguous clusters */
+	fr = TM_FATFS_INT_AllocateContiguous(&Log->File, clusters);
+	if (fr) {
+		/* Remove file */
+		f_close(&Log->File);
+		f_unlink(path);
+		return fr;
+	}
+	
+	/* Log area */
+	Log->StartSector = clust2sect(Log->File.fs, Log->File.sclust);
+	Log->Sectors = clusters * Log->File.fs->csize;
+	
+	/* Save empty file with allocated clusters */
+	Log->File.fsize = 0;
+	Log->File.flag |= FA__WRITTEN;
+	fr = f_sync(&Log->File);
+	if (fr) return fr;
+	
+	/* Enable cycle counter for write time measurement */
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	
+	/* Return OK */
+	return FR_OK;
+}
+
+FRESULT TM_FATFS_LogWrite(TM_FATFS_Log_t* Log, const void* data, uint32_t btw) {
+	const uint8_t* ptr = (const uint8_t *)data;
+	uint32_t n;
+	FRESULT fr;
+	
+	while (btw) {
+		/* Log is full */
+		if (Log->Sector * 512 + Log->BufferCount >= Log->Sectors * 512) {
+			return FR_DENIED;
+		}
+		
+		/* Copy to buffer */
+		n = Log->BufferSize - Log->BufferCount;
+		if (n > btw) {
+			n = btw;
+		}
+		if (n > Log->Sectors * 512 - Log->Sector * 512 - Log->BufferCount) {
+			n = Log->Sectors * 512 - Log->Sector * 512 - Log->BufferCount;
+		}
+		memcpy(&Log->Buffer[Log->BufferCount], ptr, n);
+		Log->BufferCount += n;
+		Log->Size += n;
+		ptr += n;
+		btw -= n;
+		
+		/* Write full sectors when buffer is full or log area ends */
+		if (Log->BufferCount == Log->BufferSize || Log->Sector * 512 + Log->BufferCount == Log->Sectors * 512) {
+			fr = TM_FATFS_INT_LogWriteSectors(Log, Log->BufferCount / 512);
+			if (fr) return fr;
+			Log->Sector += Log->BufferCount / 512;
+			Log->BufferCount = 0;
+		}
+	}
+	
+	/* Automatic checkpoint */
+	if (Log->CheckpointInterval && (Log->Size - Log->CheckpointSize) >= Log->CheckpointInterval) {
+		return TM_FATFS_LogSync(Log);
+	}
+	
+	/* Return OK */
+	return FR_OK;
+}
+
+FRESULT TM_FATFS_LogSync(TM_FATFS_Log_t* Log) {
+	UINT count;
+	FRESULT fr;
+	
+	/* Write sectors with data in buffer, they are written again when buffer is full */
+	if (Log->BufferCount) {
+		count = (Log->BufferCount + 511) / 512;
+		memset(&Log->Buffer[Log->BufferCount], 0, count * 512 - Log->BufferCount);
+		fr = TM_FATFS_INT_LogWriteSectors(Log, count);
+		if (fr) return fr;
+	}
+	
+	/* Update size in directory entry */
+	Log->File.fsize = Log->Size;
+	Log->File.flag |= FA__WRITTEN;
+	fr = f_sync(&Log->File);
+	if (fr) return fr;
+	
+	/* Checkpoint done */
+	Log->CheckpointSize = Log->Size;
+	
+	/* Return OK */
+	return FR_OK;
+}
+
+FRESULT TM_FATFS_LogClose(TM_FATFS_Log_t* Log) {
+	FRESULT fr;
+	
+	/* Write everything */
+	fr = TM_FATFS_LogSync(Log);
+	if (fr) return fr;
+	
+	/* Free clusters after end of data */
+	Log->File.fsize = Log->Sectors * 512;
+	fr = f_lseek(&Log->File, Log->Size);
+	if (fr) return fr;
+	fr = f_truncate(&Log->File);
+	if (fr) return fr;
+	
+	/* Close file */
+	return f_close(&Log->File);
+}
+
+FRESULT TM_FATFS_RingOpen(TM_FATFS_Ring_t* Ring, const char* path, uint32_t size) {
+	TM_FATFS_RingHeader_t Header[2], *h;
+	uint8_t valid0, valid1;
+	FRESULT fr;
+	
+	/* Check parameters */
+	if (size == 0) {
+		return FR_INVALID_PARAMETER;
+	}
+	
+	/* Reset structure */
+	memset(Ring, 0, sizeof(TM_FATFS_Ring_t));
+	Ring->Size = size;
+	
+	/* Open existing file */
+	fr = f_open(&Ring->File, path, FA_OPEN_EXISTING | FA_READ | FA_WRITE);
+	if (fr == FR_OK) {
+		/* Check both headers, power may fail while one of them is written */
+		valid0 = TM_FATFS_INT_RingReadHeader(Ring, 0, &Header[0]);
+		valid1 = TM_FATFS_INT_RingReadHeader(Ring, 1, &Header[1]);
+		
+		if (!valid0 && !valid1) {
+			/* File is not a ring log or both headers are damaged, do not touch it */
+			fr = FR_INT_ERR;
+		} else {
+			/* Use newer header, counter may overflow so compare difference */
+			h = &Header[0];
+			if (!valid0 || (valid1 && (int32_t)(Header[1].Sequence - Header[0].Sequence) > 0)) {
+				h = &Header[1];
+			}
+			
+			/* Ring with different size is not recreated, old data would be lost */
+			if (h->Size != size || f_size(&Ring->File) != RING_HEADER_SIZE + size) {
+				fr = FR_INVALID_PARAMETER;
+			}
+		}
+		if (fr) {
+			f_close(&Ring->File);
+			return fr;
+		}
+		
+		/* Use existing ring */
+		Ring->Tail = h->Tail;
+		Ring->Count = h->Count;
+		Ring->Sequence = h->Sequence;
+		return FR_OK;
+	} else if (fr != FR_NO_FILE) {
+		return fr;
+	}
+	
+	/* Create file, only if it does not exist */
+	fr = f_open(&Ring->File, path, FA_CREATE_NEW | FA_READ | FA_WRITE);
+	if (fr) return fr;
+	
+	/* Allocate whole file, file size does not change after that */
+	fr = f_lseek(&Ring->File, RING_HEADER_SIZE + size);
+	if (fr == FR_OK && f_tell(&Ring->File) != RING_HEADER_SIZE + size) {
+		fr = FR_DENIED;
+	}
+	if (fr) {
+		f_close(&Ring->File);
+		f_unlink(path);
+		return fr;
+	}
+	
+	/* Save empty ring */
+	return TM_FATFS_RingSync(Ring);
+}
+
+FRESULT TM_FATFS_RingWrite(TM_FATFS_Ring_t* Ring, const void* data, uint32_t btw) {
+	const uint8_t* ptr = (const uint8_t *)data;
+	uint32_t head, n;
+	FRESULT fr;
+	
+	/* Check free space */
+	if (btw > Ring->Size - Ring->Count) {
+		if (!Ring->Overwrite) {
+			return FR_DENIED;
+		}
+		
+		/* Only last part fits to ring */
+		if (btw > Ring->Size) {
+			ptr += btw - Ring->Size;
+			btw = Ring->Size;
+		}
+		
+		/* Drop oldest data */
+		TM_FATFS_RingTrim(Ring, btw - (Ring->Size - Ring->Count));
+	}
+	
+	/* Write in 1 or 2 parts */
+	head = (Ring->Tail + Ring->Count) % Ring->Size;
+	while (btw) {
+		n = Ring->Size - head;
+		if (n > btw) {
+			n = btw;
+		}
+		fr = TM_FATFS_INT_RingAccess(Ring, head, (void *)ptr, n, 1);
+		if (fr) return fr;
+		
+		Ring->Count += n;
+		ptr += n;
+		btw -= n;
+		head = 0;
+	}
+	
+	/* Return OK */
+	return FR_OK;
+}
+
+FRESULT TM_FATFS_RingRead(TM_FATFS_Ring_t* Ring, uint32_t offset, void* data, uint32_t btr, uint32_t* br) {
+	uint8_t* ptr = (uint8_t *)data;
+	uint32_t pos, n;
+	FRESULT fr;
+	
+	/* Nothing read yet */
+	*br = 0;
+	
+	/* Limit to stored data */
+	if (offset >= Ring->Count) {
+		return FR_OK;
+	}
+	if (btr > Ring->Count - offset) {
+		btr = Ring->Count - offset;
+	}
+	
+	/* Read in 1 or 2 parts */
+	pos = (Ring->Tail + offset) % Ring->Size;
+	while (btr) {
+		n = Ring->Size - pos;
+		if (n > btr) {
+			n = btr;
+		}
+		fr = TM_FATFS_INT_RingAccess(Ring, pos, ptr, n, 0);
+		if (fr) return fr;
+		
+		*br += n;
+		ptr += n;
+		btr -= n;
+		pos = 0;
+	}
+	
+	/* Return OK */
+	return FR_OK;
+}
+
+void TM_FATFS_RingTrim(TM_FATFS_Ring_t* Ring, uint32_t count) {
+	/* Move tail, data are not touched */
+	if (count > Ring->Count) {
+		count = Ring->Count;
+	}
+	Ring->Tail = (Ring->Tail + count) % Ring->Size;
+	Ring->Count -= count;
+}
+
+FRESULT TM_FATFS_RingSync(TM_FATFS_Ring_t* Ring) {
+	TM_FATFS_RingHeader_t Header;
+	UINT bw;
+	FRESULT fr;
+	
+	/* Fill header */
+	Ring->Sequence++;
+	Header.Magic = RING_MAGIC;
+	Header.Size = Ring->Size;
+	Header.Tail = Ring->Tail;
+	Header.Count = Ring->Count;
+	Header.Sequence = Ring->Sequence;
+	Header.Check = Header.Size ^ Header.Tail ^ Header.Count ^ Header.Sequence;
+	
+	/* Write header to sector with older one, the other stays valid if power fails */
+	fr = f_lseek(&Ring->File, (Ring->Sequence & 1) * RING_SECTOR_SIZE);
+	if (fr) return fr;
+	fr = f_write(&Ring->File, &Header, sizeof(Header), &bw);
+	if (fr) return fr;
+	
+	/* Write everything to disk */
+	return f_sync(&Ring->File);
+}
+
+FRESULT TM_FATFS_RingClose(TM_FATFS_Ring_t* Ring) {
+	FRESULT fr;
+	
+	/* Save header */
+	fr = TM_FATFS_RingSync(Ring);
+	if (fr) return fr;
+	
+	/* Close file */
+	return f_close(&Ring->File);
+}
+
 uint8_t TM_FATFS_CheckCardDetectPin(void) {
 	uint8_t status = 1;
 	
@@ -291,3 +639,114 @@ static FRESULT scan_files(char* path, uint16_t tmp_buffer_size, TM_FATFS_Search_
 	/* Return result */
 	return res;
 }
+
+static FRESULT TM_FATFS_INT_AllocateContiguous(FIL* fil, DWORD clusters) {
+	FATFS* fs = fil->fs;
+	DWORD cl, start, found, val;
+	FRESULT fr;
+	
+	/* Find free contiguous area in FAT */
+	start = cl = 2;
+	found = 0;
+	while (found < clusters) {
+		if (cl >= fs->n_fatent) {
+			return FR_DENIED;
+		}
+		val = get_fat(fs, cl);
+		if (val == 0xFFFFFFFF) {
+			return FR_DISK_ERR;
+		}
+		if (val == 1) {
+			return FR_INT_ERR;
+		}
+		cl++;
+		if (val) {
+			/* Cluster is used, start again after it */
+			start = cl;
+			found = 0;
+		} else {
+			found++;
+		}
+	}
+	
+	/* FatFs allocates new clusters after last allocated cluster */
+	fs->last_clust = start - 1;
+	fr = f_lseek(fil, clusters * fs->csize * 512);
+	if (fr) return fr;
+	if (fil->fsize != clusters * fs->csize * 512 || fil->sclust != start) {
+		return FR_DENIED;
+	}
+	
+	/* Check chain */
+	for (cl = start; cl < start + clusters - 1; cl++) {
+		if (get_fat(fs, cl) != cl + 1) {
+			return FR_DENIED;
+		}
+	}
+	
+	/* Return OK */
+	return FR_OK;
+}
+
+static FRESULT TM_FATFS_INT_LogWriteSectors(TM_FATFS_Log_t* Log, UINT count) {
+	uint32_t time;
+	DRESULT res;
+	
+	/* Write directly to drive, bypassing FatFs file buffer */
+	time = DWT->CYCCNT;
+	res = disk_write(Log->File.fs->drv, Log->Buffer, Log->StartSector + Log->Sector, count);
+	time = (DWT->CYCCNT - time) / (SystemCoreClock / 1000000);
+	
+	/* Statistics */
+	Log->Writes++;
+	Log->TotalWriteTime += time;
+	if (time > Log->MaxWriteTime) {
+		Log->MaxWriteTime = time;
+	}
+	
+	/* Return result */
+	return res == RES_OK ? FR_OK : FR_DISK_ERR;
+}
+
+static uint8_t TM_FATFS_INT_RingReadHeader(TM_FATFS_Ring_t* Ring, uint8_t slot, TM_FATFS_RingHeader_t* Header) {
+	UINT br;
+	
+	/* Read header from selected sector */
+	if (
+		f_lseek(&Ring->File, slot * RING_SECTOR_SIZE) != FR_OK ||
+		f_read(&Ring->File, Header, sizeof(TM_FATFS_RingHeader_t), &br) != FR_OK ||
+		br != sizeof(TM_FATFS_RingHeader_t)
+	) {
+		return 0;
+	}
+	
+	/* Check if header is complete and consistent */
+	return
+		Header->Magic == RING_MAGIC &&
+		Header->Size > 0 &&
+		Header->Tail < Header->Size &&
+		Header->Count <= Header->Size &&
+		Header->Check == (Header->Size ^ Header->Tail ^ Header->Count ^ Header->Sequence);
+}
+
+static FRESULT TM_FATFS_INT_RingAccess(TM_FATFS_Ring_t* Ring, uint32_t offset, void* data, uint32_t count, uint8_t write) {
+	UINT cnt;
+	FRESULT fr;
+	
+	/* Go to position in data area */
+	fr = f_lseek(&Ring->File, RING_HEADER_SIZE + offset);
+	if (fr) return fr;
+	
+	/* Read or write, file size stays the same */
+	if (write) {
+		fr = f_write(&Ring->File, data, count, &cnt);
+	} else {
+		fr = f_read(&Ring->File, data, count, &cnt);
+	}
+	if (fr == FR_OK && cnt != count) {
+		fr = FR_INT_ERR;
+	}
+	
+	/* Return result */
+	return fr;
+}
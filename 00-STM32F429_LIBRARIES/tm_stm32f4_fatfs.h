@@ -4,7 +4,7 @@
  * @website http://stm32f4-discovery.net
  * @link    http://stm32f4-discovery.net/2014/07/library-21-read-sd-card-fatfs-stm32f4xx-devices/
  * @link    http://stm32f4-discovery.net/2014/08/library-29-usb-msc-host-usb-flash-drive-stm32f4xx-devices
- * @version v1.7
+ * @version v1.11
  * @ide     Keil uVision
  * @license GNU GPL v3
  * @brief   Fatfs implementation for STM32F4xx devices
@@ -29,7 +29,7 @@
 @endverbatim
  */
 #ifndef TM_FATFS_H
-#define TM_FATFS_H 170
+#define TM_FATFS_H 1110
 
 /**
  * @addtogroup TM_STM32F4xx_Libraries
@@ -83,6 +83,17 @@
 @verbatim
 //Set SDIO with 1-bit communication
 #define FATFS_SDIO_4BIT   0
+@endverbatim
+ * 
+ * SDIO DMA needs 4-bytes aligned buffers. When FatFs passes unaligned buffer (for example f_read to char array),
+ * data go through aligned bounce buffer, which is big enough for multiple sectors so multi-block commands are still used.
+ * Use TM_FATFS_SDIO_GetStats() to see how often this happens.
+ *
+@verbatim
+//Bounce buffer size in sectors, 32 sectors = 16kB, default is 8
+#define FATFS_SDIO_BOUNCE_SECTORS  32
+//Optional bounce buffer address, for example in SDRAM. CCM RAM can not be used with DMA
+#define FATFS_SDIO_BOUNCE_ADDR     0xD0780000
 @endverbatim
  * 
  * For SDIO communication, you will need at least these files:
@@ -101,6 +112,38 @@
 - fatfs/drivers/fatfs_sd_sdio.h
 - fatfs/drivers/fatfs_sd_sdio.c
 @endverbatim 
+ *
+ * \par Asynchronous SDIO
+ *
+ * By default, SDIO driver waits in loop until data are transferred and card finishes programming,
+ * which can take hundreds of milliseconds on write. With asynchronous mode, read and write requests are put to queue
+ * and function returns immediately. Data are transferred by SDIO and DMA interrupts and card busy state
+ * is checked every 1 ms with TM DELAY timer. Callback is called from interrupt when request is done.
+ *
+ * FatFs functions still wait for their requests, but your code can prepare next buffer while previous one is written.
+ *
+@verbatim
+//Enable asynchronous SDIO in defines.h, TM_DELAY_Init() must be called before disk is mounted
+#define FATFS_SDIO_ASYNC          1
+//Maximal time for one request in milliseconds
+#define FATFS_SDIO_ASYNC_TIMEOUT  1000
+
+//Write buffer to sectors directly, buffer must be 4-bytes aligned
+void Done(TM_FATFS_SDIO_Request_t* Request) {
+    //Called from interrupt, buffer can be used again
+}
+
+TM_FATFS_SDIO_Request_t Req;
+Req.Buffer = (uint8_t *)Buffer;
+Req.Sector = 1000;
+Req.Count = 16;
+Req.Write = 1;
+Req.Callback = Done;
+TM_FATFS_SDIO_Submit(&Req);
+//Fill second buffer while first is written
+@endverbatim
+ *
+ * @note  Sectors written with TM_FATFS_SDIO_Submit() bypass FatFs. Use it for raw areas or preallocated files.
  *
  * \par SPI Communication
  * 
@@ -305,9 +348,25 @@ f_mount(&usb_fs, "1:", 1);
  *
  * \par FatFS with SPI FLASH
  *
- * This option is added to implementation, but low level drivers are not implemented yet.
- * 
- * @note If you will try to read from SPIFLASH using @ref f_mount() function, you will get errors.
+ * Serial NOR flash (W25Qxx and similar, up to 16MB) can be used as FATFS drive. Set FATFS_USE_SPI_FLASH to 1 in defines.h file.
+ * Pins, SPI and DMA settings are in fatfs/drivers/fatfs_spi_flash.h file, default is SPI4 with CS on PE4.
+ *
+ * Flash size is detected from JEDEC ID. NOR flash can only be erased in 4kB blocks, so 512-byte sectors are mapped to flash
+ * with flash translation layer in fatfs/drivers/fatfs_spi_flash_ftl.c. It does wear levelling and garbage collection,
+ * and data survives power fail in the middle of write. Part of flash is used for metadata and spare blocks, so FATFS gets about 85% of flash.
+ *
+ * Set _USE_TRIM to 1 in ffconf.h (or on compiler command line). Then FATFS tells FTL which sectors are free
+ * after file is deleted or truncated and FTL does not copy them during garbage collection.
+ *
+ * Flash is empty on first use, so you have to use @ref f_mkfs() function once, like with SDRAM.
+ * FTL can be tested on computer with simulated flash, see tools/spi_flash_ftl_bench folder.
+ *
+@verbatim
+//Mount SPI flash and format it on first use
+if (f_mount(&fs, "SPIFLASH:", 1) == FR_NO_FILESYSTEM) {
+    f_mkfs("SPIFLASH:", 0, 0);
+}
+@endverbatim
  *
  * \par New names for drivers
  *
@@ -347,7 +406,7 @@ f_open(&fil, "USB:my_file.txt", FA...);
  * - SDCARD: <b>SD</b>; Drive number 0
  * - USB DRIVE: <b>USB</b>; Drive number 1
  * - SDRAM: <b>SDRAM</b>; Drive number 2
- * - SPI FLASH: <b>SPIFLASH</b>; Drive number 3; Low level driver is not implemented yet
+ * - SPI FLASH: <b>SPIFLASH</b>; Drive number 3
  *
  * Example for opening files:
  *
@@ -371,7 +430,7 @@ f_open(&fil, "SD:my_file_sd.txt", FA...);
 //Enable SDRAM
 #define FATFS_USE_SDRAM     1
 //Enable SPI flash
-#define FATFS_USE_SPIFLASH  1 //Not implemented yet
+#define FATFS_USE_SPI_FLASH 1
 
 //SDCARD is enabled by default, but when you enable anything else too, SDCARD is disabled
 //If you want to enable it too, you have to tell that!
@@ -389,9 +448,121 @@ f_open(&fil, "SD:my_file_sd.txt", FA...);
  *
  * Check documentation for these 2 functions for more info.
  *
+ * \par Log writer
+ *
+ * Writing small records with f_write is slow. FatFs reads and writes partial sectors, updates FAT for each new cluster
+ * and each write is a separate command to card, so some writes take much longer than others.
+ *
+ * Log writer allocates contiguous clusters for the whole file when file is created.
+ * Records are collected to user buffer and each full buffer is written with one multi-sector command directly to sectors of file.
+ * File size in directory entry is only updated on checkpoints, with @ref TM_FATFS_LogSync or after CheckpointInterval bytes.
+ *
+@verbatim
+//Buffer for 32 sectors, aligned for DMA
+uint32_t LogBuffer[32 * 512 / 4];
+TM_FATFS_Log_t Log;
+
+//Create 16MB log
+if (TM_FATFS_LogOpen(&Log, "SD:log.txt", 16 * 1024 * 1024, (uint8_t *)LogBuffer, sizeof(LogBuffer)) == FR_OK) {
+    //Update file size every 64kB
+    Log.CheckpointInterval = 65536;
+
+    TM_FATFS_LogWrite(&Log, "Record\n", 7);
+    //...
+
+    //Close, unused clusters are freed
+    TM_FATFS_LogClose(&Log);
+}
+@endverbatim
+ *
+ * @note  Disk must have free contiguous area for log, formatted or defragmented disk is best.
+ *        If power fails, file has size of last checkpoint and clusters after it stay allocated to file.
+ *
+ * \par Ring log file
+ *
+ * @ref TM_FATFS_TruncateBeginning copies the whole file to remove old data. Ring log file has fixed size instead.
+ * First 2 sectors are headers with offset of oldest byte and number of stored bytes, data area follows them.
+ * Headers are written alternately, each with sequence number. On open, valid header with higher sequence number is used,
+ * so if power fails while header is written, previous one is still available.
+ * New data are written after the newest byte and wrap to beginning of data area.
+ * Removing old data with @ref TM_FATFS_RingTrim only changes tail offset.
+ *
+@verbatim
+TM_FATFS_Ring_t Ring;
+char buf[64];
+uint32_t br, offset = 0;
+
+//Open or create ring with 1MB of data
+if (TM_FATFS_RingOpen(&Ring, "SD:ring.log", 1024 * 1024) == FR_OK) {
+    //Drop oldest data when full
+    Ring.Overwrite = 1;
+
+    TM_FATFS_RingWrite(&Ring, "Record\n", 7);
+
+    //Save header from time to time
+    TM_FATFS_RingSync(&Ring);
+
+    //Read everything from oldest to newest
+    while (TM_FATFS_RingRead(&Ring, offset, buf, sizeof(buf), &br) == FR_OK && br) {
+        offset += br;
+    }
+
+    TM_FATFS_RingClose(&Ring);
+}
+@endverbatim
+ *
+ * @note  With Overwrite set, oldest record can be cut in the middle. Readers of text logs should skip to first new line.
+ *
+ * \par Sector cache
+ *
+ * FatFs reads and writes FAT and directory sectors one by one, and each of them is a separate command to SD card.
+ * Optional write-back cache in diskio.c keeps recently used sectors of all drives in RAM:
+ *  - Sectors are in 4-way set associative cache with LRU replacement
+ *  - Written sectors are only marked as dirty and are written to drive when they are replaced or on @ref f_sync / @ref f_close
+ *  - Dirty consecutive sectors are written with one multi-block write command, up to FATFS_CACHE_COALESCE sectors at a time
+ *  - Consecutive missing sectors are read with one multi-block read command
+ *  - Transfers of FATFS_CACHE_BYPASS or more sectors (large file reads and writes) go directly to driver
+ *
+ * Cache is disabled by default. To enable it, open defines.h file and add:
+ *
+@verbatim
+//Enable sector cache
+#define FATFS_USE_CACHE       1
+//Number of cached sectors, 512 bytes each
+#define FATFS_CACHE_SECTORS   64
+//Place cache to SDRAM instead of internal RAM, TM SDRAM must be initialized first
+#define FATFS_CACHE_ADDR      0xD0600000
+@endverbatim
+ *
+ * @note  SDRAM drive uses whole SDRAM, so cache can not be in SDRAM when FATFS_USE_SDRAM is set.
+ *        Compilation fails if FATFS_CACHE_ADDR is defined together with FATFS_USE_SDRAM, cache must stay in internal RAM then.
+ *
+ * @note  Data are not on drive until @ref f_sync or @ref f_close is called. Card must not be removed before.
+ *
+ * Cache statistics can be read with TM_FATFS_CacheGetStats() function, declared in fatfs/diskio.h.
+ *
  * \par Changelog
  *
 @verbatim
+ Version 1.11
+  - October 19, 2026
+  - Implemented SPI flash driver with flash translation layer, wear levelling and trim
+  - Ring log file has 2 alternating headers, existing file with invalid header is not recreated
+  
+ Version 1.10
+  - October 19, 2026
+  - Added sequential log writer with pre-allocated contiguous files
+  - Added ring log file, replacement for TM_FATFS_TruncateBeginning for logs
+  
+ Version 1.9
+  - October 19, 2026
+  - Added asynchronous SDIO request queue, driven by SDIO and DMA interrupts
+  - Unaligned SDIO buffers use multi-sector bounce buffer instead of single sector transfers
+  
+ Version 1.8
+  - October 19, 2026
+  - Added optional write-back sector cache with coalescing of writes
+  
  Version 1.7
   - April 30, 2015
   - Added support for SDRAM as FATFS drive
@@ -437,6 +608,7 @@ f_open(&fil, "SD:my_file_sd.txt", FA...);
  - TM DELAY         (only when SPI)
  - TM GPIO
  - TM SDRAM         (only when SDRAM)
+ - TM SPI DMA       (only when SPI FLASH)
  - FatFS by Chan
 @endverbatim
  */
@@ -506,6 +678,38 @@ typedef struct {
 } TM_FATFS_Search_t;
 
 
+/**
+ * @brief  Sequential log writer structure
+ * @note   All members are set by library, only CheckpointInterval can be changed by user
+ */
+typedef struct {
+	FIL File;                    /*!< FatFs file object */
+	uint8_t* Buffer;             /*!< Pointer to user buffer, 4-bytes aligned */
+	uint32_t BufferSize;         /*!< Buffer size in bytes, multiple of 512 */
+	uint32_t BufferCount;        /*!< Number of bytes in buffer */
+	DWORD StartSector;           /*!< First sector of file on drive */
+	DWORD Sectors;               /*!< Number of pre-allocated sectors */
+	DWORD Sector;                /*!< Sector of buffer start, relative to StartSector */
+	uint32_t Size;               /*!< Number of bytes written to log */
+	uint32_t CheckpointSize;     /*!< File size in directory entry */
+	uint32_t CheckpointInterval; /*!< Number of bytes after which directory entry is updated, 0 to update only with @ref TM_FATFS_LogSync */
+	uint32_t Writes;             /*!< Number of write commands to drive */
+	uint32_t MaxWriteTime;       /*!< Longest write command in units of microseconds */
+	uint32_t TotalWriteTime;     /*!< Time of all write commands in units of microseconds */
+} TM_FATFS_Log_t;
+
+/**
+ * @brief  Ring log file structure
+ */
+typedef struct {
+	FIL File;          /*!< FatFs file object */
+	uint32_t Size;     /*!< Size of data area in bytes */
+	uint32_t Tail;     /*!< Offset of oldest byte in data area */
+	uint32_t Count;    /*!< Number of bytes stored in ring */
+	uint32_t Sequence; /*!< Number of header updates */
+	uint8_t Overwrite; /*!< Set to 1 to drop oldest data when ring is full, or 0 to return error */
+} TM_FATFS_Ring_t;
+
 /**
  * @}
  */
@@ -546,6 +750,8 @@ FRESULT TM_FATFS_USBDriveSize(uint32_t* total, uint32_t* free);
 
 /**
  * @brief  Truncates beginning of file
+ * @note   Function copies all data after index to the beginning of file. For logs which drop old data often,
+ *         use ring log file with @ref TM_FATFS_RingOpen and @ref TM_FATFS_RingTrim instead
  *
  * Example:
  *	- You have a file, its content is: "abcdefghijklmnoprstuvwxyz",
@@ -560,6 +766,99 @@ FRESULT TM_FATFS_USBDriveSize(uint32_t* total, uint32_t* free);
  */
 FRESULT TM_FATFS_TruncateBeginning(FIL* fil, uint32_t index);
 
+/**
+ * @brief  Creates log file with pre-allocated contiguous clusters
+ * @note   Existing file is overwritten. File is empty until first @ref TM_FATFS_LogSync
+ * @param  *Log: Pointer to empty @ref TM_FATFS_Log_t structure
+ * @param  *path: File path
+ * @param  size: Maximal log size in bytes, rounded up to cluster size
+ * @param  *buffer: Pointer to buffer, 4-bytes aligned for SDIO DMA
+ * @param  buffer_size: Buffer size in bytes, multiple of 512. Each full buffer is written with one multi-sector command
+ * @retval Member of @ref FRESULT enumeration. FR_DENIED is returned if there is no contiguous free area of this size
+ */
+FRESULT TM_FATFS_LogOpen(TM_FATFS_Log_t* Log, const char* path, uint32_t size, uint8_t* buffer, uint32_t buffer_size);
+
+/**
+ * @brief  Writes data to log
+ * @note   Data are copied to buffer, full buffer is written directly to drive
+ * @param  *Log: Pointer to @ref TM_FATFS_Log_t structure
+ * @param  *data: Pointer to data
+ * @param  btw: Number of bytes to write
+ * @retval Member of @ref FRESULT enumeration. FR_DENIED is returned if log is full
+ */
+FRESULT TM_FATFS_LogWrite(TM_FATFS_Log_t* Log, const void* data, uint32_t btw);
+
+/**
+ * @brief  Writes buffered data and updates file size in directory entry (checkpoint)
+ * @note   Data after last checkpoint are lost on power failure
+ * @param  *Log: Pointer to @ref TM_FATFS_Log_t structure
+ * @retval Member of @ref FRESULT enumeration
+ */
+FRESULT TM_FATFS_LogSync(TM_FATFS_Log_t* Log);
+
+/**
+ * @brief  Writes buffered data, frees unused clusters and closes log file
+ * @param  *Log: Pointer to @ref TM_FATFS_Log_t structure
+ * @retval Member of @ref FRESULT enumeration
+ */
+FRESULT TM_FATFS_LogClose(TM_FATFS_Log_t* Log);
+
+/**
+ * @brief  Opens ring log file or creates new one with fixed size
+ * @note   Empty ring is created only if file does not exist. Existing file is never recreated, so log is not lost:
+ *            - FR_INT_ERR is returned if none of its headers is valid
+ *            - FR_INVALID_PARAMETER is returned if it has different size
+ *         Delete such file with f_unlink to create new ring
+ * @param  *Ring: Pointer to empty @ref TM_FATFS_Ring_t structure
+ * @param  *path: File path
+ * @param  size: Size of data area in bytes. File is 1024 bytes larger because of 2 headers
+ * @retval Member of @ref FRESULT enumeration
+ */
+FRESULT TM_FATFS_RingOpen(TM_FATFS_Ring_t* Ring, const char* path, uint32_t size);
+
+/**
+ * @brief  Writes data at the end of ring
+ * @param  *Ring: Pointer to @ref TM_FATFS_Ring_t structure
+ * @param  *data: Pointer to data
+ * @param  btw: Number of bytes to write
+ * @retval Member of @ref FRESULT enumeration. FR_DENIED is returned if there is not enough free space and Overwrite is 0
+ */
+FRESULT TM_FATFS_RingWrite(TM_FATFS_Ring_t* Ring, const void* data, uint32_t btw);
+
+/**
+ * @brief  Reads data from ring without removing them
+ * @param  *Ring: Pointer to @ref TM_FATFS_Ring_t structure
+ * @param  offset: Offset from oldest byte in ring
+ * @param  *data: Pointer to buffer for data
+ * @param  btr: Number of bytes to read
+ * @param  *br: Pointer to variable to store number of read bytes to
+ * @retval Member of @ref FRESULT enumeration
+ */
+FRESULT TM_FATFS_RingRead(TM_FATFS_Ring_t* Ring, uint32_t offset, void* data, uint32_t btr, uint32_t* br);
+
+/**
+ * @brief  Removes oldest data from ring
+ * @note   Only tail offset is changed, data are not moved
+ * @param  *Ring: Pointer to @ref TM_FATFS_Ring_t structure
+ * @param  count: Number of bytes to remove
+ * @retval None
+ */
+void TM_FATFS_RingTrim(TM_FATFS_Ring_t* Ring, uint32_t count);
+
+/**
+ * @brief  Saves header with tail and count and writes everything to disk
+ * @param  *Ring: Pointer to @ref TM_FATFS_Ring_t structure
+ * @retval Member of @ref FRESULT enumeration
+ */
+FRESULT TM_FATFS_RingSync(TM_FATFS_Ring_t* Ring);
+
+/**
+ * @brief  Saves header and closes ring log file
+ * @param  *Ring: Pointer to @ref TM_FATFS_Ring_t structure
+ * @retval Member of @ref FRESULT enumeration
+ */
+FRESULT TM_FATFS_RingClose(TM_FATFS_Ring_t* Ring);
+
 /**
  * @brief  Checks card detect pin (if activated) if card is inserted
  * @note   Pin must be set low in order to get card inserted, otherwise card is not inserted
@@ -339,3 +339,122 @@ char* TM_FONTS_GetStringSize(char* str, TM_FONTS_SIZE_t* SizeStruct, TM_FontDef_
 	/* Return pointer */
 	return str;
 }
+
+char* TM_FONTS_GetPropStringSize(char* str, TM_FONTS_SIZE_t* SizeStruct, const TM_FONTS_PropFont_t* Font) {
+	const TM_FONTS_PropGlyph_t* glyph;
+	uint16_t length = 0;
+	char* s = str;
+	
+	/* Sum advances of all characters */
+	while (*s) {
+		glyph = TM_FONTS_GetPropGlyph(Font, *s);
+		if (glyph) {
+			length += glyph->Advance;
+			
+			/* Kerning with next character */
+			if (Font->KerningCount && *(s + 1)) {
+				length += TM_FONTS_GetKerning(Font, *s, *(s + 1));
+			}
+		}
+		s++;
+	}
+	
+	/* Fill settings */
+	SizeStruct->Height = Font->Height;
+	SizeStruct->Length = length;
+	
+	/* Return pointer */
+	return str;
+}
+
+const TM_FONTS_PropGlyph_t* TM_FONTS_GetPropGlyph(const TM_FONTS_PropFont_t* Font, char c) {
+	/* Check if character is in font */
+	if ((uint8_t)c < Font->FirstChar || (uint8_t)c > Font->LastChar) {
+		return 0;
+	}
+	
+	/* Return character */
+	return &Font->Glyphs[(uint8_t)c - Font->FirstChar];
+}
+
+int8_t TM_FONTS_GetKerning(const TM_FONTS_PropFont_t* Font, char left, char right) {
+	int32_t low, high, mid;
+	uint16_t key, pair;
+	
+	/* Binary search, pairs are sorted by left and then by right character */
+	key = ((uint16_t)(uint8_t)left << 8) | (uint8_t)right;
+	low = 0;
+	high = (int32_t)Font->KerningCount - 1;
+	while (low <= high) {
+		mid = (low + high) >> 1;
+		pair = ((uint16_t)Font->Kerning[mid].Left << 8) | Font->Kerning[mid].Right;
+		if (pair == key) {
+			return Font->Kerning[mid].Value;
+		}
+		if (pair < key) {
+			low = mid + 1;
+		} else {
+			high = mid - 1;
+		}
+	}
+	
+	/* No pair */
+	return 0;
+}
+
+uint8_t TM_FONTS_DecodePropGlyph(const TM_FONTS_PropFont_t* Font, const TM_FONTS_PropGlyph_t* Glyph, uint8_t* Buffer, uint32_t size) {
+	const uint8_t* data;
+	uint32_t i, count, pixels;
+	uint8_t value;
+	
+	/* Check buffer size */
+	pixels = (uint32_t)Glyph->Width * Glyph->Height;
+	if (pixels > size) {
+		return 1;
+	}
+	
+	data = &Font->Data[Glyph->Offset];
+	switch (Font->Format) {
+		case TM_FONTS_PropFormat_1BPP:
+			/* 8 pixels in byte, MSB first */
+			for (i = 0; i < pixels; i++) {
+				Buffer[i] = (data[i >> 3] & (0x80 >> (i & 0x07))) ? 0xFF : 0x00;
+			}
+			break;
+		case TM_FONTS_PropFormat_4BPP:
+			/* 2 pixels in byte, high nibble first, 0x0F is expanded to 0xFF */
+			for (i = 0; i < pixels; i++) {
+				value = (i & 0x01) ? (data[i >> 1] & 0x0F) : (data[i >> 1] >> 4);
+				Buffer[i] = value * 0x11;
+			}
+			break;
+		case TM_FONTS_PropFormat_1BPP_RLE:
+		case TM_FONTS_PropFormat_4BPP_RLE:
+			/* One run in each byte */
+			i = 0;
+			while (i < pixels) {
+				if (Font->Format == TM_FONTS_PropFormat_1BPP_RLE) {
+					value = (*data & 0x80) ? 0xFF : 0x00;
+					count = (*data & 0x7F) + 1;
+				} else {
+					value = (*data & 0x0F) * 0x11;
+					count = (*data >> 4) + 1;
+				}
+				data++;
+				
+				/* Run can not go over the end of bitmap */
+				if (count > (pixels - i)) {
+					count = pixels - i;
+				}
+				while (count--) {
+					Buffer[i++] = value;
+				}
+			}
+			break;
+		default:
+			return 1;
+	}
+	
+	/* Return OK */
+	return 0;
+}
@@ -3,7 +3,7 @@
  * @email   tilen@majerle.eu
  * @website http://stm32f4-discovery.net
  * @link    
- * @version v1.2
+ * @version v1.3
  * @ide     Keil uVision
  * @license GNU GPL v3
  * @brief   Fonts library for LCD libraries
@@ -28,7 +28,7 @@
 @endverbatim
  */
 #ifndef TM_FONTS_H
-#define TM_FONTS_H 120
+#define TM_FONTS_H 130
 
 /* C++ detection */
 #ifdef __cplusplus
@@ -54,9 +54,43 @@ extern "C" {
  *  - 11 x 18 pixels
  *  - 16 x 26 pixels
  *
+ * \par Proportional fonts
+ *
+ * Fonts above are monospace, 1 bit per pixel and at most 16 pixels wide, one <code>uint16_t</code> per row.
+ * For bigger and nicer text, library also supports proportional fonts with @ref TM_FONTS_PropFont_t structure:
+ *
+ *  - Each character has its own bitmap size, position and advance (distance to next character)
+ *  - Optional kerning pairs, for example "AV" is drawn closer together
+ *  - No limit for width and height, only area of bitmap is stored, without empty rows and columns
+ *  - Bitmaps are 1 bit per pixel or 4 bits per pixel for anti-aliased edges
+ *  - Bitmaps can be run length encoded, which saves most memory on big fonts (large numbers for example)
+ *
+ * String width is calculated only from advance table and kerning pairs, bitmaps are not decoded.
+ *
+ * Data format for each bitmap, pixels go from left to right and from top to bottom without padding:
+ *  - @ref TM_FONTS_PropFormat_1BPP: 8 pixels in byte, MSB first
+ *  - @ref TM_FONTS_PropFormat_4BPP: 2 pixels in byte, high nibble first
+ *  - @ref TM_FONTS_PropFormat_1BPP_RLE: each byte is one run, bit 7 is pixel value, bits 6:0 are number of pixels - 1
+ *  - @ref TM_FONTS_PropFormat_4BPP_RLE: each byte is one run, bits 7:4 are number of pixels - 1, bits 3:0 are pixel value
+ *
+ * Fonts are made with <code>tools/fontconv.py</code> script from BDF bitmap fonts, which can be exported
+ * from any TTF font with FontForge or otf2bdf. For anti-aliased font, export BDF at 4 times bigger size
+ * and script will scale it down to 4 bits per pixel:
+ *
+@verbatim
+otf2bdf -p 128 -r 72 Font.ttf -o Font_128.bdf
+python fontconv.py Font_128.bdf TM_Font_Digits32 --aa 4 --rle auto --chars "0123456789.-:"
+@endverbatim
+ *
+ * Script creates .c and .h file with @ref TM_FONTS_PropFont_t variable, add them to your project.
+ *
  * \par Changelog
  *
 @verbatim
+ Version 1.3
+  - Added proportional fonts with kerning, 4-bit anti-aliasing and RLE compression
+  - Added TM_FONTS_GetPropStringSize function which uses advance table only
+
  Version 1.2
   - May 24, 2015
   - Added support for string length and height
@@ -100,6 +134,52 @@ typedef struct {
 	uint16_t Height;      /*!< String height in units of pixels */
 } TM_FONTS_SIZE_t;
 
+/**
+ * @brief  Bitmap format of proportional font
+ */
+typedef enum {
+	TM_FONTS_PropFormat_1BPP = 0x00, /*!< 1 bit per pixel, bit packed */
+	TM_FONTS_PropFormat_4BPP,        /*!< 4 bits per pixel anti-aliased, nibble packed */
+	TM_FONTS_PropFormat_1BPP_RLE,    /*!< 1 bit per pixel, run length encoded */
+	TM_FONTS_PropFormat_4BPP_RLE     /*!< 4 bits per pixel anti-aliased, run length encoded */
+} TM_FONTS_PropFormat_t;
+
+/**
+ * @brief  One character of proportional font
+ */
+typedef struct {
+	uint32_t Offset;  /*!< Index of first bitmap byte in font data array */
+	uint8_t Width;    /*!< Bitmap width in units of pixels */
+	uint8_t Height;   /*!< Bitmap height in units of pixels */
+	uint8_t Advance;  /*!< Distance from start of this character to start of next one */
+	int8_t OffsetX;   /*!< Distance from start of character to left bitmap edge */
+	int8_t OffsetY;   /*!< Distance from top of line to top bitmap edge */
+} TM_FONTS_PropGlyph_t;
+
+/**
+ * @brief  Kerning pair of proportional font
+ */
+typedef struct {
+	uint8_t Left;     /*!< First character in pair */
+	uint8_t Right;    /*!< Second character in pair */
+	int8_t Value;     /*!< Advance correction of first character, negative moves characters together */
+} TM_FONTS_Kerning_t;
+
+/**
+ * @brief  Proportional font structure, made with fontconv.py script
+ */
+typedef struct {
+	uint8_t Height;                     /*!< Line height in units of pixels */
+	uint8_t Baseline;                   /*!< Distance from top of line to baseline */
+	uint8_t FirstChar;                  /*!< First character in font */
+	uint8_t LastChar;                   /*!< Last character in font */
+	TM_FONTS_PropFormat_t Format;       /*!< Bitmap format. This parameter can be a value of @ref TM_FONTS_PropFormat_t enumeration */
+	const TM_FONTS_PropGlyph_t* Glyphs; /*!< Pointer to characters from first to last */
+	const uint8_t* Data;                /*!< Pointer to bitmap data of all characters */
+	const TM_FONTS_Kerning_t* Kerning;  /*!< Pointer to kerning pairs, sorted by left and then right character */
+	uint16_t KerningCount;              /*!< Number of kerning pairs */
+} TM_FONTS_PropFont_t;
+
 /**
  * @}
  */
@@ -144,6 +224,47 @@ extern TM_FontDef_t TM_Font_16x26;
  */
 char* TM_FONTS_GetStringSize(char* str, TM_FONTS_SIZE_t* SizeStruct, TM_FontDef_t* Font);
 
+/**
+ * @brief  Calculates string length and height in units of pixels for proportional font
+ * @note   Only advance table and kerning pairs are used, bitmaps are not decoded
+ * @param  *str: String to be checked for length and height
+ * @param  *SizeStruct: Pointer to empty @ref TM_FONTS_SIZE_t structure where informations will be saved
+ * @param  *Font: Pointer to @ref TM_FONTS_PropFont_t font used for calculations
+ * @retval Pointer to string used for length and height
+ */
+char* TM_FONTS_GetPropStringSize(char* str, TM_FONTS_SIZE_t* SizeStruct, const TM_FONTS_PropFont_t* Font);
+
+/**
+ * @brief  Gets character of proportional font
+ * @param  *Font: Pointer to @ref TM_FONTS_PropFont_t font
+ * @param  c: Character to get
+ * @retval Pointer to @ref TM_FONTS_PropGlyph_t character or NULL if character is not in font
+ */
+const TM_FONTS_PropGlyph_t* TM_FONTS_GetPropGlyph(const TM_FONTS_PropFont_t* Font, char c);
+
+/**
+ * @brief  Gets kerning correction for 2 characters
+ * @param  *Font: Pointer to @ref TM_FONTS_PropFont_t font
+ * @param  left: First character
+ * @param  right: Second character
+ * @retval Advance correction in units of pixels, 0 if there is no pair
+ */
+int8_t TM_FONTS_GetKerning(const TM_FONTS_PropFont_t* Font, char left, char right);
+
+/**
+ * @brief  Decodes character bitmap to 8-bit alpha mask
+ * @note   Mask has Width * Height bytes of alpha, from 0x00 (background) to 0xFF (foreground).
+ *         1-bit formats give only 0x00 and 0xFF, 4-bit formats give 16 levels, each 4-bit value is multiplied by 0x11
+ * @param  *Font: Pointer to @ref TM_FONTS_PropFont_t font
+ * @param  *Glyph: Pointer to @ref TM_FONTS_PropGlyph_t character from this font
+ * @param  *Buffer: Pointer to buffer where mask will be saved
+ * @param  size: Buffer size in units of bytes
+ * @retval Status:
+ *            - 0: Mask is decoded
+ *            - > 0: Buffer is too small
+ */
+uint8_t TM_FONTS_DecodePropGlyph(const TM_FONTS_PropFont_t* Font, const TM_FONTS_PropGlyph_t* Glyph, uint8_t* Buffer, uint32_t size);
+
 /**
  * @}
  */
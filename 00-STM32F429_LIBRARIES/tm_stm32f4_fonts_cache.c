@@ -0,0 +1,265 @@
+/**
+ * |----------------------------------------------------------------------
+ * | Copyright (C) Tilen MAJERLE, 2015
+ * |
+ * | This program is free software: you can redistribute it and/or modify
+ * | it under the terms of the GNU General Public License as published by
+ * | the Free Software Foundation, either version 3 of the License, or
+ * | any later version.
+ * |
+ * | This program is distributed in the hope that it will be useful,
+ * | but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * | GNU General Public License for more details.
+ * |
+ * | You should have received a copy of the GNU General Public License
+ * | along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * |----------------------------------------------------------------------
+ */
+#include "tm_stm32f4_fonts_cache.h"
+
+/* Private structure for one cache entry */
+typedef struct {
+	TM_FontDef_t* Font;
+	uint32_t Foreground;
+	uint32_t Background;
+	uint32_t LastUse;
+	int16_t Next;
+	uint8_t Char;
+	uint8_t Mode;
+} TM_FONTS_CACHE_INT_Entry_t;
+
+/* Private variables */
+static TM_FONTS_CACHE_INT_Entry_t FONTS_CACHE_Entries[FONTS_CACHE_SLOTS];
+static int16_t FONTS_CACHE_Buckets[FONTS_CACHE_BUCKETS];
+static TM_FONTS_CACHE_Stats_t FONTS_CACHE_Stats;
+static uint32_t FONTS_CACHE_Time = 0;
+static uint8_t FONTS_CACHE_Initialized = 0;
+
+/* Mode is combination of format and rotation */
+#define FONTS_CACHE_MODE(format, rotate)    ((uint8_t)(format) | ((uint8_t)(rotate) << 4))
+
+/* Bytes per pixel for each format */
+static const uint8_t FONTS_CACHE_BPP[3] = {1, 2, 4};
+
+/* Private functions */
+static uint16_t TM_INT_FONTS_CACHE_Hash(TM_FontDef_t* Font, uint8_t c, uint8_t mode, uint32_t Foreground, uint32_t Background);
+static int16_t TM_INT_FONTS_CACHE_Find(uint16_t hash, TM_FontDef_t* Font, uint8_t c, uint8_t mode, uint32_t Foreground, uint32_t Background);
+static int16_t TM_INT_FONTS_CACHE_Allocate(void);
+static void TM_INT_FONTS_CACHE_Render(void* Data, TM_FontDef_t* Font, uint8_t c, TM_FONTS_CACHE_Format_t Format, TM_FONTS_CACHE_Rotate_t Rotate, uint32_t Foreground, uint32_t Background);
+
+uint8_t TM_FONTS_CACHE_Get(TM_FONTS_CACHE_Glyph_t* Glyph, TM_FontDef_t* Font, char c, TM_FONTS_CACHE_Format_t Format, TM_FONTS_CACHE_Rotate_t Rotate, uint32_t Foreground, uint32_t Background) {
+	uint8_t mode;
+	uint16_t hash;
+	int16_t index;
+
+	/* Check parameters */
+	if (
+		(uint8_t)c < 32 ||
+		(uint8_t)c > 126 ||
+		(Font->FontWidth * Font->FontHeight) > FONTS_CACHE_MAX_PIXELS
+	) {
+		return 1;
+	}
+
+	/* Initialize on first use */
+	if (!FONTS_CACHE_Initialized) {
+		TM_FONTS_CACHE_Flush();
+	}
+
+	/* Colours are not part of alpha mask */
+	if (Format == TM_FONTS_CACHE_Format_A8) {
+		Foreground = 0;
+		Background = 0;
+	}
+
+	/* Find entry */
+	mode = FONTS_CACHE_MODE(Format, Rotate);
+	hash = TM_INT_FONTS_CACHE_Hash(Font, c, mode, Foreground, Background);
+	index = TM_INT_FONTS_CACHE_Find(hash, Font, c, mode, Foreground, Background);
+
+	if (index >= 0) {
+		/* Glyph is in cache */
+		FONTS_CACHE_Stats.Hits++;
+	} else {
+		/* Get free or least recently used slot */
+		index = TM_INT_FONTS_CACHE_Allocate();
+
+		/* Fill entry */
+		FONTS_CACHE_Entries[index].Font = Font;
+		FONTS_CACHE_Entries[index].Char = c;
+		FONTS_CACHE_Entries[index].Mode = mode;
+		FONTS_CACHE_Entries[index].Foreground = Foreground;
+		FONTS_CACHE_Entries[index].Background = Background;
+
+		/* Add to the beginning of bucket list */
+		FONTS_CACHE_Entries[index].Next = FONTS_CACHE_Buckets[hash];
+		FONTS_CACHE_Buckets[hash] = index;
+
+		/* DMA2D may still read this slot from previous character */
+		DMA2D_WAIT;
+
+		/* Render glyph to slot */
+		TM_INT_FONTS_CACHE_Render(
+			(void *)(FONTS_CACHE_ADDR + (uint32_t)index * FONTS_CACHE_SLOT_SIZE),
+			Font, c, Format, Rotate, Foreground, Background
+		);
+
+		FONTS_CACHE_Stats.Misses++;
+	}
+
+	/* Mark as used */
+	FONTS_CACHE_Entries[index].LastUse = ++FONTS_CACHE_Time;
+
+	/* Fill glyph info */
+	Glyph->Data = (void *)(FONTS_CACHE_ADDR + (uint32_t)index * FONTS_CACHE_SLOT_SIZE);
+	Glyph->Format = Format;
+	if (Rotate == TM_FONTS_CACHE_Rotate_90 || Rotate == TM_FONTS_CACHE_Rotate_270) {
+		Glyph->Width = Font->FontHeight;
+		Glyph->Height = Font->FontWidth;
+	} else {
+		Glyph->Width = Font->FontWidth;
+		Glyph->Height = Font->FontHeight;
+	}
+
+	/* Return OK */
+	return 0;
+}
+
+void TM_FONTS_CACHE_Flush(void) {
+	uint16_t i;
+
+	/* Clear all buckets */
+	for (i = 0; i < FONTS_CACHE_BUCKETS; i++) {
+		FONTS_CACHE_Buckets[i] = -1;
+	}
+
+	/* Clear all entries */
+	for (i = 0; i < FONTS_CACHE_SLOTS; i++) {
+		FONTS_CACHE_Entries[i].Font = 0;
+		FONTS_CACHE_Entries[i].LastUse = 0;
+		FONTS_CACHE_Entries[i].Next = -1;
+	}
+
+	/* Reset statistics */
+	FONTS_CACHE_Stats.Hits = 0;
+	FONTS_CACHE_Stats.Misses = 0;
+	FONTS_CACHE_Stats.Evictions = 0;
+	FONTS_CACHE_Time = 0;
+
+	/* Initialized */
+	FONTS_CACHE_Initialized = 1;
+}
+
+void TM_FONTS_CACHE_GetStats(TM_FONTS_CACHE_Stats_t* Stats) {
+	/* Copy statistics */
+	*Stats = FONTS_CACHE_Stats;
+}
+
+/* Private functions */
+static uint16_t TM_INT_FONTS_CACHE_Hash(TM_FontDef_t* Font, uint8_t c, uint8_t mode, uint32_t Foreground, uint32_t Background) {
+	uint32_t hash;
+
+	/* Mix all key parts together */
+	hash = (uint32_t)Font ^ ((uint32_t)c * 0x9E3779B1) ^ ((uint32_t)mode << 24);
+	hash ^= Foreground * 31 + Background;
+	hash ^= hash >> 16;
+	hash ^= hash >> 8;
+
+	/* Return bucket index */
+	return hash & (FONTS_CACHE_BUCKETS - 1);
+}
+
+static int16_t TM_INT_FONTS_CACHE_Find(uint16_t hash, TM_FontDef_t* Font, uint8_t c, uint8_t mode, uint32_t Foreground, uint32_t Background) {
+	int16_t index;
+	TM_FONTS_CACHE_INT_Entry_t* entry;
+
+	/* Go through bucket list */
+	for (index = FONTS_CACHE_Buckets[hash]; index >= 0; index = entry->Next) {
+		entry = &FONTS_CACHE_Entries[index];
+		if (
+			entry->Font == Font &&
+			entry->Char == c &&
+			entry->Mode == mode &&
+			entry->Foreground == Foreground &&
+			entry->Background == Background
+		) {
+			return index;
+		}
+	}
+
+	/* Not found */
+	return -1;
+}
+
+static int16_t TM_INT_FONTS_CACHE_Allocate(void) {
+	int16_t i, lru = 0, *link;
+	TM_FONTS_CACHE_INT_Entry_t* entry;
+
+	/* Find free slot or least recently used one */
+	for (i = 0; i < FONTS_CACHE_SLOTS; i++) {
+		if (FONTS_CACHE_Entries[i].Font == 0) {
+			return i;
+		}
+		if (FONTS_CACHE_Entries[i].LastUse < FONTS_CACHE_Entries[lru].LastUse) {
+			lru = i;
+		}
+	}
+
+	/* Remove LRU entry from its bucket list */
+	entry = &FONTS_CACHE_Entries[lru];
+	link = &FONTS_CACHE_Buckets[TM_INT_FONTS_CACHE_Hash(entry->Font, entry->Char, entry->Mode, entry->Foreground, entry->Background)];
+	while (*link != lru) {
+		link = &FONTS_CACHE_Entries[*link].Next;
+	}
+	*link = entry->Next;
+
+	FONTS_CACHE_Stats.Evictions++;
+
+	/* Return slot */
+	return lru;
+}
+
+static void TM_INT_FONTS_CACHE_Render(void* Data, TM_FontDef_t* Font, uint8_t c, TM_FONTS_CACHE_Format_t Format, TM_FONTS_CACHE_Rotate_t Rotate, uint32_t Foreground, uint32_t Background) {
+	const uint16_t* data;
+	uint32_t i, j, b, w, h;
+	int32_t index, stepX, stepY;
+
+	w = Font->FontWidth;
+	h = Font->FontHeight;
+
+	/* Get position of first pixel and steps in memory, depends on rotation */
+	if (Rotate == TM_FONTS_CACHE_Rotate_180) {
+		index = (h - 1) * w + (w - 1);
+		stepX = -1;
+		stepY = -(int32_t)w;
+	} else if (Rotate == TM_FONTS_CACHE_Rotate_90) {
+		index = (w - 1) * h;
+		stepX = -(int32_t)h;
+		stepY = 1;
+	} else if (Rotate == TM_FONTS_CACHE_Rotate_270) {
+		index = h - 1;
+		stepX = h;
+		stepY = -1;
+	} else {
+		index = 0;
+		stepX = 1;
+		stepY = w;
+	}
+
+	/* Expand 1-bit font rows to selected format */
+	data = &Font->data[(c - 32) * h];
+	for (i = 0; i < h; i++) {
+		b = data[i];
+		for (j = 0; j < w; j++) {
+			if (FONTS_CACHE_BPP[Format] == 1) {
+				((uint8_t *)Data)[index + j * stepX] = (b & (0x8000 >> j)) ? 0xFF : 0x00;
+			} else if (FONTS_CACHE_BPP[Format] == 2) {
+				((uint16_t *)Data)[index + j * stepX] = (b & (0x8000 >> j)) ? Foreground : Background;
+			} else {
+				((uint32_t *)Data)[index + j * stepX] = (b & (0x8000 >> j)) ? Foreground : Background;
+			}
+		}
+		index += stepY;
+	}
+}
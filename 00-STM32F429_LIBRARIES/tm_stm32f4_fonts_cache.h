@@ -0,0 +1,263 @@
+/**
+ * @author  Tilen MAJERLE
+ * @email   tilen@majerle.eu
+ * @website http://stm32f4-discovery.net
+ * @link
+ * @version v1.0
+ * @ide     Keil uVision
+ * @license GNU GPL v3
+ * @brief   Pre-rendered glyph cache for fonts library, stored in SDRAM
+ *
+@verbatim
+   ----------------------------------------------------------------------
+    Copyright (C) Tilen MAJERLE, 2015
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+   ----------------------------------------------------------------------
+@endverbatim
+ */
+#ifndef TM_FONTS_CACHE_H
+#define TM_FONTS_CACHE_H 100
+
+/* C++ detection */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup TM_STM32F4xx_Libraries
+ * @{
+ */
+
+/**
+ * @defgroup TM_FONTS_CACHE
+ * @brief    Pre-rendered glyph cache for fonts library, stored in SDRAM
+ * @{
+ *
+ * Fonts in @ref TM_FONTS library are stored as 1 bit per pixel and each LCD library decodes them bit by bit on every character.
+ *
+ * This library expands character on first use to pixel format which LCD uses and saves it to cache.
+ * Next time the same character is needed, it is already prepared and LCD library only copies it
+ * to framebuffer or to LCD, usually with one DMA2D or DMA transfer.
+ *
+ * \par Supported formats
+ *
+ *  - @ref TM_FONTS_CACHE_Format_A8: 8-bit alpha mask, 0xFF for foreground and 0x00 for background pixels. Colours are not used.
+ *    Use it with DMA2D blending for transparent text
+ *  - @ref TM_FONTS_CACHE_Format_RGB565: Foreground and background colour in RGB565 format
+ *  - @ref TM_FONTS_CACHE_Format_ARGB8888: Foreground and background colour in ARGB8888 format, background can be transparent
+ *
+ * \par Rotation
+ *
+ * Glyph can be stored already rotated, so it matches framebuffer memory layout for each LCD orientation
+ * and copy can be done with simple rectangle transfer. Check @ref TM_FONTS_CACHE_Rotate_t for more info.
+ *
+ * \par Memory
+ *
+ * Cache has fixed number of slots, each large enough for biggest glyph in ARGB8888 format.
+ * Glyph data is stored in SDRAM at @ref FONTS_CACHE_ADDR, only small table for lookup is in internal RAM.
+ *
+ * Entry is identified by font, character, format, rotation and both colours.
+ * When all slots are used, least recently used glyph is overwritten.
+ *
+ * To change default settings, add lines below to defines.h file and edit them:
+ *
+@verbatim
+//Address in memory where glyphs are stored
+#define FONTS_CACHE_ADDR         (SDRAM_START_ADR + 0x700000)
+
+//Number of glyphs in cache
+#define FONTS_CACHE_SLOTS        128
+
+//Maximal number of pixels in one glyph, FontWidth * FontHeight
+#define FONTS_CACHE_MAX_PIXELS   (16 * 26)
+@endverbatim
+ *
+ * @note     SDRAM must be initialized before cache is used. LCD libraries do this in their init functions.
+ *
+ * \par Changelog
+ *
+@verbatim
+ Version 1.0
+  - First release
+@endverbatim
+ *
+ * \par Dependencies
+ *
+@verbatim
+ - STM32F4xx
+ - defines.h
+ - TM FONTS
+ - TM SDRAM
+ - TM DMA2D GRAPHIC
+@endverbatim
+ */
+
+#include "stm32f4xx.h"
+#include "defines.h"
+#include "tm_stm32f4_fonts.h"
+#include "tm_stm32f4_sdram.h"
+#include "tm_stm32f4_dma2d_graphic.h"
+
+/**
+ * @defgroup TM_FONTS_CACHE_Macros
+ * @brief    Library defines
+ * @{
+ */
+
+/**
+ * @brief  Start address of glyph data in memory
+ * @note   Default is after LCD layers and emWin memory on STM32F429-Discovery, see SDRAM memory map in TM SDRAM library
+ */
+#ifndef FONTS_CACHE_ADDR
+#define FONTS_CACHE_ADDR            (SDRAM_START_ADR + 0x700000)
+#endif
+
+/**
+ * @brief  Number of glyphs in cache
+ */
+#ifndef FONTS_CACHE_SLOTS
+#define FONTS_CACHE_SLOTS           128
+#endif
+
+/**
+ * @brief  Maximal number of pixels in one glyph
+ * @note   It must be at least FontWidth * FontHeight of the biggest font used
+ */
+#ifndef FONTS_CACHE_MAX_PIXELS
+#define FONTS_CACHE_MAX_PIXELS      (16 * 26)
+#endif
+
+/**
+ * @brief  Number of hash buckets for lookup
+ * @note   Must be power of 2
+ */
+#ifndef FONTS_CACHE_BUCKETS
+#define FONTS_CACHE_BUCKETS         64
+#endif
+
+/**
+ * @brief  Size of one slot in units of bytes, enough for ARGB8888 glyph
+ */
+#define FONTS_CACHE_SLOT_SIZE       (FONTS_CACHE_MAX_PIXELS * 4)
+
+/**
+ * @}
+ */
+
+/**
+ * @defgroup TM_FONTS_CACHE_Typedefs
+ * @brief    Library Typedefs
+ * @{
+ */
+
+/**
+ * @brief  Pixel format of cached glyph
+ */
+typedef enum {
+	TM_FONTS_CACHE_Format_A8 = 0x00, /*!< 8-bit alpha mask, 1 byte per pixel */
+	TM_FONTS_CACHE_Format_RGB565,    /*!< RGB565 colours, 2 bytes per pixel */
+	TM_FONTS_CACHE_Format_ARGB8888   /*!< ARGB8888 colours, 4 bytes per pixel */
+} TM_FONTS_CACHE_Format_t;
+
+/**
+ * @brief  Rotation of cached glyph in memory
+ * @note   Width and height in @ref TM_FONTS_CACHE_Glyph_t are swapped for 90 and 270 degrees rotation
+ */
+typedef enum {
+	TM_FONTS_CACHE_Rotate_0 = 0x00, /*!< Glyph is stored as it is in font */
+	TM_FONTS_CACHE_Rotate_180,      /*!< Glyph is rotated for 180 degrees, first pixel in memory is bottom right pixel of character */
+	TM_FONTS_CACHE_Rotate_90,       /*!< Glyph is rotated for 90 degrees, font row is stored as memory column from bottom to top */
+	TM_FONTS_CACHE_Rotate_270       /*!< Glyph is rotated for 270 degrees, font row is stored as memory column from top to bottom */
+} TM_FONTS_CACHE_Rotate_t;
+
+/**
+ * @brief  Cached glyph information, returned from @ref TM_FONTS_CACHE_Get function
+ */
+typedef struct {
+	void* Data;                     /*!< Pointer to glyph pixels in memory */
+	uint16_t Width;                 /*!< Glyph width in memory in units of pixels, number of pixels in one line */
+	uint16_t Height;                /*!< Glyph height in memory in units of pixels, number of lines */
+	TM_FONTS_CACHE_Format_t Format; /*!< Pixel format of glyph */
+} TM_FONTS_CACHE_Glyph_t;
+
+/**
+ * @brief  Cache statistics
+ */
+typedef struct {
+	uint32_t Hits;      /*!< Number of times glyph was found in cache */
+	uint32_t Misses;    /*!< Number of times glyph had to be rendered */
+	uint32_t Evictions; /*!< Number of times used glyph was overwritten with new one */
+} TM_FONTS_CACHE_Stats_t;
+
+/**
+ * @}
+ */
+
+/**
+ * @defgroup TM_FONTS_CACHE_Functions
+ * @brief    Library Functions
+ * @{
+ */
+
+/**
+ * @brief  Gets glyph from cache. If it is not in cache, it is rendered first
+ * @note   Returned data stays valid until @ref FONTS_CACHE_SLOTS other glyphs are requested
+ *         or @ref TM_FONTS_CACHE_Flush is called
+ * @param  *Glyph: Pointer to @ref TM_FONTS_CACHE_Glyph_t structure to be filled with glyph info
+ * @param  *Font: Pointer to @ref TM_FontDef_t font used
+ * @param  c: Character to get
+ * @param  Format: Pixel format of glyph. This parameter can be a value of @ref TM_FONTS_CACHE_Format_t enumeration
+ * @param  Rotate: Rotation of glyph in memory. This parameter can be a value of @ref TM_FONTS_CACHE_Rotate_t enumeration
+ * @param  Foreground: Foreground colour in selected format. Not used for @ref TM_FONTS_CACHE_Format_A8
+ * @param  Background: Background colour in selected format. Not used for @ref TM_FONTS_CACHE_Format_A8
+ * @retval Status:
+ *            - 0: Glyph is ready
+ *            - > 0: Glyph is too big for cache slot or character is not in font
+ */
+uint8_t TM_FONTS_CACHE_Get(TM_FONTS_CACHE_Glyph_t* Glyph, TM_FontDef_t* Font, char c, TM_FONTS_CACHE_Format_t Format, TM_FONTS_CACHE_Rotate_t Rotate, uint32_t Foreground, uint32_t Background);
+
+/**
+ * @brief  Removes all glyphs from cache and resets statistics
+ * @note   Call this if font data in RAM was changed
+ * @param  None
+ * @retval None
+ */
+void TM_FONTS_CACHE_Flush(void);
+
+/**
+ * @brief  Gets cache statistics
+ * @param  *Stats: Pointer to @ref TM_FONTS_CACHE_Stats_t structure to be filled
+ * @retval None
+ */
+void TM_FONTS_CACHE_GetStats(TM_FONTS_CACHE_Stats_t* Stats);
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+
+/* C++ detection */
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -27,18 +27,57 @@ typedef struct {
 	uint8_t Cols;
 	uint8_t currentX;
 	uint8_t currentY;
+	uint16_t QueueCount;
+	uint16_t QueueIndex;
+	uint8_t Step;
+	__IO uint8_t Busy;
 } HD44780_Options_t;
 
+#if HD44780_USE_TIM == 1
+/* GPIO port with data and RS pins, D4, D5, D6, D7, RS */
+typedef struct {
+	GPIO_TypeDef* GPIOx;
+	uint16_t Pins[5];
+} HD44780_Port_t;
+#endif
+
 /* Private functions */
 static void TM_HD44780_InitPins(void);
 static void TM_HD44780_Cmd(uint8_t cmd);
 static void TM_HD44780_Cmd4bit(uint8_t cmd);
 static void TM_HD44780_Data(uint8_t data);
 static void TM_HD44780_CursorSet(uint8_t col, uint8_t row);
+static uint16_t TM_HD44780_BuildQueue(void);
+#if HD44780_USE_TIM == 1
+static void TM_HD44780_InitTIM(void);
+static void TM_HD44780_AddPin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin, uint8_t bit);
+static void TM_HD44780_Nibble(uint8_t nibble);
+#endif
 
 /* Private variable */
 static HD44780_Options_t HD44780_Opts;
 
+/* DDRAM address of each row */
+static const uint8_t HD44780_RowOffsets[] = {0x00, 0x40, 0x14, 0x54};
+
+/* Wanted content of LCD and content which is already on LCD */
+static char HD44780_Screen[HD44780_MAX_CHARS];
+static char HD44780_Glass[HD44780_MAX_CHARS];
+
+/* Bytes to send for update, bits 0-7 are data, bit 8 is RS pin */
+static uint16_t HD44780_Queue[2 * HD44780_MAX_CHARS + 1];
+#define HD44780_QUEUE_DATA          0x0100
+
+#if HD44780_USE_TIM == 1
+/* Ports used by data and RS pins */
+static HD44780_Port_t HD44780_Ports[5];
+static uint8_t HD44780_PortCount;
+
+/* Timer steps in units of microseconds, E pulse and command execution time */
+#define HD44780_TIM_PULSE           2
+#define HD44780_TIM_EXEC            50
+#endif
+
 /* Pin definitions */
 #define HD44780_RS_LOW              TM_GPIO_SetPinLow(HD44780_RS_PORT, HD44780_RS_PIN)
 #define HD44780_RS_HIGH             TM_GPIO_SetPinHigh(HD44780_RS_PORT, HD44780_RS_PIN)
@@ -101,6 +140,11 @@ void TM_HD44780_Init(uint8_t cols, uint8_t rows) {
 	HD44780_Opts.currentX = 0;
 	HD44780_Opts.currentY = 0;
 	
+#if HD44780_USE_TIM == 1
+	/* Init timer for updates in background */
+	TM_HD44780_InitTIM();
+#endif
+	
 	HD44780_Opts.DisplayFunction = HD44780_4BITMODE | HD44780_5x8DOTS | HD44780_1LINE;
 	if (rows > 1) {
 		HD44780_Opts.DisplayFunction |= HD44780_2LINE;
@@ -143,6 +187,10 @@ void TM_HD44780_Init(uint8_t cols, uint8_t rows) {
 void TM_HD44780_Clear(void) {
 	TM_HD44780_Cmd(HD44780_CLEARDISPLAY);
 	HD44780_Delay(3000);
+	
+	/* LCD and buffer are empty */
+	memset(HD44780_Screen, ' ', sizeof(HD44780_Screen));
+	memset(HD44780_Glass, ' ', sizeof(HD44780_Glass));
 }
 
 void TM_HD44780_Puts(uint8_t x, uint8_t y, char* str) {
@@ -160,6 +208,12 @@ void TM_HD44780_Puts(uint8_t x, uint8_t y, char* str) {
 			TM_HD44780_CursorSet(0, HD44780_Opts.currentY);
 		} else {
 			TM_HD44780_Data(*str);
+			
+			/* Keep buffers the same as LCD */
+			if ((HD44780_Opts.currentY * HD44780_Opts.Cols + HD44780_Opts.currentX) < HD44780_MAX_CHARS) {
+				HD44780_Screen[HD44780_Opts.currentY * HD44780_Opts.Cols + HD44780_Opts.currentX] = *str;
+				HD44780_Glass[HD44780_Opts.currentY * HD44780_Opts.Cols + HD44780_Opts.currentX] = *str;
+			}
 			HD44780_Opts.currentX++;
 		}
 		str++;
@@ -218,10 +272,164 @@ void TM_HD44780_CreateChar(uint8_t location, uint8_t *data) {
 void TM_HD44780_PutCustom(uint8_t x, uint8_t y, uint8_t location) {
 	TM_HD44780_CursorSet(x, y);
 	TM_HD44780_Data(location);
+	
+	/* Keep buffers the same as LCD */
+	if ((HD44780_Opts.currentY * HD44780_Opts.Cols + HD44780_Opts.currentX) < HD44780_MAX_CHARS) {
+		HD44780_Screen[HD44780_Opts.currentY * HD44780_Opts.Cols + HD44780_Opts.currentX] = location;
+		HD44780_Glass[HD44780_Opts.currentY * HD44780_Opts.Cols + HD44780_Opts.currentX] = location;
+	}
+}
+
+void TM_HD44780_BufferPuts(uint8_t x, uint8_t y, char* str) {
+	/* Go to beginning */
+	if (y >= HD44780_Opts.Rows) {
+		y = 0;
+	}
+	
+	/* Same rules as for TM_HD44780_Puts */
+	while (*str) {
+		if (x >= HD44780_Opts.Cols) {
+			x = 0;
+			y++;
+		}
+		if (y >= HD44780_Opts.Rows) {
+			y = 0;
+		}
+		if (*str == '\n') {
+			y++;
+		} else if (*str == '\r') {
+			x = 0;
+		} else {
+			if ((y * HD44780_Opts.Cols + x) < HD44780_MAX_CHARS) {
+				HD44780_Screen[y * HD44780_Opts.Cols + x] = *str;
+			}
+			x++;
+		}
+		str++;
+	}
+}
+
+void TM_HD44780_BufferPutCustom(uint8_t x, uint8_t y, uint8_t location) {
+	/* Check location */
+	if (x < HD44780_Opts.Cols && y < HD44780_Opts.Rows && (y * HD44780_Opts.Cols + x) < HD44780_MAX_CHARS) {
+		HD44780_Screen[y * HD44780_Opts.Cols + x] = location;
+	}
+}
+
+void TM_HD44780_BufferClear(void) {
+	/* Fill with spaces */
+	memset(HD44780_Screen, ' ', sizeof(HD44780_Screen));
+}
+
+void TM_HD44780_Update(void) {
+	uint16_t i, count;
+	
+	/* Wait for update in background */
+	while (HD44780_Opts.Busy);
+	
+	/* Send changes */
+	count = TM_HD44780_BuildQueue();
+	for (i = 0; i < count; i++) {
+		if (HD44780_Queue[i] & HD44780_QUEUE_DATA) {
+			TM_HD44780_Data(HD44780_Queue[i]);
+		} else {
+			TM_HD44780_Cmd(HD44780_Queue[i]);
+		}
+	}
+}
+
+uint8_t TM_HD44780_UpdateIT(void) {
+#if HD44780_USE_TIM == 1
+	/* Previous update is still in progress */
+	if (HD44780_Opts.Busy) {
+		return 0;
+	}
+	
+	/* Nothing changed */
+	HD44780_Opts.QueueCount = TM_HD44780_BuildQueue();
+	if (HD44780_Opts.QueueCount == 0) {
+		return 1;
+	}
+	
+	/* Start with first byte, next steps are done in interrupt */
+	HD44780_Opts.QueueIndex = 0;
+	HD44780_Opts.Step = 0;
+	HD44780_Opts.Busy = 1;
+	HD44780_TIM->CNT = 0;
+	HD44780_TIM->ARR = HD44780_TIM_PULSE - 1;
+	HD44780_TIM->CR1 |= TIM_CR1_CEN;
+#else
+	/* Blocking update */
+	TM_HD44780_Update();
+#endif
+	
+	/* Update started */
+	return 1;
 }
 
+uint8_t TM_HD44780_IsUpdating(void) {
+	/* Return timer status */
+	return HD44780_Opts.Busy;
+}
+
+#if HD44780_USE_TIM == 1
+void HD44780_TIM_IRQHandler(void) {
+	uint16_t entry;
+	
+	/* Clear flag */
+	HD44780_TIM->SR = ~TIM_IT_Update;
+	
+	switch (HD44780_Opts.Step) {
+		case 0:
+			/* Previous byte is clocked in */
+			HD44780_E_LOW;
+			
+			/* Everything sent, wait until LCD executes last byte */
+			if (HD44780_Opts.QueueIndex >= HD44780_Opts.QueueCount) {
+				HD44780_TIM->ARR = HD44780_TIM_EXEC - 1;
+				HD44780_Opts.Step = 4;
+				return;
+			}
+			
+			/* High nibble, E goes high after LCD executes previous byte */
+			entry = HD44780_Queue[HD44780_Opts.QueueIndex];
+			TM_HD44780_Nibble((entry >> 4) & 0x1F);
+			HD44780_TIM->ARR = HD44780_TIM_EXEC - 1;
+			break;
+		case 1:
+		case 3:
+			/* Clock nibble in on falling edge */
+			HD44780_E_HIGH;
+			HD44780_TIM->ARR = HD44780_TIM_PULSE - 1;
+			if (HD44780_Opts.Step == 3) {
+				HD44780_Opts.QueueIndex++;
+				HD44780_Opts.Step = 0;
+				return;
+			}
+			break;
+		case 2:
+			/* Low nibble */
+			HD44780_E_LOW;
+			entry = HD44780_Queue[HD44780_Opts.QueueIndex];
+			TM_HD44780_Nibble((entry & 0x0F) | ((entry >> 4) & 0x10));
+			break;
+		default:
+			/* Update done */
+			HD44780_TIM->CR1 &= ~TIM_CR1_CEN;
+			HD44780_Opts.Busy = 0;
+			return;
+	}
+	
+	/* Next step */
+	HD44780_Opts.Step++;
+}
+#endif
+
 /* Private functions */
 static void TM_HD44780_Cmd(uint8_t cmd) {
+	/* Wait for update in background */
+	while (HD44780_Opts.Busy);
+	
 	/* Command mode */
 	HD44780_RS_LOW;
 	
@@ -232,6 +440,9 @@ static void TM_HD44780_Cmd(uint8_t cmd) {
 }
 
 static void TM_HD44780_Data(uint8_t data) {
+	/* Wait for update in background */
+	while (HD44780_Opts.Busy);
+	
 	/* Data mode */
 	HD44780_RS_HIGH;
 	
@@ -251,8 +462,6 @@ static void TM_HD44780_Cmd4bit(uint8_t cmd) {
 }
 
 static void TM_HD44780_CursorSet(uint8_t col, uint8_t row) {
-	uint8_t row_offsets[] = {0x00, 0x40, 0x14, 0x54};
-	
 	/* Go to beginning */
 	if (row >= HD44780_Opts.Rows) {
 		row = 0;
@@ -263,8 +472,126 @@ static void TM_HD44780_CursorSet(uint8_t col, uint8_t row) {
 	HD44780_Opts.currentY = row;
 	
 	/* Set location address */
-	TM_HD44780_Cmd(HD44780_SETDDRAMADDR | (col + row_offsets[row]));
+	TM_HD44780_Cmd(HD44780_SETDDRAMADDR | (col + HD44780_RowOffsets[row]));
+}
+
+static uint16_t TM_HD44780_BuildQueue(void) {
+	uint8_t x, y, addr = 0xFF;
+	uint16_t i, count = 0;
+	
+	/* Go through all characters */
+	for (y = 0; y < HD44780_Opts.Rows; y++) {
+		for (x = 0; x < HD44780_Opts.Cols; x++) {
+			i = y * HD44780_Opts.Cols + x;
+			if (i >= HD44780_MAX_CHARS || HD44780_Screen[i] == HD44780_Glass[i]) {
+				continue;
+			}
+			
+			/* Move cursor only if LCD address counter is not already there */
+			if (addr != (x + HD44780_RowOffsets[y])) {
+				addr = x + HD44780_RowOffsets[y];
+				HD44780_Queue[count++] = HD44780_SETDDRAMADDR | addr;
+			}
+			
+			/* Character, address counter is increased by LCD */
+			HD44780_Queue[count++] = HD44780_QUEUE_DATA | (uint8_t)HD44780_Screen[i];
+			HD44780_Glass[i] = HD44780_Screen[i];
+			addr++;
+		}
+	}
+	
+	/* Visible cursor goes back to its position */
+	if (count && (HD44780_Opts.DisplayControl & (HD44780_CURSORON | HD44780_BLINKON))) {
+		HD44780_Queue[count++] = HD44780_SETDDRAMADDR | (HD44780_Opts.currentX + HD44780_RowOffsets[HD44780_Opts.currentY]);
+	}
+	
+	/* Return number of bytes */
+	return count;
+}
+
+#if HD44780_USE_TIM == 1
+static void TM_HD44780_InitTIM(void) {
+	TIM_TimeBaseInitTypeDef TIM_TimeBaseStruct;
+	NVIC_InitTypeDef NVIC_InitStruct;
+	TM_TIMER_PROPERTIES_t TIM_Data;
+	
+	/* Ports for nibbles */
+	HD44780_PortCount = 0;
+	TM_HD44780_AddPin(HD44780_D4_PORT, HD44780_D4_PIN, 0);
+	TM_HD44780_AddPin(HD44780_D5_PORT, HD44780_D5_PIN, 1);
+	TM_HD44780_AddPin(HD44780_D6_PORT, HD44780_D6_PIN, 2);
+	TM_HD44780_AddPin(HD44780_D7_PORT, HD44780_D7_PIN, 3);
+	TM_HD44780_AddPin(HD44780_RS_PORT, HD44780_RS_PIN, 4);
+	
+	/* Get timer properties */
+	TM_TIMER_PROPERTIES_GetTimerProperties(HD44780_TIM, &TIM_Data);
+	
+	/* Enable clock for TIMx */
+	TM_TIMER_PROPERTIES_EnableClock(HD44780_TIM);
+	
+	/* Set timer settings, 1 microsecond tick */
+	TIM_TimeBaseStruct.TIM_ClockDivision = 0;
+	TIM_TimeBaseStruct.TIM_CounterMode = TIM_CounterMode_Up;
+	TIM_TimeBaseStruct.TIM_Period = HD44780_TIM_EXEC - 1;
+	TIM_TimeBaseStruct.TIM_Prescaler = TIM_Data.TimerFrequency / 1000000 - 1;
+	TIM_TimeBaseStruct.TIM_RepetitionCounter = 0;
+	
+	/* Initialize timer, it is started for each update */
+	TIM_TimeBaseInit(HD44780_TIM, &TIM_TimeBaseStruct);
+	HD44780_TIM->SR = ~TIM_IT_Update;
+	
+	/* Enable interrupt */
+	HD44780_TIM->DIER |= TIM_IT_Update;
+	
+	/* Set NVIC parameters */
+	NVIC_InitStruct.NVIC_IRQChannel = HD44780_TIM_IRQn;
+	NVIC_InitStruct.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_InitStruct.NVIC_IRQChannelPreemptionPriority = HD44780_NVIC_PRIORITY;
+	NVIC_InitStruct.NVIC_IRQChannelSubPriority = HD44780_NVIC_SUBPRIORITY;
+	
+	/* Add to NVIC */
+	NVIC_Init(&NVIC_InitStruct);
+}
+
+static void TM_HD44780_AddPin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin, uint8_t bit) {
+	uint8_t i;
+	
+	/* Find port */
+	for (i = 0; i < HD44780_PortCount; i++) {
+		if (HD44780_Ports[i].GPIOx == GPIOx) {
+			break;
+		}
+	}
+	
+	/* New port */
+	if (i == HD44780_PortCount) {
+		memset(&HD44780_Ports[i], 0, sizeof(HD44780_Port_t));
+		HD44780_Ports[i].GPIOx = GPIOx;
+		HD44780_PortCount++;
+	}
+	
+	/* Save pin */
+	HD44780_Ports[i].Pins[bit] = GPIO_Pin;
+}
+
+static void TM_HD44780_Nibble(uint8_t nibble) {
+	uint8_t i, b;
+	uint16_t set, all;
+	
+	/* One BSRR write per port, low half sets pins and high half resets them */
+	for (i = 0; i < HD44780_PortCount; i++) {
+		set = 0;
+		all = 0;
+		for (b = 0; b < 5; b++) {
+			all |= HD44780_Ports[i].Pins[b];
+			if (nibble & (1 << b)) {
+				set |= HD44780_Ports[i].Pins[b];
+			}
+		}
+		*(__IO uint32_t *)&HD44780_Ports[i].GPIOx->BSRRL = set | ((uint32_t)(all & ~set) << 16);
+	}
 }
+#endif
 
 static void TM_HD44780_InitPins(void) {
 	/* Init all pins */
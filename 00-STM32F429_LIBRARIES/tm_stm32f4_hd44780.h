@@ -3,7 +3,7 @@
  * @email   tilen@majerle.eu
  * @website http://stm32f4-discovery.net
  * @link    http://stm32f4-discovery.net/2014/06/library-16-interfacing-hd44780-lcd-controller-with-stm32f4/
- * @version v1.2
+ * @version v1.3
  * @ide     Keil uVision
  * @license GNU GPL v3
  * @brief   HD44780 LCD driver library for STM32F4xx
@@ -28,7 +28,7 @@
 @endverbatim
  */
 #ifndef TM_HD44780_H
-#define TM_HD44780_H 120
+#define TM_HD44780_H 130
 /**
  * @addtogroup TM_STM32F4xx_Libraries
  * @{
@@ -85,11 +85,53 @@ K		GND				Ground for back light
 //D7 - Data 7 pin
 #define HD44780_D7_PORT     GPIOB
 #define HD44780_D7_PIN      GPIO_PIN_13
+@endverbatim
+ *
+ * \par Shadow buffer
+ *
+ * Functions above write to LCD immediately and wait for each character. For screens which are refreshed periodically,
+ * use buffer functions instead. They only change buffer in RAM with the content of the screen.
+ * Library keeps second buffer with the content which is already on LCD, so @ref TM_HD44780_Update and
+ * @ref TM_HD44780_UpdateIT send only characters which changed. Cursor is moved only when changed characters are not next to each other.
+ *
+@verbatim
+while (1) {
+    sprintf(str, "Temp: %3d C", temp);
+    TM_HD44780_BufferPuts(0, 0, str);
+    TM_HD44780_BufferPuts(0, 1, "Status: OK");
+
+    //Only changed digits are sent, function does not wait
+    TM_HD44780_UpdateIT();
+}
+@endverbatim
+ *
+ * @ref TM_HD44780_UpdateIT uses basic timer interrupt to clock out nibbles. Data and RS pins are set with
+ * one BSRR register write per GPIO port, so when all of them are on the same port, each nibble is a single write.
+ * Each character takes 4 short interrupts, CPU does not wait for LCD at all.
+ * Functions which write to LCD immediately wait until update in background is finished.
+ *
+ * Timer can be changed in defines.h file, set HD44780_USE_TIM to 0 to send changes without timer:
+ *
+@verbatim
+//Timer for TM_HD44780_UpdateIT
+#define HD44780_TIM                TIM7
+#define HD44780_TIM_IRQn           TIM7_IRQn
+#define HD44780_TIM_IRQHandler     TIM7_IRQHandler
+
+//Use timer interrupt for TM_HD44780_UpdateIT. If 0, function waits until LCD is updated
+#define HD44780_USE_TIM            1
+
+//Maximal number of characters on LCD for buffers, columns * rows
+#define HD44780_MAX_CHARS          80
 @endverbatim
  *
  * \par Changelog
  *
 @verbatim
+ Version 1.3
+  - Added shadow buffer, only changed characters are sent to LCD
+  - Added TM_HD44780_UpdateIT function, LCD is updated in background from timer interrupt
+
  Version 1.2
   - March 11, 2015
   - Added support for my new GPIO library
@@ -107,7 +149,13 @@ K		GND				Ground for back light
 @verbatim
  - STM32F4xx
  - STM32F4xx RCC
+ - STM32F4xx TIM
+ - misc.h
  - defines.h
+ - TM DELAY
+ - TM GPIO
+ - TM TIMER PROPERTIES
+ - string.h
 @endverbatim
  */
 #include "stm32f4xx.h"
@@ -116,6 +164,11 @@ K		GND				Ground for back light
 #include "defines.h"
 #include "tm_stm32f4_delay.h"
 #include "tm_stm32f4_gpio.h"
+#include "tm_stm32f4_timer_properties.h"
+#include "stm32f4xx_tim.h"
+#include "misc.h"
+
+#include "string.h"
 
 /**
  * @defgroup TM_HD44780_Macros
@@ -157,6 +210,31 @@ K		GND				Ground for back light
 #define HD44780_D7_PIN				GPIO_PIN_13
 #endif
 
+/* Maximal number of characters for shadow buffers */
+#ifndef HD44780_MAX_CHARS
+#define HD44780_MAX_CHARS			80
+#endif
+
+/* Use timer interrupt for TM_HD44780_UpdateIT */
+#ifndef HD44780_USE_TIM
+#define HD44780_USE_TIM				1
+#endif
+
+/* Timer for TM_HD44780_UpdateIT */
+#ifndef HD44780_TIM
+#define HD44780_TIM					TIM7
+#define HD44780_TIM_IRQn			TIM7_IRQn
+#define HD44780_TIM_IRQHandler		TIM7_IRQHandler
+#endif
+
+/* Timer interrupt priority */
+#ifndef HD44780_NVIC_PRIORITY
+#define HD44780_NVIC_PRIORITY		0x07
+#endif
+#ifndef HD44780_NVIC_SUBPRIORITY
+#define HD44780_NVIC_SUBPRIORITY	0x00
+#endif
+
 /**
  * @}
  */
@@ -262,6 +340,60 @@ void TM_HD44780_CreateChar(uint8_t location, uint8_t* data);
  */
 void TM_HD44780_PutCustom(uint8_t x, uint8_t y, uint8_t location);
 
+/**
+ * @brief  Puts string to shadow buffer
+ * @note   @ref TM_HD44780_Update or @ref TM_HD44780_UpdateIT must be called to show it on LCD
+ * @param  x location
+ * @param  y location
+ * @param  *str: pointer to string to display
+ * @retval None
+ */
+void TM_HD44780_BufferPuts(uint8_t x, uint8_t y, char* str);
+
+/**
+ * @brief  Puts custom created character to shadow buffer
+ * @note   @ref TM_HD44780_Update or @ref TM_HD44780_UpdateIT must be called to show it on LCD
+ * @param  x location
+ * @param  y location
+ * @param  location: Location on LCD where character is stored, 0 - 7
+ * @retval None
+ */
+void TM_HD44780_BufferPutCustom(uint8_t x, uint8_t y, uint8_t location);
+
+/**
+ * @brief  Fills shadow buffer with spaces
+ * @note   @ref TM_HD44780_Update or @ref TM_HD44780_UpdateIT must be called to show it on LCD
+ * @param  None
+ * @retval None
+ */
+void TM_HD44780_BufferClear(void);
+
+/**
+ * @brief  Sends changed characters from shadow buffer to LCD and waits until they are sent
+ * @param  None
+ * @retval None
+ */
+void TM_HD44780_Update(void);
+
+/**
+ * @brief  Starts sending changed characters from shadow buffer to LCD in timer interrupt
+ * @note   Shadow buffer can be changed right after function returns, changes are sent on next update
+ * @param  None
+ * @retval Update status:
+ *           - 0: Previous update is still in progress, nothing was started
+ *           - > 0: Update started or there was nothing to send
+ */
+uint8_t TM_HD44780_UpdateIT(void);
+
+/**
+ * @brief  Checks if update started with @ref TM_HD44780_UpdateIT is still in progress
+ * @param  None
+ * @retval Update status:
+ *           - 0: LCD is not being updated
+ *           - > 0: Update in progress
+ */
+uint8_t TM_HD44780_IsUpdating(void);
+
 /**
  * @}
  */
@@ -17,6 +17,12 @@
  * |----------------------------------------------------------------------
  */
 #include "tm_stm32f4_ili9341.h"
+#if ILI9341_USE_FONTS_CACHE == 1
+#include "tm_stm32f4_fonts_cache.h"
+#endif
+#if ILI9341_USE_SHADOW == 1 && ILI9341_SHADOW_SDRAM == 1
+#include "tm_stm32f4_sdram.h"
+#endif
 
 /**
  * @brief  Orientation
@@ -37,6 +43,16 @@ typedef struct {
 	TM_ILI9341_Orientation orientation; // 1 = portrait; 0 = landscape
 } TM_ILI931_Options_t;
 
+/**
+ * @brief  Dirty rectangle, all coordinates are inclusive
+ */
+typedef struct {
+	uint16_t x0;
+	uint16_t y0;
+	uint16_t x1;
+	uint16_t y1;
+} TM_ILI9341_INT_Rect_t;
+
 /* Pin definitions */
 #define ILI9341_RST_SET				GPIO_SetBits(ILI9341_RST_PORT, ILI9341_RST_PIN)
 #define ILI9341_RST_RESET			GPIO_ResetBits(ILI9341_RST_PORT, ILI9341_RST_PIN)
@@ -83,6 +99,15 @@ uint16_t ILI9341_y;
 TM_ILI931_Options_t ILI9341_Opts;
 uint8_t ILI9341_INT_CalledFromPuts = 0;
 
+#if ILI9341_USE_SHADOW == 1
+/* Shadow framebuffer, pixels are stored MSB first as LCD expects them */
+#define ILI9341_SHADOW				((uint16_t *)(ILI9341_SHADOW_ADDR))
+
+/* Changed regions since last flush */
+static TM_ILI9341_INT_Rect_t ILI9341_Dirty[ILI9341_DIRTY_RECTS];
+static uint8_t ILI9341_DirtyCount = 0;
+#endif
+
 /* Private functions */
 void TM_ILI9341_InitLCD(void);
 void TM_ILI9341_SendData(uint8_t data);
@@ -90,6 +115,12 @@ void TM_ILI9341_SendCommand(uint8_t data);
 void TM_ILI9341_Delay(volatile unsigned int delay);
 void TM_ILI9341_SetCursorPosition(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2);
 void TM_ILI9341_INT_Fill(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint16_t color);
+#if ILI9341_USE_FONTS_CACHE == 1
+uint8_t TM_INT_ILI9341_PutcCache(char c, TM_FontDef_t *font, uint32_t foreground, uint32_t background);
+#endif
+#if ILI9341_USE_SHADOW == 1
+static void TM_INT_ILI9341_AddDirty(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
+#endif
 
 void TM_ILI9341_Init() {
 	/* Init WRX pin */
@@ -110,6 +141,11 @@ void TM_ILI9341_Init() {
 	/* Init DMA for SPI */
 	TM_SPI_DMA_Init(ILI9341_SPI);
 	
+#if ILI9341_USE_SHADOW == 1 && ILI9341_SHADOW_SDRAM == 1
+	/* Shadow framebuffer is in SDRAM */
+	TM_SDRAM_Init();
+#endif
+	
 	/* Init LCD */
 	TM_ILI9341_InitLCD();	
 	
@@ -121,6 +157,9 @@ void TM_ILI9341_Init() {
 	
 	/* Fill with white color */
 	TM_ILI9341_Fill(ILI9341_COLOR_WHITE);
+	
+	/* Send to LCD if shadow framebuffer is used */
+	TM_ILI9341_Flush();
 }
 
 void TM_ILI9341_InitLCD(void) {
@@ -257,11 +296,24 @@ void TM_ILI9341_SendData(uint8_t data) {
 }
 
 void TM_ILI9341_DrawPixel(uint16_t x, uint16_t y, uint32_t color) {
+#if ILI9341_USE_SHADOW == 1
+	/* Check if pixel is on LCD */
+	if (x >= ILI9341_Opts.width || y >= ILI9341_Opts.height) {
+		return;
+	}
+	
+	/* Save to shadow framebuffer */
+	ILI9341_SHADOW[(uint32_t)y * ILI9341_Opts.width + x] = ILI9341_SWAP16(color);
+	
+	/* Mark as changed */
+	TM_INT_ILI9341_AddDirty(x, y, x, y);
+#else
 	TM_ILI9341_SetCursorPosition(x, y, x, y);
 
 	TM_ILI9341_SendCommand(ILI9341_GRAM);
 	TM_ILI9341_SendData(color >> 8);
 	TM_ILI9341_SendData(color & 0xFF);
+#endif
 }
 
 
@@ -285,6 +337,33 @@ void TM_ILI9341_Fill(uint32_t color) {
 }
 
 void TM_ILI9341_INT_Fill(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint16_t color) {
+#if ILI9341_USE_SHADOW == 1
+	uint16_t* ptr;
+	uint16_t x, y;
+	
+	/* Clip to LCD */
+	if (x1 >= ILI9341_Opts.width) {
+		x1 = ILI9341_Opts.width - 1;
+	}
+	if (y1 >= ILI9341_Opts.height) {
+		y1 = ILI9341_Opts.height - 1;
+	}
+	if (x0 > x1 || y0 > y1) {
+		return;
+	}
+	
+	/* Fill shadow framebuffer */
+	color = ILI9341_SWAP16(color);
+	for (y = y0; y <= y1; y++) {
+		ptr = &ILI9341_SHADOW[(uint32_t)y * ILI9341_Opts.width + x0];
+		for (x = x0; x <= x1; x++) {
+			*ptr++ = color;
+		}
+	}
+	
+	/* Mark as changed */
+	TM_INT_ILI9341_AddDirty(x0, y0, x1, y1);
+#else
 	uint32_t pixels_count;
 	
 	/* Set cursor position */
@@ -320,6 +399,7 @@ void TM_ILI9341_INT_Fill(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uin
 
 	/* Go back to 8-bit SPI mode */
 	TM_SPI_SetDataSize(ILI9341_SPI, TM_SPI_DataSize_8b);
+#endif
 }
 
 void TM_ILI9341_Delay(volatile unsigned int delay) {
@@ -347,6 +427,67 @@ void TM_ILI9341_Rotate(TM_ILI9341_Orientation_t orientation) {
 		ILI9341_Opts.height = ILI9341_WIDTH;
 		ILI9341_Opts.orientation = TM_ILI9341_Landscape;
 	}
+	
+#if ILI9341_USE_SHADOW == 1
+	/* Content in old layout is not valid anymore, clear it and send everything on next flush */
+	ILI9341_DirtyCount = 0;
+	TM_ILI9341_Fill(ILI9341_COLOR_BLACK);
+#endif
+}
+
+void TM_ILI9341_Flush(void) {
+#if ILI9341_USE_SHADOW == 1
+	TM_ILI9341_INT_Rect_t* rect;
+	uint8_t* data;
+	uint32_t count, len;
+	uint16_t width, y;
+	uint8_t i;
+	
+	/* Send all changed regions */
+	for (i = 0; i < ILI9341_DirtyCount; i++) {
+		rect = &ILI9341_Dirty[i];
+		width = rect->x1 - rect->x0 + 1;
+		
+		/* Set window for region */
+		TM_ILI9341_SetCursorPosition(rect->x0, rect->y0, rect->x1, rect->y1);
+		
+		/* Set command for GRAM data */
+		TM_ILI9341_SendCommand(ILI9341_GRAM);
+		
+		/* Send everything */
+		ILI9341_CS_RESET;
+		ILI9341_WRX_SET;
+		
+		if (width == ILI9341_Opts.width) {
+			/* Full lines are one continuous block in memory, send it with as few transfers as possible */
+			data = (uint8_t *)&ILI9341_SHADOW[(uint32_t)rect->y0 * width];
+			count = (uint32_t)width * (rect->y1 - rect->y0 + 1) * 2;
+			while (count) {
+				len = (count > 0xFFFE) ? 0xFFFE : count;
+				TM_SPI_DMA_Send(ILI9341_SPI, data, len);
+				
+				/* Wait till done */
+				while (TM_SPI_DMA_Working(ILI9341_SPI));
+				
+				data += len;
+				count -= len;
+			}
+		} else {
+			/* Send line by line, LCD continues inside window automatically */
+			for (y = rect->y0; y <= rect->y1; y++) {
+				TM_SPI_DMA_Send(ILI9341_SPI, (uint8_t *)&ILI9341_SHADOW[(uint32_t)y * ILI9341_Opts.width + rect->x0], width * 2);
+				
+				/* Wait till done */
+				while (TM_SPI_DMA_Working(ILI9341_SPI));
+			}
+		}
+		
+		ILI9341_CS_SET;
+	}
+	
+	/* Everything is on LCD now */
+	ILI9341_DirtyCount = 0;
+#endif
 }
 
 void TM_ILI9341_Puts(uint16_t x, uint16_t y, char *str, TM_FontDef_t *font, uint32_t foreground, uint32_t background) {
@@ -400,6 +541,18 @@ void TM_ILI9341_Putc(uint16_t x, uint16_t y, char c, TM_FontDef_t *font, uint32_
 		ILI9341_x = 0;
 	}
 	
+#if ILI9341_USE_FONTS_CACHE == 1
+	/* Send prepared glyph from cache with one DMA transfer */
+	if (
+		(background & ILI9341_TRANSPARENT) == 0 &&
+		TM_INT_ILI9341_PutcCache(c, font, foreground, background)
+	) {
+		/* Set new pointer */
+		ILI9341_x += font->FontWidth;
+		return;
+	}
+#endif
+	
 	/* Draw rectangle for background */
 	TM_ILI9341_INT_Fill(ILI9341_x, ILI9341_y, ILI9341_x + font->FontWidth, ILI9341_y + font->FontHeight, background);
 	
@@ -417,6 +570,65 @@ void TM_ILI9341_Putc(uint16_t x, uint16_t y, char c, TM_FontDef_t *font, uint32_
 	ILI9341_x += font->FontWidth;
 }
 
+#if ILI9341_USE_FONTS_CACHE == 1
+uint8_t TM_INT_ILI9341_PutcCache(char c, TM_FontDef_t *font, uint32_t foreground, uint32_t background) {
+	TM_FONTS_CACHE_Glyph_t glyph;
+#if ILI9341_USE_SHADOW == 1
+	uint16_t i;
+#endif
+	
+	/* Character must be completely visible */
+	if (
+		(ILI9341_x + font->FontWidth) > ILI9341_Opts.width ||
+		(ILI9341_y + font->FontHeight) > ILI9341_Opts.height
+	) {
+		return 0;
+	}
+	
+	/* LCD expects MSB first, colours are byte swapped so glyph can be sent in 8-bit mode directly from memory */
+	if (TM_FONTS_CACHE_Get(
+		&glyph, font, c, TM_FONTS_CACHE_Format_RGB565, TM_FONTS_CACHE_Rotate_0,
+		ILI9341_SWAP16(foreground), ILI9341_SWAP16(background)
+	)) {
+		return 0;
+	}
+	
+#if ILI9341_USE_SHADOW == 1
+	/* Copy glyph to shadow framebuffer line by line */
+	for (i = 0; i < glyph.Height; i++) {
+		memcpy(
+			&ILI9341_SHADOW[(uint32_t)(ILI9341_y + i) * ILI9341_Opts.width + ILI9341_x],
+			(uint16_t *)glyph.Data + i * glyph.Width,
+			glyph.Width * 2
+		);
+	}
+	
+	/* Mark as changed */
+	TM_INT_ILI9341_AddDirty(ILI9341_x, ILI9341_y, ILI9341_x + glyph.Width - 1, ILI9341_y + glyph.Height - 1);
+#else
+	/* Set cursor position, LCD rotates itself */
+	TM_ILI9341_SetCursorPosition(ILI9341_x, ILI9341_y, ILI9341_x + glyph.Width - 1, ILI9341_y + glyph.Height - 1);
+
+	/* Set command for GRAM data */
+	TM_ILI9341_SendCommand(ILI9341_GRAM);
+	
+	/* Send everything */
+	ILI9341_CS_RESET;
+	ILI9341_WRX_SET;
+	
+	/* Send glyph with DMA */
+	TM_SPI_DMA_Transmit(ILI9341_SPI, (uint8_t *)glyph.Data, NULL, glyph.Width * glyph.Height * 2);
+	
+	/* Wait till done */
+	while (TM_SPI_DMA_Working(ILI9341_SPI));
+	
+	ILI9341_CS_SET;
+#endif
+	
+	/* Glyph sent */
+	return 1;
+}
+#endif
 
 void TM_ILI9341_DrawLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint32_t color) {
 	/* Code by dewoller: https://github.com/dewoller */
@@ -573,3 +785,99 @@ void TM_ILI9341_DrawFilledCircle(int16_t x0, int16_t y0, int16_t r, uint32_t col
         TM_ILI9341_DrawLine(x0 + y, y0 - x, x0 - y, y0 - x, color);
     }
 }
+
+#if ILI9341_USE_SHADOW == 1
+static void TM_INT_ILI9341_AddDirty(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
+	TM_ILI9341_INT_Rect_t *rect, *other;
+	uint32_t growth, best_growth = 0xFFFFFFFF;
+	uint8_t i, best = 0;
+	
+	/* Check all regions */
+	for (i = 0; i < ILI9341_DirtyCount; i++) {
+		rect = &ILI9341_Dirty[i];
+		
+		/* Overlapping or touching region, join them */
+		if (
+			x0 <= (rect->x1 + 1) && (x1 + 1) >= rect->x0 &&
+			y0 <= (rect->y1 + 1) && (y1 + 1) >= rect->y0
+		) {
+			best = i;
+			best_growth = 0;
+			break;
+		}
+		
+		/* Calculate how much area grows if joined with this region */
+		growth = 
+			(uint32_t)(((x1 > rect->x1) ? x1 : rect->x1) - ((x0 < rect->x0) ? x0 : rect->x0) + 1) *
+			(uint32_t)(((y1 > rect->y1) ? y1 : rect->y1) - ((y0 < rect->y0) ? y0 : rect->y0) + 1) -
+			(uint32_t)(rect->x1 - rect->x0 + 1) * (uint32_t)(rect->y1 - rect->y0 + 1);
+		if (growth < best_growth) {
+			best = i;
+			best_growth = growth;
+		}
+	}
+	
+	/* Add new region if not touching others and there is space */
+	if (best_growth && ILI9341_DirtyCount < ILI9341_DIRTY_RECTS) {
+		rect = &ILI9341_Dirty[ILI9341_DirtyCount++];
+		rect->x0 = x0;
+		rect->y0 = y0;
+		rect->x1 = x1;
+		rect->y1 = y1;
+		return;
+	}
+	
+	/* Join with region with smallest area growth */
+	rect = &ILI9341_Dirty[best];
+	if (x0 < rect->x0) {
+		rect->x0 = x0;
+	}
+	if (y0 < rect->y0) {
+		rect->y0 = y0;
+	}
+	if (x1 > rect->x1) {
+		rect->x1 = x1;
+	}
+	if (y1 > rect->y1) {
+		rect->y1 = y1;
+	}
+	
+	/* Grown region may now overlap others, join them too so no area is sent twice */
+	i = 0;
+	while (i < ILI9341_DirtyCount) {
+		other = &ILI9341_Dirty[i];
+		if (
+			i == best ||
+			rect->x0 > (other->x1 + 1) || (rect->x1 + 1) < other->x0 ||
+			rect->y0 > (other->y1 + 1) || (rect->y1 + 1) < other->y0
+		) {
+			i++;
+			continue;
+		}
+		
+		/* Union of both regions */
+		if (other->x0 < rect->x0) {
+			rect->x0 = other->x0;
+		}
+		if (other->y0 < rect->y0) {
+			rect->y0 = other->y0;
+		}
+		if (other->x1 > rect->x1) {
+			rect->x1 = other->x1;
+		}
+		if (other->y1 > rect->y1) {
+			rect->y1 = other->y1;
+		}
+		
+		/* Remove joined region, last one takes its place */
+		*other = ILI9341_Dirty[--ILI9341_DirtyCount];
+		if (best == ILI9341_DirtyCount) {
+			best = i;
+			rect = other;
+		}
+		
+		/* Region has grown, check all again */
+		i = 0;
+	}
+}
+#endif
@@ -3,7 +3,7 @@
  * @email   tilen@majerle.eu
  * @website http://stm32f4-discovery.net
  * @link    http://stm32f4-discovery.net/2014/04/library-08-ili9341-lcd-on-stm32f429-discovery-board/
- * @version v1.3
+ * @version v1.5
  * @ide     Keil uVision
  * @license GNU GPL v3
  * @brief   ILI9341 library for STM32F4xx with SPI communication, without LTDC hardware
@@ -28,7 +28,7 @@
 @endverbatim
  */
 #ifndef TM_ILI9341_H
-#define TM_ILI9341_H 130
+#define TM_ILI9341_H 150
 
 /**
  * @addtogroup TM_STM32F4xx_Libraries
@@ -89,11 +89,65 @@ VCC          3.3V         Positive power supply
 //Default RESET pin. Edit this in your defines.h file
 #define ILI9341_RST_PORT			GPIOD
 #define ILI9341_RST_PIN				GPIO_PIN_12
+@endverbatim
+ *
+ * \par Glyph cache
+ *
+ * Characters can be taken from @ref TM_FONTS_CACHE, where they are prepared in RGB565 format with both colours.
+ * Each character is then sent to LCD with one SPI DMA transfer instead of background fill and pixel by pixel drawing.
+ * Characters with transparent background are still drawn pixel by pixel.
+ *
+ * Cache needs memory for glyphs, by default in SDRAM, so it is disabled by default.
+ * To enable it, add lines below to defines.h file:
+ *
+@verbatim
+//Use glyph cache for characters
+#define ILI9341_USE_FONTS_CACHE    1
+
+//Glyph cache in internal RAM if SDRAM is not used, 32 slots for glyphs up to 16x26 pixels
+//Array must be defined somewhere in project
+extern uint32_t GlyphCache[32 * 16 * 26];
+#define FONTS_CACHE_ADDR           ((uint32_t)GlyphCache)
+#define FONTS_CACHE_SLOTS          32
+@endverbatim
+ *
+ * \par Shadow framebuffer
+ *
+ * Without shadow framebuffer, each pixel is sent to LCD with its own window and GRAM command, which is very slow.
+ *
+ * When shadow framebuffer is enabled, all drawing functions only write to memory and remember changed regions (dirty rectangles).
+ * Nothing is sent to LCD until @ref TM_ILI9341_Flush is called. Then only changed regions are sent,
+ * each with one window command and long SPI DMA transfers.
+ * Regions which touch or overlap are joined. When there is no space for new region,
+ * it is joined with the one where area grows the least. Other regions which overlap the grown one are joined with it too,
+ * so no area is sent twice.
+ *
+ * @ref TM_ILI9341_Rotate changes layout of shadow framebuffer. It is cleared to black then, content must be drawn again.
+ *
+ * Shadow framebuffer needs 240 * 320 * 2 = 150kB of memory and is placed at the beginning of SDRAM by default.
+ * SDRAM is initialized in @ref TM_ILI9341_Init function in this case.
+ * Memory must be accessible by DMA used for SPI.
+ *
+@verbatim
+//Enable shadow framebuffer
+#define ILI9341_USE_SHADOW        1
+
+//Set custom address for shadow framebuffer, memory is not initialized by library in this case
+#define ILI9341_SHADOW_ADDR       ((uint32_t)0xD0000000)
+
+//Number of dirty rectangles remembered between flushes
+#define ILI9341_DIRTY_RECTS       8
 @endverbatim
  *
  * \par Changelog
  *
 @verbatim
+ Version 1.5
+  - Added optional shadow framebuffer with dirty rectangles and TM_ILI9341_Flush() function
+
+ Version 1.4
+  - Added optional glyph cache for characters, sent with one SPI DMA transfer
+
  Version 1.3
   - June 06, 2015
   - Added support for SPI DMA for faster refreshing
@@ -119,6 +173,8 @@ VCC          3.3V         Positive power supply
  - TM DMA
  - TM SPI DMA
  - TM FONTS
+ - TM FONTS CACHE, only if enabled
+ - TM SDRAM, only if shadow framebuffer is in SDRAM
  - TM GPIO
 @endverbatim
  */
@@ -194,6 +250,40 @@ VCC          3.3V         Positive power supply
 /* Transparent background, only for strings and chars */
 #define ILI9341_TRANSPARENT			0x80000000
 
+/**
+ * @brief  Enable (1) or disable (0) glyph cache for characters
+ */
+#ifndef ILI9341_USE_FONTS_CACHE
+#define ILI9341_USE_FONTS_CACHE		0
+#endif
+
+/**
+ * @brief  Enable (1) or disable (0) shadow framebuffer
+ */
+#ifndef ILI9341_USE_SHADOW
+#define ILI9341_USE_SHADOW			0
+#endif
+
+/**
+ * @brief  Address of shadow framebuffer, default at the beginning of SDRAM
+ */
+#ifndef ILI9341_SHADOW_ADDR
+#define ILI9341_SHADOW_ADDR			SDRAM_START_ADR
+#define ILI9341_SHADOW_SDRAM		1
+#else
+#define ILI9341_SHADOW_SDRAM		0
+#endif
+
+/**
+ * @brief  Number of dirty rectangles remembered between flushes
+ */
+#ifndef ILI9341_DIRTY_RECTS
+#define ILI9341_DIRTY_RECTS			8
+#endif
+
+/* Swaps bytes in 16-bit colour */
+#define ILI9341_SWAP16(x)			(uint16_t)((((x) & 0xFF) << 8) | (((x) >> 8) & 0xFF))
+
 /**
  * @}
  */
@@ -251,11 +341,20 @@ void TM_ILI9341_Fill(uint32_t color);
 
 /**
  * @brief  Rotates LCD to specific orientation
+ * @note   When shadow framebuffer is used, it is cleared to black and must be drawn again
  * @param  orientation: LCD orientation. This parameter can be a value of @ref TM_ILI9341_Orientation_t enumeration
  * @retval None
  */
 void TM_ILI9341_Rotate(TM_ILI9341_Orientation_t orientation);
 
+/**
+ * @brief  Sends all changed regions of shadow framebuffer to LCD
+ * @note   Function does nothing if shadow framebuffer is not used, so it is safe to call it always
+ * @param  None
+ * @retval None
+ */
+void TM_ILI9341_Flush(void);
+
 /**
  * @brief  Puts single character to LCD
  * @param  x: X position of top left corner
@@ -18,6 +18,10 @@
  */
 #include "tm_stm32f4_ili9341_ltdc.h"
 #include "tm_stm32f4_fonts.h"
+#include "tm_stm32f4_dma2d_graphic.h"
+#include "tm_stm32f4_fonts_cache.h"
+#include "tm_stm32f4_span.h"
+#include "tm_stm32f4_aa.h"
 
 /* Private structures */
 /**
@@ -42,6 +46,13 @@ typedef struct {
 	uint8_t Layer1Opacity;
 	uint8_t Layer2Opacity;
 	TM_ILI9341_Orientation_t Orient;
+	uint32_t Layer1Offset;
+	uint8_t FrontBuffer;
+	uint8_t BackBuffer;
+	TM_ILI9341_Format_t Layer1Format;
+	TM_ILI9341_Format_t Layer2Format;
+	TM_ILI9341_Format_t Format;
+	uint8_t PixelSize;
 } TM_ILI931_Options_t;
 
 /* Private defines */
@@ -61,6 +72,12 @@ typedef struct {
 #define ILI9341_FRAME_BUFFER		SDRAM_START_ADR
 /* Offset for Layer 2 */
 #define ILI9341_FRAME_OFFSET		(uint32_t)ILI9341_PIXEL * 2
+/* Offset for layer 1 buffers, buffer 0 is layer 1 memory, others are after layer 2 */
+#define ILI9341_BUFFER_OFFSET(i)	((i) ? ((uint32_t)(i) + 1) * ILI9341_FRAME_OFFSET : 0)
+/* Number of bytes per pixel for layer format */
+#define ILI9341_PIXEL_SIZE(format)	(((format) == TM_ILI9341_Format_L8 || (format) == TM_ILI9341_Format_AL44) ? 1 : 2)
+/* First line of vertical blanking, LTDC AccumulatedActiveH + 1 */
+#define ILI9341_VBLANK_LINE			324
 
 /* Commands */
 #define ILI9341_RESET				0x01
@@ -99,9 +116,17 @@ uint16_t ILI9341_x;
 uint16_t ILI9341_y;
 TM_ILI931_Options_t ILI9341_Opts;
 
+/* Alpha mask for proportional font characters */
+static uint8_t ILI9341_PropMask[ILI9341_PROP_MAX_PIXELS];
+
+#if ILI9341_BUFFERS > 1
+/* Buffer swap status and number of displayed frames */
+static __IO uint8_t ILI9341_SwapPending = 0;
+static __IO uint32_t ILI9341_FrameCount = 0;
+#endif
+
 /* Private functions */
 void TM_INT_ILI9341_DrawCircleCorner(int16_t x0, int16_t y0, int16_t r, uint8_t corner, uint32_t color);
-void TM_INT_ILI9341_DrawFilledCircleCorner(int16_t x0, int16_t y0, int16_t r, uint8_t corner, uint32_t color);
 void TM_ILI9341_InitPins(void);
 void TM_LCD9341_InitLTDC(void);
 void TM_ILI9341_InitLayers(void);
@@ -111,8 +136,21 @@ void TM_ILI9341_SendCommand(uint8_t data);
 void TM_ILI9341_Delay(volatile unsigned int delay);
 void TM_ILI9341_SetCursorPosition(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2);
 void TM_ILI9341_UpdateLayerOpacity(void);
+void TM_INT_ILI9341_Putc(uint16_t x, uint16_t y, char c, TM_FontDef_t *font, uint32_t foreground, uint32_t background);
+#if ILI9341_DMA2D_TEXT == 1
+uint8_t TM_INT_ILI9341_PutcDMA2D(char c, TM_FontDef_t *font, uint32_t foreground, uint32_t background);
+#endif
+static void TM_INT_ILI9341_SetFormat(LTDC_Layer_TypeDef* LTDC_Layerx, TM_ILI9341_Format_t format);
+static void TM_INT_ILI9341_SetCLUT(LTDC_Layer_TypeDef* LTDC_Layerx, const uint32_t* CLUT, uint16_t count);
+static void TM_INT_ILI9341_FillRect8(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint8_t color);
+static void TM_INT_ILI9341_FillRounded8(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t r, uint8_t color);
 
 void TM_ILI9341_Init(void) {
+#if ILI9341_BUFFERS > 1
+	NVIC_InitTypeDef NVIC_InitStruct;
+	uint8_t i;
+#endif
+	
 	/* Initialize pins used */
 	TM_ILI9341_InitPins();
 	/* SPI chip select high */
@@ -139,12 +177,44 @@ void TM_ILI9341_Init(void) {
 	ILI9341_Opts.CurrentLayerOffset = 0;
 	ILI9341_Opts.Layer1Opacity = 255;
 	ILI9341_Opts.Layer2Opacity = 0;
+	ILI9341_Opts.Layer1Offset = 0;
+	ILI9341_Opts.FrontBuffer = 0;
+	ILI9341_Opts.BackBuffer = 0;
+	ILI9341_Opts.Layer1Format = TM_ILI9341_Format_RGB565;
+	ILI9341_Opts.Layer2Format = TM_ILI9341_Format_RGB565;
+	ILI9341_Opts.Format = TM_ILI9341_Format_RGB565;
+	ILI9341_Opts.PixelSize = 2;
 	
 	/* Fill both layers with default colors */
 	TM_ILI9341_SetLayer1();
 	TM_ILI9341_Fill(ILI9341_COLOR_WHITE);
 	TM_ILI9341_SetLayer2();
 	TM_ILI9341_Fill(ILI9341_COLOR_WHITE);
+	
+#if ILI9341_BUFFERS > 1
+	/* Fill other layer 1 buffers */
+	for (i = 1; i < ILI9341_BUFFERS; i++) {
+		ILI9341_Opts.CurrentLayerOffset = ILI9341_BUFFER_OFFSET(i);
+		TM_ILI9341_Fill(ILI9341_COLOR_WHITE);
+	}
+	
+	/* Buffer 0 is displayed, drawing is done to buffer 1 */
+	ILI9341_Opts.BackBuffer = 1;
+	ILI9341_Opts.Layer1Offset = ILI9341_BUFFER_OFFSET(1);
+	
+	/* Line interrupt at the beginning of vertical blanking */
+	LTDC_LIPConfig(ILI9341_VBLANK_LINE);
+	LTDC_ClearITPendingBit(LTDC_IT_LI);
+	LTDC_ITConfig(LTDC_IT_LI, ENABLE);
+	
+	/* Set NVIC */
+	NVIC_InitStruct.NVIC_IRQChannel = LTDC_IRQn;
+	NVIC_InitStruct.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_InitStruct.NVIC_IRQChannelPreemptionPriority = ILI9341_NVIC_PRIORITY;
+	NVIC_InitStruct.NVIC_IRQChannelSubPriority = ILI9341_NVIC_SUBPRIORITY;
+	NVIC_Init(&NVIC_InitStruct);
+#endif
+	
 	TM_ILI9341_SetLayer1();
 }
 
@@ -326,8 +396,8 @@ void TM_LCD9341_InitLTDC(void) {
 	/* Enable Pixel Clock */
 	/* PLLSAI_VCO Input = HSE_VALUE/PLL_M = 1 Mhz */
 	/* PLLSAI_VCO Output = PLLSAI_VCO Input * PLLSAI_N = 192 Mhz */
-	/* PLLLCDCLK = PLLSAI_VCO Output/PLLSAI_R = 192/4 = 96 Mhz */
-	/* LTDC clock frequency = PLLLCDCLK / RCC_PLLSAIDivR = 96/4 = 24 Mhz */
+	/* PLLLCDCLK = PLLSAI_VCO Output/PLLSAI_R = 192/4 = 48 Mhz */
+	/* LTDC clock frequency = PLLLCDCLK / RCC_PLLSAIDivR = 48/4 = 12 Mhz */
 	RCC_PLLSAIConfig(192, 7, 4);
 	RCC_LTDCCLKDivConfig(RCC_PLLSAIDivR_Div4);
 
@@ -470,7 +540,7 @@ void TM_ILI9341_SendData(uint8_t data) {
 }
 
 void TM_ILI9341_DrawPixel(uint16_t x, uint16_t y, uint32_t color) {
-	uint16_t tmp;
+	uint32_t index;
 	if (x >= ILI9341_Opts.Width) {
 		return;
 	}
@@ -479,32 +549,37 @@ void TM_ILI9341_DrawPixel(uint16_t x, uint16_t y, uint32_t color) {
 	}
 	if (ILI9341_Opts.Orient == TM_ILI9341_Orientation_Portrait_1) {
 		/* Portrait1 */
-		*(uint16_t *) (ILI9341_FRAME_BUFFER + ILI9341_Opts.CurrentLayerOffset + 2 * (ILI9341_PIXEL - x - ILI9341_Opts.Width * y)) = color;
+		index = ILI9341_PIXEL - x - ILI9341_Opts.Width * y;
 	} else if (ILI9341_Opts.Orient == TM_ILI9341_Orientation_Portrait_2) {
 		/* Portrait2, original */
-		*(uint16_t *) (ILI9341_FRAME_BUFFER + ILI9341_Opts.CurrentLayerOffset + 2 * (x + ILI9341_Opts.Width * y)) = color;
+		index = x + ILI9341_Opts.Width * y;
 	} else if (ILI9341_Opts.Orient == TM_ILI9341_Orientation_Landscape_1) {
-		/* L andscape 1 */
-		tmp = x;
-		x = y;
-		y = ILI9341_HEIGHT - 1 - tmp;
-		*(uint16_t *) (ILI9341_FRAME_BUFFER + ILI9341_Opts.CurrentLayerOffset + 2 * (x + ILI9341_WIDTH * y)) = color;
+		/* Landscape 1 */
+		index = y + ILI9341_WIDTH * (ILI9341_HEIGHT - 1 - x);
 	} else {
 		/* Landscape2 */
-		tmp = y;
-		y = x;
-		x = ILI9341_WIDTH - 1 - tmp;
-		*(uint16_t *) (ILI9341_FRAME_BUFFER + ILI9341_Opts.CurrentLayerOffset + 2 * (x + ILI9341_WIDTH * y)) = color;
+		index = ILI9341_WIDTH - 1 - y + ILI9341_WIDTH * x;
+	}
+	
+	/* Write pixel in layer format */
+	if (ILI9341_Opts.PixelSize == 1) {
+		*(uint8_t *) (ILI9341_FRAME_BUFFER + ILI9341_Opts.CurrentLayerOffset + index) = color;
+	} else {
+		*(uint16_t *) (ILI9341_FRAME_BUFFER + ILI9341_Opts.CurrentLayerOffset + 2 * index) = color;
 	}
-	return;
 }
 
 void TM_ILI9341_Fill(uint32_t color) {
-	uint32_t i;
-	uint32_t pixels = ILI9341_PIXEL * 2;
-	for (i = 0; i < pixels; i += 2) {
-		*(uint16_t *) (ILI9341_FRAME_BUFFER + ILI9341_Opts.CurrentLayerOffset + i) = color;
+	if (ILI9341_Opts.PixelSize == 1) {
+		/* 2 pixels in one 16-bit DMA2D pixel */
+		TM_DMA2DGRAPHIC_FillBufferIT((void *)(ILI9341_FRAME_BUFFER + ILI9341_Opts.CurrentLayerOffset), ILI9341_WIDTH / 2, ILI9341_HEIGHT, 0, (color & 0xFF) * 0x0101);
+	} else {
+		/* Raw 16-bit value, valid for all 16-bit formats */
+		TM_DMA2DGRAPHIC_FillBufferIT((void *)(ILI9341_FRAME_BUFFER + ILI9341_Opts.CurrentLayerOffset), ILI9341_WIDTH, ILI9341_HEIGHT, 0, color);
 	}
+	
+	/* Layer is filled when function returns */
+	DMA2D_WAIT;
 }
 
 void TM_ILI9341_Delay(volatile unsigned int delay) {
@@ -525,13 +600,63 @@ void TM_ILI9341_Rotate(TM_ILI9341_Orientation_t orientation) {
 }
 
 void TM_ILI9341_SetLayer1(void) {
-	ILI9341_Opts.CurrentLayerOffset = 0;
+	ILI9341_Opts.CurrentLayerOffset = ILI9341_Opts.Layer1Offset;
 	ILI9341_Opts.CurrentLayer = 0;
+	ILI9341_Opts.Format = ILI9341_Opts.Layer1Format;
+	ILI9341_Opts.PixelSize = ILI9341_PIXEL_SIZE(ILI9341_Opts.Format);
 }
 
 void TM_ILI9341_SetLayer2(void) {
 	ILI9341_Opts.CurrentLayerOffset = ILI9341_FRAME_OFFSET;
 	ILI9341_Opts.CurrentLayer = 1;
+	ILI9341_Opts.Format = ILI9341_Opts.Layer2Format;
+	ILI9341_Opts.PixelSize = ILI9341_PIXEL_SIZE(ILI9341_Opts.Format);
+}
+
+void TM_ILI9341_SetLayer1Format(TM_ILI9341_Format_t format) {
+	ILI9341_Opts.Layer1Format = format;
+	TM_INT_ILI9341_SetFormat(LTDC_Layer1, format);
+}
+
+void TM_ILI9341_SetLayer2Format(TM_ILI9341_Format_t format) {
+	ILI9341_Opts.Layer2Format = format;
+	TM_INT_ILI9341_SetFormat(LTDC_Layer2, format);
+}
+
+void TM_ILI9341_SetLayer1CLUT(const uint32_t* CLUT, uint16_t count) {
+	TM_INT_ILI9341_SetCLUT(LTDC_Layer1, CLUT, count);
+}
+
+void TM_ILI9341_SetLayer2CLUT(const uint32_t* CLUT, uint16_t count) {
+	TM_INT_ILI9341_SetCLUT(LTDC_Layer2, CLUT, count);
+}
+
+uint32_t TM_ILI9341_CalculateBandwidth(void) {
+	LTDC_Layer_TypeDef* layers[2] = {LTDC_Layer1, LTDC_Layer2};
+	uint32_t clock, total, bytes = 0;
+	uint8_t i;
+	
+	/* PLLSAI has the same input as main PLL */
+	clock = (RCC->PLLCFGR & RCC_PLLCFGR_PLLSRC) ? HSE_VALUE : HSI_VALUE;
+	clock /= RCC->PLLCFGR & RCC_PLLCFGR_PLLM;
+	
+	/* Pixel clock = input * N / R / DIVR */
+	clock *= (RCC->PLLSAICFGR >> 6) & 0x1FF;
+	clock /= (RCC->PLLSAICFGR >> 28) & 0x07;
+	clock /= 2 << ((RCC->DCKCFGR >> 16) & 0x03);
+	
+	/* Number of pixel clocks in one frame */
+	total = (((LTDC->TWCR >> 16) & 0xFFF) + 1) * ((LTDC->TWCR & 0x7FF) + 1);
+	
+	/* Bytes of enabled layers in one frame, line length register has 3 bytes more than line */
+	for (i = 0; i < 2; i++) {
+		if (layers[i]->CR & LTDC_LxCR_LEN) {
+			bytes += ((layers[i]->CFBLR & 0x1FFF) - 3) * (layers[i]->CFBLNR & 0x7FF);
+		}
+	}
+	
+	/* Bytes per second */
+	return (uint64_t)bytes * clock / total;
 }
 
 void TM_ILI9341_SetLayer1Opacity(uint8_t opacity) {
@@ -555,21 +680,86 @@ void TM_ILI9341_UpdateLayerOpacity(void) {
 void TM_ILI9341_ChangeLayers(void) {
 	if (ILI9341_Opts.CurrentLayer == 0) {
 		TM_ILI9341_SetLayer2();
-		TM_ILI9341_SetLayer1Opacity(0);
-		TM_ILI9341_SetLayer2Opacity(255);
+		ILI9341_Opts.Layer1Opacity = 0;
+		ILI9341_Opts.Layer2Opacity = 255;
 	} else {
 		TM_ILI9341_SetLayer1();
-		TM_ILI9341_SetLayer1Opacity(255);
-		TM_ILI9341_SetLayer2Opacity(0);
+		ILI9341_Opts.Layer1Opacity = 255;
+		ILI9341_Opts.Layer2Opacity = 0;
+	}
+	
+	/* Wait for DMA2D, layer must be completely drawn */
+	DMA2D_WAIT;
+	
+	/* Change opacity in vertical blanking, to prevent tearing */
+	LTDC_LayerAlpha(LTDC_Layer1, ILI9341_Opts.Layer1Opacity);
+	LTDC_LayerAlpha(LTDC_Layer2, ILI9341_Opts.Layer2Opacity);
+	LTDC_ReloadConfig(LTDC_VBReload);
+	
+	/* Wait till new values are used, old layer may be drawn after that */
+	while (LTDC->SRCR & LTDC_SRCR_VBR);
+}
+
+void TM_ILI9341_SwapBuffers(uint8_t wait) {
+#if ILI9341_BUFFERS > 1
+	/* Wait for DMA2D, back buffer must be completely drawn */
+	DMA2D_WAIT;
+	
+	/* Only one swap can be pending */
+	while (TM_ILI9341_IsSwapPending());
+	
+	/* Show back buffer from next vertical blanking */
+	ILI9341_SwapPending = 1;
+	LTDC_LayerAddress(LTDC_Layer1, ILI9341_FRAME_BUFFER + ILI9341_BUFFER_OFFSET(ILI9341_Opts.BackBuffer));
+	LTDC_ReloadConfig(LTDC_VBReload);
+	
+	/* Drawing continues to next buffer */
+	ILI9341_Opts.FrontBuffer = ILI9341_Opts.BackBuffer;
+	if (++ILI9341_Opts.BackBuffer >= ILI9341_BUFFERS) {
+		ILI9341_Opts.BackBuffer = 0;
 	}
+	ILI9341_Opts.Layer1Offset = ILI9341_BUFFER_OFFSET(ILI9341_Opts.BackBuffer);
+	if (ILI9341_Opts.CurrentLayer == 0) {
+		ILI9341_Opts.CurrentLayerOffset = ILI9341_Opts.Layer1Offset;
+	}
+	
+	/* With 2 buffers, new back buffer is displayed until swap is done */
+	if (wait || ILI9341_BUFFERS == 2) {
+		while (TM_ILI9341_IsSwapPending());
+	}
+#endif
+}
+
+uint8_t TM_ILI9341_IsSwapPending(void) {
+#if ILI9341_BUFFERS > 1
+	/* Reload flag is cleared by hardware when new address is used */
+	if (ILI9341_SwapPending && !(LTDC->SRCR & LTDC_SRCR_VBR)) {
+		ILI9341_SwapPending = 0;
+	}
+	
+	/* Return status */
+	return ILI9341_SwapPending;
+#else
+	/* No swap with single buffer */
+	return 0;
+#endif
+}
+
+uint32_t TM_ILI9341_GetFrameCount(void) {
+#if ILI9341_BUFFERS > 1
+	/* Return number of frames */
+	return ILI9341_FrameCount;
+#else
+	/* Not counted with single buffer */
+	return 0;
+#endif
 }
 
-#include "tm_stm32f4_dma2d_graphic.h"
 void TM_ILI9341_Layer2To1(void) {
 	/* Make a memory copy */
 	TM_DMA2DGRAPHIC_CopyBuffer(
 		(uint8_t *)(ILI9341_FRAME_BUFFER + ILI9341_FRAME_OFFSET), 
-		(uint8_t *)(ILI9341_FRAME_BUFFER),
+		(uint8_t *)(ILI9341_FRAME_BUFFER + ILI9341_Opts.Layer1Offset),
 		240, 320, 0, 0
 	);
 }
@@ -577,7 +767,7 @@ void TM_ILI9341_Layer2To1(void) {
 void TM_ILI9341_Layer1To2(void) {
 	/* Make a memory copy */
 	TM_DMA2DGRAPHIC_CopyBuffer(
-		(uint8_t *)(ILI9341_FRAME_BUFFER), 
+		(uint8_t *)(ILI9341_FRAME_BUFFER + ILI9341_Opts.Layer1Offset), 
 		(uint8_t *)(ILI9341_FRAME_BUFFER + ILI9341_FRAME_OFFSET),
 		240, 320, 0, 0
 	);
@@ -609,9 +799,14 @@ void TM_ILI9341_Puts(uint16_t x, uint16_t y, char *str, TM_FontDef_t *font, uint
 			continue;
 		}
 		
-		/* Put character */
-		TM_ILI9341_Putc(ILI9341_x, ILI9341_y, *str++, font, foreground, background);
+		/* Put character, DMA2D is not waited between characters */
+		TM_INT_ILI9341_Putc(ILI9341_x, ILI9341_y, *str++, font, foreground, background);
 	}
+	
+#if ILI9341_DMA2D_TEXT == 1
+	/* Wait for last character to be blended */
+	DMA2D_WAIT;
+#endif
 }
 
 void TM_ILI9341_GetStringSize(char *str, TM_FontDef_t *font, uint16_t *width, uint16_t *height) {
@@ -626,7 +821,78 @@ void TM_ILI9341_GetStringSize(char *str, TM_FontDef_t *font, uint16_t *width, ui
 	*width = w;
 }
 
+void TM_ILI9341_PutsProp(int16_t x, int16_t y, char* str, const TM_FONTS_PropFont_t* font, uint32_t foreground) {
+	const TM_FONTS_PropGlyph_t* glyph;
+	TM_SPAN_Target_t Target;
+	int16_t startX = x;
+	uint16_t i, j;
+	
+	/* Get framebuffer */
+	TM_ILI9341_GetTarget(&Target);
+	
+	while (*str) {
+		/* New line */
+		if (*str == '\n') {
+			y += font->Height;
+			x = startX;
+			str++;
+			continue;
+		} else if (*str == '\r') {
+			str++;
+			continue;
+		}
+		
+		/* Decode character to mask and blend it */
+		glyph = TM_FONTS_GetPropGlyph(font, *str);
+		if (glyph) {
+			if (
+				glyph->Width && glyph->Height &&
+				TM_FONTS_DecodePropGlyph(font, glyph, ILI9341_PropMask, ILI9341_PROP_MAX_PIXELS) == 0
+			) {
+				if (ILI9341_Opts.Format == TM_ILI9341_Format_RGB565) {
+					TM_AA_DrawAlphaMask(&Target, x + glyph->OffsetX, y + glyph->OffsetY, ILI9341_PropMask, glyph->Width, glyph->Height, foreground);
+				} else {
+					/* No blending in other formats, draw pixels with at least 50 % alpha */
+					for (i = 0; i < glyph->Height; i++) {
+						for (j = 0; j < glyph->Width; j++) {
+							if (ILI9341_PropMask[i * glyph->Width + j] >= 0x80 && x + glyph->OffsetX + j >= 0 && y + glyph->OffsetY + i >= 0) {
+								TM_ILI9341_DrawPixel(x + glyph->OffsetX + j, y + glyph->OffsetY + i, foreground);
+							}
+						}
+					}
+				}
+			}
+			
+			/* Go to next character */
+			x += glyph->Advance;
+			if (font->KerningCount && *(str + 1)) {
+				x += TM_FONTS_GetKerning(font, *str, *(str + 1));
+			}
+		}
+		str++;
+	}
+}
+
+void TM_ILI9341_GetPropStringSize(char* str, const TM_FONTS_PropFont_t* font, uint16_t* width, uint16_t* height) {
+	TM_FONTS_SIZE_t size;
+	
+	/* Calculate from advance table */
+	TM_FONTS_GetPropStringSize(str, &size, font);
+	*width = size.Length;
+	*height = size.Height;
+}
+
 void TM_ILI9341_Putc(uint16_t x, uint16_t y, char c, TM_FontDef_t *font, uint32_t foreground, uint32_t background) {
+	/* Put character */
+	TM_INT_ILI9341_Putc(x, y, c, font, foreground, background);
+	
+#if ILI9341_DMA2D_TEXT == 1
+	/* Wait for DMA2D to finish, framebuffer may be used by CPU after this function */
+	DMA2D_WAIT;
+#endif
+}
+
+void TM_INT_ILI9341_Putc(uint16_t x, uint16_t y, char c, TM_FontDef_t *font, uint32_t foreground, uint32_t background) {
 	uint32_t i, b, j;
 	/* Set coordinates */
 	ILI9341_x = x;
@@ -636,6 +902,16 @@ void TM_ILI9341_Putc(uint16_t x, uint16_t y, char c, TM_FontDef_t *font, uint32_
 		ILI9341_y += font->FontHeight;
 		ILI9341_x = 0;
 	}
+	
+#if ILI9341_DMA2D_TEXT == 1
+	/* Try with DMA2D first, glyph cache has only RGB565 and A8 glyphs */
+	if (ILI9341_Opts.Format == TM_ILI9341_Format_RGB565 && TM_INT_ILI9341_PutcDMA2D(c, font, foreground, background)) {
+		/* Go to new X location */
+		ILI9341_x += font->FontWidth;
+		return;
+	}
+#endif
+	
 	for (i = 0; i < font->FontHeight; i++) {
 		b = font->data[(c - 32) * font->FontHeight + i];
 		for (j = 0; j < font->FontWidth; j++) {
@@ -650,6 +926,78 @@ void TM_ILI9341_Putc(uint16_t x, uint16_t y, char c, TM_FontDef_t *font, uint32_
 	ILI9341_x += font->FontWidth;
 }
 
+#if ILI9341_DMA2D_TEXT == 1
+uint8_t TM_INT_ILI9341_PutcDMA2D(char c, TM_FontDef_t *font, uint32_t foreground, uint32_t background) {
+	TM_FONTS_CACHE_Glyph_t glyph;
+	TM_FONTS_CACHE_Rotate_t rotate;
+	uint32_t address;
+	
+	/* Character must be completely visible, else use per pixel path */
+	if (
+		(ILI9341_x + font->FontWidth) > ILI9341_Opts.Width ||
+		(ILI9341_y + font->FontHeight) > ILI9341_Opts.Height
+	) {
+		return 0;
+	}
+	
+	/* Get memory location of character and glyph rotation, depends on orientation */
+	if (ILI9341_Opts.Orient == TM_ILI9341_Orientation_Portrait_1) {
+		/* Memory index = PIXEL - x - WIDTH * y, both directions are mirrored */
+		address = ILI9341_PIXEL - (ILI9341_x + font->FontWidth - 1) - ILI9341_WIDTH * (ILI9341_y + font->FontHeight - 1);
+		rotate = TM_FONTS_CACHE_Rotate_180;
+	} else if (ILI9341_Opts.Orient == TM_ILI9341_Orientation_Portrait_2) {
+		/* Memory index = x + WIDTH * y */
+		address = ILI9341_x + ILI9341_WIDTH * ILI9341_y;
+		rotate = TM_FONTS_CACHE_Rotate_0;
+	} else if (ILI9341_Opts.Orient == TM_ILI9341_Orientation_Landscape_1) {
+		/* Memory index = y + WIDTH * (HEIGHT - 1 - x) */
+		address = ILI9341_y + ILI9341_WIDTH * (ILI9341_HEIGHT - ILI9341_x - font->FontWidth);
+		rotate = TM_FONTS_CACHE_Rotate_90;
+	} else {
+		/* Memory index = WIDTH - 1 - y + WIDTH * x */
+		address = ILI9341_WIDTH - ILI9341_y - font->FontHeight + ILI9341_WIDTH * ILI9341_x;
+		rotate = TM_FONTS_CACHE_Rotate_270;
+	}
+	
+	/* Get glyph from cache, opaque text is already in final colours */
+	if ((background & ILI9341_TRANSPARENT) == 0) {
+		if (TM_FONTS_CACHE_Get(&glyph, font, c, TM_FONTS_CACHE_Format_RGB565, rotate, foreground & 0xFFFF, background & 0xFFFF)) {
+			return 0;
+		}
+	} else {
+		if (TM_FONTS_CACHE_Get(&glyph, font, c, TM_FONTS_CACHE_Format_A8, rotate, 0, 0)) {
+			return 0;
+		}
+	}
+	
+	/* Absolute address in memory */
+	address = ILI9341_FRAME_BUFFER + ILI9341_Opts.CurrentLayerOffset + 2 * address;
+	
+	/* Put to DMA2D queue, do not wait */
+	if (glyph.Format == TM_FONTS_CACHE_Format_RGB565) {
+		/* Copy prepared glyph to framebuffer */
+		TM_DMA2DGRAPHIC_CopyBufferIT(
+			glyph.Data, (void *)address,
+			glyph.Width, glyph.Height,
+			0, ILI9341_WIDTH - glyph.Width
+		);
+	} else {
+		/* Blend A8 mask with foreground colour over framebuffer, colour is in RGB888 format */
+		TM_DMA2DGRAPHIC_BlendBufferIT(
+			glyph.Data, (void *)address, (void *)address,
+			glyph.Width, glyph.Height,
+			0, ILI9341_WIDTH - glyph.Width, ILI9341_WIDTH - glyph.Width,
+			CM_A8,
+			((((foreground >> 11) & 0x1F) * 255 / 31) << 16) |
+			((((foreground >> 5) & 0x3F) * 255 / 63) << 8) |
+			((foreground & 0x1F) * 255 / 31)
+		);
+	}
+	
+	/* Done with DMA2D */
+	return 1;
+}
+#endif
 
 void TM_ILI9341_DrawLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint32_t color) {
 	/* Code by dewoller: https://github.com/dewoller */	
@@ -750,56 +1098,36 @@ void TM_ILI9341_DrawRoundedRectangle(uint16_t x0, uint16_t y0, uint16_t x1, uint
 }
 
 void TM_ILI9341_DrawFilledRoundedRectangle(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint16_t r, uint32_t color) {
-	uint16_t temp;
+	TM_SPAN_Target_t Target;
 	
 	/* Check input parameters */
 	if (x1 == x0 || y1 == y0) {
 		return;
 	}
 	
-	/* No radius */
-	if (r == 0) {
-		TM_ILI9341_DrawFilledRectangle(x0, y0, x1, y1, color);
-	}
-	
-	/* Swap X coordinates */
-	if (x0 > x1) {
-		temp = x1;
-		x1 = x0;
-		x0 = temp;
-	}
-	
-	/* Swap Y coordinates */
-	if (y0 > y1) {
-		temp = y1;
-		y1 = y0;
-		y0 = temp;
-	}
-	
-	/* Check max radius */
-	if (r > ((x1 - x0) / 2)) {
-		r = (x1 - x0) / 2;
-	}
-	if (r > ((y1 - y0) / 2)) {
-		r = (y1 - y0) / 2;
+	/* 8-bit formats are filled line by line */
+	if (ILI9341_Opts.PixelSize == 1) {
+		TM_INT_ILI9341_FillRounded8(x0, y0, x1, y1, r, color);
+		return;
 	}
 	
-	/* Draw rectangles */
-	TM_ILI9341_DrawFilledRectangle(x0 + r, y0, x1 - r, y1, color);
-	TM_ILI9341_DrawFilledRectangle(x0, y0 + r, x0 + r, y1 - r, color);
-	TM_ILI9341_DrawFilledRectangle(x1 - r, y0 + r, x1, y1 - r, color);
-	
-	/* Draw corners */
-	TM_INT_ILI9341_DrawFilledCircleCorner(x0 + r, y0 + r, r, 0x01, color);
-	TM_INT_ILI9341_DrawFilledCircleCorner(x1 - r, y0 + r, r, 0x02, color);
-	TM_INT_ILI9341_DrawFilledCircleCorner(x1 - r, y1 - r - 1, r, 0x04, color);
-	TM_INT_ILI9341_DrawFilledCircleCorner(x0 + r, y1 - r - 1, r, 0x08, color);
+	/* Draw with span rasterizer, coordinates are sorted there */
+	TM_ILI9341_GetTarget(&Target);
+	TM_SPAN_FillRoundedRectangle(&Target, x0, y0, x1, y1, r, color);
 }
 
 void TM_ILI9341_DrawFilledRectangle(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint32_t color) {
-	for (; y0 <= y1; y0++) {
-		TM_ILI9341_DrawLine(x0, y0, x1, y0, color);
+	TM_SPAN_Target_t Target;
+	
+	/* 8-bit formats are filled line by line */
+	if (ILI9341_Opts.PixelSize == 1) {
+		TM_INT_ILI9341_FillRect8(x0, y0, x1, y1, color);
+		return;
 	}
+	
+	/* Draw with span rasterizer, all lines are filled at once */
+	TM_ILI9341_GetTarget(&Target);
+	TM_SPAN_FillRectangle(&Target, x0, y0, x1, y1, color);
 }
 
 void TM_ILI9341_DrawCircle(int16_t x0, int16_t y0, int16_t r, uint32_t color) {
@@ -837,34 +1165,105 @@ void TM_ILI9341_DrawCircle(int16_t x0, int16_t y0, int16_t r, uint32_t color) {
 }
 
 void TM_ILI9341_DrawFilledCircle(int16_t x0, int16_t y0, int16_t r, uint32_t color) {
-	int16_t f = 1 - r;
-	int16_t ddF_x = 1;
-	int16_t ddF_y = -2 * r;
-	int16_t x = 0;
-	int16_t y = r;
+	TM_SPAN_Target_t Target;
+	
+	/* Check radius */
+	if (r < 0) {
+		return;
+	}
+	
+	/* 8-bit formats are filled line by line */
+	if (ILI9341_Opts.PixelSize == 1) {
+		TM_INT_ILI9341_FillRounded8(x0 - r, y0 - r, x0 + r, y0 + r, r, color);
+		return;
+	}
+	
+	/* Draw with span rasterizer */
+	TM_ILI9341_GetTarget(&Target);
+	TM_SPAN_FillCircle(&Target, x0, y0, r, color);
+}
 
-    TM_ILI9341_DrawPixel(x0, y0 + r, color);
-    TM_ILI9341_DrawPixel(x0, y0 - r, color);
-    TM_ILI9341_DrawPixel(x0 + r, y0, color);
-    TM_ILI9341_DrawPixel(x0 - r, y0, color);
-    TM_ILI9341_DrawLine(x0 - r, y0, x0 + r, y0, color);
+void TM_ILI9341_DrawLineAA(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint32_t color) {
+	TM_SPAN_Target_t Target;
+	
+	/* Anti-aliasing needs RGB565 format */
+	if (ILI9341_Opts.Format != TM_ILI9341_Format_RGB565) {
+		if (x0 >= 0 && y0 >= 0 && x1 >= 0 && y1 >= 0) {
+			TM_ILI9341_DrawLine(x0, y0, x1, y1, color);
+		}
+		return;
+	}
+	
+	/* Draw with anti-aliasing */
+	TM_ILI9341_GetTarget(&Target);
+	TM_AA_DrawLine(&Target, x0, y0, x1, y1, color);
+}
 
-    while (x < y) {
-        if (f >= 0) {
-            y--;
-            ddF_y += 2;
-            f += ddF_y;
-        }
-        x++;
-        ddF_x += 2;
-        f += ddF_x;
+void TM_ILI9341_DrawThickLineAA(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint8_t width, uint32_t color) {
+	TM_SPAN_Target_t Target;
+	
+	/* Anti-aliasing needs RGB565 format */
+	if (ILI9341_Opts.Format != TM_ILI9341_Format_RGB565) {
+		if (x0 >= 0 && y0 >= 0 && x1 >= 0 && y1 >= 0) {
+			TM_ILI9341_DrawLine(x0, y0, x1, y1, color);
+		}
+		return;
+	}
+	
+	/* Draw with anti-aliasing */
+	TM_ILI9341_GetTarget(&Target);
+	TM_AA_DrawThickLine(&Target, x0, y0, x1, y1, width, color);
+}
 
-        TM_ILI9341_DrawLine(x0 - x, y0 + y, x0 + x, y0 + y, color);
-        TM_ILI9341_DrawLine(x0 + x, y0 - y, x0 - x, y0 - y, color);
+void TM_ILI9341_DrawCircleAA(int16_t x0, int16_t y0, int16_t r, uint32_t color) {
+	TM_SPAN_Target_t Target;
+	
+	/* Check radius */
+	if (r < 0) {
+		return;
+	}
+	
+	/* Anti-aliasing needs RGB565 format */
+	if (ILI9341_Opts.Format != TM_ILI9341_Format_RGB565) {
+		TM_ILI9341_DrawCircle(x0, y0, r, color);
+		return;
+	}
+	
+	/* Draw with anti-aliasing */
+	TM_ILI9341_GetTarget(&Target);
+	TM_AA_DrawCircle(&Target, x0, y0, r, color);
+}
 
-        TM_ILI9341_DrawLine(x0 + y, y0 + x, x0 - y, y0 + x, color);
-        TM_ILI9341_DrawLine(x0 + y, y0 - x, x0 - y, y0 - x, color);
-    }
+void TM_ILI9341_DrawFilledCircleAA(int16_t x0, int16_t y0, int16_t r, uint32_t color) {
+	TM_SPAN_Target_t Target;
+	
+	/* Check radius */
+	if (r < 0) {
+		return;
+	}
+	
+	/* Anti-aliasing needs RGB565 format */
+	if (ILI9341_Opts.Format != TM_ILI9341_Format_RGB565) {
+		TM_ILI9341_DrawFilledCircle(x0, y0, r, color);
+		return;
+	}
+	
+	/* Draw with anti-aliasing */
+	TM_ILI9341_GetTarget(&Target);
+	TM_AA_DrawFilledCircle(&Target, x0, y0, r, color);
+}
+
+void TM_ILI9341_DrawArcAA(int16_t x0, int16_t y0, int16_t r, uint8_t width, uint16_t start, uint16_t end, uint32_t color) {
+	TM_SPAN_Target_t Target;
+	
+	/* Check radius, anti-aliasing needs RGB565 format */
+	if (r < 0 || ILI9341_Opts.Format != TM_ILI9341_Format_RGB565) {
+		return;
+	}
+	
+	/* Draw with anti-aliasing */
+	TM_ILI9341_GetTarget(&Target);
+	TM_AA_DrawArc(&Target, x0, y0, r, width, start, end, color);
 }
 
 /* Internal functions */
@@ -907,42 +1306,170 @@ void TM_INT_ILI9341_DrawCircleCorner(int16_t x0, int16_t y0, int16_t r, uint8_t
     }
 }
 
-void TM_INT_ILI9341_DrawFilledCircleCorner(int16_t x0, int16_t y0, int16_t r, uint8_t corner, uint32_t color) {
-	int16_t f = 1 - r;
-	int16_t ddF_x = 1;
-	int16_t ddF_y = -2 * r;
-	int16_t x = 0;
-	int16_t y = r;
+static void TM_INT_ILI9341_SetFormat(LTDC_Layer_TypeDef* LTDC_Layerx, TM_ILI9341_Format_t format) {
+	/* Wait for DMA2D, it may still draw in old format */
+	DMA2D_WAIT;
+	
+	/* Set format, line length and pitch are recalculated */
+	LTDC_LayerPixelFormat(LTDC_Layerx, format);
+	
+	/* Use new format in vertical blanking */
+	LTDC_ReloadConfig(LTDC_VBReload);
+	while (LTDC->SRCR & LTDC_SRCR_VBR);
+	
+	/* Update current layer */
+	if (ILI9341_Opts.CurrentLayer == 0) {
+		TM_ILI9341_SetLayer1();
+	} else {
+		TM_ILI9341_SetLayer2();
+	}
+}
 
-    while (x < y) {
-        if (f >= 0) {
-            y--;
-            ddF_y += 2;
-            f += ddF_y;
-        }
-        x++;
-        ddF_x += 2;
-        f += ddF_x;
+static void TM_INT_ILI9341_SetCLUT(LTDC_Layer_TypeDef* LTDC_Layerx, const uint32_t* CLUT, uint16_t count) {
+	uint16_t i;
+	
+	/* Check count */
+	if (count > 256) {
+		count = 256;
+	}
+	
+	/* Write in vertical synchronization, when LTDC does not read CLUT */
+	while (!(LTDC->CDSR & LTDC_CDSR_VSYNCS));
+	for (i = 0; i < count; i++) {
+		LTDC_Layerx->CLUTWR = ((uint32_t)i << 24) | (CLUT[i] & 0x00FFFFFF);
+	}
+	
+	/* Enable CLUT */
+	LTDC_Layerx->CR |= LTDC_LxCR_CLUTEN;
+	LTDC_ReloadConfig(LTDC_IMReload);
+}
 
-        if (corner & 0x01) {
-			TM_ILI9341_DrawLine(x0, y0 - y, x0 - x, y0 - y, color);
-			TM_ILI9341_DrawLine(x0, y0 - x, x0 - y, y0 - x, color);
-		}
-		
-        if (corner & 0x02) {	
-			TM_ILI9341_DrawLine(x0 + x, y0 - y, x0, y0 - y, color);
-			TM_ILI9341_DrawLine(x0 + y, y0 - x, x0, y0 - x, color);
+static void TM_INT_ILI9341_FillRect8(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint8_t color) {
+	TM_SPAN_Target_t Target;
+	int32_t first;
+	uint16_t pixels, lines;
+	uint8_t* ptr;
+	int16_t tmp;
+	
+	/* Sort coordinates */
+	if (x0 > x1) {
+		tmp = x0; x0 = x1; x1 = tmp;
+	}
+	if (y0 > y1) {
+		tmp = y0; y0 = y1; y1 = tmp;
+	}
+	
+	/* Clip to LCD */
+	if (x1 < 0 || y1 < 0 || x0 >= (int16_t)ILI9341_Opts.Width || y0 >= (int16_t)ILI9341_Opts.Height) {
+		return;
+	}
+	if (x0 < 0) {
+		x0 = 0;
+	}
+	if (y0 < 0) {
+		y0 = 0;
+	}
+	if (x1 >= (int16_t)ILI9341_Opts.Width) {
+		x1 = ILI9341_Opts.Width - 1;
+	}
+	if (y1 >= (int16_t)ILI9341_Opts.Height) {
+		y1 = ILI9341_Opts.Height - 1;
+	}
+	
+	/* Memory layout is the same as for 16-bit formats, only pixel size is different */
+	TM_ILI9341_GetTarget(&Target);
+	first = Target.Base;
+	first += (Target.StepX > 0 ? x0 : x1) * Target.StepX;
+	first += (Target.StepY > 0 ? y0 : y1) * Target.StepY;
+	if (Target.StepX == 1 || Target.StepX == -1) {
+		pixels = x1 - x0 + 1;
+		lines = y1 - y0 + 1;
+	} else {
+		pixels = y1 - y0 + 1;
+		lines = x1 - x0 + 1;
+	}
+	
+	/* Fill memory lines */
+	ptr = (uint8_t *)Target.Address + first;
+	while (lines--) {
+		memset(ptr, color, pixels);
+		ptr += ILI9341_WIDTH;
+	}
+}
+
+static void TM_INT_ILI9341_FillRounded8(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t r, uint8_t color) {
+	int16_t tmp, x, y;
+	
+	/* Sort coordinates */
+	if (x0 > x1) {
+		tmp = x0; x0 = x1; x1 = tmp;
+	}
+	if (y0 > y1) {
+		tmp = y0; y0 = y1; y1 = tmp;
+	}
+	
+	/* Check max radius */
+	if (r > (x1 - x0) / 2) {
+		r = (x1 - x0) / 2;
+	}
+	if (r > (y1 - y0) / 2) {
+		r = (y1 - y0) / 2;
+	}
+	
+	/* Lines with corners, x is half width of circle at distance y from center */
+	x = r;
+	for (y = r; y > 0; y--) {
+		while (x > 0 && (int32_t)x * x + (int32_t)y * y > (int32_t)r * r + r) {
+			x--;
 		}
+		TM_INT_ILI9341_FillRect8(x0 + r - x, y0 + r - y, x1 - r + x, y0 + r - y, color);
+		TM_INT_ILI9341_FillRect8(x0 + r - x, y1 - r + y, x1 - r + x, y1 - r + y, color);
+	}
+	
+	/* Middle part */
+	TM_INT_ILI9341_FillRect8(x0, y0 + r, x1, y1 - r, color);
+}
+
+void TM_ILI9341_GetTarget(TM_SPAN_Target_t* Target) {
+	/* Framebuffer of current layer */
+	Target->Address = ILI9341_FRAME_BUFFER + ILI9341_Opts.CurrentLayerOffset;
+	Target->Pitch = ILI9341_WIDTH;
+	Target->Width = ILI9341_Opts.Width;
+	Target->Height = ILI9341_Opts.Height;
+	
+	/* Memory index of pixel for each orientation, same as in TM_ILI9341_DrawPixel */
+	if (ILI9341_Opts.Orient == TM_ILI9341_Orientation_Portrait_1) {
+		Target->Base = ILI9341_PIXEL;
+		Target->StepX = -1;
+		Target->StepY = -ILI9341_WIDTH;
+	} else if (ILI9341_Opts.Orient == TM_ILI9341_Orientation_Portrait_2) {
+		Target->Base = 0;
+		Target->StepX = 1;
+		Target->StepY = ILI9341_WIDTH;
+	} else if (ILI9341_Opts.Orient == TM_ILI9341_Orientation_Landscape_1) {
+		Target->Base = ILI9341_WIDTH * (ILI9341_HEIGHT - 1);
+		Target->StepX = -ILI9341_WIDTH;
+		Target->StepY = 1;
+	} else {
+		Target->Base = ILI9341_WIDTH - 1;
+		Target->StepX = ILI9341_WIDTH;
+		Target->StepY = -1;
+	}
+}
+
+#if ILI9341_BUFFERS > 1
+/* LTDC IRQ Handler */
+void LTDC_IRQHandler(void) {
+	/* Line interrupt, vertical blanking has started */
+	if (LTDC_GetITStatus(LTDC_IT_LI)) {
+		/* Clear flag */
+		LTDC_ClearITPendingBit(LTDC_IT_LI);
 		
-		if (corner & 0x04) {
-			TM_ILI9341_DrawLine(x0, y0 + y, x0 + x, y0 + y, color);
-			TM_ILI9341_DrawLine(x0 + y, y0 + x, x0, y0 + x, color);
-		}
+		/* Count frames */
+		ILI9341_FrameCount++;
 		
-        if (corner & 0x08) {
-			TM_ILI9341_DrawLine(x0 - x, y0 + y, x0, y0 + y, color);
-			TM_ILI9341_DrawLine(x0, y0 + x, x0 - y, y0 + x, color);
-		}
-    }
+		/* Check if swap is done */
+		TM_ILI9341_IsSwapPending();
+	}
 }
-
+#endif
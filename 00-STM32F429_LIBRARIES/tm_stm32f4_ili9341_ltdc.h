@@ -3,7 +3,7 @@
  * @email   tilen@majerle.eu
  * @website http://stm32f4-discovery.net
  * @link    http://stm32f4-discovery.net/2014/06/library-18-ili9341-ltdc-stm32f429-discovery/
- * @version v1.4
+ * @version v1.12
  * @ide     Keil uVision
  * @license GNU GPL v3
  * @brief   ILI9341 library for LCD on STM32F429 Discovery using LTDC and external ram
@@ -28,7 +28,7 @@
 @endverbatim
  */
 #ifndef TM_ILI9341_LTDC_H
-#define TM_ILI9341_LTDC_H 140
+#define TM_ILI9341_LTDC_H 1120
 
 /* C++ detection */
 #ifdef __cplusplus
@@ -56,11 +56,143 @@ PA6  <-> G2    | PB8  <-> B6 | PC10 <-> R2    |             |                 |
 PA11 <-> R4    | PB9  <-> B7 |                |             |                 | PG11 <-> B3     |
 PA12 <-> R5    | PB10 <-> G4 |                |             |                 | PG12 <-> B4     |
                | PB11 <-> G5 |                |             |                 |                 |
+@endverbatim
+ *
+ * \par Text rendering with DMA2D
+ *
+ * By default, characters are not drawn pixel by pixel. Each character is taken from @ref TM_FONTS_CACHE,
+ * where it is already prepared in memory orientation of current LCD rotation:
+ *  - If background is not transparent, glyph is cached in RGB565 format with both colours
+ *    and DMA2D copies it to framebuffer with one memory to memory transfer
+ *  - If background is transparent, glyph is cached as 8-bit alpha mask (A8)
+ *    and DMA2D blends foreground colour over framebuffer using this mask
+ *
+ * Character is expanded from font only first time it is used with the same colours.
+ * CPU prepares next character while DMA2D still copies previous one.
+ * If character is not completely visible on LCD, slow per pixel path is used instead.
+ *
+ * To disable DMA2D text rendering, add line below to defines.h file:
+ *
+@verbatim
+#define ILI9341_DMA2D_TEXT    0
+@endverbatim
+ *
+ * \par Proportional fonts
+ *
+ * Proportional and anti-aliased fonts (@ref TM_FONTS_PropFont_t) are drawn with @ref TM_ILI9341_PutsProp function.
+ * Each character is decoded to 8-bit alpha mask in internal RAM and blended over framebuffer with CPU,
+ * so background stays visible. Mask buffer has @ref ILI9341_PROP_MAX_PIXELS bytes,
+ * increase it in defines.h file if you use bigger characters:
+ *
+@verbatim
+//Maximal number of pixels in one character of proportional font
+#define ILI9341_PROP_MAX_PIXELS    (64 * 64)
+@endverbatim
+ *
+ * \par Double and triple buffering
+ *
+ * Layer 1 can use more than one framebuffer. Drawing is always done to back buffer, which is not displayed.
+ * When frame is ready, @ref TM_ILI9341_SwapBuffers sets back buffer as layer 1 start address.
+ * LTDC uses new address from next vertical blanking period, so there is no tearing and no memory copy.
+ *
+ *  - With 2 buffers, function waits until swap is done, because old front buffer is next back buffer
+ *  - With 3 buffers, drawing can continue to third buffer immediately
+ *
+ * Buffer 0 is layer 1 memory, buffers 1 and 2 are placed in SDRAM after layer 2.
+ * LTDC line interrupt is used at the beginning of vertical blanking to check swap status and count frames.
+ *
+ * @note     In this mode, LTDC_IRQHandler is defined in this library, so it can not be used together with emWin library
+ *
+@verbatim
+//Number of buffers for layer 1, 1 = single buffer (default), 2 = double buffering, 3 = triple buffering
+#define ILI9341_BUFFERS    3
+@endverbatim
+ *
+ * @ref TM_ILI9341_ChangeLayers function also changes layers in vertical blanking period and waits for it.
+ *
+ * \par Layer pixel formats
+ *
+ * Both layers are RGB565 after initialization. LTDC reads all enabled layers from SDRAM on every frame,
+ * so low colour overlays can use smaller pixel formats to save SDRAM bandwidth for CPU and DMA2D:
+ *
+@verbatim
+Format     Bytes per pixel    Pixel value
+RGB565     2                  Red, green and blue, 5-6-5 bits
+ARGB4444   2                  Alpha, red, green and blue, 4 bits each
+AL88       2                  Alpha in upper byte, CLUT index in lower byte
+L8         1                  CLUT index
+AL44       1                  Alpha in upper 4 bits, CLUT index in lower 4 bits
+@endverbatim
+ *
+ * Format is changed with @ref TM_ILI9341_SetLayer1Format or @ref TM_ILI9341_SetLayer2Format and
+ * colour lookup table for L8, AL88 and AL44 formats is loaded with @ref TM_ILI9341_SetLayer1CLUT or @ref TM_ILI9341_SetLayer2CLUT.
+ * Colour parameter of drawing functions is then raw pixel value in layer format.
+ *
+ * Two RGB565 layers need 307200 bytes per frame. With L8 or AL44 overlay on layer 2, this is 230400 bytes per frame.
+ * @ref TM_ILI9341_CalculateBandwidth calculates number of bytes LTDC reads per second from current LTDC and clock configuration.
+ * This is theoretical value, it is not measured. FIFO refills, SDRAM refresh and row changes and accesses of CPU and DMA2D are not included.
+ * With default settings (12 MHz pixel clock, 280 x 328 clocks per frame, 130.7 frames per second) function returns:
+ *
+@verbatim
+Layer 1    Layer 2    Bytes per frame    Bytes per second
+RGB565     RGB565     307200             40139372
+RGB565     L8         230400             30104529
+@endverbatim
+ *
+ * Drawing in each format:
+ *  - Pixels, lines, fills and filled shapes work in all formats. In 8-bit formats, filled shapes are drawn line by line with CPU
+ *    and whole layer is filled with DMA2D using 2 pixels per 16-bit DMA2D pixel
+ *  - Characters are drawn with DMA2D and glyph cache only in RGB565 format, other formats use per pixel path
+ *  - Anti-aliased shapes need RGB565 format. In other formats, lines and circles are drawn without anti-aliasing,
+ *    pixels of proportional fonts are drawn where alpha is at least 50 % and arcs are not drawn
+ *  - @ref TM_ILI9341_GetTarget describes 16-bit framebuffer, do not use it with libraries like @ref TM_QOI when layer is in 8-bit format
+ *
+@verbatim
+//Palette overlay on layer 2
+const uint32_t Palette[4] = {0x000000, 0xFF0000, 0x00FF00, 0xFFFFFF};
+
+TM_ILI9341_SetLayer2Format(TM_ILI9341_Format_AL44);
+TM_ILI9341_SetLayer2CLUT(Palette, 4);
+TM_ILI9341_SetLayer2();
+TM_ILI9341_Fill(0x00);                                   //Fully transparent
+TM_ILI9341_DrawFilledRectangle(10, 10, 100, 40, 0x81);   //Half transparent red
+TM_ILI9341_Puts(15, 20, "Overlay", &TM_Font_7x10, 0xF3, 0x81);
+TM_ILI9341_SetLayer2Opacity(255);
 @endverbatim
  *
  * \par Changelog
  *
 @verbatim
+ Version 1.12
+  - October 19, 2026
+  - Added L8, AL44, AL88 and ARGB4444 layer formats with colour lookup tables
+  - Added TM_ILI9341_CalculateBandwidth() function
+  - Added ILI9341_SDRAM_END define
+  - TM_ILI9341_Fill() uses DMA2D
+
+ Version 1.11
+  - Added TM_ILI9341_GetTarget function for libraries which draw directly to framebuffer, like TM QOI
+
+ Version 1.10
+  - Added anti-aliased lines, thick lines, circles and arcs with TM AA library
+  - Added proportional fonts with TM_ILI9341_PutsProp() function
+
+ Version 1.9
+  - Characters are put to DMA2D command queue of TM DMA2D GRAPHIC library
+
+ Version 1.8
+  - Filled rectangles, circles and rounded rectangles are drawn with TM SPAN rasterizer
+
+ Version 1.7
+  - Added double and triple buffering for layer 1 with TM_ILI9341_SwapBuffers() function
+  - TM_ILI9341_ChangeLayers() changes layers in vertical blanking period to prevent tearing
+
+ Version 1.6
+  - Characters are taken from glyph cache in SDRAM, opaque characters are drawn with one DMA2D copy
+
+ Version 1.5
+  - Characters are drawn with DMA2D using A8 alpha masks and blending, also with transparent background
+
  Version 1.4
   - March 14, 2015
   - Added support for new GPIO system
@@ -94,6 +226,11 @@ PA12 <-> R5    | PB10 <-> G4 |                |             |                 |
  - TM FONTS
  - TM SDRAM
  - TM GPIO
+ - TM DMA2D GRAPHIC
+ - TM FONTS CACHE
+ - TM SPAN
+ - TM AA
+ - string.h
 @endverbatim
  */
 #include "stm32f4xx.h"
@@ -105,6 +242,8 @@ PA12 <-> R5    | PB10 <-> G4 |                |             |                 |
 #include "tm_stm32f4_fonts.h"
 #include "tm_stm32f4_sdram.h"
 #include "tm_stm32f4_gpio.h"
+#include "tm_stm32f4_span.h"
+#include "string.h"
 
 /**
  * @defgroup TM_ILI9341_LTDC_Macros
@@ -160,6 +299,47 @@ PA12 <-> R5    | PB10 <-> G4 |                |             |                 |
  */
 #define ILI9341_TRANSPARENT			0x80000000
 
+/**
+ * @brief  Number of buffers for layer 1, 1 = single buffer, 2 = double buffering, 3 = triple buffering
+ */
+#ifndef ILI9341_BUFFERS
+#define ILI9341_BUFFERS				1
+#endif
+
+/**
+ * @brief  First SDRAM address after LCD memory: layer 1, layer 2 and back buffers of layer 1
+ * @note   Use it to place other buffers in SDRAM
+ */
+#define ILI9341_SDRAM_END			(SDRAM_START_ADR + ((uint32_t)ILI9341_BUFFERS + 1) * 240 * 320 * 2)
+
+/**
+ * @brief  NVIC priority for LTDC line interrupt, used with more than one buffer
+ */
+#ifndef ILI9341_NVIC_PRIORITY
+#define ILI9341_NVIC_PRIORITY		0x05
+#endif
+
+/**
+ * @brief  NVIC subpriority for LTDC line interrupt, used with more than one buffer
+ */
+#ifndef ILI9341_NVIC_SUBPRIORITY
+#define ILI9341_NVIC_SUBPRIORITY	0x00
+#endif
+
+/**
+ * @brief  Enable (1) or disable (0) DMA2D for drawing characters
+ */
+#ifndef ILI9341_DMA2D_TEXT
+#define ILI9341_DMA2D_TEXT			1
+#endif
+
+/**
+ * @brief  Maximal number of pixels in one character of proportional font, Width * Height of bitmap
+ */
+#ifndef ILI9341_PROP_MAX_PIXELS
+#define ILI9341_PROP_MAX_PIXELS		(64 * 64)
+#endif
+
 /**
  * @}
  */
@@ -180,6 +360,17 @@ typedef enum {
 	TM_ILI9341_Orientation_Landscape_2  /*!< Landscape orientation mode 2 */
 } TM_ILI9341_Orientation_t;
 
+/**
+ * @brief  Layer pixel formats
+ */
+typedef enum {
+	TM_ILI9341_Format_RGB565 = LTDC_Pixelformat_RGB565,     /*!< 16-bit RGB565 pixels, default */
+	TM_ILI9341_Format_ARGB4444 = LTDC_Pixelformat_ARGB4444, /*!< 16-bit pixels with 4-bit alpha */
+	TM_ILI9341_Format_AL88 = LTDC_Pixelformat_AL88,         /*!< 8-bit alpha and 8-bit CLUT index */
+	TM_ILI9341_Format_L8 = LTDC_Pixelformat_L8,             /*!< 8-bit CLUT index */
+	TM_ILI9341_Format_AL44 = LTDC_Pixelformat_AL44          /*!< 4-bit alpha and 4-bit CLUT index */
+} TM_ILI9341_Format_t;
+
 /**
  * @}
  */
@@ -254,6 +445,36 @@ void TM_ILI9341_Puts(uint16_t x, uint16_t y, char* str, TM_FontDef_t *font, uint
  */
 void TM_ILI9341_GetStringSize(char* str, TM_FontDef_t* font, uint16_t* width, uint16_t* height);
 
+/**
+ * @brief  Puts string with proportional font to LCD, background is not changed
+ * @param  x: X position of top left corner of first character
+ * @param  y: Y position of top left corner of first character
+ * @param  *str: Pointer to first character
+ * @param  *font: Pointer to @ref TM_FONTS_PropFont_t used font
+ * @param  foreground: Color for characters
+ * @retval None
+ */
+void TM_ILI9341_PutsProp(int16_t x, int16_t y, char* str, const TM_FONTS_PropFont_t* font, uint32_t foreground);
+
+/**
+ * @brief  Gets width and height of string with proportional font
+ * @note   Only advance table and kerning pairs of font are used
+ * @param  *str: Pointer to first character
+ * @param  *font: Pointer to @ref TM_FONTS_PropFont_t used font
+ * @param  *width: Pointer to variable to store width
+ * @param  *height: Pointer to variable to store height
+ * @retval None
+ */
+void TM_ILI9341_GetPropStringSize(char* str, const TM_FONTS_PropFont_t* font, uint16_t* width, uint16_t* height);
+
+/**
+ * @brief  Gets framebuffer description of currently active layer and orientation
+ * @note   Use it with libraries which draw directly to framebuffer, for example @ref TM_QOI
+ * @param  *Target: Pointer to @ref TM_SPAN_Target_t structure to be filled
+ * @retval None
+ */
+void TM_ILI9341_GetTarget(TM_SPAN_Target_t* Target);
+
 /**
  * @brief  Draws line to LCD
  * @param  x0: X coordinate of starting point
@@ -331,6 +552,62 @@ void TM_ILI9341_DrawCircle(int16_t x0, int16_t y0, int16_t r, uint32_t color);
  */
 void TM_ILI9341_DrawFilledCircle(int16_t x0, int16_t y0, int16_t r, uint32_t color);
 
+/**
+ * @brief  Draws anti-aliased line on LCD
+ * @param  x0: Line X start point
+ * @param  y0: Line Y start point
+ * @param  x1: Line X end point
+ * @param  y1: Line Y end point
+ * @param  color: Line color
+ * @retval None
+ */
+void TM_ILI9341_DrawLineAA(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint32_t color);
+
+/**
+ * @brief  Draws anti-aliased line with width and round caps on LCD
+ * @param  x0: Line X start point
+ * @param  y0: Line Y start point
+ * @param  x1: Line X end point
+ * @param  y1: Line Y end point
+ * @param  width: Line width in units of pixels
+ * @param  color: Line color
+ * @retval None
+ */
+void TM_ILI9341_DrawThickLineAA(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint8_t width, uint32_t color);
+
+/**
+ * @brief  Draws anti-aliased circle on LCD
+ * @param  x0: X coordinate of center circle point
+ * @param  y0: Y coordinate of center circle point
+ * @param  r: Circle radius
+ * @param  color: Circle color
+ * @retval None
+ */
+void TM_ILI9341_DrawCircleAA(int16_t x0, int16_t y0, int16_t r, uint32_t color);
+
+/**
+ * @brief  Draws filled circle with anti-aliased edge on LCD
+ * @param  x0: X coordinate of center circle point
+ * @param  y0: Y coordinate of center circle point
+ * @param  r: Circle radius
+ * @param  color: Circle color
+ * @retval None
+ */
+void TM_ILI9341_DrawFilledCircleAA(int16_t x0, int16_t y0, int16_t r, uint32_t color);
+
+/**
+ * @brief  Draws anti-aliased arc on LCD
+ * @param  x0: X coordinate of center point
+ * @param  y0: Y coordinate of center point
+ * @param  r: Radius of arc middle line
+ * @param  width: Arc width in units of pixels
+ * @param  start: Start angle in degrees, 0 is on the right side and angles go clockwise
+ * @param  end: End angle in degrees. If it is equal to start, full ring is drawn
+ * @param  color: Arc color
+ * @retval None
+ */
+void TM_ILI9341_DrawArcAA(int16_t x0, int16_t y0, int16_t r, uint8_t width, uint16_t start, uint16_t end, uint32_t color);
+
 /**
  * @brief  Sets layer 2 to currently active layer
  * @param  None
@@ -359,15 +636,84 @@ void TM_ILI9341_SetLayer1Opacity(uint8_t opacity);
  */
 void TM_ILI9341_SetLayer2Opacity(uint8_t opacity);
 
+/**
+ * @brief  Sets pixel format of layer 1
+ * @note   Layer content is not converted, fill it again after format change
+ * @note   Function waits for vertical blanking, so there is no tearing
+ * @param  format: Pixel format. This parameter can be a value of @ref TM_ILI9341_Format_t enumeration
+ * @retval None
+ */
+void TM_ILI9341_SetLayer1Format(TM_ILI9341_Format_t format);
+
+/**
+ * @brief  Sets pixel format of layer 2
+ * @note   Layer content is not converted, fill it again after format change
+ * @note   Function waits for vertical blanking, so there is no tearing
+ * @param  format: Pixel format. This parameter can be a value of @ref TM_ILI9341_Format_t enumeration
+ * @retval None
+ */
+void TM_ILI9341_SetLayer2Format(TM_ILI9341_Format_t format);
+
+/**
+ * @brief  Loads colour lookup table of layer 1, used with L8, AL44 and AL88 formats
+ * @param  *CLUT: Pointer to colours in RGB888 format, upper 8 bits are ignored
+ * @param  count: Number of colours, 1 to 256. AL44 format uses only first 16 colours
+ * @retval None
+ */
+void TM_ILI9341_SetLayer1CLUT(const uint32_t* CLUT, uint16_t count);
+
+/**
+ * @brief  Loads colour lookup table of layer 2, used with L8, AL44 and AL88 formats
+ * @param  *CLUT: Pointer to colours in RGB888 format, upper 8 bits are ignored
+ * @param  count: Number of colours, 1 to 256. AL44 format uses only first 16 colours
+ * @retval None
+ */
+void TM_ILI9341_SetLayer2CLUT(const uint32_t* CLUT, uint16_t count);
+
+/**
+ * @brief  Calculates number of bytes LTDC reads from SDRAM per second
+ * @note   Value is theoretical, calculated from enabled layers, their formats, pixel clock and LCD timings
+ * @param  None
+ * @retval Number of bytes per second
+ */
+uint32_t TM_ILI9341_CalculateBandwidth(void);
+
 /**
  * @brief  This changes current active layer
  *         It sets transparency to 0 and 255 depends on which layer is selected
  
  * @note   If current layer is Layer 1, then now will be Layer 2 and vice versa
+ * @note   Layers are changed in vertical blanking period and function waits for it, maximal one frame
  * @retval None
  */
 void TM_ILI9341_ChangeLayers(void);
 
+/**
+ * @brief  Shows layer 1 back buffer on LCD and continues drawing to next buffer
+ * @note   Function does nothing if @ref ILI9341_BUFFERS is 1
+ * @note   With 2 buffers, function always waits until swap is done
+ * @param  wait: Set to 1 to wait until new buffer is displayed, or 0 to return immediately
+ * @retval None
+ */
+void TM_ILI9341_SwapBuffers(uint8_t wait);
+
+/**
+ * @brief  Checks if buffer swap is still waiting for vertical blanking
+ * @param  None
+ * @retval Swap status:
+ *            - 0: New buffer is displayed
+ *            - > 0: Swap is pending
+ */
+uint8_t TM_ILI9341_IsSwapPending(void);
+
+/**
+ * @brief  Gets number of frames sent to LCD since initialization
+ * @note   Frames are counted in LTDC line interrupt, only if @ref ILI9341_BUFFERS is greater than 1
+ * @param  None
+ * @retval Number of frames
+ */
+uint32_t TM_ILI9341_GetFrameCount(void);
+
 /**
  * @brief  Copies content of layer 2 to layer 1
  * @note   It will do a memory copy from layer 2 to layer 1
@@ -23,6 +23,14 @@ static void TM_LCD_INT_InitLTDC(void);
 static void TM_LCD_INT_InitLayers(void);
 static void TM_LCD_INT_InitLCD(void);
 static void TM_LCD_INT_InitPins(void);
+static TM_LCD_Result_t TM_LCD_INT_SetFormat(LTDC_Layer_TypeDef* LTDC_Layerx, TM_LCD_Format_t format);
+static TM_LCD_Result_t TM_LCD_INT_SetCLUT(LTDC_Layer_TypeDef* LTDC_Layerx, const uint32_t* CLUT, uint16_t count);
+
+/* Number of bytes per pixel for layer format */
+#define LCD_PIXEL_SIZE(format)      (((format) == TM_LCD_Format_L8 || (format) == TM_LCD_Format_AL44) ? 1 : 2)
+
+/* Check if DMA2D can draw to current layer */
+#define LCD_CHECK_DMA2D()           if (LCD.PixelSize == 1) { return TM_LCD_Result_Error; }
 
 /* Private structure */
 typedef struct _TM_LCD_INT_t {
@@ -37,6 +45,8 @@ typedef struct _TM_LCD_INT_t {
 	uint32_t BackgroundColor;
 	uint16_t CurrentX;
 	uint16_t CurrentY;
+	TM_LCD_Format_t LayerFormat[2];
+	uint8_t PixelSize;
 } TM_LCD_INT_t;
 static TM_LCD_INT_t LCD;
 
@@ -58,6 +68,9 @@ TM_LCD_Result_t TM_LCD_Init(void) {
 	LCD.CurrentFont = &TM_Font_11x18;
 	LCD.ForegroundColor = 0x0000;
 	LCD.BackgroundColor = 0xFFFF;
+	LCD.LayerFormat[0] = TM_LCD_Format_RGB565;
+	LCD.LayerFormat[1] = TM_LCD_Format_RGB565;
+	LCD.PixelSize = 2;
 	
 	/* Set configrations for DMA2D */
 	DMA2DConf.BufferStart = LCD_FRAME_BUFFER;
@@ -95,6 +108,15 @@ TM_LCD_Result_t TM_LCD_Init(void) {
 }
 
 TM_LCD_Result_t TM_LCD_Fill(uint32_t color) {
+	/* 8-bit layer, fill 2 pixels in one 16-bit DMA2D pixel */
+	if (LCD.PixelSize == 1) {
+		TM_DMA2DGRAPHIC_FillBufferIT((void *)LCD.CurrentFrameBuffer, LCD.Width / 2, LCD.Height, 0, (color & 0xFF) * 0x0101);
+		DMA2D_WAIT;
+		
+		/* Return OK */
+		return TM_LCD_Result_Ok;
+	}
+	
 	/* Erase memory */
 	TM_DMA2DGRAPHIC_Fill(color);
 	
@@ -150,13 +172,14 @@ TM_LCD_Result_t TM_LCD_SetColors(uint32_t Foreground, uint32_t Background) {
 }
 
 TM_LCD_Result_t TM_LCD_Putc(char c) {
+	TM_FONTS_CACHE_Glyph_t glyph;
 	uint32_t i, b, j;
 	
 	/* Check current coordinates */
 	if ((LCD.CurrentX + LCD.CurrentFont->FontWidth) >= LCD.Width) {
 		/* If at the end of a line of display, go to new line and set x to 0 position */
 		LCD.CurrentY += LCD.CurrentFont->FontHeight;
-		LCD.CurrentY = 0;
+		LCD.CurrentX = 0;
 		
 		/* Check for Y position */
 		if (LCD.CurrentY >= LCD.Height) {
@@ -165,6 +188,27 @@ TM_LCD_Result_t TM_LCD_Putc(char c) {
 		}
 	}
 	
+	/* Get prepared glyph from cache and copy it with DMA2D */
+	if (
+		LCD.LayerFormat[LCD.CurrentLayer] == TM_LCD_Format_RGB565 &&
+		(LCD.CurrentX + LCD.CurrentFont->FontWidth) <= LCD.Width &&
+		(LCD.CurrentY + LCD.CurrentFont->FontHeight) <= LCD.Height &&
+		TM_FONTS_CACHE_Get(&glyph, LCD.CurrentFont, c, TM_FONTS_CACHE_Format_RGB565, TM_FONTS_CACHE_Rotate_0, LCD.ForegroundColor, LCD.BackgroundColor) == 0
+	) {
+		TM_DMA2DGRAPHIC_CopyBuffer(
+			glyph.Data,
+			(void *)(LCD.CurrentFrameBuffer + 2 * (LCD.CurrentY * LCD.Width + LCD.CurrentX)),
+			glyph.Width, glyph.Height,
+			0, LCD.Width - glyph.Width
+		);
+		
+		/* Go to new X location */
+		TM_LCD_SetXY(LCD.CurrentX + LCD.CurrentFont->FontWidth, LCD.CurrentY);
+		
+		/* Return OK */
+		return TM_LCD_Result_Ok;
+	}
+	
 	/* Draw all pixels */
 	for (i = 0; i < LCD.CurrentFont->FontHeight; i++) {
 		b = LCD.CurrentFont->data[(c - 32) * LCD.CurrentFont->FontHeight + i];
@@ -186,7 +230,11 @@ TM_LCD_Result_t TM_LCD_Putc(char c) {
 
 TM_LCD_Result_t TM_LCD_DrawPixel(uint16_t X, uint16_t Y, uint32_t color) {
 	/* Draw pixel at desired location */
-	*(__IO uint16_t *) (LCD.CurrentFrameBuffer + 2 * ((Y * LCD.Width) + X)) = color;
+	if (LCD.PixelSize == 1) {
+		*(__IO uint8_t *) (LCD.CurrentFrameBuffer + (Y * LCD.Width) + X) = color;
+	} else {
+		*(__IO uint16_t *) (LCD.CurrentFrameBuffer + 2 * ((Y * LCD.Width) + X)) = color;
+	}
 	
 	/* Return OK */
 	return TM_LCD_Result_Ok;
@@ -194,6 +242,9 @@ TM_LCD_Result_t TM_LCD_DrawPixel(uint16_t X, uint16_t Y, uint32_t color) {
 
 uint32_t TM_LCD_GetPixel(uint16_t X, uint16_t Y) {
 	/* Get pixel at desired location */
+	if (LCD.PixelSize == 1) {
+		return *(__IO uint8_t *) (LCD.CurrentFrameBuffer + (Y * LCD.Width) + X);
+	}
 	return *(__IO uint16_t *) (LCD.CurrentFrameBuffer + 2 * ((Y * LCD.Width) + X));
 }
 
@@ -218,6 +269,7 @@ TM_LCD_Result_t TM_LCD_SetLayer1(void) {
 	/* Fill settings */
 	LCD.CurrentFrameBuffer = LCD.FrameStart;
 	LCD.CurrentLayer = 0;
+	LCD.PixelSize = LCD_PIXEL_SIZE(LCD.LayerFormat[0]);
 	
 	/* Set layer for DMA2D also */
 	//TM_DMA2DGRAPHIC_SetLayer(LCD.CurrentLayer + 1);
@@ -231,6 +283,7 @@ TM_LCD_Result_t TM_LCD_SetLayer2(void) {
 	/* Fill settings */
 	LCD.CurrentFrameBuffer = LCD.FrameStart + LCD.FrameOffset;
 	LCD.CurrentLayer = 1;
+	LCD.PixelSize = LCD_PIXEL_SIZE(LCD.LayerFormat[1]);
 	
 	/* Set layer for DMA2D also */
 	//TM_DMA2DGRAPHIC_SetLayer(LCD.CurrentLayer + 1);
@@ -265,14 +318,20 @@ TM_LCD_Result_t TM_LCD_ChangeLayers(void) {
 	/* Change layers */
 	if (LCD.CurrentLayer == 0) {
 		TM_LCD_SetLayer2();
-		TM_LCD_SetLayer1Opacity(0);
-		TM_LCD_SetLayer2Opacity(255);
+		LTDC_Layer1->CACR = 0;
+		LTDC_Layer2->CACR = 255;
 	} else {
 		TM_LCD_SetLayer1();
-		TM_LCD_SetLayer1Opacity(255);
-		TM_LCD_SetLayer2Opacity(0);
+		LTDC_Layer1->CACR = 255;
+		LTDC_Layer2->CACR = 0;
 	}
 	
+	/* Reload in vertical blanking to prevent tearing */
+	LTDC->SRCR = LTDC_SRCR_VBR;
+	
+	/* Wait till new values are used */
+	while (LTDC->SRCR & LTDC_SRCR_VBR);
+	
 	/* Return OK */
 	return TM_LCD_Result_Ok;
 }
@@ -308,6 +367,9 @@ TM_LCD_Result_t TM_LCD_Layer1To2(void) {
 }
 
 TM_LCD_Result_t TM_LCD_DrawLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint32_t color) {
+	/* DMA2D can not draw 8-bit pixels */
+	LCD_CHECK_DMA2D();
+	
 	/* Draw line with DMA2D */
 	TM_DMA2DGRAPHIC_DrawLine(x0, y0, x1, y1, color);
 	
@@ -317,6 +379,9 @@ TM_LCD_Result_t TM_LCD_DrawLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t
 
 
 TM_LCD_Result_t TM_LCD_DrawRectangle(uint16_t x0, uint16_t y0, uint16_t Width, uint16_t Height, uint32_t color) {
+	/* DMA2D can not draw 8-bit pixels */
+	LCD_CHECK_DMA2D();
+	
 	/* Use DMA2D for drawing */
 	TM_DMA2DGRAPHIC_DrawRectangle(x0, y0, Width, Height, color);
 	
@@ -325,6 +390,9 @@ TM_LCD_Result_t TM_LCD_DrawRectangle(uint16_t x0, uint16_t y0, uint16_t Width, u
 }
 
 TM_LCD_Result_t TM_LCD_DrawRoundedRectangle(uint16_t x0, uint16_t y0, uint16_t Width, uint16_t Height, uint16_t r, uint32_t color) {
+	/* DMA2D can not draw 8-bit pixels */
+	LCD_CHECK_DMA2D();
+	
 	/* Check input parameters */
 	if ((x0 + Width) > LCD.Width || (y0 + Height) > LCD.Height) {
 		/* Return error */
@@ -339,6 +407,9 @@ TM_LCD_Result_t TM_LCD_DrawRoundedRectangle(uint16_t x0, uint16_t y0, uint16_t W
 }
 
 TM_LCD_Result_t TM_LCD_DrawFilledRoundedRectangle(uint16_t x0, uint16_t y0, uint16_t Width, uint16_t Height, uint16_t r, uint32_t color) {
+	/* DMA2D can not draw 8-bit pixels */
+	LCD_CHECK_DMA2D();
+	
 	/* Check input parameters */
 	TM_DMA2DGRAPHIC_DrawFilledRoundedRectangle(x0, y0, Width, Height, r, color);
 	
@@ -347,6 +418,9 @@ TM_LCD_Result_t TM_LCD_DrawFilledRoundedRectangle(uint16_t x0, uint16_t y0, uint
 }
 
 TM_LCD_Result_t TM_LCD_DrawFilledRectangle(uint16_t x0, uint16_t y0, uint16_t Width, uint16_t Height, uint32_t color) {
+	/* DMA2D can not draw 8-bit pixels */
+	LCD_CHECK_DMA2D();
+	
 	/* Draw with DMA2D */
 	TM_DMA2DGRAPHIC_DrawFilledRectangle(x0, y0, Width, Height, color);
 	
@@ -355,6 +429,9 @@ TM_LCD_Result_t TM_LCD_DrawFilledRectangle(uint16_t x0, uint16_t y0, uint16_t Wi
 }
 
 TM_LCD_Result_t TM_LCD_DrawCircle(int16_t x0, int16_t y0, int16_t r, uint32_t color) {
+	/* DMA2D can not draw 8-bit pixels */
+	LCD_CHECK_DMA2D();
+	
 	/* Use DMA2D */
 	TM_DMA2DGRAPHIC_DrawCircle(x0, y0, r, color);
 	
@@ -363,6 +440,9 @@ TM_LCD_Result_t TM_LCD_DrawCircle(int16_t x0, int16_t y0, int16_t r, uint32_t co
 }
 
 TM_LCD_Result_t TM_LCD_DrawFilledCircle(int16_t x0, int16_t y0, int16_t r, uint32_t color) {
+	/* DMA2D can not draw 8-bit pixels */
+	LCD_CHECK_DMA2D();
+	
 	/* Use DMA2D */
 	TM_DMA2DGRAPHIC_DrawFilledCircle(x0, y0, r, color);
 	
@@ -383,7 +463,93 @@ uint32_t TM_LCD_GetFrameBuffer(void) {
 	return LCD.FrameStart;
 }
 
+TM_LCD_Result_t TM_LCD_SetLayer1Format(TM_LCD_Format_t format) {
+	LCD.LayerFormat[0] = format;
+	return TM_LCD_INT_SetFormat(LTDC_Layer1, format);
+}
+
+TM_LCD_Result_t TM_LCD_SetLayer2Format(TM_LCD_Format_t format) {
+	LCD.LayerFormat[1] = format;
+	return TM_LCD_INT_SetFormat(LTDC_Layer2, format);
+}
+
+TM_LCD_Result_t TM_LCD_SetLayer1CLUT(const uint32_t* CLUT, uint16_t count) {
+	return TM_LCD_INT_SetCLUT(LTDC_Layer1, CLUT, count);
+}
+
+TM_LCD_Result_t TM_LCD_SetLayer2CLUT(const uint32_t* CLUT, uint16_t count) {
+	return TM_LCD_INT_SetCLUT(LTDC_Layer2, CLUT, count);
+}
+
+uint32_t TM_LCD_CalculateBandwidth(void) {
+	LTDC_Layer_TypeDef* layers[2] = {LTDC_Layer1, LTDC_Layer2};
+	uint32_t clock, total, bytes = 0;
+	uint8_t i;
+	
+	/* PLLSAI has the same input as main PLL */
+	clock = (RCC->PLLCFGR & RCC_PLLCFGR_PLLSRC) ? HSE_VALUE : HSI_VALUE;
+	clock /= RCC->PLLCFGR & RCC_PLLCFGR_PLLM;
+	
+	/* Pixel clock = input * N / R / DIVR */
+	clock *= (RCC->PLLSAICFGR >> 6) & 0x1FF;
+	clock /= (RCC->PLLSAICFGR >> 28) & 0x07;
+	clock /= 2 << ((RCC->DCKCFGR >> 16) & 0x03);
+	
+	/* Number of pixel clocks in one frame */
+	total = (((LTDC->TWCR >> 16) & 0xFFF) + 1) * ((LTDC->TWCR & 0x7FF) + 1);
+	
+	/* Bytes of enabled layers in one frame, line length register has 3 bytes more than line */
+	for (i = 0; i < 2; i++) {
+		if (layers[i]->CR & LTDC_LxCR_LEN) {
+			bytes += ((layers[i]->CFBLR & 0x1FFF) - 3) * (layers[i]->CFBLNR & 0x7FF);
+		}
+	}
+	
+	/* Bytes per second */
+	return (uint64_t)bytes * clock / total;
+}
+
 /* Private functions */
+static TM_LCD_Result_t TM_LCD_INT_SetFormat(LTDC_Layer_TypeDef* LTDC_Layerx, TM_LCD_Format_t format) {
+	/* Wait for DMA2D, it may still draw in old format */
+	DMA2D_WAIT;
+	
+	/* Set format, line length and pitch are recalculated */
+	LTDC_LayerPixelFormat(LTDC_Layerx, format);
+	
+	/* Use new format in vertical blanking */
+	LTDC->SRCR = LTDC_SRCR_VBR;
+	while (LTDC->SRCR & LTDC_SRCR_VBR);
+	
+	/* Update pixel size of current layer */
+	LCD.PixelSize = LCD_PIXEL_SIZE(LCD.LayerFormat[LCD.CurrentLayer]);
+	
+	/* Return OK */
+	return TM_LCD_Result_Ok;
+}
+
+static TM_LCD_Result_t TM_LCD_INT_SetCLUT(LTDC_Layer_TypeDef* LTDC_Layerx, const uint32_t* CLUT, uint16_t count) {
+	uint16_t i;
+	
+	/* Check count */
+	if (count > 256) {
+		return TM_LCD_Result_Error;
+	}
+	
+	/* Write in vertical synchronization, when LTDC does not read CLUT */
+	while (!(LTDC->CDSR & LTDC_CDSR_VSYNCS));
+	for (i = 0; i < count; i++) {
+		LTDC_Layerx->CLUTWR = ((uint32_t)i << 24) | (CLUT[i] & 0x00FFFFFF);
+	}
+	
+	/* Enable CLUT */
+	LTDC_Layerx->CR |= LTDC_LxCR_CLUTEN;
+	LTDC->SRCR = LTDC_SRCR_IMR;
+	
+	/* Return OK */
+	return TM_LCD_Result_Ok;
+}
+
 static void TM_LCD_INT_InitLTDC(void) {
 	LTDC_InitTypeDef LTDC_InitStruct;
 	
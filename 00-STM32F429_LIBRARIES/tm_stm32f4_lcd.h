@@ -3,7 +3,7 @@
  * @email   tilen@majerle.eu
  * @website http://stm32f4-discovery.net
  * @link    
- * @version v1.0
+ * @version v1.3
  * @ide     Keil uVision
  * @license GNU GPL v3
  * @brief   Library template 
@@ -28,7 +28,7 @@
 @endverbatim
  */
 #ifndef TM_LIBRARY_H
-#define TM_LIBRARY_H 100
+#define TM_LIBRARY_H 130
 
 /* C++ detection */
 #ifdef __cplusplus
@@ -45,9 +45,38 @@ extern "C" {
  * @brief    Library description here
  * @{
  *
+ * \par Layer pixel formats
+ *
+ * Both layers start in RGB565 format. Each layer can be changed to ARGB4444, AL88, L8 or AL44 format
+ * with @ref TM_LCD_SetLayer1Format and @ref TM_LCD_SetLayer2Format. Memory for layers stays the same,
+ * but LTDC reads less data from SDRAM for 8-bit layers. Use @ref TM_LCD_CalculateBandwidth to get bytes LTDC reads per second.
+ * This is theoretical value, it is not measured. FIFO refills, SDRAM refresh and row changes and accesses of CPU and DMA2D are not included.
+ * With 640x480 LCD on STM324x9-EVAL (24 MHz pixel clock, 800 x 525 clocks per frame, 57.1 frames per second) function returns:
+ *
+@verbatim
+Layer 1    Layer 2    Bytes per frame    Bytes per second
+RGB565     RGB565     1228800            70217142
+RGB565     L8         921600             52662857
+@endverbatim
+ *
+ * L8 and AL44 layers need colour lookup table, set with @ref TM_LCD_SetLayer1CLUT or @ref TM_LCD_SetLayer2CLUT.
+ *
+ * In 8-bit formats only pixels and fill work. DMA2D can not write 8-bit pixels, so other drawing functions
+ * return @ref TM_LCD_Result_Error and characters are drawn pixel by pixel.
+ *
  * \par Changelog
  *
 @verbatim
+ Version 1.3
+  - Added L8, AL44, AL88 and ARGB4444 layer formats with colour lookup tables
+  - Added TM_LCD_CalculateBandwidth() function
+
+ Version 1.2
+  - TM_LCD_ChangeLayers() changes layers in vertical blanking period to prevent tearing
+
+ Version 1.1
+  - Characters are copied from glyph cache in SDRAM with DMA2D
+
  Version 1.0
   - First release
 @endverbatim
@@ -69,6 +98,7 @@ extern "C" {
 #include "tm_stm32f4_gpio.h"
 #include "tm_stm32f4_fonts.h"
 #include "tm_stm32f4_dma2d_graphic.h"
+#include "tm_stm32f4_fonts_cache.h"
 
 /**
  * @defgroup TM_LCD_Macros
@@ -115,6 +145,17 @@ typedef enum _TM_LCD_Result_t {
 	TM_LCD_Result_SDRAM_Error
 } TM_LCD_Result_t;
 
+/**
+ * @brief  Layer pixel formats
+ */
+typedef enum _TM_LCD_Format_t {
+	TM_LCD_Format_RGB565 = LTDC_Pixelformat_RGB565,     /*!< 16-bit colour, default format */
+	TM_LCD_Format_ARGB4444 = LTDC_Pixelformat_ARGB4444, /*!< 16-bit colour with 4-bit alpha */
+	TM_LCD_Format_AL88 = LTDC_Pixelformat_AL88,         /*!< 8-bit alpha and 8-bit index to CLUT */
+	TM_LCD_Format_L8 = LTDC_Pixelformat_L8,             /*!< 8-bit index to CLUT */
+	TM_LCD_Format_AL44 = LTDC_Pixelformat_AL44          /*!< 4-bit alpha and 4-bit index to CLUT */
+} TM_LCD_Format_t;
+
 /**
  * @}
  */
@@ -172,6 +213,11 @@ TM_LCD_Result_t TM_LCD_SetLayer2Opacity(uint8_t opacity);
 TM_LCD_Result_t TM_LCD_ChangeLayers(void);
 TM_LCD_Result_t TM_LCD_Layer2To1(void);
 TM_LCD_Result_t TM_LCD_Layer1To2(void);
+TM_LCD_Result_t TM_LCD_SetLayer1Format(TM_LCD_Format_t format);
+TM_LCD_Result_t TM_LCD_SetLayer2Format(TM_LCD_Format_t format);
+TM_LCD_Result_t TM_LCD_SetLayer1CLUT(const uint32_t* CLUT, uint16_t count);
+TM_LCD_Result_t TM_LCD_SetLayer2CLUT(const uint32_t* CLUT, uint16_t count);
+uint32_t TM_LCD_CalculateBandwidth(void);
 
 /**
  * @}
@@ -0,0 +1,370 @@
+/**
+ * |----------------------------------------------------------------------
+ * | Copyright (C) Tilen MAJERLE, 2015
+ * |
+ * | This program is free software: you can redistribute it and/or modify
+ * | it under the terms of the GNU General Public License as published by
+ * | the Free Software Foundation, either version 3 of the License, or
+ * | any later version.
+ * |
+ * | This program is distributed in the hope that it will be useful,
+ * | but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * | GNU General Public License for more details.
+ * |
+ * | You should have received a copy of the GNU General Public License
+ * | along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * |----------------------------------------------------------------------
+ */
+#include "tm_stm32f4_mono.h"
+
+/* Number of columns converted at once for characters and sprites */
+#define MONO_COLUMNS          16
+
+/* Byte repeated in all 4 bytes of word */
+#define MONO_WORD(b)          ((uint32_t)(b) * 0x01010101UL)
+
+/* Operation as masks, new = (old & ~((v & AV) | (m & AM))) ^ ((v & BV) ^ (m & BM)), v are foreground pixels, m are all pixels drawn */
+typedef struct {
+	uint32_t AV;
+	uint32_t AM;
+	uint32_t BV;
+	uint32_t BM;
+} TM_MONO_INT_Op_t;
+
+static const TM_MONO_INT_Op_t TM_MONO_INT_Ops[] = {
+	{0xFFFFFFFF, 0x00000000, 0xFFFFFFFF, 0x00000000}, /* Set */
+	{0xFFFFFFFF, 0x00000000, 0x00000000, 0x00000000}, /* Clear */
+	{0x00000000, 0x00000000, 0xFFFFFFFF, 0x00000000}, /* Xor */
+	{0x00000000, 0xFFFFFFFF, 0xFFFFFFFF, 0x00000000}, /* Copy */
+	{0x00000000, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF}  /* Copy inverted */
+};
+
+/* Private functions */
+static void TM_INT_MONO_Run(const TM_MONO_t* Mono, uint16_t page, uint16_t x, uint16_t count, uint8_t a, uint8_t b);
+static void TM_INT_MONO_Columns(const TM_MONO_t* Mono, int16_t x, int16_t y, uint8_t height, const uint32_t* cols, const uint32_t* masks, uint8_t count, TM_MONO_Op_t op);
+static void TM_INT_MONO_ChangedAll(const TM_MONO_t* Mono);
+
+void TM_MONO_Fill(const TM_MONO_t* Mono, uint8_t value) {
+	/* Set memory */
+	memset(Mono->Buffer, value ? 0xFF : 0x00, Mono->Width * (Mono->Height / 8));
+
+	/* All pixels changed */
+	TM_INT_MONO_ChangedAll(Mono);
+}
+
+void TM_MONO_Invert(const TM_MONO_t* Mono) {
+	uint16_t page;
+
+	/* Toggle all bits, page by page */
+	for (page = 0; page < Mono->Height / 8; page++) {
+		TM_INT_MONO_Run(Mono, page, 0, Mono->Width, 0xFF, 0xFF);
+	}
+}
+
+void TM_MONO_FillRectangle(const TM_MONO_t* Mono, int16_t x, int16_t y, uint16_t width, uint16_t height, TM_MONO_Op_t op) {
+	int32_t x0, y0, x1, y1;
+	uint16_t page;
+	uint8_t m;
+	const TM_MONO_INT_Op_t* o = &TM_MONO_INT_Ops[op];
+
+	/* Clip rectangle to buffer */
+	x0 = (x < 0) ? 0 : x;
+	y0 = (y < 0) ? 0 : y;
+	x1 = ((int32_t)x + width > Mono->Width) ? Mono->Width : ((int32_t)x + width);
+	y1 = ((int32_t)y + height > Mono->Height) ? Mono->Height : ((int32_t)y + height);
+	if (x0 >= x1 || y0 >= y1) {
+		return;
+	}
+
+	/* Go through pages */
+	for (page = y0 / 8; page <= (y1 - 1) / 8; page++) {
+		/* Rows of rectangle on this page */
+		m = 0xFF;
+		if (y0 > page * 8) {
+			m &= 0xFF << (y0 - page * 8);
+		}
+		if (y1 < (page + 1) * 8) {
+			m &= 0xFF >> ((page + 1) * 8 - y1);
+		}
+
+		/* All pixels are foreground */
+		TM_INT_MONO_Run(Mono, page, x0, x1 - x0, ~((m & o->AV) | (m & o->AM)), (m & o->BV) ^ (m & o->BM));
+	}
+}
+
+void TM_MONO_DrawSprite(const TM_MONO_t* Mono, int16_t x, int16_t y, const uint8_t* data, const uint8_t* mask, uint16_t width, uint16_t height, TM_MONO_Op_t op) {
+	uint32_t cols[MONO_COLUMNS], masks[MONO_COLUMNS];
+	uint16_t row, col, i, k, pages;
+	uint8_t count, rows;
+
+	/* Go through strips of 32 rows */
+	for (row = 0; row < height; row += 32) {
+		rows = (height - row) > 32 ? 32 : (height - row);
+		pages = (rows + 7) / 8;
+
+		/* Convert columns to words, a few at a time */
+		for (col = 0; col < width; col += MONO_COLUMNS) {
+			count = (width - col) > MONO_COLUMNS ? MONO_COLUMNS : (width - col);
+			for (i = 0; i < count; i++) {
+				cols[i] = 0;
+				masks[i] = 0;
+				for (k = 0; k < pages; k++) {
+					cols[i] |= (uint32_t)data[(row / 8 + k) * width + col + i] << (8 * k);
+					if (mask) {
+						masks[i] |= (uint32_t)mask[(row / 8 + k) * width + col + i] << (8 * k);
+					}
+				}
+			}
+
+			/* Draw columns */
+			TM_INT_MONO_Columns(Mono, x + col, y + row, rows, cols, mask ? masks : NULL, count, op);
+		}
+	}
+}
+
+void TM_MONO_Putc(const TM_MONO_t* Mono, int16_t x, int16_t y, char ch, TM_FontDef_t* Font, TM_MONO_Op_t op) {
+	uint32_t cols[MONO_COLUMNS];
+	uint32_t b;
+	uint8_t i, j, count;
+
+	/* Fonts have 16-bit rows */
+	count = Font->FontWidth > MONO_COLUMNS ? MONO_COLUMNS : Font->FontWidth;
+	memset(cols, 0, sizeof(cols));
+
+	/* Convert rows to columns, MSB of row is left pixel */
+	for (i = 0; i < Font->FontHeight; i++) {
+		b = Font->data[(ch - 32) * Font->FontHeight + i];
+		for (j = 0; b; j++, b = (b << 1) & 0xFFFF) {
+			if (b & 0x8000) {
+				cols[j] |= (uint32_t)1 << i;
+			}
+		}
+	}
+
+	/* Draw columns */
+	TM_INT_MONO_Columns(Mono, x, y, Font->FontHeight, cols, NULL, count, op);
+}
+
+int16_t TM_MONO_Puts(const TM_MONO_t* Mono, int16_t x, int16_t y, const char* str, TM_FontDef_t* Font, TM_MONO_Op_t op) {
+	/* Write characters */
+	while (*str) {
+		TM_MONO_Putc(Mono, x, y, *str++, Font, op);
+		x += Font->FontWidth;
+	}
+
+	/* Return position after string */
+	return x;
+}
+
+void TM_MONO_Scroll(const TM_MONO_t* Mono, int16_t dx, int16_t dy) {
+	uint16_t page, col, pages = Mono->Height / 8;
+	uint16_t p = (dy < 0 ? -dy : dy) / 8;
+	uint8_t s = (dy < 0 ? -dy : dy) % 8;
+	uint8_t lo, hi;
+	int32_t q;
+	uint8_t* buf = Mono->Buffer;
+
+	/* Everything moved out */
+	if ((dx < 0 ? -dx : dx) >= Mono->Width || (dy < 0 ? -dy : dy) >= Mono->Height) {
+		TM_MONO_Fill(Mono, 0);
+		return;
+	}
+
+	/* Vertical, whole pages only */
+	if (dy != 0 && s == 0) {
+		if (dy > 0) {
+			memmove(&buf[p * Mono->Width], buf, (pages - p) * Mono->Width);
+			memset(buf, 0x00, p * Mono->Width);
+		} else {
+			memmove(buf, &buf[p * Mono->Width], (pages - p) * Mono->Width);
+			memset(&buf[(pages - p) * Mono->Width], 0x00, p * Mono->Width);
+		}
+	} else if (dy > 0) {
+		/* Down, bottom page first, so sources above are not overwritten yet */
+		for (page = pages; page-- > 0; ) {
+			q = (int32_t)page - p;
+			for (col = 0; col < Mono->Width; col++) {
+				hi = (q >= 0) ? buf[q * Mono->Width + col] : 0;
+				lo = (q >= 1) ? buf[(q - 1) * Mono->Width + col] : 0;
+				buf[page * Mono->Width + col] = (hi << s) | (lo >> (8 - s));
+			}
+		}
+	} else if (dy < 0) {
+		/* Up, top page first */
+		for (page = 0; page < pages; page++) {
+			q = (int32_t)page + p;
+			for (col = 0; col < Mono->Width; col++) {
+				lo = (q < pages) ? buf[q * Mono->Width + col] : 0;
+				hi = (q + 1 < pages) ? buf[(q + 1) * Mono->Width + col] : 0;
+				buf[page * Mono->Width + col] = (lo >> s) | (hi << (8 - s));
+			}
+		}
+	}
+
+	/* Horizontal, move each page */
+	if (dx > 0) {
+		for (page = 0; page < pages; page++) {
+			memmove(&buf[page * Mono->Width + dx], &buf[page * Mono->Width], Mono->Width - dx);
+			memset(&buf[page * Mono->Width], 0x00, dx);
+		}
+	} else if (dx < 0) {
+		for (page = 0; page < pages; page++) {
+			memmove(&buf[page * Mono->Width], &buf[page * Mono->Width - dx], Mono->Width + dx);
+			memset(&buf[(page + 1) * Mono->Width + dx], 0x00, -dx);
+		}
+	}
+
+	/* All pixels changed */
+	if (dx != 0 || dy != 0) {
+		TM_INT_MONO_ChangedAll(Mono);
+	}
+}
+
+/* Private functions */
+static void TM_INT_MONO_Run(const TM_MONO_t* Mono, uint16_t page, uint16_t x, uint16_t count, uint8_t a, uint8_t b) {
+	uint8_t* row = &Mono->Buffer[page * Mono->Width];
+	uint8_t* ptr = &row[x];
+	uint8_t* end = &row[x + count];
+	uint8_t *first = NULL, *last = NULL;
+	uint32_t aw = MONO_WORD(a), bw = MONO_WORD(b), w, d;
+	uint8_t old;
+
+	/* Single bytes until word boundary */
+	while (ptr < end && ((uintptr_t)ptr & 0x03)) {
+		old = *ptr;
+		*ptr = (old & a) ^ b;
+		if (*ptr != old) {
+			if (!first) {
+				first = ptr;
+			}
+			last = ptr;
+		}
+		ptr++;
+	}
+
+	/* 4 columns at a time */
+	while ((end - ptr) >= 4) {
+		w = *(uint32_t *)ptr;
+		d = ((w & aw) ^ bw) ^ w;
+		if (d) {
+			*(uint32_t *)ptr = w ^ d;
+
+			/* Little endian, lowest byte is left column */
+			if (!first) {
+				first = ptr + ((d & 0x000000FF) ? 0 : (d & 0x0000FFFF) ? 1 : (d & 0x00FFFFFF) ? 2 : 3);
+			}
+			last = ptr + ((d & 0xFF000000) ? 3 : (d & 0x00FF0000) ? 2 : (d & 0x0000FF00) ? 1 : 0);
+		}
+		ptr += 4;
+	}
+
+	/* Remaining bytes */
+	while (ptr < end) {
+		old = *ptr;
+		*ptr = (old & a) ^ b;
+		if (*ptr != old) {
+			if (!first) {
+				first = ptr;
+			}
+			last = ptr;
+		}
+		ptr++;
+	}
+
+	/* Report changed columns */
+	if (first && Mono->Changed) {
+		Mono->Changed(page, first - row, last - row + 1);
+	}
+}
+
+static void TM_INT_MONO_Columns(const TM_MONO_t* Mono, int16_t x, int16_t y, uint8_t height, const uint32_t* cols, const uint32_t* masks, uint8_t count, TM_MONO_Op_t op) {
+	const TM_MONO_INT_Op_t* o = &TM_MONO_INT_Ops[op];
+	uint32_t all, v, m;
+	uint8_t skip = 0, rows, sh, k, pages, old, a, b;
+	int16_t i, start, end, first, last;
+	uint16_t page;
+	uint8_t* row;
+
+	/* Clip top */
+	if (y < 0) {
+		if (-y >= height) {
+			return;
+		}
+		skip = -y;
+		y = 0;
+	}
+	rows = height - skip;
+
+	/* Clip bottom */
+	if (y >= Mono->Height) {
+		return;
+	}
+	if (rows > Mono->Height - y) {
+		rows = Mono->Height - y;
+	}
+	all = (rows >= 32) ? 0xFFFFFFFF : (((uint32_t)1 << rows) - 1);
+
+	/* Clip left and right */
+	start = (x < 0) ? -x : 0;
+	end = ((int32_t)x + count > Mono->Width) ? (Mono->Width - x) : count;
+	if (start >= end) {
+		return;
+	}
+
+	/* Pages covered by columns */
+	sh = y % 8;
+	pages = (sh + rows + 7) / 8;
+	for (k = 0; k < pages; k++) {
+		page = y / 8 + k;
+		row = &Mono->Buffer[page * Mono->Width];
+		first = -1;
+		last = -1;
+
+		for (i = start; i < end; i++) {
+			/* Column shifted to top of drawn area */
+			m = (masks ? (masks[i] >> skip) : 0xFFFFFFFF) & all;
+			v = (cols[i] >> skip) & m;
+
+			/* Part of column on this page */
+			if (k == 0) {
+				m = (uint8_t)(m << sh);
+				v = (uint8_t)(v << sh);
+			} else {
+				m = (uint8_t)(m >> (8 * k - sh));
+				v = (uint8_t)(v >> (8 * k - sh));
+			}
+			if (!m) {
+				continue;
+			}
+
+			/* Write byte */
+			a = ~((v & o->AV) | (m & o->AM));
+			b = (v & o->BV) ^ (m & o->BM);
+			old = row[x + i];
+			row[x + i] = (old & a) ^ b;
+			if (row[x + i] != old) {
+				if (first < 0) {
+					first = i;
+				}
+				last = i;
+			}
+		}
+
+		/* Report changed columns */
+		if (first >= 0 && Mono->Changed) {
+			Mono->Changed(page, x + first, x + last + 1);
+		}
+	}
+}
+
+static void TM_INT_MONO_ChangedAll(const TM_MONO_t* Mono) {
+	uint16_t page;
+
+	/* Report all columns of all pages */
+	if (Mono->Changed) {
+		for (page = 0; page < Mono->Height / 8; page++) {
+			Mono->Changed(page, 0, Mono->Width);
+		}
+	}
+}
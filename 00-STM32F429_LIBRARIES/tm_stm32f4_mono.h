@@ -0,0 +1,248 @@
+/**
+ * @author  Tilen MAJERLE
+ * @email   tilen@majerle.eu
+ * @website http://stm32f4-discovery.net
+ * @link
+ * @version v1.0
+ * @ide     Keil uVision
+ * @license GNU GPL v3
+ * @brief   Drawing engine for monochrome LCD buffers organised in pages, used by SSD1306 and PCD8544 libraries
+ *
+@verbatim
+   ----------------------------------------------------------------------
+    Copyright (C) Tilen MAJERLE, 2015
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+   ----------------------------------------------------------------------
+@endverbatim
+ */
+#ifndef TM_MONO_H
+#define TM_MONO_H 100
+
+/* C++ detection */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup TM_STM32F4xx_Libraries
+ * @{
+ */
+
+/**
+ * @defgroup TM_MONO
+ * @brief    Drawing engine for monochrome LCD buffers organised in pages, used by SSD1306 and PCD8544 libraries
+ * @{
+ *
+ * Monochrome controllers like SSD1306 and PCD8544 keep 8 vertical pixels in one byte.
+ * Byte at index <code>x + (y / 8) * Width</code> holds column x of page y / 8, top pixel in LSB.
+ *
+ * Drawing pixel by pixel needs bounds check and read-modify-write of a byte for every pixel.
+ * This library works with whole bytes and words instead:
+ *  - Rectangles are filled page by page with one mask per page, 4 columns at a time with 32-bit words
+ *  - Characters and sprites are converted to columns first, then each column is shifted to its position
+ *    and written to 1 or more pages with a single mask operation per byte
+ *  - Whole buffer is filled with memset and inverted with 32-bit words
+ *  - Scrolling moves whole pages with memmove and shifts the rest of bits across pages
+ *
+ * Clipping is done once per primitive, so coordinates can be partially or completely outside of buffer.
+ *
+ * Speed against drawing pixel by pixel is measured on computer with the same results checked, see tools/mono_bench folder.
+ *
+ * \par Operations
+ *
+ * Each primitive is drawn with one of @ref TM_MONO_Op_t operations. Foreground are pixels set in character or sprite,
+ * or all pixels of rectangle:
+ *  - @ref TM_MONO_Op_Set, @ref TM_MONO_Op_Clear and @ref TM_MONO_Op_Xor change only foreground, background stays as it is
+ *  - @ref TM_MONO_Op_Copy and @ref TM_MONO_Op_CopyInverted draw foreground and background, like normal and inverted text
+ *
+ * \par Changed areas
+ *
+ * Library compares bytes before and after drawing. For each page with changes, optional Changed callback
+ * in @ref TM_MONO_t structure gets range of columns which really changed. LCD library uses it to send only changed parts of screen.
+ *
+ * \par Sprite format
+ *
+ * Sprites use the same format as LCD buffer, <code>(height + 7) / 8</code> pages of <code>width</code> bytes, top pixel in LSB.
+ * This is "vertical" format of most LCD image converters. Optional mask in the same format selects pixels to draw,
+ * so sprites can have transparent parts.
+ *
+@verbatim
+static void Changed(uint16_t page, uint16_t start, uint16_t end) {
+    //Columns from start to end - 1 on page changed
+}
+
+uint8_t Buffer[128 * 64 / 8];
+TM_MONO_t Mono = {Buffer, 128, 64, Changed};
+
+TM_MONO_FillRectangle(&Mono, 10, 5, 50, 20, TM_MONO_Op_Set);
+TM_MONO_Puts(&Mono, 12, 8, "Hello", &TM_Font_7x10, TM_MONO_Op_Xor);
+TM_MONO_Scroll(&Mono, 0, -3);
+@endverbatim
+ *
+ * \par Changelog
+ *
+@verbatim
+ Version 1.0
+  - First release
+@endverbatim
+ *
+ * \par Dependencies
+ *
+@verbatim
+ - STM32F4xx
+ - defines.h
+ - TM FONTS
+ - string.h
+@endverbatim
+ */
+
+#include "stm32f4xx.h"
+#include "defines.h"
+#include "tm_stm32f4_fonts.h"
+
+#include "string.h"
+
+/**
+ * @defgroup TM_MONO_Typedefs
+ * @brief    Library Typedefs
+ * @{
+ */
+
+/**
+ * @brief  Drawing operations
+ */
+typedef enum {
+	TM_MONO_Op_Set = 0x00,  /*!< Foreground pixels are set, background is not changed */
+	TM_MONO_Op_Clear,       /*!< Foreground pixels are cleared, background is not changed */
+	TM_MONO_Op_Xor,         /*!< Foreground pixels are inverted, background is not changed */
+	TM_MONO_Op_Copy,        /*!< Foreground pixels are set, background pixels are cleared */
+	TM_MONO_Op_CopyInverted /*!< Foreground pixels are cleared, background pixels are set */
+} TM_MONO_Op_t;
+
+/**
+ * @brief  Monochrome buffer description
+ */
+typedef struct {
+	uint8_t* Buffer; /*!< Pointer to buffer, Width * Height / 8 bytes */
+	uint16_t Width;  /*!< Buffer width in units of pixels */
+	uint16_t Height; /*!< Buffer height in units of pixels, must be multiple of 8 */
+	void (*Changed)(uint16_t page, uint16_t start, uint16_t end); /*!< Called with range of changed columns on page, end is not included. Set to NULL if not used */
+} TM_MONO_t;
+
+/**
+ * @}
+ */
+
+/**
+ * @defgroup TM_MONO_Functions
+ * @brief    Library Functions
+ * @{
+ */
+
+/**
+ * @brief  Fills whole buffer
+ * @param  *Mono: Pointer to @ref TM_MONO_t buffer description
+ * @param  value: Set to 0 to clear all pixels or 1 to set all pixels
+ * @retval None
+ */
+void TM_MONO_Fill(const TM_MONO_t* Mono, uint8_t value);
+
+/**
+ * @brief  Inverts all pixels in buffer
+ * @param  *Mono: Pointer to @ref TM_MONO_t buffer description
+ * @retval None
+ */
+void TM_MONO_Invert(const TM_MONO_t* Mono);
+
+/**
+ * @brief  Fills rectangle
+ * @note   Use width or height of 1 for fast horizontal or vertical line
+ * @param  *Mono: Pointer to @ref TM_MONO_t buffer description
+ * @param  x: Left X coordinate, can be negative
+ * @param  y: Top Y coordinate, can be negative
+ * @param  width: Rectangle width in units of pixels
+ * @param  height: Rectangle height in units of pixels
+ * @param  op: Operation, member of @ref TM_MONO_Op_t. Rectangle has no background, so Copy operations are the same as Set and Clear
+ * @retval None
+ */
+void TM_MONO_FillRectangle(const TM_MONO_t* Mono, int16_t x, int16_t y, uint16_t width, uint16_t height, TM_MONO_Op_t op);
+
+/**
+ * @brief  Draws sprite in LCD buffer format
+ * @param  *Mono: Pointer to @ref TM_MONO_t buffer description
+ * @param  x: Left X coordinate, can be negative
+ * @param  y: Top Y coordinate, can be negative
+ * @param  *data: Pointer to sprite data, (height + 7) / 8 pages of width bytes, top pixel in LSB
+ * @param  *mask: Pointer to mask in the same format. Only pixels set in mask are drawn. Set to NULL to draw whole sprite
+ * @param  width: Sprite width in units of pixels
+ * @param  height: Sprite height in units of pixels
+ * @param  op: Operation, member of @ref TM_MONO_Op_t
+ * @retval None
+ */
+void TM_MONO_DrawSprite(const TM_MONO_t* Mono, int16_t x, int16_t y, const uint8_t* data, const uint8_t* mask, uint16_t width, uint16_t height, TM_MONO_Op_t op);
+
+/**
+ * @brief  Draws character with @ref TM_FontDef_t font
+ * @note   Font height must not be more than 32 pixels
+ * @param  *Mono: Pointer to @ref TM_MONO_t buffer description
+ * @param  x: Left X coordinate, can be negative
+ * @param  y: Top Y coordinate, can be negative
+ * @param  ch: Character to draw
+ * @param  *Font: Pointer to @ref TM_FontDef_t font
+ * @param  op: Operation, member of @ref TM_MONO_Op_t
+ * @retval None
+ */
+void TM_MONO_Putc(const TM_MONO_t* Mono, int16_t x, int16_t y, char ch, TM_FontDef_t* Font, TM_MONO_Op_t op);
+
+/**
+ * @brief  Draws string with @ref TM_FontDef_t font in one line
+ * @param  *Mono: Pointer to @ref TM_MONO_t buffer description
+ * @param  x: Left X coordinate, can be negative
+ * @param  y: Top Y coordinate, can be negative
+ * @param  *str: Pointer to string
+ * @param  *Font: Pointer to @ref TM_FontDef_t font
+ * @param  op: Operation, member of @ref TM_MONO_Op_t
+ * @retval X coordinate after last character
+ */
+int16_t TM_MONO_Puts(const TM_MONO_t* Mono, int16_t x, int16_t y, const char* str, TM_FontDef_t* Font, TM_MONO_Op_t op);
+
+/**
+ * @brief  Scrolls whole buffer
+ * @note   Pixels moved out of buffer are lost, uncovered pixels are cleared
+ * @param  *Mono: Pointer to @ref TM_MONO_t buffer description
+ * @param  dx: Number of pixels to move right, negative to move left
+ * @param  dy: Number of pixels to move down, negative to move up
+ * @retval None
+ */
+void TM_MONO_Scroll(const TM_MONO_t* Mono, int16_t dx, int16_t dy);
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+
+/* C++ detection */
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -23,6 +23,10 @@ unsigned char PCD8544_UpdateXmin = 0, PCD8544_UpdateXmax = 0, PCD8544_UpdateYmin
 unsigned char PCD8544_x;
 unsigned char PCD8544_y;
 
+//Buffer for drawing engine, changed columns extend update area
+static void PCD8544_INT_Changed(uint16_t page, uint16_t start, uint16_t end);
+static const TM_MONO_t PCD8544_Mono = {PCD8544_Buffer, PCD8544_WIDTH, PCD8544_HEIGHT, PCD8544_INT_Changed};
+
 //Fonts 5x7
 const uint8_t PCD8544_Font5x7 [97][PCD8544_CHAR5x7_WIDTH] = {
 	{ 0x00, 0x00, 0x00, 0x00, 0x00 },   // sp
@@ -441,13 +445,22 @@ void PCD8544_UpdateArea(unsigned char xMin, unsigned char yMin, unsigned char xM
 	}
 }
 
+const TM_MONO_t* PCD8544_GetMono(void) {
+	return &PCD8544_Mono;
+}
+
+static void PCD8544_INT_Changed(uint16_t page, uint16_t start, uint16_t end) {
+	PCD8544_UpdateArea(start, page * 8, end - 1, page * 8 + 7);
+}
+
 void PCD8544_GotoXY(unsigned char x, unsigned char y) {
 	PCD8544_x = x;
 	PCD8544_y = y;
 }
 
 void PCD8544_Putc(char c, PCD8544_Pixel_t color, PCD8544_FontSize_t size) {
-	unsigned char c_height, c_width, i, b, j;
+	unsigned char c_height, c_width, i, b, count = 0;
+	uint8_t cols[PCD8544_CHAR5x7_WIDTH];
 	if (size == PCD8544_FontSize_3x5) {
 		c_width = PCD8544_CHAR3x5_WIDTH;
 		c_height = PCD8544_CHAR3x5_HEIGHT;
@@ -460,9 +473,11 @@ void PCD8544_Putc(char c, PCD8544_Pixel_t color, PCD8544_FontSize_t size) {
 		PCD8544_y += c_height;
 		PCD8544_x = 0;
 	}
+	//Collect columns, empty columns are skipped except for space
 	for (i = 0; i < c_width - 1; i++) {
 		if (c < 32) {
 			//b = _custom_chars[_font_size][(uint8_t)chr][i];
+			b = 0x00;
 		} else if (size == PCD8544_FontSize_3x5) {
 			b = PCD8544_Font3x5[c - 32][i];
 		} else {
@@ -471,16 +486,11 @@ void PCD8544_Putc(char c, PCD8544_Pixel_t color, PCD8544_FontSize_t size) {
 		if (b == 0x00 && (c != 0 && c != 32)) {
 			continue;
 		}
-		for (j = 0; j < c_height; j++) {
-			if (color == PCD8544_Pixel_Set) {
-				PCD8544_DrawPixel(PCD8544_x, (PCD8544_y + j), ((b >> j) & 1) ? PCD8544_Pixel_Set : PCD8544_Pixel_Clear);
-			} else {
-				PCD8544_DrawPixel(PCD8544_x, (PCD8544_y + j), ((b >> j) & 1) ? PCD8544_Pixel_Clear : PCD8544_Pixel_Set);
-			}
-		}
-		PCD8544_x++;
+		cols[count++] = b;
 	}
-	PCD8544_x++;
+	//Columns are in lcd buffer format, draw them with background at once
+	TM_MONO_DrawSprite(&PCD8544_Mono, PCD8544_x, PCD8544_y, cols, NULL, count, c_height, (color == PCD8544_Pixel_Set) ? TM_MONO_Op_Copy : TM_MONO_Op_CopyInverted);
+	PCD8544_x += count + 1;
 }
 
 void PCD8544_Puts(char *c, PCD8544_Pixel_t color, PCD8544_FontSize_t size) {
@@ -508,17 +518,13 @@ void PCD8544_DrawLine(unsigned char x0, unsigned char y0, unsigned char x1, unsi
 	dy = y1 - y0;
 
 	if (dx == 0) {
-		do {
-			PCD8544_DrawPixel(x0, y0, color);
-			y0++;
-		} while (y1 >= y0);
+		//Vertical line, whole bytes at once
+		TM_MONO_FillRectangle(&PCD8544_Mono, x0, y0, 1, dy + 1, (color != PCD8544_Pixel_Clear) ? TM_MONO_Op_Set : TM_MONO_Op_Clear);
 		return;
 	}
 	if (dy == 0) {
-		do {
-			PCD8544_DrawPixel(x0, y0, color);
-			x0++;
-		} while (x1 >= x0);
+		//Horizontal line
+		TM_MONO_FillRectangle(&PCD8544_Mono, x0, y0, dx + 1, 1, (color != PCD8544_Pixel_Clear) ? TM_MONO_Op_Set : TM_MONO_Op_Clear);
 		return;
 	}
 
@@ -560,8 +566,15 @@ void PCD8544_DrawRectangle(unsigned char x0, unsigned char y0, unsigned char x1,
 }
 
 void PCD8544_DrawFilledRectangle(unsigned char x0, unsigned char y0, unsigned char x1, unsigned char y1, PCD8544_Pixel_t color) {
-	for (; y0 < y1; y0++) {
-		PCD8544_DrawLine(x0, y0, x1, y0, color);
+	unsigned char temp;
+	if (x0 > x1) {
+		temp = x1;
+		x1 = x0;
+		x0 = temp;
+	}
+	//Rows from y0 to y1 - 1, all pages at once
+	if (y0 < y1) {
+		TM_MONO_FillRectangle(&PCD8544_Mono, x0, y0, x1 - x0 + 1, y1 - y0, (color != PCD8544_Pixel_Clear) ? TM_MONO_Op_Set : TM_MONO_Op_Clear);
 	}
 }
 
@@ -6,7 +6,7 @@
  *	@email		tilen@majerle.eu
  *	@website	http://stm32f4-discovery.net
  *	@link		http://stm32f4-discovery.net/pcd8544-nokia-33105110-lcd-stm32f429-discovery-library/
- *	@version 	v1.0
+ *	@version 	v1.1
  *	@ide		Keil uVision
  *	@license	GNU GPL v3
  *	
@@ -65,13 +65,20 @@
  *	
  */
 #ifndef PCD8544_H
-#define PCD8544_H 100
+#define PCD8544_H 110
+/**
+ * Version 1.1
+ * - Text, horizontal and vertical lines and filled rectangles are drawn with TM_MONO library,
+ *   whole bytes of buffer are changed instead of one pixel at a time
+ * - Added PCD8544_GetMono function, use it with TM_MONO functions for sprites, XOR drawing and scrolling
+ */
 /**
  * Library dependencies
  * - STM32F4xx
  * - STM32F4xx RCC
  * - STM32F4xx GPIO
  * - TM_SPI
+ * - TM_MONO
  */
 /**
  * Includes
@@ -81,6 +88,7 @@
 #include "stm32f4xx_gpio.h"
 #include "stm32f4xx_rcc.h"
 #include "tm_stm32f4_spi.h"
+#include "tm_stm32f4_mono.h"
 
 //SPI used
 #ifndef PCD8544_SPI
@@ -261,6 +269,14 @@ extern void PCD8544_Invert(PCD8544_Invert_t invert);
  */
 extern void PCD8544_Clear(void);
 
+/**
+ * Get description of lcd buffer for TM_MONO functions
+ * Changed area is sent to lcd with PCD8544_Refresh
+ *
+ * Returns pointer to TM_MONO_t structure
+ */
+extern const TM_MONO_t* PCD8544_GetMono(void);
+
 /**
  * Set/clear pixel at specific location
  *
@@ -0,0 +1,352 @@
+/**
+ * |----------------------------------------------------------------------
+ * | Copyright (C) Tilen MAJERLE, 2015
+ * |
+ * | This program is free software: you can redistribute it and/or modify
+ * | it under the terms of the GNU General Public License as published by
+ * | the Free Software Foundation, either version 3 of the License, or
+ * | any later version.
+ * |
+ * | This program is distributed in the hope that it will be useful,
+ * | but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * | GNU General Public License for more details.
+ * |
+ * | You should have received a copy of the GNU General Public License
+ * | along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * |----------------------------------------------------------------------
+ */
+#include "tm_stm32f4_qoi.h"
+
+/* QOI operations */
+#define QOI_OP_INDEX        0x00
+#define QOI_OP_DIFF         0x40
+#define QOI_OP_LUMA         0x80
+#define QOI_OP_RUN          0xC0
+#define QOI_OP_RGB          0xFE
+#define QOI_OP_RGBA         0xFF
+#define QOI_OP_MASK         0xC0
+
+/* Reader errors */
+#define QOI_READ_OK         0x00
+#define QOI_READ_FILE       0x01
+#define QOI_READ_END        0x02
+
+/* Private structure for file reading */
+typedef struct {
+	FIL* File;
+	uint16_t Pos;
+	uint16_t Len;
+	uint8_t Error;
+	uint32_t ReadTime;
+} TM_QOI_INT_Reader_t;
+
+/* Private variables */
+static uint8_t QOI_Buffer[QOI_BUFFER_SIZE];
+static uint32_t QOI_Index[64];
+static TM_QOI_INT_Reader_t QOI_Reader;
+#if QOI_USE_DMA2D == 1
+static uint32_t QOI_Line[2][QOI_MAX_WIDTH];
+#endif
+
+/* Next byte from file, buffer is refilled when empty */
+#define QOI_BYTE()          (QOI_Reader.Pos < QOI_Reader.Len ? QOI_Buffer[QOI_Reader.Pos++] : TM_INT_QOI_Fill())
+
+/* Private functions */
+static void TM_INT_QOI_Open(FIL* fil);
+static uint8_t TM_INT_QOI_Fill(void);
+static TM_QOI_Result_t TM_INT_QOI_ReadHeader(uint16_t* width, uint16_t* height, uint8_t* channels);
+#if QOI_USE_DMA2D == 0
+static uint16_t TM_INT_QOI_Blend(uint16_t bg, uint16_t fg, uint8_t alpha);
+#endif
+
+TM_QOI_Result_t TM_QOI_GetInfo(FIL* fil, uint16_t* width, uint16_t* height) {
+	TM_QOI_Result_t result;
+	uint8_t channels;
+
+	/* Read header and go back to beginning */
+	TM_INT_QOI_Open(fil);
+	result = TM_INT_QOI_ReadHeader(width, height, &channels);
+	f_lseek(fil, 0);
+
+	return result;
+}
+
+TM_QOI_Result_t TM_QOI_Draw(const TM_SPAN_Target_t* Target, int16_t x, int16_t y, FIL* fil, TM_QOI_Stats_t* Stats) {
+	TM_QOI_Result_t result;
+	uint16_t width, height, row, col, color = 0;
+	uint8_t channels, b1, b2, r = 0, g = 0, b = 0, a = 0xFF, run = 0, visible;
+	int32_t c0, c1, line, vg;
+	uint32_t start, argb = 0xFF000000;
+#if QOI_USE_DMA2D == 1
+	uint32_t fence[2], xSize, ySize, offset;
+	uint16_t* dst;
+	int32_t pos, step;
+	uint8_t cur = 0;
+#else
+	uint16_t* fb = (uint16_t *)Target->Address;
+#endif
+
+	/* Enable DWT cycle counter for statistics */
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	start = DWT->CYCCNT;
+
+	/* Read header */
+	TM_INT_QOI_Open(fil);
+	result = TM_INT_QOI_ReadHeader(&width, &height, &channels);
+	if (result != TM_QOI_Result_Ok) {
+		return result;
+	}
+
+	/* Visible columns, from c0 to c1 - 1 */
+	c0 = x < 0 ? -x : 0;
+	c1 = (int32_t)Target->Width - x;
+	if (c1 > width) {
+		c1 = width;
+	}
+	if (c1 < c0) {
+		c1 = c0;
+	}
+
+#if QOI_USE_DMA2D == 1
+	/* Visible part of line must fit to line buffer */
+	if ((c1 - c0) > QOI_MAX_WIDTH) {
+		return TM_QOI_Result_TooWide;
+	}
+
+	/* Line buffers are free */
+	fence[0] = fence[1] = TM_DMA2DGRAPHIC_Fence();
+
+	/* Line buffer is in memory order, reversed when X goes backwards in memory */
+	step = Target->StepX > 0 ? 1 : -1;
+	if (Target->StepX == 1 || Target->StepX == -1) {
+		/* Image line is memory line */
+		xSize = c1 - c0;
+		ySize = 1;
+		offset = 0;
+	} else {
+		/* Image line is memory column, copied as 1 pixel wide lines */
+		xSize = 1;
+		ySize = c1 - c0;
+		offset = Target->Pitch - 1;
+	}
+#else
+	/* Queued operations may still write to framebuffer */
+	DMA2D_WAIT;
+#endif
+
+	/* Reset decoder */
+	for (col = 0; col < 64; col++) {
+		QOI_Index[col] = 0;
+	}
+
+	for (row = 0; row < height; row++) {
+		/* Check if line is on LCD */
+		visible = c0 < c1 && (y + row) >= 0 && (y + row) < (int32_t)Target->Height;
+
+#if QOI_USE_DMA2D == 1
+		if (visible) {
+			/* Wait until DMA2D finishes with this line buffer */
+			TM_DMA2DGRAPHIC_WaitFence(fence[cur]);
+			pos = step > 0 ? 0 : (c1 - c0 - 1);
+		}
+#else
+		/* Memory index of pixel at column 0 */
+		line = Target->Base + x * Target->StepX + (y + row) * Target->StepY;
+#endif
+
+		for (col = 0; col < width; col++) {
+			/* Decode pixel */
+			if (run) {
+				run--;
+			} else {
+				b1 = QOI_BYTE();
+				if (b1 == QOI_OP_RGB) {
+					r = QOI_BYTE();
+					g = QOI_BYTE();
+					b = QOI_BYTE();
+				} else if (b1 == QOI_OP_RGBA) {
+					r = QOI_BYTE();
+					g = QOI_BYTE();
+					b = QOI_BYTE();
+					a = QOI_BYTE();
+				} else if ((b1 & QOI_OP_MASK) == QOI_OP_INDEX) {
+					argb = QOI_Index[b1];
+					a = argb >> 24;
+					r = argb >> 16;
+					g = argb >> 8;
+					b = argb;
+				} else if ((b1 & QOI_OP_MASK) == QOI_OP_DIFF) {
+					r += ((b1 >> 4) & 0x03) - 2;
+					g += ((b1 >> 2) & 0x03) - 2;
+					b += (b1 & 0x03) - 2;
+				} else if ((b1 & QOI_OP_MASK) == QOI_OP_LUMA) {
+					b2 = QOI_BYTE();
+					vg = (b1 & 0x3F) - 32;
+					r += vg - 8 + ((b2 >> 4) & 0x0F);
+					g += vg;
+					b += vg - 8 + (b2 & 0x0F);
+				} else {
+					/* Run, this pixel and next ones are the same as previous */
+					run = b1 & 0x3F;
+				}
+
+				/* Save to index and convert to RGB565 */
+				argb = ((uint32_t)a << 24) | ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+				QOI_Index[(r * 3 + g * 5 + b * 7 + a * 11) & 0x3F] = argb;
+				color = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+			}
+
+			/* Store visible pixels */
+			if (!visible || col < c0 || col >= c1) {
+				continue;
+			}
+#if QOI_USE_DMA2D == 1
+			if (channels == 4) {
+				QOI_Line[cur][pos] = argb;
+			} else {
+				((uint16_t *)QOI_Line[cur])[pos] = color;
+			}
+			pos += step;
+#else
+			if (a == 0xFF) {
+				fb[line + col * Target->StepX] = color;
+			} else if (a) {
+				fb[line + col * Target->StepX] = TM_INT_QOI_Blend(fb[line + col * Target->StepX], color, a);
+			}
+#endif
+		}
+
+#if QOI_USE_DMA2D == 1
+		if (visible) {
+			/* Lowest memory address of line */
+			line = Target->Base + (x + (step > 0 ? c0 : (c1 - 1))) * Target->StepX + (y + row) * Target->StepY;
+			dst = (uint16_t *)Target->Address + line;
+
+			/* Copy or blend line to framebuffer, next line is decoded meanwhile */
+			if (channels == 4) {
+				TM_DMA2DGRAPHIC_BlendBufferIT(QOI_Line[cur], dst, dst, xSize, ySize, 0, offset, offset, CM_ARGB8888, 0);
+			} else {
+				TM_DMA2DGRAPHIC_CopyBufferIT(QOI_Line[cur], dst, xSize, ySize, 0, offset);
+			}
+			fence[cur] = TM_DMA2DGRAPHIC_Fence();
+			cur ^= 1;
+		}
+#endif
+	}
+
+#if QOI_USE_DMA2D == 1
+	/* Image is complete when function returns */
+	TM_DMA2DGRAPHIC_Flush();
+#endif
+
+	/* Check file errors */
+	if (QOI_Reader.Error == QOI_READ_FILE) {
+		return TM_QOI_Result_FileError;
+	}
+	if (QOI_Reader.Error == QOI_READ_END) {
+		return TM_QOI_Result_Corrupted;
+	}
+
+	/* Fill statistics */
+	if (Stats) {
+		Stats->Time = DWT->CYCCNT - start;
+		Stats->ReadTime = QOI_Reader.ReadTime;
+		Stats->Width = width;
+		Stats->Height = height;
+		Stats->FileSize = f_size(fil);
+		Stats->RawSize = (uint32_t)width * height * 2;
+		Stats->Savings = 100 - (int32_t)((uint64_t)Stats->FileSize * 100 / Stats->RawSize);
+		Stats->Speed = Stats->Time ? (uint32_t)((uint64_t)Stats->RawSize * SystemCoreClock / Stats->Time / 1000) : 0;
+	}
+
+	return TM_QOI_Result_Ok;
+}
+
+/* Private functions */
+static void TM_INT_QOI_Open(FIL* fil) {
+	/* Read from beginning, so all reads are aligned to sectors */
+	f_lseek(fil, 0);
+	QOI_Reader.File = fil;
+	QOI_Reader.Pos = 0;
+	QOI_Reader.Len = 0;
+	QOI_Reader.Error = QOI_READ_OK;
+	QOI_Reader.ReadTime = 0;
+}
+
+static uint8_t TM_INT_QOI_Fill(void) {
+	uint32_t start;
+	UINT br = 0;
+	FRESULT fres;
+
+	/* After error, return zeros until image is done */
+	if (QOI_Reader.Error != QOI_READ_OK) {
+		return 0;
+	}
+
+	/* Read next block */
+	start = DWT->CYCCNT;
+	fres = f_read(QOI_Reader.File, QOI_Buffer, QOI_BUFFER_SIZE, &br);
+	QOI_Reader.ReadTime += DWT->CYCCNT - start;
+
+	/* Check result */
+	if (fres != FR_OK) {
+		QOI_Reader.Error = QOI_READ_FILE;
+		return 0;
+	}
+	if (br == 0) {
+		QOI_Reader.Error = QOI_READ_END;
+		return 0;
+	}
+
+	/* Return first byte */
+	QOI_Reader.Len = br;
+	QOI_Reader.Pos = 1;
+	return QOI_Buffer[0];
+}
+
+static TM_QOI_Result_t TM_INT_QOI_ReadHeader(uint16_t* width, uint16_t* height, uint8_t* channels) {
+	uint8_t header[14];
+	uint32_t w, h;
+	uint8_t i;
+
+	/* Header is 14 bytes */
+	for (i = 0; i < 14; i++) {
+		header[i] = QOI_BYTE();
+	}
+	if (QOI_Reader.Error == QOI_READ_FILE) {
+		return TM_QOI_Result_FileError;
+	}
+
+	/* Magic "qoif", big endian width and height, number of channels and colour space */
+	if (header[0] != 'q' || header[1] != 'o' || header[2] != 'i' || header[3] != 'f') {
+		return TM_QOI_Result_Format;
+	}
+	w = ((uint32_t)header[4] << 24) | ((uint32_t)header[5] << 16) | ((uint32_t)header[6] << 8) | header[7];
+	h = ((uint32_t)header[8] << 24) | ((uint32_t)header[9] << 16) | ((uint32_t)header[10] << 8) | header[11];
+	if (w == 0 || h == 0 || w > 0xFFFF || h > 0xFFFF || (header[12] != 3 && header[12] != 4)) {
+		return TM_QOI_Result_Format;
+	}
+
+	/* Save values */
+	*width = w;
+	*height = h;
+	*channels = header[12];
+
+	return TM_QOI_Result_Ok;
+}
+
+#if QOI_USE_DMA2D == 0
+static uint16_t TM_INT_QOI_Blend(uint16_t bg, uint16_t fg, uint8_t alpha) {
+	uint32_t b, f, a;
+
+	/* Expand to 00000GGGGGG00000RRRRR000000BBBBB and blend all components with one multiplication */
+	a = ((uint32_t)alpha + 4) >> 3;
+	b = (bg | ((uint32_t)bg << 16)) & 0x07E0F81F;
+	f = (fg | ((uint32_t)fg << 16)) & 0x07E0F81F;
+	b = ((f * a + b * (32 - a)) >> 5) & 0x07E0F81F;
+
+	return (uint16_t)(b | (b >> 16));
+}
+#endif
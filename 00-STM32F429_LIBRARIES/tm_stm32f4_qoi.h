@@ -0,0 +1,243 @@
+/**
+ * @author  Tilen MAJERLE
+ * @email   tilen@majerle.eu
+ * @website http://stm32f4-discovery.net
+ * @link
+ * @version v1.0
+ * @ide     Keil uVision
+ * @license GNU GPL v3
+ * @brief   Streaming QOI image decoder from FatFs file to RGB565 framebuffer
+ *
+@verbatim
+   ----------------------------------------------------------------------
+    Copyright (C) Tilen MAJERLE, 2015
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+   ----------------------------------------------------------------------
+@endverbatim
+ */
+#ifndef TM_QOI_H
+#define TM_QOI_H 100
+
+/* C++ detection */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup TM_STM32F4xx_Libraries
+ * @{
+ */
+
+/**
+ * @defgroup TM_QOI
+ * @brief    Streaming QOI image decoder from FatFs file to RGB565 framebuffer
+ * @{
+ *
+ * QOI (Quite OK Image format, https://qoiformat.org) is lossless image format, which is decoded with a few operations per pixel
+ * and usually compresses pictures, splash screens and map tiles to 20-50% of RGB565 size.
+ *
+ * Image is never loaded to RAM as whole. File is read with FatFs in blocks of @ref QOI_BUFFER_SIZE bytes,
+ * each block starts on sector boundary, so FatFs reads sectors directly to library buffer.
+ * Decoded lines are written to framebuffer described with @ref TM_SPAN_Target_t structure,
+ * so image can be drawn in any of 4 LCD orientations and is clipped to LCD.
+ *
+ * \par Writing to framebuffer
+ *
+ * With @ref QOI_USE_DMA2D set to 1 (default), each line is decoded to line buffer in internal RAM
+ * and then copied to framebuffer with DMA2D from @ref TM_DMA2D_GRAPHIC command queue.
+ * There are 2 line buffers, CPU decodes next line while DMA2D copies previous one.
+ * Images with alpha channel are decoded to ARGB8888 and blended over LCD content by DMA2D.
+ *
+ * With @ref QOI_USE_DMA2D set to 0, CPU writes pixels directly to framebuffer.
+ *
+ * Example for LCD on STM32F429-Discovery, framebuffer of active layer is given by @ref TM_ILI9341_LTDC library:
+ *
+@verbatim
+FIL fil;
+TM_SPAN_Target_t Target;
+TM_QOI_Stats_t Stats;
+
+if (f_open(&fil, "splash.qoi", FA_READ) == FR_OK) {
+    TM_ILI9341_GetTarget(&Target);
+    TM_QOI_Draw(&Target, 0, 0, &fil, &Stats);
+    f_close(&fil);
+    
+    //Stats.Speed / 1000 is decoding speed in MB/s
+    //Stats.Savings is space saved on card in percent
+}
+@endverbatim
+ *
+ * RAM used by library is @ref QOI_BUFFER_SIZE + 256 bytes for colour index + 2 * @ref QOI_MAX_WIDTH * 4 bytes for line buffers.
+ *
+ * \par Statistics
+ *
+ * Each draw can fill @ref TM_QOI_Stats_t structure with decoding time, speed and space saved on card compared to RGB565 file.
+ *
+ * \par Creating images
+ *
+ * Use <code>tools/qoiconv.py</code> script to convert 24-bit or 32-bit BMP file to QOI file.
+ * Colours are rounded to RGB565 first, so there are more equal neighbour pixels and file is smaller.
+ *
+ * \par Custom settings
+ *
+ * Add lines below to defines.h file and edit them:
+ *
+@verbatim
+//Size of file read buffer, must be multiple of 512
+#define QOI_BUFFER_SIZE      512
+
+//Maximal image line length in units of pixels, used with DMA2D
+#define QOI_MAX_WIDTH        320
+
+//Use DMA2D for writing lines to framebuffer
+#define QOI_USE_DMA2D        1
+@endverbatim
+ *
+ * \par Changelog
+ *
+@verbatim
+ Version 1.0
+  - First release
+@endverbatim
+ *
+ * \par Dependencies
+ *
+@verbatim
+ - STM32F4xx
+ - defines.h
+ - FatFs
+ - TM SPAN
+ - TM DMA2D GRAPHIC
+@endverbatim
+ */
+
+#include "stm32f4xx.h"
+#include "defines.h"
+#include "ff.h"
+#include "tm_stm32f4_span.h"
+#include "tm_stm32f4_dma2d_graphic.h"
+
+/**
+ * @defgroup TM_QOI_Macros
+ * @brief    Library defines
+ * @{
+ */
+
+/**
+ * @brief  Size of file read buffer in units of bytes
+ * @note   Must be multiple of 512, so reads are aligned to sectors
+ */
+#ifndef QOI_BUFFER_SIZE
+#define QOI_BUFFER_SIZE             512
+#endif
+
+/**
+ * @brief  Maximal image line length in units of pixels for DMA2D line buffers
+ */
+#ifndef QOI_MAX_WIDTH
+#define QOI_MAX_WIDTH               320
+#endif
+
+/**
+ * @brief  Lines are copied to framebuffer with DMA2D when set to 1, or written by CPU when set to 0
+ */
+#ifndef QOI_USE_DMA2D
+#define QOI_USE_DMA2D               1
+#endif
+
+/**
+ * @}
+ */
+
+/**
+ * @defgroup TM_QOI_Typedefs
+ * @brief    Library Typedefs
+ * @{
+ */
+
+/**
+ * @brief  Result enumeration
+ */
+typedef enum {
+	TM_QOI_Result_Ok = 0x00, /*!< Image decoded */
+	TM_QOI_Result_FileError, /*!< FatFs returned error while reading file */
+	TM_QOI_Result_Format,    /*!< File is not QOI image */
+	TM_QOI_Result_Corrupted, /*!< File ended before all pixels were decoded */
+	TM_QOI_Result_TooWide    /*!< Visible part of image line is longer than @ref QOI_MAX_WIDTH pixels */
+} TM_QOI_Result_t;
+
+/**
+ * @brief  Decoding statistics
+ */
+typedef struct {
+	uint16_t Width;    /*!< Image width in units of pixels */
+	uint16_t Height;   /*!< Image height in units of pixels */
+	uint32_t FileSize; /*!< Size of QOI file in units of bytes */
+	uint32_t RawSize;  /*!< Size of the same image in RGB565 format, Width * Height * 2 bytes */
+	int16_t Savings;   /*!< Space saved compared to RGB565 file in percent, negative if QOI file is bigger */
+	uint32_t Time;     /*!< Whole decoding time in units of CPU cycles, including file reading */
+	uint32_t ReadTime; /*!< Time spent in FatFs reading file in units of CPU cycles */
+	uint32_t Speed;    /*!< Decoding speed in kB of RGB565 pixels per second, divide by 1000 for MB/s */
+} TM_QOI_Stats_t;
+
+/**
+ * @}
+ */
+
+/**
+ * @defgroup TM_QOI_Functions
+ * @brief    Library Functions
+ * @{
+ */
+
+/**
+ * @brief  Reads image size from QOI file header
+ * @param  *fil: Pointer to opened file
+ * @param  *width: Pointer to variable to store image width into
+ * @param  *height: Pointer to variable to store image height into
+ * @retval Member of @ref TM_QOI_Result_t enumeration
+ */
+TM_QOI_Result_t TM_QOI_GetInfo(FIL* fil, uint16_t* width, uint16_t* height);
+
+/**
+ * @brief  Decodes QOI file to framebuffer
+ * @note   Image is complete in framebuffer when function returns
+ * @param  *Target: Pointer to @ref TM_SPAN_Target_t framebuffer description
+ * @param  x: Left X coordinate of image, can be negative
+ * @param  y: Top Y coordinate of image, can be negative
+ * @param  *fil: Pointer to opened file. It is read from beginning
+ * @param  *Stats: Pointer to @ref TM_QOI_Stats_t structure to be filled with statistics. Set to NULL if not used
+ * @retval Member of @ref TM_QOI_Result_t enumeration
+ */
+TM_QOI_Result_t TM_QOI_Draw(const TM_SPAN_Target_t* Target, int16_t x, int16_t y, FIL* fil, TM_QOI_Stats_t* Stats);
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+
+/* C++ detection */
+#ifdef __cplusplus
+}
+#endif
+
+#endif
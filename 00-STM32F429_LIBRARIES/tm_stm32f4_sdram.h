@@ -3,7 +3,7 @@
  * @email   tilen@majerle.eu
  * @website http://stm32f4-discovery.net
  * @link    http://stm32f4-discovery.net/2014/05/library-14-working-with-sdram-on-stm32f429-discovery/
- * @version v1.3
+ * @version v1.4
  * @ide     Keil uVision
  * @license GNU GPL v3
  * @brief   External SDRAM for STM32F429-Discovery or STM324x9-EVAL boards
@@ -28,7 +28,7 @@
 @endverbatim
  */
 #ifndef TM_SDRAM_H
-#define TM_SDRAM_H 130
+#define TM_SDRAM_H 140
 /**
  * @addtogroup TM_STM32F4xx_Libraries
  * @{
@@ -90,10 +90,31 @@ PD15 <-> FMC_D1   | PE11 <-> FMC_D8    | PF11 <-> FC_NRAS   | PH11 <-> FMC_D19
                   | PE14 <-> FMC_D11   | PF14 <-> FMC_A8    |                    | PH15 <-> FMC_D23   | PI10 <-> FMC_D31
                   | PE15 <-> FMC_D12   | PF15 <-> FMC_A9    |                    |                    |
 @endverbatim                                                                                            
+ *
+ * \par SDRAM memory map
+ *
+ * Libraries and examples use fixed addresses in SDRAM. Offsets below are from SDRAM_START_ADR on STM32F429-Discovery board.
+ * When you place your own buffers in SDRAM, use free areas only.
+ *
+@verbatim
+Offset      Size     Used by
+0x000000    300kB    LCD layer 1 and layer 2 (TM ILI9341 LTDC, TM LCD, TM DMA2D GRAPHIC)
+0x04B000    300kB    Back buffers of layer 1 with ILI9341_BUFFERS = 3, ILI9341_SDRAM_END is end of LCD memory
+0x100000    4MB      emWin memory, GUIConf.c
+0x600000    40kB     FatFs sector cache, FATFS_CACHE_ADDR in examples
+0x700000    208kB    Glyphs of TM FONTS CACHE, FONTS_CACHE_ADDR default
+0x780000    16kB     FatFs SDIO bounce buffer, FATFS_SDIO_BOUNCE_ADDR in examples
+@endverbatim
+ *
+ * FatFs SDRAM drive (fatfs_sdram.c) uses whole SDRAM, so nothing above can be used together with it.
  *          
  * \par Changelog
  *
 @verbatim
+ Version 1.4
+  - October 19, 2026
+  - Added SDRAM memory map of libraries to documentation
+
  Version 1.3
   - March 19, 2015
   - Added support for STM324x9_EVAL board
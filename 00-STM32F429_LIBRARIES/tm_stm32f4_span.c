@@ -0,0 +1,359 @@
+/**
+ * |----------------------------------------------------------------------
+ * | Copyright (C) Tilen MAJERLE, 2015
+ * |
+ * | This program is free software: you can redistribute it and/or modify
+ * | it under the terms of the GNU General Public License as published by
+ * | the Free Software Foundation, either version 3 of the License, or
+ * | any later version.
+ * |
+ * | This program is distributed in the hope that it will be useful,
+ * | but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * | GNU General Public License for more details.
+ * |
+ * | You should have received a copy of the GNU General Public License
+ * | along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * |----------------------------------------------------------------------
+ */
+#include "tm_stm32f4_span.h"
+
+/* Private structure for rectangle of joined spans */
+typedef struct {
+	const TM_SPAN_Target_t* Target;
+	int16_t X0;
+	int16_t X1;
+	int16_t Y0;
+	int16_t Y1;
+	uint16_t Color;
+	uint8_t Valid;
+} TM_SPAN_INT_Rect_t;
+
+/* Private variables */
+static TM_SPAN_INT_Rect_t SPAN_Pending;
+
+/* Private functions */
+static void TM_INT_SPAN_Begin(void);
+static void TM_INT_SPAN_End(void);
+static void TM_INT_SPAN_Add(const TM_SPAN_Target_t* Target, int16_t x0, int16_t x1, int16_t y, uint16_t color);
+static void TM_INT_SPAN_Flush(void);
+static void TM_INT_SPAN_FillCPU(uint16_t* ptr, uint16_t pixels, uint16_t lines, uint16_t pitch, uint16_t color);
+static uint16_t TM_INT_SPAN_Sqrt(uint32_t value);
+
+void TM_SPAN_FillRectangle(const TM_SPAN_Target_t* Target, int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+	int16_t y;
+
+	TM_INT_SPAN_Begin();
+
+	/* All lines are equal, they are joined to one transfer */
+	for (y = y0; y <= y1; y++) {
+		TM_INT_SPAN_Add(Target, x0, x1, y, color);
+	}
+
+	TM_INT_SPAN_End();
+}
+
+void TM_SPAN_FillCircle(const TM_SPAN_Target_t* Target, int16_t x0, int16_t y0, uint16_t r, uint16_t color) {
+	int16_t dy, dx;
+	uint32_t rr;
+
+	TM_INT_SPAN_Begin();
+
+	/* Pixel is inside if dx^2 + dy^2 <= r^2 + r, same shape as midpoint algorithm */
+	rr = (uint32_t)r * r + r;
+
+	/* Go from top to bottom, one span per line */
+	for (dy = -(int16_t)r; dy <= (int16_t)r; dy++) {
+		dx = TM_INT_SPAN_Sqrt(rr - (int32_t)dy * dy);
+		TM_INT_SPAN_Add(Target, x0 - dx, x0 + dx, y0 + dy, color);
+	}
+
+	TM_INT_SPAN_End();
+}
+
+void TM_SPAN_FillRoundedRectangle(const TM_SPAN_Target_t* Target, int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t r, uint16_t color) {
+	int16_t y, dy, dx, tmp;
+	uint32_t rr;
+
+	/* Sort coordinates */
+	if (x0 > x1) {
+		tmp = x0; x0 = x1; x1 = tmp;
+	}
+	if (y0 > y1) {
+		tmp = y0; y0 = y1; y1 = tmp;
+	}
+
+	/* Radius can be at most half of width and height */
+	if (r > (x1 - x0) / 2) {
+		r = (x1 - x0) / 2;
+	}
+	if (r > (y1 - y0) / 2) {
+		r = (y1 - y0) / 2;
+	}
+
+	TM_INT_SPAN_Begin();
+
+	rr = (uint32_t)r * r + r;
+	for (y = y0; y <= y1; y++) {
+		/* Distance from corner centers, 0 in the middle part */
+		if (y < y0 + r) {
+			dy = y0 + r - y;
+		} else if (y > y1 - r) {
+			dy = y - (y1 - r);
+		} else {
+			dy = 0;
+		}
+
+		/* Corner width */
+		dx = r - TM_INT_SPAN_Sqrt(rr - (int32_t)dy * dy);
+		TM_INT_SPAN_Add(Target, x0 + dx, x1 - dx, y, color);
+	}
+
+	TM_INT_SPAN_End();
+}
+
+void TM_SPAN_FillTriangle(const TM_SPAN_Target_t* Target, int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t x3, int16_t y3, uint16_t color) {
+	TM_SPAN_Point_t points[3];
+
+	/* Triangle is convex polygon with 3 points */
+	points[0].X = x1;
+	points[0].Y = y1;
+	points[1].X = x2;
+	points[1].Y = y2;
+	points[2].X = x3;
+	points[2].Y = y3;
+
+	TM_SPAN_FillConvexPolygon(Target, points, 3, color);
+}
+
+void TM_SPAN_FillConvexPolygon(const TM_SPAN_Target_t* Target, const TM_SPAN_Point_t* Points, uint16_t count, uint16_t color) {
+	int16_t y, ymin, ymax, xmin, xmax, x;
+	uint16_t i;
+	const TM_SPAN_Point_t *a, *b;
+
+	/* Check count */
+	if (count == 0) {
+		return;
+	}
+
+	/* Get vertical range */
+	ymin = ymax = Points[0].Y;
+	for (i = 1; i < count; i++) {
+		if (Points[i].Y < ymin) {
+			ymin = Points[i].Y;
+		}
+		if (Points[i].Y > ymax) {
+			ymax = Points[i].Y;
+		}
+	}
+
+	/* Clip vertical range, no need to go through lines which are not visible */
+	if (ymin < 0) {
+		ymin = 0;
+	}
+	if (ymax >= (int16_t)Target->Height) {
+		ymax = Target->Height - 1;
+	}
+
+	TM_INT_SPAN_Begin();
+
+	for (y = ymin; y <= ymax; y++) {
+		xmin = 0x7FFF;
+		xmax = -0x7FFF;
+
+		/* Find leftmost and rightmost edge on this line */
+		for (i = 0; i < count; i++) {
+			a = &Points[i];
+			b = &Points[(i + 1) < count ? (i + 1) : 0];
+
+			/* Check if edge crosses this line */
+			if ((y < a->Y && y < b->Y) || (y > a->Y && y > b->Y)) {
+				continue;
+			}
+
+			if (a->Y == b->Y) {
+				/* Horizontal edge, both points are on the line */
+				if (a->X < xmin) {
+					xmin = a->X;
+				}
+				if (a->X > xmax) {
+					xmax = a->X;
+				}
+				x = b->X;
+			} else {
+				/* Intersection in 16.16 fixed point, rounded to nearest pixel */
+				x = (int16_t)((((int32_t)a->X * 65536) + (((int32_t)(b->X - a->X) * 65536) / (b->Y - a->Y)) * (y - a->Y) + 0x8000) >> 16);
+			}
+
+			if (x < xmin) {
+				xmin = x;
+			}
+			if (x > xmax) {
+				xmax = x;
+			}
+		}
+
+		/* Add span */
+		if (xmin <= xmax) {
+			TM_INT_SPAN_Add(Target, xmin, xmax, y, color);
+		}
+	}
+
+	TM_INT_SPAN_End();
+}
+
+/* Private functions */
+static void TM_INT_SPAN_Begin(void) {
+	/* No pending rectangle */
+	SPAN_Pending.Valid = 0;
+}
+
+static void TM_INT_SPAN_End(void) {
+	/* Fill last rectangle, DMA2D fills stay in queue */
+	TM_INT_SPAN_Flush();
+}
+
+static void TM_INT_SPAN_Add(const TM_SPAN_Target_t* Target, int16_t x0, int16_t x1, int16_t y, uint16_t color) {
+	int16_t tmp;
+
+	/* Sort coordinates */
+	if (x0 > x1) {
+		tmp = x0; x0 = x1; x1 = tmp;
+	}
+
+	/* Clip to LCD */
+	if (y < 0 || y >= (int16_t)Target->Height || x1 < 0 || x0 >= (int16_t)Target->Width) {
+		return;
+	}
+	if (x0 < 0) {
+		x0 = 0;
+	}
+	if (x1 >= (int16_t)Target->Width) {
+		x1 = Target->Width - 1;
+	}
+
+	/* Join with pending rectangle if span continues it */
+	if (
+		SPAN_Pending.Valid &&
+		SPAN_Pending.Target == Target &&
+		SPAN_Pending.Color == color &&
+		SPAN_Pending.X0 == x0 &&
+		SPAN_Pending.X1 == x1 &&
+		SPAN_Pending.Y1 == (y - 1)
+	) {
+		SPAN_Pending.Y1 = y;
+		return;
+	}
+
+	/* Fill previous rectangle and start new one */
+	TM_INT_SPAN_Flush();
+	SPAN_Pending.Target = Target;
+	SPAN_Pending.X0 = x0;
+	SPAN_Pending.X1 = x1;
+	SPAN_Pending.Y0 = y;
+	SPAN_Pending.Y1 = y;
+	SPAN_Pending.Color = color;
+	SPAN_Pending.Valid = 1;
+}
+
+static void TM_INT_SPAN_Flush(void) {
+	const TM_SPAN_Target_t* Target;
+	uint16_t* ptr;
+	int32_t first;
+	uint16_t pixels, lines;
+
+	/* Check if anything to fill */
+	if (!SPAN_Pending.Valid) {
+		return;
+	}
+	SPAN_Pending.Valid = 0;
+	Target = SPAN_Pending.Target;
+
+	/* Memory index of corner with the lowest address, fill starts there */
+	first = Target->Base;
+	first += (Target->StepX > 0 ? SPAN_Pending.X0 : SPAN_Pending.X1) * Target->StepX;
+	first += (Target->StepY > 0 ? SPAN_Pending.Y0 : SPAN_Pending.Y1) * Target->StepY;
+
+	/* Spans are memory lines when X step is 1 pixel, otherwise they are memory columns */
+	if (Target->StepX == 1 || Target->StepX == -1) {
+		pixels = SPAN_Pending.X1 - SPAN_Pending.X0 + 1;
+		lines = SPAN_Pending.Y1 - SPAN_Pending.Y0 + 1;
+	} else {
+		pixels = SPAN_Pending.Y1 - SPAN_Pending.Y0 + 1;
+		lines = SPAN_Pending.X1 - SPAN_Pending.X0 + 1;
+	}
+
+	ptr = (uint16_t *)Target->Address + first;
+
+	/* Small rectangles are faster with CPU than with DMA2D setup */
+	if ((uint32_t)pixels * lines < SPAN_DMA2D_MIN_PIXELS) {
+		/* Queued DMA2D operations may still use the same memory */
+		TM_DMA2DGRAPHIC_WaitRegion(ptr, ((uint32_t)(lines - 1) * Target->Pitch + pixels) * 2);
+		TM_INT_SPAN_FillCPU(ptr, pixels, lines, Target->Pitch, SPAN_Pending.Color);
+		return;
+	}
+
+	/* Put fill to DMA2D queue, next spans are calculated meanwhile */
+	TM_DMA2DGRAPHIC_FillBufferIT(
+		ptr,
+		pixels, lines,
+		Target->Pitch - pixels,
+		SPAN_Pending.Color
+	);
+}
+
+static void TM_INT_SPAN_FillCPU(uint16_t* ptr, uint16_t pixels, uint16_t lines, uint16_t pitch, uint16_t color) {
+	uint32_t* wptr;
+	uint32_t color32;
+	uint16_t i, count;
+
+	/* 2 pixels in one word */
+	color32 = ((uint32_t)color << 16) | color;
+
+	while (lines--) {
+		count = pixels;
+		i = 0;
+
+		/* Align to word */
+		if (((uintptr_t)ptr & 0x02) && count) {
+			ptr[i++] = color;
+			count--;
+		}
+
+		/* Write 2 pixels at a time */
+		wptr = (uint32_t *)&ptr[i];
+		while (count >= 2) {
+			*wptr++ = color32;
+			count -= 2;
+		}
+
+		/* Last pixel */
+		if (count) {
+			*(uint16_t *)wptr = color;
+		}
+
+		/* Go to next line */
+		ptr += pitch;
+	}
+}
+
+static uint16_t TM_INT_SPAN_Sqrt(uint32_t value) {
+	uint32_t result = 0, bit = 1UL << 30;
+
+	/* Integer square root, digit by digit */
+	while (bit > value) {
+		bit >>= 2;
+	}
+	while (bit) {
+		if (value >= result + bit) {
+			value -= result + bit;
+			result = (result >> 1) + bit;
+		} else {
+			result >>= 1;
+		}
+		bit >>= 2;
+	}
+
+	/* Return floor of square root */
+	return (uint16_t)result;
+}
@@ -0,0 +1,239 @@
+/**
+ * @author  Tilen MAJERLE
+ * @email   tilen@majerle.eu
+ * @website http://stm32f4-discovery.net
+ * @link
+ * @version v1.2
+ * @ide     Keil uVision
+ * @license GNU GPL v3
+ * @brief   Span based rasterizer for filled shapes in RGB565 framebuffers, using CPU and DMA2D
+ *
+@verbatim
+   ----------------------------------------------------------------------
+    Copyright (C) Tilen MAJERLE, 2015
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+   ----------------------------------------------------------------------
+@endverbatim
+ */
+#ifndef TM_SPAN_H
+#define TM_SPAN_H 120
+
+/* C++ detection */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup TM_STM32F4xx_Libraries
+ * @{
+ */
+
+/**
+ * @defgroup TM_SPAN
+ * @brief    Span based rasterizer for filled shapes in RGB565 framebuffers, using CPU and DMA2D
+ * @{
+ *
+ * Library is shared between LCD libraries which draw to framebuffer in memory (@ref TM_ILI9341_LTDC and @ref TM_DMA2D_GRAPHIC).
+ *
+ * \par How it works
+ *
+ * Each filled shape is split into horizontal runs of pixels (spans), one per line, from top to bottom.
+ * Spans on consecutive lines with the same start and end are joined into one rectangle.
+ * This way rectangles and middle parts of circles and rounded rectangles are filled with one operation.
+ *
+ * Each rectangle is then filled:
+ *  - With CPU if it has less than @ref SPAN_DMA2D_MIN_PIXELS pixels. 2 pixels are written at a time with 32-bit writes
+ *  - With DMA2D register to memory transfer otherwise. Transfer is put to @ref TM_DMA2D_GRAPHIC command queue,
+ *    CPU does not wait for it and calculates next span meanwhile
+ *
+ * Before CPU fills rectangle, it waits only for queued DMA2D operations which use the same memory, with @ref TM_DMA2DGRAPHIC_WaitRegion.
+ * DMA2D fills stay in queue when drawing function returns. Use @ref DMA2D_WAIT before framebuffer is read by CPU.
+ *
+ * \par Supported shapes
+ *
+ *  - Rectangles
+ *  - Circles
+ *  - Rounded rectangles
+ *  - Triangles
+ *  - Convex polygons
+ *
+ * \par Orientation
+ *
+ * Shapes are rasterized in LCD coordinates. Memory index of each pixel is calculated as <code>Base + x * StepX + y * StepY</code>,
+ * so any of 4 LCD orientations can be described with @ref TM_SPAN_Target_t structure.
+ * When LCD is rotated for 90 degrees, spans are vertical in memory, DMA2D then fills them as 1 pixel wide columns.
+ *
+ * \par Changelog
+ *
+@verbatim
+ Version 1.2
+  - CPU fills wait only for DMA2D operations on the same memory, DMA2D fills stay in queue when shape is drawn
+
+ Version 1.1
+  - DMA2D fills are put to TM DMA2D GRAPHIC command queue
+
+ Version 1.0
+  - First release
+@endverbatim
+ *
+ * \par Dependencies
+ *
+@verbatim
+ - STM32F4xx
+ - STM32F4xx DMA2D
+ - defines.h
+ - TM DMA2D GRAPHIC
+@endverbatim
+ */
+
+#include "stm32f4xx.h"
+#include "stm32f4xx_dma2d.h"
+#include "defines.h"
+#include "tm_stm32f4_dma2d_graphic.h"
+
+/**
+ * @defgroup TM_SPAN_Macros
+ * @brief    Library defines
+ * @{
+ */
+
+/**
+ * @brief  Minimal number of pixels in rectangle to be filled with DMA2D, smaller are filled with CPU
+ */
+#ifndef SPAN_DMA2D_MIN_PIXELS
+#define SPAN_DMA2D_MIN_PIXELS       48
+#endif
+
+/**
+ * @}
+ */
+
+/**
+ * @defgroup TM_SPAN_Typedefs
+ * @brief    Library Typedefs
+ * @{
+ */
+
+/**
+ * @brief  Framebuffer where shapes are drawn
+ */
+typedef struct {
+	uintptr_t Address; /*!< Start address of framebuffer in memory */
+	uint16_t Pitch;   /*!< Number of pixels in one framebuffer line in memory */
+	uint16_t Width;   /*!< LCD width in current orientation, used for clipping */
+	uint16_t Height;  /*!< LCD height in current orientation, used for clipping */
+	int32_t Base;     /*!< Memory index of pixel at X = 0 and Y = 0 */
+	int32_t StepX;    /*!< Memory index difference when X is increased by 1. Must be 1, -1, Pitch or -Pitch */
+	int32_t StepY;    /*!< Memory index difference when Y is increased by 1. Must be 1, -1, Pitch or -Pitch */
+} TM_SPAN_Target_t;
+
+/**
+ * @brief  Point for polygons
+ */
+typedef struct {
+	int16_t X; /*!< X coordinate */
+	int16_t Y; /*!< Y coordinate */
+} TM_SPAN_Point_t;
+
+/**
+ * @}
+ */
+
+/**
+ * @defgroup TM_SPAN_Functions
+ * @brief    Library Functions
+ * @{
+ */
+
+/**
+ * @brief  Fills rectangle
+ * @param  *Target: Pointer to @ref TM_SPAN_Target_t framebuffer description
+ * @param  x0: Left X coordinate
+ * @param  y0: Top Y coordinate
+ * @param  x1: Right X coordinate, included in rectangle
+ * @param  y1: Bottom Y coordinate, included in rectangle
+ * @param  color: Color in RGB565 format
+ * @retval None
+ */
+void TM_SPAN_FillRectangle(const TM_SPAN_Target_t* Target, int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color);
+
+/**
+ * @brief  Fills circle
+ * @param  *Target: Pointer to @ref TM_SPAN_Target_t framebuffer description
+ * @param  x0: X coordinate of center
+ * @param  y0: Y coordinate of center
+ * @param  r: Circle radius
+ * @param  color: Color in RGB565 format
+ * @retval None
+ */
+void TM_SPAN_FillCircle(const TM_SPAN_Target_t* Target, int16_t x0, int16_t y0, uint16_t r, uint16_t color);
+
+/**
+ * @brief  Fills rectangle with rounded corners
+ * @note   Radius is reduced if it is greater than half of width or height
+ * @param  *Target: Pointer to @ref TM_SPAN_Target_t framebuffer description
+ * @param  x0: Left X coordinate
+ * @param  y0: Top Y coordinate
+ * @param  x1: Right X coordinate, included in rectangle
+ * @param  y1: Bottom Y coordinate, included in rectangle
+ * @param  r: Corner radius
+ * @param  color: Color in RGB565 format
+ * @retval None
+ */
+void TM_SPAN_FillRoundedRectangle(const TM_SPAN_Target_t* Target, int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t r, uint16_t color);
+
+/**
+ * @brief  Fills triangle
+ * @param  *Target: Pointer to @ref TM_SPAN_Target_t framebuffer description
+ * @param  x1: First point X coordinate
+ * @param  y1: First point Y coordinate
+ * @param  x2: Second point X coordinate
+ * @param  y2: Second point Y coordinate
+ * @param  x3: Third point X coordinate
+ * @param  y3: Third point Y coordinate
+ * @param  color: Color in RGB565 format
+ * @retval None
+ */
+void TM_SPAN_FillTriangle(const TM_SPAN_Target_t* Target, int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t x3, int16_t y3, uint16_t color);
+
+/**
+ * @brief  Fills convex polygon
+ * @note   For concave polygons, each line is filled from the leftmost to the rightmost edge
+ * @param  *Target: Pointer to @ref TM_SPAN_Target_t framebuffer description
+ * @param  *Points: Pointer to @ref TM_SPAN_Point_t array of polygon points, in clockwise or counter clockwise order
+ * @param  count: Number of points
+ * @param  color: Color in RGB565 format
+ * @retval None
+ */
+void TM_SPAN_FillConvexPolygon(const TM_SPAN_Target_t* Target, const TM_SPAN_Point_t* Points, uint16_t count, uint16_t color);
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+
+/* C++ detection */
+#ifdef __cplusplus
+}
+#endif
+
+#endif
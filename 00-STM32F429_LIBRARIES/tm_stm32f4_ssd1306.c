@@ -24,21 +24,52 @@
 #define SSD1306_WRITEDATA(data)            TM_I2C_Write(SSD1306_I2C, SSD1306_I2C_ADDR, 0x40, (data))
 /* Absolute value */
 #define ABS(x)   ((x) > 0 ? (x) : -(x))
+/* Set or clear operation for color, inverted mode included */
+#define SSD1306_OP(color)                  ((((color) == SSD1306_COLOR_WHITE) ^ SSD1306.Inverted) ? TM_MONO_Op_Set : TM_MONO_Op_Clear)
+
+/* Number of pages, each page is 8 pixels high */
+#define SSD1306_PAGES                      (SSD1306_HEIGHT / 8)
+/* Control bytes and page/column commands before data of each span */
+#define SSD1306_SPAN_HEADER                7
 
 /* SSD1306 data buffer */
 static uint8_t SSD1306_Buffer[SSD1306_WIDTH * SSD1306_HEIGHT / 8];
 
+/* Changed columns in each page, end column is not included */
+static uint8_t SSD1306_DirtyStart[SSD1306_PAGES];
+static uint8_t SSD1306_DirtyEnd[SSD1306_PAGES];
+
+/* Spans ready to send, header and copy of changed columns for each dirty page */
+static uint8_t SSD1306_TxBuffer[SSD1306_PAGES * (SSD1306_WIDTH + SSD1306_SPAN_HEADER)];
+static uint8_t SSD1306_SpanLength[SSD1306_PAGES];
+
 /* Private SSD1306 structure */
 typedef struct {
 	uint16_t CurrentX;
 	uint16_t CurrentY;
 	uint8_t Inverted;
 	uint8_t Initialized;
+	uint8_t SpanCount;
+	uint8_t SpanIndex;
+	uint16_t TxOffset;
+	__IO uint8_t Busy;
 } SSD1306_t;
 
 /* Private variable */
 static SSD1306_t SSD1306;
 
+/* Private functions */
+static void TM_INT_SSD1306_MarkDirty(uint16_t page, uint16_t start, uint16_t end);
+static uint8_t TM_INT_SSD1306_BuildSpans(void);
+#if SSD1306_USE_DMA == 1
+static void TM_INT_SSD1306_InitDMA(void);
+static void TM_INT_SSD1306_StartSpan(void);
+static void TM_INT_SSD1306_StopDMA(void);
+#endif
+
+/* Buffer for drawing engine, changed columns are marked dirty */
+static const TM_MONO_t SSD1306_Mono = {SSD1306_Buffer, SSD1306_WIDTH, SSD1306_HEIGHT, TM_INT_SSD1306_MarkDirty};
+
 uint8_t TM_SSD1306_Init(void) {
 	/* Init delay */
 	TM_DELAY_Init();
@@ -52,6 +83,11 @@ uint8_t TM_SSD1306_Init(void) {
 		return 0;
 	}
 	
+#if SSD1306_USE_DMA == 1
+	/* Prepare DMA stream and I2C interrupts */
+	TM_INT_SSD1306_InitDMA();
+#endif
+	
 	/* A little delay */
 	Delayms(100);
 	
@@ -104,35 +140,80 @@ uint8_t TM_SSD1306_Init(void) {
 
 void TM_SSD1306_UpdateScreen(void) {
 	uint8_t m;
+	uint16_t offset = 0;
 	
-	for (m = 0; m < 8; m++) {
-		SSD1306_WRITECOMMAND(0xB0 + m);
-		SSD1306_WRITECOMMAND(0x00);
-		SSD1306_WRITECOMMAND(0x10);
-		
-		/* Write multi data */
-		TM_I2C_WriteMulti(SSD1306_I2C, SSD1306_I2C_ADDR, 0x40, &SSD1306_Buffer[SSD1306_WIDTH * m], SSD1306_WIDTH);
+	/* Wait for DMA update */
+	while (SSD1306.Busy);
+	
+	/* Send only changed columns of each page */
+	TM_INT_SSD1306_BuildSpans();
+	for (m = 0; m < SSD1306.SpanCount; m++) {
+		/* First control byte is sent as register */
+		TM_I2C_WriteMulti(SSD1306_I2C, SSD1306_I2C_ADDR, SSD1306_TxBuffer[offset], &SSD1306_TxBuffer[offset + 1], SSD1306_SpanLength[m] - 1);
+		offset += SSD1306_SpanLength[m];
 	}
 }
 
-void TM_SSD1306_ToggleInvert(void) {
-	uint16_t i;
+uint8_t TM_SSD1306_UpdateScreenDMA(void) {
+#if SSD1306_USE_DMA == 1
+	/* Previous update is still in progress */
+	if (SSD1306.Busy) {
+		return 0;
+	}
 	
+	/* Nothing changed */
+	if (!TM_INT_SSD1306_BuildSpans()) {
+		return 1;
+	}
+	
+	/* Start with first span, next ones are started from interrupt */
+	SSD1306.SpanIndex = 0;
+	SSD1306.TxOffset = 0;
+	SSD1306.Busy = 1;
+	TM_INT_SSD1306_StartSpan();
+#else
+	/* Blocking update */
+	TM_SSD1306_UpdateScreen();
+#endif
+	
+	/* Update started */
+	return 1;
+}
+
+uint8_t TM_SSD1306_IsUpdating(void) {
+	/* Return DMA status */
+	return SSD1306.Busy;
+}
+
+void TM_SSD1306_Invalidate(void) {
+	uint8_t m;
+	
+	/* Whole screen is sent on next update */
+	for (m = 0; m < SSD1306_PAGES; m++) {
+		TM_INT_SSD1306_MarkDirty(m, 0, SSD1306_WIDTH);
+	}
+}
+
+const TM_MONO_t* TM_SSD1306_GetMono(void) {
+	return &SSD1306_Mono;
+}
+
+void TM_SSD1306_ToggleInvert(void) {
 	/* Toggle invert */
 	SSD1306.Inverted = !SSD1306.Inverted;
 	
-	/* Do memory toggle */
-	for (i = 0; i < sizeof(SSD1306_Buffer); i++) {
-		SSD1306_Buffer[i] = ~SSD1306_Buffer[i];
-	}
+	/* Do memory toggle, all columns are marked as changed */
+	TM_MONO_Invert(&SSD1306_Mono);
 }
 
 void TM_SSD1306_Fill(SSD1306_COLOR_t color) {
-	/* Set memory */
-	memset(SSD1306_Buffer, (color == SSD1306_COLOR_BLACK) ? 0x00 : 0xFF, sizeof(SSD1306_Buffer));
+	/* Set memory, all columns are marked as changed */
+	TM_MONO_Fill(&SSD1306_Mono, color != SSD1306_COLOR_BLACK);
 }
 
 void TM_SSD1306_DrawPixel(uint16_t x, uint16_t y, SSD1306_COLOR_t color) {
+	uint8_t old;
+	
 	if (
 		x >= SSD1306_WIDTH ||
 		y >= SSD1306_HEIGHT
@@ -147,11 +228,17 @@ void TM_SSD1306_DrawPixel(uint16_t x, uint16_t y, SSD1306_COLOR_t color) {
 	}
 	
 	/* Set color */
+	old = SSD1306_Buffer[x + (y / 8) * SSD1306_WIDTH];
 	if (color == SSD1306_COLOR_WHITE) {
 		SSD1306_Buffer[x + (y / 8) * SSD1306_WIDTH] |= 1 << (y % 8);
 	} else {
 		SSD1306_Buffer[x + (y / 8) * SSD1306_WIDTH] &= ~(1 << (y % 8));
 	}
+	
+	/* Column is sent on next update only if it changed */
+	if (SSD1306_Buffer[x + (y / 8) * SSD1306_WIDTH] != old) {
+		TM_INT_SSD1306_MarkDirty(y / 8, x, x + 1);
+	}
 }
 
 void TM_SSD1306_GotoXY(uint16_t x, uint16_t y) {
@@ -161,8 +248,6 @@ void TM_SSD1306_GotoXY(uint16_t x, uint16_t y) {
 }
 
 char TM_SSD1306_Putc(char ch, TM_FontDef_t* Font, SSD1306_COLOR_t color) {
-	uint32_t i, b, j;
-	
 	/* Check available space in LCD */
 	if (
 		SSD1306_WIDTH <= (SSD1306.CurrentX + Font->FontWidth) ||
@@ -172,17 +257,8 @@ char TM_SSD1306_Putc(char ch, TM_FontDef_t* Font, SSD1306_COLOR_t color) {
 		return 0;
 	}
 	
-	/* Go through font */
-	for (i = 0; i < Font->FontHeight; i++) {
-		b = Font->data[(ch - 32) * Font->FontHeight + i];
-		for (j = 0; j < Font->FontWidth; j++) {
-			if ((b << j) & 0x8000) {
-				TM_SSD1306_DrawPixel(SSD1306.CurrentX + j, (SSD1306.CurrentY + i), (SSD1306_COLOR_t) color);
-			} else {
-				TM_SSD1306_DrawPixel(SSD1306.CurrentX + j, (SSD1306.CurrentY + i), (SSD1306_COLOR_t)!color);
-			}
-		}
-	}
+	/* Draw character with background, column by column */
+	TM_MONO_Putc(&SSD1306_Mono, SSD1306.CurrentX, SSD1306.CurrentY, ch, Font, SSD1306_OP(color) == TM_MONO_Op_Set ? TM_MONO_Op_Copy : TM_MONO_Op_CopyInverted);
 	
 	/* Increase pointer */
 	SSD1306.CurrentX += Font->FontWidth;
@@ -210,7 +286,7 @@ char TM_SSD1306_Puts(char* str, TM_FontDef_t* Font, SSD1306_COLOR_t color) {
  
 
 void TM_SSD1306_DrawLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, SSD1306_COLOR_t c) {
-	int16_t dx, dy, sx, sy, err, e2, i, tmp; 
+	int16_t dx, dy, sx, sy, err, e2, tmp; 
 	
 	/* Check for overflow */
 	if (x0 >= SSD1306_WIDTH) {
@@ -246,9 +322,7 @@ void TM_SSD1306_DrawLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, SSD
 		}
 		
 		/* Vertical line */
-		for (i = y0; i <= y1; i++) {
-			TM_SSD1306_DrawPixel(x0, i, c);
-		}
+		TM_MONO_FillRectangle(&SSD1306_Mono, x0, y0, 1, y1 - y0 + 1, SSD1306_OP(c));
 		
 		/* Return from function */
 		return;
@@ -268,9 +342,7 @@ void TM_SSD1306_DrawLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, SSD
 		}
 		
 		/* Horizontal line */
-		for (i = x0; i <= x1; i++) {
-			TM_SSD1306_DrawPixel(i, y0, c);
-		}
+		TM_MONO_FillRectangle(&SSD1306_Mono, x0, y0, x1 - x0 + 1, 1, SSD1306_OP(c));
 		
 		/* Return from function */
 		return;
@@ -319,8 +391,6 @@ void TM_SSD1306_DrawRectangle(uint16_t x, uint16_t y, uint16_t w, uint16_t h, SS
 }
 
 void TM_SSD1306_DrawFilledRectangle(uint16_t x, uint16_t y, uint16_t w, uint16_t h, SSD1306_COLOR_t c) {
-	uint8_t i;
-	
 	/* Check input parameters */
 	if (
 		x >= SSD1306_WIDTH ||
@@ -338,11 +408,8 @@ void TM_SSD1306_DrawFilledRectangle(uint16_t x, uint16_t y, uint16_t w, uint16_t
 		h = SSD1306_HEIGHT - y;
 	}
 	
-	/* Draw lines */
-	for (i = 0; i <= h; i++) {
-		/* Draw lines */
-		TM_SSD1306_DrawLine(x, y + i, x + w, y + i, c);
-	}
+	/* Fill all pages at once, last row and column are included */
+	TM_MONO_FillRectangle(&SSD1306_Mono, x, y, w + 1, h + 1, SSD1306_OP(c));
 }
 
 void TM_SSD1306_DrawTriangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t x3, uint16_t y3, SSD1306_COLOR_t color) {
@@ -475,12 +542,171 @@ void TM_SSD1306_DrawFilledCircle(int16_t x0, int16_t y0, int16_t r, SSD1306_COLO
 }
  
 void SSD1306_ON(void) {
+	while (SSD1306.Busy);
 	SSD1306_WRITECOMMAND(0x8D);  
 	SSD1306_WRITECOMMAND(0x14);  
 	SSD1306_WRITECOMMAND(0xAF);  
 }
 void SSD1306_OFF(void) {
+	while (SSD1306.Busy);
 	SSD1306_WRITECOMMAND(0x8D);  
 	SSD1306_WRITECOMMAND(0x10);
 	SSD1306_WRITECOMMAND(0xAE);  
 }
+
+/* Private functions */
+static void TM_INT_SSD1306_MarkDirty(uint16_t page, uint16_t start, uint16_t end) {
+	/* Page is clean when start is not lower than end */
+	if (SSD1306_DirtyStart[page] >= SSD1306_DirtyEnd[page]) {
+		SSD1306_DirtyStart[page] = start;
+		SSD1306_DirtyEnd[page] = end;
+		return;
+	}
+	
+	/* Extend range */
+	if (start < SSD1306_DirtyStart[page]) {
+		SSD1306_DirtyStart[page] = start;
+	}
+	if (end > SSD1306_DirtyEnd[page]) {
+		SSD1306_DirtyEnd[page] = end;
+	}
+}
+
+static uint8_t TM_INT_SSD1306_BuildSpans(void) {
+	uint8_t* tx = SSD1306_TxBuffer;
+	uint8_t m, start, count;
+	
+	SSD1306.SpanCount = 0;
+	for (m = 0; m < SSD1306_PAGES; m++) {
+		/* Page did not change */
+		if (SSD1306_DirtyStart[m] >= SSD1306_DirtyEnd[m]) {
+			continue;
+		}
+		start = SSD1306_DirtyStart[m];
+		count = SSD1306_DirtyEnd[m] - start;
+		
+		/* Commands with Co bit set, each is followed by new control byte, then data till end of transfer */
+		*tx++ = 0x80;
+		*tx++ = 0xB0 + m;            /* Page address */
+		*tx++ = 0x80;
+		*tx++ = start & 0x0F;        /* Lower column address */
+		*tx++ = 0x80;
+		*tx++ = 0x10 | (start >> 4); /* Higher column address */
+		*tx++ = 0x40;
+		
+		/* Copy columns, drawing may continue while DMA sends them */
+		memcpy(tx, &SSD1306_Buffer[SSD1306_WIDTH * m + start], count);
+		tx += count;
+		SSD1306_SpanLength[SSD1306.SpanCount++] = SSD1306_SPAN_HEADER + count;
+		
+		/* Page is clean */
+		SSD1306_DirtyStart[m] = SSD1306_WIDTH;
+		SSD1306_DirtyEnd[m] = 0;
+	}
+	
+	/* Return number of spans */
+	return SSD1306.SpanCount;
+}
+
+#if SSD1306_USE_DMA == 1
+static void TM_INT_SSD1306_InitDMA(void) {
+	DMA_InitTypeDef DMA_InitStruct;
+	NVIC_InitTypeDef NVIC_InitStruct;
+	
+	/* Enable DMA clock */
+	if (SSD1306_DMA_STREAM >= DMA2_Stream0) {
+		RCC->AHB1ENR |= RCC_AHB1ENR_DMA2EN;
+	} else {
+		RCC->AHB1ENR |= RCC_AHB1ENR_DMA1EN;
+	}
+	
+	/* Memory to I2C data register, address and count are set for each span */
+	DMA_StructInit(&DMA_InitStruct);
+	DMA_InitStruct.DMA_Channel = SSD1306_DMA_CHANNEL;
+	DMA_InitStruct.DMA_PeripheralBaseAddr = (uint32_t) &SSD1306_I2C->DR;
+	DMA_InitStruct.DMA_Memory0BaseAddr = (uint32_t) SSD1306_TxBuffer;
+	DMA_InitStruct.DMA_DIR = DMA_DIR_MemoryToPeripheral;
+	DMA_InitStruct.DMA_BufferSize = 1;
+	DMA_InitStruct.DMA_MemoryInc = DMA_MemoryInc_Enable;
+	DMA_Init(SSD1306_DMA_STREAM, &DMA_InitStruct);
+	
+	/* I2C event and error interrupts */
+	NVIC_InitStruct.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_InitStruct.NVIC_IRQChannelPreemptionPriority = SSD1306_NVIC_PRIORITY;
+	NVIC_InitStruct.NVIC_IRQChannelSubPriority = SSD1306_NVIC_SUBPRIORITY;
+	NVIC_InitStruct.NVIC_IRQChannel = SSD1306_I2C_EV_IRQn;
+	NVIC_Init(&NVIC_InitStruct);
+	NVIC_InitStruct.NVIC_IRQChannel = SSD1306_I2C_ER_IRQn;
+	NVIC_Init(&NVIC_InitStruct);
+}
+
+static void TM_INT_SSD1306_StartSpan(void) {
+	/* Set span memory */
+	TM_DMA_ClearFlags(SSD1306_DMA_STREAM);
+	SSD1306_DMA_STREAM->M0AR = (uint32_t) &SSD1306_TxBuffer[SSD1306.TxOffset];
+	SSD1306_DMA_STREAM->NDTR = SSD1306_SpanLength[SSD1306.SpanIndex];
+	
+	/* Enable interrupts and generate start, transfer continues in interrupt */
+	SSD1306_I2C->CR2 |= I2C_CR2_ITEVTEN | I2C_CR2_ITERREN;
+	SSD1306_I2C->CR1 |= I2C_CR1_START;
+}
+
+static void TM_INT_SSD1306_StopDMA(void) {
+	/* Disable DMA requests and stream */
+	SSD1306_I2C->CR2 &= ~I2C_CR2_DMAEN;
+	SSD1306_DMA_STREAM->CR &= ~DMA_SxCR_EN;
+	
+	/* Generate stop */
+	SSD1306_I2C->CR1 |= I2C_CR1_STOP;
+}
+
+void SSD1306_I2C_EV_IRQHandler(void) {
+	uint32_t timeout;
+	uint16_t sr1 = SSD1306_I2C->SR1;
+	
+	if (sr1 & I2C_SR1_SB) {
+		/* Start sent, send address with write bit */
+		SSD1306_I2C->DR = SSD1306_I2C_ADDR & ~I2C_OAR1_ADD0;
+	} else if (sr1 & I2C_SR1_ADDR) {
+		/* Address acknowledged, DMA feeds data register */
+		SSD1306_DMA_STREAM->CR |= DMA_SxCR_EN;
+		SSD1306_I2C->CR2 |= I2C_CR2_DMAEN;
+		
+		/* Clear flag by reading SR2 */
+		(void)SSD1306_I2C->SR2;
+	} else if (sr1 & I2C_SR1_BTF) {
+		/* Last byte is sent when DMA has nothing more */
+		if (SSD1306_DMA_STREAM->NDTR) {
+			return;
+		}
+		TM_INT_SSD1306_StopDMA();
+		
+		/* Wait for stop condition before next start */
+		timeout = TM_I2C_TIMEOUT;
+		while ((SSD1306_I2C->CR1 & I2C_CR1_STOP) && --timeout);
+		
+		/* Next span */
+		SSD1306.TxOffset += SSD1306_SpanLength[SSD1306.SpanIndex++];
+		if (SSD1306.SpanIndex < SSD1306.SpanCount) {
+			TM_INT_SSD1306_StartSpan();
+		} else {
+			/* All spans sent */
+			SSD1306_I2C->CR2 &= ~(I2C_CR2_ITEVTEN | I2C_CR2_ITERREN);
+			SSD1306.Busy = 0;
+		}
+	}
+}
+
+void SSD1306_I2C_ER_IRQHandler(void) {
+	/* Clear error flags */
+	SSD1306_I2C->SR1 &= ~(I2C_SR1_AF | I2C_SR1_ARLO | I2C_SR1_BERR | I2C_SR1_OVR);
+	
+	/* Abort update */
+	TM_INT_SSD1306_StopDMA();
+	SSD1306_I2C->CR2 &= ~(I2C_CR2_ITEVTEN | I2C_CR2_ITERREN);
+	SSD1306.Busy = 0;
+	
+	/* Send everything again on next update */
+	TM_SSD1306_Invalidate();
+}
+#endif
@@ -3,7 +3,7 @@
  * @email   tilen@majerle.eu
  * @website http://stm32f4-discovery.net
  * @link    http://stm32f4-discovery.net/2015/05/library-61-ssd1306-oled-i2c-lcd-for-stm32f4xx
- * @version v1.0
+ * @version v1.2
  * @ide     Keil uVision
  * @license GNU GPL v3
  * @brief   Library for 128x64 SSD1306 I2C LCD
@@ -28,7 +28,7 @@
 @endverbatim
  */
 #ifndef TM_SSD1306_H
-#define TM_SSD1306_H 100
+#define TM_SSD1306_H 120
 
 /* C++ detection */
 #ifdef __cplusplus
@@ -77,11 +77,58 @@ SDA        |PC9          |Serial data line
 //Select custom width and height if your LCD differs in size
 #define SSD1306_WIDTH            128
 #define SSD1306_HEIGHT           64
+@endverbatim
+ *
+ * \par Screen update
+ *
+ * Drawing functions change only buffer in RAM. For each page (8 pixel rows), library remembers range of columns
+ * which really changed, so @ref TM_SSD1306_UpdateScreen sends only these columns instead of whole 1 kB buffer.
+ * Changing one number on screen sends a few bytes instead of 1024.
+ *
+ * @ref TM_SSD1306_UpdateScreenDMA does the same without waiting. Changed columns are copied to transmit buffer,
+ * then I2C interrupt and DMA send them while CPU continues drawing. Check @ref TM_SSD1306_IsUpdating before
+ * using other devices on the same I2C bus.
+ *
+ * DMA and I2C interrupt settings must match selected I2C. Default values are for I2C3, for other I2C add lines below to defines.h:
+ *
+@verbatim
+//I2C1 TX is on DMA1 Stream 6 or 7, channel 1, I2C2 TX is on DMA1 Stream 7, channel 7
+#define SSD1306_DMA_STREAM           DMA1_Stream6
+#define SSD1306_DMA_CHANNEL          DMA_Channel_1
+#define SSD1306_I2C_EV_IRQn          I2C1_EV_IRQn
+#define SSD1306_I2C_EV_IRQHandler    I2C1_EV_IRQHandler
+#define SSD1306_I2C_ER_IRQn          I2C1_ER_IRQn
+#define SSD1306_I2C_ER_IRQHandler    I2C1_ER_IRQHandler
+
+//Disable DMA, if I2C interrupts are used elsewhere. TM_SSD1306_UpdateScreenDMA then waits
+#define SSD1306_USE_DMA              0
+@endverbatim
+ *
+ * \par Drawing engine
+ *
+ * Filled rectangles, horizontal and vertical lines, characters, fill and invert use @ref TM_MONO library,
+ * which changes whole bytes and words of buffer instead of one pixel at a time.
+ * Use @ref TM_SSD1306_GetMono with @ref TM_MONO functions for sprites, XOR drawing and scrolling,
+ * changed columns are sent on next update the same way:
+ *
+@verbatim
+//Move screen content 8 pixels up and draw sprite over it with XOR
+TM_MONO_Scroll(TM_SSD1306_GetMono(), 0, -8);
+TM_MONO_DrawSprite(TM_SSD1306_GetMono(), 100, 40, sprite, NULL, 16, 16, TM_MONO_Op_Xor);
+TM_SSD1306_UpdateScreenDMA();
 @endverbatim
  *
  * \par Changelog
  *
 @verbatim
+ Version 1.2
+  - Rectangles, lines, characters, fill and invert are drawn with TM MONO library
+  - Added TM_SSD1306_GetMono function
+
+ Version 1.1
+  - Only changed columns of each page are sent to LCD
+  - Added TM_SSD1306_UpdateScreenDMA, TM_SSD1306_IsUpdating and TM_SSD1306_Invalidate functions
+
  Version 1.0
   - First release
 @endverbatim
@@ -93,7 +140,9 @@ SDA        |PC9          |Serial data line
  - STM32F4xx RCC
  - defines.h
  - TM I2C
+ - TM DMA
  - TM FONTS
+ - TM MONO
  - TM DELAY
  - string.h
  - stdlib.h
@@ -103,7 +152,9 @@ SDA        |PC9          |Serial data line
 #include "stm32f4xx.h"
 #include "defines.h"
 #include "tm_stm32f4_i2c.h"
+#include "tm_stm32f4_dma.h"
 #include "tm_stm32f4_fonts.h"
+#include "tm_stm32f4_mono.h"
 #include "tm_stm32f4_delay.h"
 
 #include "stdlib.h"
@@ -138,6 +189,33 @@ SDA        |PC9          |Serial data line
 #define SSD1306_HEIGHT           64
 #endif
 
+/* Use DMA and I2C interrupts for TM_SSD1306_UpdateScreenDMA */
+#ifndef SSD1306_USE_DMA
+#define SSD1306_USE_DMA          1
+#endif
+
+/* DMA stream and channel for I2C TX, default for I2C3 */
+#ifndef SSD1306_DMA_STREAM
+#define SSD1306_DMA_STREAM       DMA1_Stream4
+#define SSD1306_DMA_CHANNEL      DMA_Channel_3
+#endif
+
+/* I2C interrupts, default for I2C3 */
+#ifndef SSD1306_I2C_EV_IRQn
+#define SSD1306_I2C_EV_IRQn          I2C3_EV_IRQn
+#define SSD1306_I2C_EV_IRQHandler    I2C3_EV_IRQHandler
+#define SSD1306_I2C_ER_IRQn          I2C3_ER_IRQn
+#define SSD1306_I2C_ER_IRQHandler    I2C3_ER_IRQHandler
+#endif
+
+/* I2C interrupt priority */
+#ifndef SSD1306_NVIC_PRIORITY
+#define SSD1306_NVIC_PRIORITY        0x06
+#endif
+#ifndef SSD1306_NVIC_SUBPRIORITY
+#define SSD1306_NVIC_SUBPRIORITY     0x00
+#endif
+
 /**
  * @}
  */
@@ -178,11 +256,48 @@ uint8_t TM_SSD1306_Init(void);
 /** 
  * @brief  Updates buffer from internal RAM to LCD
  * @note   This function must be called each time you do some changes to LCD, to update buffer from RAM to LCD
+ * @note   Only changed columns are sent. Function waits for DMA update in progress first
  * @param  None
  * @retval None
  */
 void TM_SSD1306_UpdateScreen(void);
 
+/** 
+ * @brief  Starts update of changed columns from internal RAM to LCD with DMA
+ * @note   Changed columns are copied before function returns, drawing can continue immediately
+ * @param  None
+ * @retval Update status:
+ *           - 0: Previous update is still in progress, nothing was started
+ *           - > 0: Update started or there was nothing to send
+ */
+uint8_t TM_SSD1306_UpdateScreenDMA(void);
+
+/** 
+ * @brief  Checks if DMA update is in progress
+ * @param  None
+ * @retval Update status:
+ *           - 0: LCD is updated, I2C can be used
+ *           - > 0: DMA update in progress
+ */
+uint8_t TM_SSD1306_IsUpdating(void);
+
+/** 
+ * @brief  Marks whole screen as changed, it is sent on next update
+ * @note   Use it when LCD content was lost, for example after LCD power cycle
+ * @param  None
+ * @retval None
+ */
+void TM_SSD1306_Invalidate(void);
+
+/**
+ * @brief  Gets description of LCD buffer for @ref TM_MONO functions
+ * @note   Changes made with @ref TM_MONO functions are sent on next update.
+ *         Colors are not swapped by @ref TM_SSD1306_ToggleInvert, use opposite operation when screen is inverted
+ * @param  None
+ * @retval Pointer to @ref TM_MONO_t structure
+ */
+const TM_MONO_t* TM_SSD1306_GetMono(void);
+
 /**
  * @brief  Toggles pixels invertion inside internal RAM
  * @note   @ref TM_SSD1306_UpdateScreen() must be called after that in order to see updated LCD screen
@@ -78,10 +78,68 @@
 #define STMPE811_TEMP_DATA				0x61	//Temperature data access port
 #define STMPE811_TEMP_TH				0x62	//Threshold for temperature controlled interrupt
 
+/* Touch detected in TSC_CTRL */
+#define STMPE811_TSC_STA				0x80
+
+/* Interrupt bits in INT_EN and INT_STA */
+#define STMPE811_INT_TOUCH_DET			0x01
+#define STMPE811_INT_FIFO_TH			0x02
+
+/* Global interrupt enable in INT_CTRL, level interrupt, active low */
+#define STMPE811_INT_CTRL_GLOBAL		0x01
+
+/* Register address for reading FIFO without auto increment */
+#define STMPE811_TSC_DATA_NON_INC		0xD7
+
+/* Bytes of one sample in XYZ mode */
+#define STMPE811_SAMPLE_SIZE			4
+
+/* Maximal number of samples read in one I2C transaction */
+#define STMPE811_BURST_SAMPLES			16
+
+#if STMPE811_USE_IT == 1
+/* Interrupt mode state */
+typedef struct {
+	uint8_t Enabled;                          /* Interrupt mode is active */
+	__IO uint8_t Pending;                     /* Set from EXTI handler */
+	uint8_t Pressed;                          /* Touch is pressed */
+	uint8_t MedianCount;                      /* Number of valid samples in median buffer */
+	uint16_t MedianX[3];                      /* Last 3 raw X samples */
+	uint16_t MedianY[3];                      /* Last 3 raw Y samples */
+	int32_t FilterX;                          /* IIR filtered X, 4 fractional bits */
+	int32_t FilterY;                          /* IIR filtered Y, 4 fractional bits */
+	uint16_t RawX;                            /* Filtered raw X */
+	uint16_t RawY;                            /* Filtered raw Y */
+	uint16_t X;                               /* X in Portrait_2 orientation */
+	uint16_t Y;                               /* Y in Portrait_2 orientation */
+	TM_STMPE811_Orientation_t Orientation;    /* Orientation of events */
+	TM_STMPE811_Event_t Events[STMPE811_EVENT_QUEUE_SIZE];
+	uint8_t In;                               /* Write index */
+	uint8_t Out;                              /* Read index */
+	uint8_t Count;                            /* Number of events in queue */
+	TM_STMPE811_Calibration_t Calibration;    /* Calibration coefficients */
+} TM_STMPE811_IT_t;
+
+/* Default calibration, the same as conversion in polling mode */
+static const TM_STMPE811_Calibration_t STMPE811_DefaultCalibration = {
+	-11, 0, 42350,
+	0, 15, -5400,
+	165
+};
+
+static TM_STMPE811_IT_t STMPE811_IT;
+#endif
+
 /* Private functions */
 uint8_t TM_STMPE811_Read(uint8_t reg);
 uint16_t TM_STMPE811_ReadX(uint16_t x);
 uint16_t TM_STMPE811_ReadY(uint16_t y);
+#if STMPE811_USE_IT == 1
+static void TM_STMPE811_Sample(uint16_t rawx, uint16_t rawy);
+static void TM_STMPE811_Convert(TM_STMPE811_Orientation_t orientation, uint16_t* x, uint16_t* y);
+static void TM_STMPE811_AddEvent(TM_STMPE811_EventType_t type);
+static uint16_t TM_STMPE811_Median(uint16_t* values);
+#endif
 
 TM_STMPE811_State_t TM_STMPE811_Init(void) {
 	uint8_t bytes[2], mode;
@@ -193,6 +251,24 @@ TM_STMPE811_State_t TM_STMPE811_ReadTouch(TM_STMPE811_TouchData *structdata) {
 	/* Save state */
 	structdata->last_pressed = structdata->pressed;
 	
+#if STMPE811_USE_IT == 1
+	/* In interrupt mode, use filtered values */
+	if (STMPE811_IT.Enabled) {
+		/* Read new samples if any */
+		TM_STMPE811_Process();
+		
+		if (!STMPE811_IT.Pressed) {
+			structdata->pressed = TM_STMPE811_State_Released;
+			return TM_STMPE811_State_Released;
+		}
+		
+		/* Get coordinates */
+		TM_STMPE811_Convert(structdata->orientation, &structdata->x, &structdata->y);
+		structdata->pressed = TM_STMPE811_State_Pressed;
+		return TM_STMPE811_State_Pressed;
+	}
+#endif
+	
 	/* Read */
 	val = TM_STMPE811_Read(STMPE811_TSC_CTRL);
 	if ((val & 0x80) == 0) {
@@ -297,6 +373,290 @@ uint16_t TM_STMPE811_ReadY(uint16_t y) {
 		return val;
 	}
 	return y;
-}	
+}
+
+#if STMPE811_USE_IT == 1
+TM_STMPE811_State_t TM_STMPE811_InitIT(TM_STMPE811_Orientation_t orientation) {
+	/* Disable interrupt mode while initializing */
+	STMPE811_IT.Enabled = 0;
+	
+	/* Initialize controller */
+	if (TM_STMPE811_Init() != TM_STMPE811_State_Ok) {
+		return TM_STMPE811_State_Error;
+	}
+	
+	/* FIFO threshold for interrupt */
+	TM_I2C_Write(STMPE811_I2C, STMPE811_ADDRESS, STMPE811_FIFO_TH, STMPE811_FIFO_THRESHOLD);
+	
+	/* Reset FIFO */
+	TM_I2C_Write(STMPE811_I2C, STMPE811_ADDRESS, STMPE811_FIFO_STA, 0x01);
+	TM_I2C_Write(STMPE811_I2C, STMPE811_ADDRESS, STMPE811_FIFO_STA, 0x00);
+	
+	/* Interrupt on touch detection and FIFO threshold */
+	TM_I2C_Write(STMPE811_I2C, STMPE811_ADDRESS, STMPE811_INT_EN, STMPE811_INT_TOUCH_DET | STMPE811_INT_FIFO_TH);
+	
+	/* Clear pending interrupts */
+	TM_I2C_Write(STMPE811_I2C, STMPE811_ADDRESS, STMPE811_INT_STA, 0xFF);
+	
+	/* Enable global interrupt, level, active low */
+	TM_I2C_Write(STMPE811_I2C, STMPE811_ADDRESS, STMPE811_INT_CTRL, STMPE811_INT_CTRL_GLOBAL);
+	
+	/* Reset state */
+	memset((void *)&STMPE811_IT, 0, sizeof(STMPE811_IT));
+	STMPE811_IT.Orientation = orientation;
+	STMPE811_IT.Calibration = STMPE811_DefaultCalibration;
+	
+	/* Attach INT pin to EXTI */
+	if (TM_EXTI_Attach(STMPE811_INT_PORT, STMPE811_INT_PIN, TM_EXTI_Trigger_Falling) != TM_EXTI_Result_Ok) {
+		return TM_STMPE811_State_Error;
+	}
+	
+	/* Enable interrupt mode */
+	STMPE811_IT.Enabled = 1;
+	
+	/* Return OK */
+	return TM_STMPE811_State_Ok;
+}
+
+void TM_STMPE811_InterruptHandler(void) {
+	/* Data are available */
+	STMPE811_IT.Pending = 1;
+}
+
+uint8_t TM_STMPE811_Process(void) {
+	uint8_t data[STMPE811_BURST_SAMPLES * STMPE811_SAMPLE_SIZE];
+	uint8_t status, count, n, i, *d;
+	uint8_t events = STMPE811_IT.Count;
+	
+	/* Nothing to do when INT line is not active */
+	if (
+		!STMPE811_IT.Enabled ||
+		(!STMPE811_IT.Pending && TM_GPIO_GetInputPinValue(STMPE811_INT_PORT, STMPE811_INT_PIN))
+	) {
+		return 0;
+	}
+	STMPE811_IT.Pending = 0;
+	
+	/* Read interrupt status */
+	status = TM_STMPE811_Read(STMPE811_INT_STA);
+	
+	/* Read all samples from FIFO */
+	count = TM_STMPE811_Read(STMPE811_FIFO_SIZE);
+	while (count) {
+		n = count > STMPE811_BURST_SAMPLES ? STMPE811_BURST_SAMPLES : count;
+		
+		/* Burst read */
+		TM_I2C_ReadMulti(STMPE811_I2C, STMPE811_ADDRESS, STMPE811_TSC_DATA_NON_INC, data, n * STMPE811_SAMPLE_SIZE);
+		
+		/* 12-bit X, 12-bit Y and 8-bit Z */
+		for (i = 0, d = data; i < n; i++, d += STMPE811_SAMPLE_SIZE) {
+			TM_STMPE811_Sample((d[0] << 4) | (d[1] >> 4), ((d[1] & 0x0F) << 8) | d[2]);
+		}
+		count -= n;
+	}
+	
+	/* Check for release */
+	if ((TM_STMPE811_Read(STMPE811_TSC_CTRL) & STMPE811_TSC_STA) == 0) {
+		if (STMPE811_IT.Pressed) {
+			STMPE811_IT.Pressed = 0;
+			TM_STMPE811_AddEvent(TM_STMPE811_EventType_Up);
+		}
+		
+		/* Reset FIFO, remaining samples are from release */
+		TM_I2C_Write(STMPE811_I2C, STMPE811_ADDRESS, STMPE811_FIFO_STA, 0x01);
+		TM_I2C_Write(STMPE811_I2C, STMPE811_ADDRESS, STMPE811_FIFO_STA, 0x00);
+	}
+	
+	/* Clear interrupts */
+	TM_I2C_Write(STMPE811_I2C, STMPE811_ADDRESS, STMPE811_INT_STA, status);
+	
+	/* Return number of new events */
+	return STMPE811_IT.Count > events ? STMPE811_IT.Count - events : 0;
+}
+
+uint8_t TM_STMPE811_GetEvent(TM_STMPE811_Event_t* Event) {
+	/* Read new samples if any */
+	TM_STMPE811_Process();
+	
+	/* Queue empty */
+	if (STMPE811_IT.Count == 0) {
+		return 0;
+	}
+	
+	/* Get event */
+	*Event = STMPE811_IT.Events[STMPE811_IT.Out];
+	if (++STMPE811_IT.Out >= STMPE811_EVENT_QUEUE_SIZE) {
+		STMPE811_IT.Out = 0;
+	}
+	STMPE811_IT.Count--;
+	
+	/* Event stored */
+	return 1;
+}
+
+void TM_STMPE811_SetCalibration(const TM_STMPE811_Calibration_t* Calibration) {
+	/* Save coefficients */
+	STMPE811_IT.Calibration = *Calibration;
+}
+
+TM_STMPE811_State_t TM_STMPE811_CalculateCalibration(TM_STMPE811_Calibration_t* Calibration, const TM_STMPE811_Point_t* Lcd, const TM_STMPE811_Point_t* Raw) {
+	int64_t x0 = Raw[0].x, x1 = Raw[1].x, x2 = Raw[2].x;
+	int64_t y0 = Raw[0].y, y1 = Raw[1].y, y2 = Raw[2].y;
+	int64_t xd0 = Lcd[0].x, xd1 = Lcd[1].x, xd2 = Lcd[2].x;
+	int64_t yd0 = Lcd[0].y, yd1 = Lcd[1].y, yd2 = Lcd[2].y;
+	
+	/* Common divider */
+	Calibration->Divider = (x0 - x2) * (y1 - y2) - (x1 - x2) * (y0 - y2);
+	if (Calibration->Divider == 0) {
+		/* Points are on one line */
+		return TM_STMPE811_State_Error;
+	}
+	
+	/* X coefficients */
+	Calibration->An = (xd0 - xd2) * (y1 - y2) - (xd1 - xd2) * (y0 - y2);
+	Calibration->Bn = (x0 - x2) * (xd1 - xd2) - (xd0 - xd2) * (x1 - x2);
+	Calibration->Cn = y0 * (x2 * xd1 - x1 * xd2) + y1 * (x0 * xd2 - x2 * xd0) + y2 * (x1 * xd0 - x0 * xd1);
+	
+	/* Y coefficients */
+	Calibration->Dn = (yd0 - yd2) * (y1 - y2) - (yd1 - yd2) * (y0 - y2);
+	Calibration->En = (x0 - x2) * (yd1 - yd2) - (yd0 - yd2) * (x1 - x2);
+	Calibration->Fn = y0 * (x2 * yd1 - x1 * yd2) + y1 * (x0 * yd2 - x2 * yd0) + y2 * (x1 * yd0 - x0 * yd1);
+	
+	/* Return OK */
+	return TM_STMPE811_State_Ok;
+}
+
+static void TM_STMPE811_Sample(uint16_t rawx, uint16_t rawy) {
+	int32_t x, y;
+	uint8_t i;
+	
+	/* First sample after touch fills filters */
+	if (!STMPE811_IT.Pressed) {
+		STMPE811_IT.MedianCount = 0;
+	}
+	
+	/* Median of last 3 samples */
+	if (STMPE811_IT.MedianCount < 3) {
+		for (i = STMPE811_IT.MedianCount; i < 3; i++) {
+			STMPE811_IT.MedianX[i] = rawx;
+			STMPE811_IT.MedianY[i] = rawy;
+		}
+	} else {
+		STMPE811_IT.MedianX[0] = STMPE811_IT.MedianX[1];
+		STMPE811_IT.MedianX[1] = STMPE811_IT.MedianX[2];
+		STMPE811_IT.MedianX[2] = rawx;
+		STMPE811_IT.MedianY[0] = STMPE811_IT.MedianY[1];
+		STMPE811_IT.MedianY[1] = STMPE811_IT.MedianY[2];
+		STMPE811_IT.MedianY[2] = rawy;
+	}
+	x = TM_STMPE811_Median(STMPE811_IT.MedianX) << 4;
+	y = TM_STMPE811_Median(STMPE811_IT.MedianY) << 4;
+	
+	/* IIR low pass filter */
+	if (STMPE811_IT.MedianCount == 0) {
+		STMPE811_IT.FilterX = x;
+		STMPE811_IT.FilterY = y;
+	} else {
+		STMPE811_IT.FilterX += (x - STMPE811_IT.FilterX) / (1 << STMPE811_FILTER_SHIFT);
+		STMPE811_IT.FilterY += (y - STMPE811_IT.FilterY) / (1 << STMPE811_FILTER_SHIFT);
+	}
+	if (STMPE811_IT.MedianCount < 3) {
+		STMPE811_IT.MedianCount++;
+	}
+	STMPE811_IT.RawX = (STMPE811_IT.FilterX + 8) >> 4;
+	STMPE811_IT.RawY = (STMPE811_IT.FilterY + 8) >> 4;
+	
+	/* Calibrate to Portrait_2 orientation */
+	x = ((int64_t)STMPE811_IT.Calibration.An * STMPE811_IT.RawX + (int64_t)STMPE811_IT.Calibration.Bn * STMPE811_IT.RawY + STMPE811_IT.Calibration.Cn) / STMPE811_IT.Calibration.Divider;
+	y = ((int64_t)STMPE811_IT.Calibration.Dn * STMPE811_IT.RawX + (int64_t)STMPE811_IT.Calibration.En * STMPE811_IT.RawY + STMPE811_IT.Calibration.Fn) / STMPE811_IT.Calibration.Divider;
+	if (x < 0) {
+		x = 0;
+	} else if (x > 239) {
+		x = 239;
+	}
+	if (y < 0) {
+		y = 0;
+	} else if (y > 319) {
+		y = 319;
+	}
+	
+	/* Add event */
+	if (!STMPE811_IT.Pressed) {
+		STMPE811_IT.Pressed = 1;
+		STMPE811_IT.X = x;
+		STMPE811_IT.Y = y;
+		TM_STMPE811_AddEvent(TM_STMPE811_EventType_Down);
+	} else if (x != STMPE811_IT.X || y != STMPE811_IT.Y) {
+		STMPE811_IT.X = x;
+		STMPE811_IT.Y = y;
+		TM_STMPE811_AddEvent(TM_STMPE811_EventType_Move);
+	}
+}
 
+static void TM_STMPE811_Convert(TM_STMPE811_Orientation_t orientation, uint16_t* x, uint16_t* y) {
+	/* Coordinates are stored in Portrait_2 orientation */
+	if (orientation == TM_STMPE811_Orientation_Portrait_1) {
+		*x = 239 - STMPE811_IT.X;
+		*y = 319 - STMPE811_IT.Y;
+	} else if (orientation == TM_STMPE811_Orientation_Portrait_2) {
+		*x = STMPE811_IT.X;
+		*y = STMPE811_IT.Y;
+	} else if (orientation == TM_STMPE811_Orientation_Landscape_1) {
+		*x = 319 - STMPE811_IT.Y;
+		*y = STMPE811_IT.X;
+	} else {
+		*x = STMPE811_IT.Y;
+		*y = 239 - STMPE811_IT.X;
+	}
+}
 
+static void TM_STMPE811_AddEvent(TM_STMPE811_EventType_t type) {
+	TM_STMPE811_Event_t* ev;
+	uint8_t last;
+	
+	/* Merge with last Move event which was not read yet */
+	if (type == TM_STMPE811_EventType_Move && STMPE811_IT.Count) {
+		last = STMPE811_IT.In ? STMPE811_IT.In - 1 : STMPE811_EVENT_QUEUE_SIZE - 1;
+		if (STMPE811_IT.Events[last].Type == TM_STMPE811_EventType_Move) {
+			STMPE811_IT.In = last;
+			STMPE811_IT.Count--;
+		}
+	}
+	
+	/* Queue full, drop oldest event */
+	if (STMPE811_IT.Count >= STMPE811_EVENT_QUEUE_SIZE) {
+		if (++STMPE811_IT.Out >= STMPE811_EVENT_QUEUE_SIZE) {
+			STMPE811_IT.Out = 0;
+		}
+		STMPE811_IT.Count--;
+	}
+	
+	/* Store event */
+	ev = &STMPE811_IT.Events[STMPE811_IT.In];
+	ev->Type = type;
+	TM_STMPE811_Convert(STMPE811_IT.Orientation, &ev->x, &ev->y);
+	ev->RawX = STMPE811_IT.RawX;
+	ev->RawY = STMPE811_IT.RawY;
+	ev->Time = TM_Time;
+	if (++STMPE811_IT.In >= STMPE811_EVENT_QUEUE_SIZE) {
+		STMPE811_IT.In = 0;
+	}
+	STMPE811_IT.Count++;
+}
+
+static uint16_t TM_STMPE811_Median(uint16_t* values) {
+	uint16_t a = values[0], b = values[1], c = values[2];
+	
+	/* Middle of 3 values */
+	if (a > b) {
+		if (b > c) {
+			return b;
+		}
+		return a > c ? c : a;
+	}
+	if (a > c) {
+		return a;
+	}
+	return b > c ? c : b;
+}
+#endif
@@ -3,7 +3,7 @@
  * @email   tilen@majerle.eu
  * @website http://stm32f4-discovery.net
  * @link    http://stm32f4-discovery.net/2014/05/library-10-stmpe811-touch-screen-driver-for-stm32f429-discovery-board/
- * @version v1.2
+ * @version v1.3
  * @ide     Keil uVision
  * @license GNU GPL v3
  * @brief   STMPE811 Touch screen controller library
@@ -28,7 +28,7 @@
 @endverbatim
  */
 #ifndef TM_STMPE811_H
-#define TM_STMPE811_H  120
+#define TM_STMPE811_H  130
 
 /* C++ detection */
 #ifdef __cplusplus
@@ -67,10 +67,53 @@ SDA        PC9         Data pin for I2C
 #define STMPE811_I2C             I2C3
 #define STMPE811_I2C_PINSPACK    TM_I2C_PinsPack_1
 @endverbatim
+ *
+ * \par Interrupt mode
+ *
+ * With @ref TM_STMPE811_InitIT, controller collects samples to its FIFO and pulls INT line low
+ * when touch is detected or @ref STMPE811_FIFO_THRESHOLD samples are in FIFO. INT line is attached to EXTI with TM EXTI library.
+ *
+ * Samples are read with @ref TM_STMPE811_Process, only when INT line is active:
+ *  - All samples from FIFO are read in one I2C burst, 4 bytes per sample in XYZ format
+ *  - Each sample goes through median filter of last 3 samples and IIR low pass filter, see @ref STMPE811_FILTER_SHIFT
+ *  - Filtered raw values are converted to LCD coordinates with 3-point calibration, see @ref TM_STMPE811_CalculateCalibration
+ *  - Changes are stored to event queue as @ref TM_STMPE811_Event_t events, read with @ref TM_STMPE811_GetEvent
+ *
+ * When screen is not touched, there is no I2C traffic at all. @ref TM_STMPE811_ReadTouch still works in this mode
+ * and returns last filtered coordinates.
+ *
+ * Call @ref TM_STMPE811_InterruptHandler from your EXTI handler, so processing starts on next call:
+ *
+@verbatim
+//INT pin, on STM32F429-Discovery it is PA15
+#define STMPE811_INT_PORT        GPIOA
+#define STMPE811_INT_PIN         GPIO_Pin_15
+
+void TM_EXTI_Handler(uint16_t GPIO_Pin) {
+    if (GPIO_Pin == STMPE811_INT_PIN) {
+        TM_STMPE811_InterruptHandler();
+    }
+}
+
+//In main loop
+TM_STMPE811_Event_t Event;
+while (TM_STMPE811_GetEvent(&Event)) {
+    if (Event.Type == TM_STMPE811_EventType_Down) {
+        //Touch at Event.x, Event.y
+    }
+}
+@endverbatim
+ *
+ * @note   Set STMPE811_USE_IT to 0 in defines.h to remove interrupt mode and TM EXTI dependency
  *
  * \par Changelog
  *
 @verbatim
+ Version 1.3
+  - October 19, 2026
+  - Added interrupt mode with FIFO burst reads, median and IIR filtering
+  - Added 3-point calibration and touch event queue
+  
  Version 1.0
   - First release
   
@@ -92,6 +135,7 @@ SDA        PC9         Data pin for I2C
  - defines.h
  - TM I2C
  - TM DELAY
+ - TM EXTI, only when STMPE811_USE_IT is enabled
 @endverbatim
  */
  
@@ -102,6 +146,16 @@ SDA        PC9         Data pin for I2C
 #include "tm_stm32f4_i2c.h"
 #include "tm_stm32f4_delay.h"
 
+/* Interrupt mode */
+#ifndef STMPE811_USE_IT
+#define STMPE811_USE_IT					1
+#endif
+
+#if STMPE811_USE_IT == 1
+#include "tm_stm32f4_exti.h"
+#include "string.h"
+#endif
+
 /**
  * @defgroup TM_STMPE811_Macros
  * @brief    Library defines
@@ -123,6 +177,36 @@ SDA        PC9         Data pin for I2C
 #define STMPE811_I2C_CLOCK				100000
 #endif
 
+/**
+ * @brief  INT pin, used in interrupt mode. Default on STM32F429-Discovery board
+ */
+#ifndef STMPE811_INT_PORT
+#define STMPE811_INT_PORT				GPIOA
+#define STMPE811_INT_PIN				GPIO_Pin_15
+#endif
+
+/**
+ * @brief  Number of samples in FIFO to generate interrupt, 1 to 127
+ */
+#ifndef STMPE811_FIFO_THRESHOLD
+#define STMPE811_FIFO_THRESHOLD			4
+#endif
+
+/**
+ * @brief  IIR filter strength. New value = old + (sample - old) / 2^STMPE811_FILTER_SHIFT
+ * @note   Set to 0 to disable IIR filter
+ */
+#ifndef STMPE811_FILTER_SHIFT
+#define STMPE811_FILTER_SHIFT			2
+#endif
+
+/**
+ * @brief  Number of events in touch event queue
+ */
+#ifndef STMPE811_EVENT_QUEUE_SIZE
+#define STMPE811_EVENT_QUEUE_SIZE		16
+#endif
+
 /**
  * @}
  */
@@ -168,6 +252,51 @@ typedef struct {
 /* Backward compatibility */
 typedef TM_STMPE811_t TM_STMPE811_TouchData;
 
+/**
+ * @brief  Touch event types
+ */
+typedef enum {
+	TM_STMPE811_EventType_Down = 0x00, /*!< Touch pressed */
+	TM_STMPE811_EventType_Move,        /*!< Touch moved while pressed */
+	TM_STMPE811_EventType_Up           /*!< Touch released, coordinates are from last position */
+} TM_STMPE811_EventType_t;
+
+/**
+ * @brief  Touch event, stored in event queue in interrupt mode
+ */
+typedef struct {
+	TM_STMPE811_EventType_t Type; /*!< Event type */
+	uint16_t x;                   /*!< X coordinate on LCD, in orientation selected with @ref TM_STMPE811_InitIT */
+	uint16_t y;                   /*!< Y coordinate on LCD, in orientation selected with @ref TM_STMPE811_InitIT */
+	uint16_t RawX;                /*!< Filtered raw X value from controller */
+	uint16_t RawY;                /*!< Filtered raw Y value from controller */
+	uint32_t Time;                /*!< Time of event in units of milliseconds, from TM DELAY library */
+} TM_STMPE811_Event_t;
+
+/**
+ * @brief  Calibration point
+ */
+typedef struct {
+	uint16_t x; /*!< X coordinate */
+	uint16_t y; /*!< Y coordinate */
+} TM_STMPE811_Point_t;
+
+/**
+ * @brief  Calibration coefficients for conversion from raw values to LCD coordinates in Portrait_2 orientation
+ *
+ * x = (An * RawX + Bn * RawY + Cn) / Divider
+ * y = (Dn * RawX + En * RawY + Fn) / Divider
+ */
+typedef struct {
+	int32_t An;      /*!< X coefficient for raw X */
+	int32_t Bn;      /*!< X coefficient for raw Y */
+	int64_t Cn;      /*!< X offset, can be larger than 32-bit */
+	int32_t Dn;      /*!< Y coefficient for raw X */
+	int32_t En;      /*!< Y coefficient for raw Y */
+	int64_t Fn;      /*!< Y offset, can be larger than 32-bit */
+	int32_t Divider; /*!< Common divider, must not be 0 */
+} TM_STMPE811_Calibration_t;
+
 /**
  * @}
  */
@@ -208,6 +337,65 @@ TM_STMPE811_State_t TM_STMPE811_ReadTouch(TM_STMPE811_t* structdata);
  */ 
 #define TM_STMPE811_TouchInRectangle(sd, xPos, yPos, w, h)	(((sd)->x >= (xPos)) && ((sd)->x < (xPos + w)) && ((sd)->y >= (yPos)) && ((sd)->y < (yPos + h)))
 
+#if STMPE811_USE_IT == 1
+
+/**
+ * @brief  Initializes STMPE811 Touch driver in interrupt mode
+ * @note   INT pin is attached to EXTI with falling edge
+ * @param  orientation: Orientation of coordinates in events, member of @ref TM_STMPE811_Orientation_t
+ * @retval Member of @ref TM_STMPE811_State_t
+ */
+TM_STMPE811_State_t TM_STMPE811_InitIT(TM_STMPE811_Orientation_t orientation);
+
+/**
+ * @brief  Marks that STMPE811 has data, call it from EXTI handler for INT pin
+ * @note   Does not use I2C, so it is safe to call from interrupt
+ * @param  None
+ * @retval None
+ */
+void TM_STMPE811_InterruptHandler(void);
+
+/**
+ * @brief  Reads and filters all samples from controller FIFO and stores events to event queue
+ * @note   I2C is used only when INT line is active or @ref TM_STMPE811_InterruptHandler was called
+ * @param  None
+ * @retval Number of new events in queue
+ */
+uint8_t TM_STMPE811_Process(void);
+
+/**
+ * @brief  Gets oldest touch event from queue
+ * @note   @ref TM_STMPE811_Process is called first
+ * @note   When queue is full, oldest events are lost. Consecutive Move events are merged
+ * @param  *Event: Pointer to @ref TM_STMPE811_Event_t structure to store event to
+ * @retval Event status:
+ *            - 0: No event available
+ *            - > 0: Event stored
+ */
+uint8_t TM_STMPE811_GetEvent(TM_STMPE811_Event_t* Event);
+
+/**
+ * @brief  Sets calibration coefficients
+ * @param  *Calibration: Pointer to @ref TM_STMPE811_Calibration_t coefficients
+ * @retval None
+ */
+void TM_STMPE811_SetCalibration(const TM_STMPE811_Calibration_t* Calibration);
+
+/**
+ * @brief  Calculates calibration coefficients from 3 points
+ * @note   Points should be far apart and not on one line, for example near 3 corners of screen.
+ *         Raw values are RawX and RawY from events when user touches the points
+ * @param  *Calibration: Pointer to @ref TM_STMPE811_Calibration_t structure to store coefficients to
+ * @param  *Lcd: Pointer to 3 LCD points in Portrait_2 orientation
+ * @param  *Raw: Pointer to 3 raw points for LCD points
+ * @retval Member of @ref TM_STMPE811_State_t:
+ *            - TM_STMPE811_State_Ok: Coefficients calculated
+ *            - TM_STMPE811_State_Error: Points are on one line
+ */
+TM_STMPE811_State_t TM_STMPE811_CalculateCalibration(TM_STMPE811_Calibration_t* Calibration, const TM_STMPE811_Point_t* Lcd, const TM_STMPE811_Point_t* Raw);
+
+#endif
+
 /**
  * @}
  */
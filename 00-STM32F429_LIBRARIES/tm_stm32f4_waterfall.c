@@ -0,0 +1,224 @@
+/**
+ * |----------------------------------------------------------------------
+ * | Copyright (C) Tilen MAJERLE, 2015
+ * |
+ * | This program is free software: you can redistribute it and/or modify
+ * | it under the terms of the GNU General Public License as published by
+ * | the Free Software Foundation, either version 3 of the License, or
+ * | any later version.
+ * |
+ * | This program is distributed in the hope that it will be useful,
+ * | but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * | GNU General Public License for more details.
+ * |
+ * | You should have received a copy of the GNU General Public License
+ * | along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * |----------------------------------------------------------------------
+ */
+#include "tm_stm32f4_waterfall.h"
+
+/* Colour stops for default palette, R, G, B */
+static const uint8_t WATERFALL_Stops[6][3] = {
+	{0x00, 0x00, 0x00}, /* Black */
+	{0x00, 0x00, 0xFF}, /* Blue */
+	{0x00, 0xFF, 0xFF}, /* Cyan */
+	{0xFF, 0xFF, 0x00}, /* Yellow */
+	{0xFF, 0x00, 0x00}, /* Red */
+	{0xFF, 0xFF, 0xFF}  /* White */
+};
+
+/* Private functions */
+static uint16_t* TM_INT_WATERFALL_NextRow(TM_WATERFALL_t* Waterfall);
+
+uint8_t TM_WATERFALL_Init(TM_WATERFALL_t* Waterfall, uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint32_t FrameBuffer, uint16_t* RingBuffer) {
+	/* Check parameters */
+	if (
+		RingBuffer == 0 ||
+		width == 0 ||
+		height == 0 ||
+		(x + width) > WATERFALL_FRAME_WIDTH ||
+		(y + height) > WATERFALL_FRAME_HEIGHT
+	) {
+		return 1;
+	}
+
+	/* Save settings */
+	Waterfall->X = x;
+	Waterfall->Y = y;
+	Waterfall->Width = width;
+	Waterfall->Height = height;
+	Waterfall->FrameBuffer = FrameBuffer;
+	Waterfall->FrameWidth = WATERFALL_FRAME_WIDTH;
+	Waterfall->Ring = RingBuffer;
+	Waterfall->Head = 0;
+
+	/* Set default palette */
+	TM_WATERFALL_SetDefaultPalette(Waterfall);
+
+	/* Clear ring buffer */
+	TM_WATERFALL_Clear(Waterfall, Waterfall->Palette[0]);
+
+	/* Return OK */
+	return 0;
+}
+
+void TM_WATERFALL_SetPalette(TM_WATERFALL_t* Waterfall, const uint16_t* Palette) {
+	uint16_t i;
+
+	/* Copy palette */
+	for (i = 0; i < WATERFALL_PALETTE_SIZE; i++) {
+		Waterfall->Palette[i] = Palette[i];
+	}
+}
+
+void TM_WATERFALL_SetDefaultPalette(TM_WATERFALL_t* Waterfall) {
+	uint16_t i, seg, pos;
+	uint8_t r, g, b;
+	const uint8_t *from, *to;
+
+	/* 5 segments between 6 colour stops, linear interpolation inside segment */
+	for (i = 0; i < WATERFALL_PALETTE_SIZE; i++) {
+		seg = i * 5 / WATERFALL_PALETTE_SIZE;
+		pos = i * 5 - seg * WATERFALL_PALETTE_SIZE;
+
+		from = WATERFALL_Stops[seg];
+		to = WATERFALL_Stops[seg + 1];
+
+		r = from[0] + ((int16_t)(to[0] - from[0]) * pos) / WATERFALL_PALETTE_SIZE;
+		g = from[1] + ((int16_t)(to[1] - from[1]) * pos) / WATERFALL_PALETTE_SIZE;
+		b = from[2] + ((int16_t)(to[2] - from[2]) * pos) / WATERFALL_PALETTE_SIZE;
+
+		/* Save colour */
+		Waterfall->Palette[i] = WATERFALL_RGB565(r, g, b);
+	}
+}
+
+void TM_WATERFALL_Clear(TM_WATERFALL_t* Waterfall, uint16_t color) {
+	uint32_t i, count;
+
+	/* Wait for DMA2D, it may still read ring buffer */
+	DMA2D_WAIT;
+
+	/* Fill ring buffer */
+	count = (uint32_t)Waterfall->Width * (uint32_t)Waterfall->Height;
+	for (i = 0; i < count; i++) {
+		Waterfall->Ring[i] = color;
+	}
+
+	/* Reset head */
+	Waterfall->Head = 0;
+}
+
+void TM_WATERFALL_AddRow(TM_WATERFALL_t* Waterfall, const uint8_t* Levels, uint16_t count) {
+	uint16_t* row;
+	uint16_t i;
+	uint32_t step, index;
+
+	/* Check count */
+	if (count == 0) {
+		return;
+	}
+
+	/* Get pointer to new row */
+	row = TM_INT_WATERFALL_NextRow(Waterfall);
+
+	if (count == Waterfall->Width) {
+		/* Direct mapping */
+		for (i = 0; i < count; i++) {
+			row[i] = Waterfall->Palette[Levels[i]];
+		}
+	} else {
+		/* Scale bins to width, 16.16 fixed point step */
+		step = ((uint32_t)count << 16) / Waterfall->Width;
+		index = 0;
+		for (i = 0; i < Waterfall->Width; i++) {
+			row[i] = Waterfall->Palette[Levels[index >> 16]];
+			index += step;
+		}
+	}
+}
+
+void TM_WATERFALL_AddRowF32(TM_WATERFALL_t* Waterfall, const float* Values, uint16_t count, float maxValue) {
+	uint16_t* row;
+	uint16_t i;
+	uint32_t step, index;
+	float scale, value;
+
+	/* Check count */
+	if (count == 0) {
+		return;
+	}
+
+	/* Calculate scale */
+	if (maxValue > 0) {
+		scale = (float)(WATERFALL_PALETTE_SIZE - 1) / maxValue;
+	} else {
+		scale = 0;
+	}
+
+	/* Get pointer to new row */
+	row = TM_INT_WATERFALL_NextRow(Waterfall);
+
+	/* Scale bins to width, 16.16 fixed point step */
+	step = ((uint32_t)count << 16) / Waterfall->Width;
+	index = 0;
+	for (i = 0; i < Waterfall->Width; i++) {
+		/* Get level */
+		value = Values[index >> 16] * scale;
+		if (value < 0) {
+			value = 0;
+		} else if (value > (WATERFALL_PALETTE_SIZE - 1)) {
+			value = WATERFALL_PALETTE_SIZE - 1;
+		}
+
+		/* Convert to colour */
+		row[i] = Waterfall->Palette[(uint8_t)value];
+		index += step;
+	}
+}
+
+void TM_WATERFALL_Draw(TM_WATERFALL_t* Waterfall) {
+	uint16_t newest;
+	uint32_t dst;
+
+	/* Number of rows from head to end of ring, these are newest rows */
+	newest = Waterfall->Height - Waterfall->Head;
+
+	/* Destination address of top left corner */
+	dst = Waterfall->FrameBuffer + 2 * ((uint32_t)Waterfall->Y * Waterfall->FrameWidth + Waterfall->X);
+
+	/* Copy newest rows to the top of waterfall area */
+	TM_DMA2DGRAPHIC_CopyBufferIT(
+		&Waterfall->Ring[(uint32_t)Waterfall->Head * Waterfall->Width],
+		(void *)dst,
+		Waterfall->Width, newest,
+		0, Waterfall->FrameWidth - Waterfall->Width
+	);
+
+	/* Copy oldest rows below them, transfer waits for previous one to finish */
+	if (Waterfall->Head) {
+		TM_DMA2DGRAPHIC_CopyBufferIT(
+			&Waterfall->Ring[0],
+			(void *)(dst + 2 * (uint32_t)newest * Waterfall->FrameWidth),
+			Waterfall->Width, Waterfall->Head,
+			0, Waterfall->FrameWidth - Waterfall->Width
+		);
+	}
+}
+
+/* Private functions */
+static uint16_t* TM_INT_WATERFALL_NextRow(TM_WATERFALL_t* Waterfall) {
+	/* Wait for DMA2D, it may still read ring buffer */
+	DMA2D_WAIT;
+
+	/* Move head one row back, oldest row is overwritten */
+	if (Waterfall->Head == 0) {
+		Waterfall->Head = Waterfall->Height - 1;
+	} else {
+		Waterfall->Head--;
+	}
+
+	/* Return pointer to new row */
+	return &Waterfall->Ring[(uint32_t)Waterfall->Head * Waterfall->Width];
+}
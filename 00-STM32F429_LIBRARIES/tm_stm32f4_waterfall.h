@@ -0,0 +1,250 @@
+/**
+ * @author  Tilen MAJERLE
+ * @email   tilen@majerle.eu
+ * @website http://stm32f4-discovery.net
+ * @link
+ * @version v1.0
+ * @ide     Keil uVision
+ * @license GNU GPL v3
+ * @brief   Scrolling waterfall (spectrogram) widget for LTDC framebuffers using DMA2D
+ *
+@verbatim
+   ----------------------------------------------------------------------
+    Copyright (C) Tilen MAJERLE, 2015
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+   ----------------------------------------------------------------------
+@endverbatim
+ */
+#ifndef TM_WATERFALL_H
+#define TM_WATERFALL_H 100
+
+/* C++ detection */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup TM_STM32F4xx_Libraries
+ * @{
+ */
+
+/**
+ * @defgroup TM_WATERFALL
+ * @brief    Scrolling waterfall (spectrogram) widget for LTDC framebuffers using DMA2D
+ * @{
+ *
+ * Waterfall shows history of spectrum (or any other 1D data) as image, where each new row is one FFT result
+ * and colour of each pixel is magnitude of one bin, mapped through palette (LUT).
+ *
+ * \par How it works
+ *
+ * Rows are not scrolled inside framebuffer pixel by pixel. Instead, library keeps circular buffer of already
+ * converted RGB565 rows (ring buffer, usually in SDRAM). When new row is added, only one row is converted
+ * by CPU (palette lookup) and written to ring buffer, and ring head is moved.
+ *
+ * When @ref TM_WATERFALL_Draw is called, ring buffer is copied to framebuffer with maximal 2 DMA2D memory to memory transfers:
+ *  - From ring head to the end of ring buffer (newest rows) to the top of waterfall area
+ *  - From the beginning of ring buffer to head (oldest rows) below them
+ *
+ * This way no overlapping memory moves are needed, CPU only prepares one row per frame and
+ * second DMA2D transfer is not waited, so CPU can continue with DSP processing immediately.
+ *
+ * \par Coordinates
+ *
+ * Waterfall area is specified in framebuffer memory coordinates (not rotated), where one row is one framebuffer line.
+ * On STM32F429-Discovery this means rows are 240 pixels wide. When LCD is used in landscape mode,
+ * waterfall rows are displayed as columns and image scrolls horizontally, which is classic spectrogram view.
+ *
+ * \par Ring buffer size
+ *
+ * Ring buffer must be at least width * height * 2 bytes long.
+ * For full 240x320 area this is 150kB, so it should be placed in SDRAM, after LCD layers and back buffers.
+ * With TM ILI9341 LTDC library, this is @ref ILI9341_SDRAM_END address.
+ *
+ * \par Changelog
+ *
+@verbatim
+ Version 1.0
+  - First release
+@endverbatim
+ *
+ * \par Dependencies
+ *
+@verbatim
+ - STM32F4xx
+ - STM32F4xx DMA2D
+ - defines.h
+ - TM DMA2D GRAPHIC
+@endverbatim
+ */
+
+#include "stm32f4xx.h"
+#include "defines.h"
+#include "tm_stm32f4_dma2d_graphic.h"
+
+/**
+ * @defgroup TM_WATERFALL_Macros
+ * @brief    Library defines
+ * @{
+ */
+
+/**
+ * @brief  Number of entries in palette table
+ * @note   Input levels are 8-bit values, so each level has its own colour
+ */
+#define WATERFALL_PALETTE_SIZE      256
+
+/**
+ * @brief  Default framebuffer line width in pixels
+ */
+#ifndef WATERFALL_FRAME_WIDTH
+#define WATERFALL_FRAME_WIDTH       DMA2D_GRAPHIC_LCD_WIDTH
+#endif
+
+/**
+ * @brief  Default framebuffer height in pixels
+ */
+#ifndef WATERFALL_FRAME_HEIGHT
+#define WATERFALL_FRAME_HEIGHT      DMA2D_GRAPHIC_LCD_HEIGHT
+#endif
+
+/**
+ * @brief  Converts 8-bit R, G and B values to RGB565 colour format
+ */
+#define WATERFALL_RGB565(r, g, b)   (uint16_t)((((uint16_t)(r) & 0xF8) << 8) | (((uint16_t)(g) & 0xFC) << 3) | ((uint16_t)(b) >> 3))
+
+/**
+ * @}
+ */
+
+/**
+ * @defgroup TM_WATERFALL_Typedefs
+ * @brief    Library Typedefs
+ * @{
+ */
+
+/**
+ * @brief  Waterfall working structure
+ */
+typedef struct {
+	uint16_t X;                                 /*!< X coordinate of top left corner in framebuffer */
+	uint16_t Y;                                 /*!< Y coordinate of top left corner in framebuffer */
+	uint16_t Width;                             /*!< Waterfall width in units of pixels, this is number of pixels in one row */
+	uint16_t Height;                            /*!< Waterfall height in units of pixels, this is number of rows shown */
+	uint32_t FrameBuffer;                       /*!< Framebuffer start address where waterfall is drawn */
+	uint16_t FrameWidth;                        /*!< Framebuffer line width in units of pixels */
+	uint16_t* Ring;                             /*!< Pointer to ring buffer for rows. Meant for private use */
+	uint16_t Head;                              /*!< Index of newest row in ring buffer. Meant for private use */
+	uint16_t Palette[WATERFALL_PALETTE_SIZE];   /*!< Palette (LUT) for converting levels to RGB565 colours */
+} TM_WATERFALL_t;
+
+/**
+ * @}
+ */
+
+/**
+ * @defgroup TM_WATERFALL_Functions
+ * @brief    Library Functions
+ * @{
+ */
+
+/**
+ * @brief  Initializes waterfall structure, sets default palette and clears ring buffer to black colour
+ * @note   DMA2D clock must be enabled before waterfall is drawn. This is done in @ref TM_ILI9341_Init or @ref TM_DMA2DGRAPHIC_Init functions
+ * @param  *Waterfall: Pointer to empty @ref TM_WATERFALL_t structure
+ * @param  x: X coordinate of top left corner in framebuffer
+ * @param  y: Y coordinate of top left corner in framebuffer
+ * @param  width: Width of waterfall in units of pixels
+ * @param  height: Height of waterfall in units of pixels (number of rows)
+ * @param  FrameBuffer: Address of framebuffer (LTDC layer start address) where waterfall will be drawn
+ * @param  *RingBuffer: Pointer to memory for ring buffer. It must be at least width * height entries long
+ * @retval Initialization status:
+ *            - 0: Initialized OK
+ *            - > 0: Invalid parameters, area is out of framebuffer or ring buffer is not set
+ */
+uint8_t TM_WATERFALL_Init(TM_WATERFALL_t* Waterfall, uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint32_t FrameBuffer, uint16_t* RingBuffer);
+
+/**
+ * @brief  Sets custom palette for converting levels to colours
+ * @param  *Waterfall: Pointer to @ref TM_WATERFALL_t structure
+ * @param  *Palette: Pointer to array of @ref WATERFALL_PALETTE_SIZE colours in RGB565 format. Index 0 is used for level 0 (lowest magnitude)
+ * @retval None
+ */
+void TM_WATERFALL_SetPalette(TM_WATERFALL_t* Waterfall, const uint16_t* Palette);
+
+/**
+ * @brief  Sets default "heat" palette, black - blue - cyan - yellow - red - white
+ * @param  *Waterfall: Pointer to @ref TM_WATERFALL_t structure
+ * @retval None
+ */
+void TM_WATERFALL_SetDefaultPalette(TM_WATERFALL_t* Waterfall);
+
+/**
+ * @brief  Fills entire ring buffer with one colour
+ * @note   Use @ref TM_WATERFALL_Draw to show changes on LCD
+ * @param  *Waterfall: Pointer to @ref TM_WATERFALL_t structure
+ * @param  color: Colour in RGB565 format
+ * @retval None
+ */
+void TM_WATERFALL_Clear(TM_WATERFALL_t* Waterfall, uint16_t color);
+
+/**
+ * @brief  Adds new row to waterfall from 8-bit levels
+ * @note   If count differs from waterfall width, bins are scaled to width using nearest neighbour
+ * @param  *Waterfall: Pointer to @ref TM_WATERFALL_t structure
+ * @param  *Levels: Pointer to array of levels, 0 to 255, each is mapped through palette
+ * @param  count: Number of levels in array
+ * @retval None
+ */
+void TM_WATERFALL_AddRow(TM_WATERFALL_t* Waterfall, const uint8_t* Levels, uint16_t count);
+
+/**
+ * @brief  Adds new row to waterfall from float magnitudes, for example from FFT output
+ * @note   If count differs from waterfall width, bins are scaled to width using nearest neighbour
+ * @param  *Waterfall: Pointer to @ref TM_WATERFALL_t structure
+ * @param  *Values: Pointer to array of magnitudes
+ * @param  count: Number of magnitudes in array
+ * @param  maxValue: Magnitude mapped to last palette entry. Greater values are saturated
+ * @retval None
+ */
+void TM_WATERFALL_AddRowF32(TM_WATERFALL_t* Waterfall, const float* Values, uint16_t count, float maxValue);
+
+/**
+ * @brief  Draws waterfall to framebuffer using DMA2D
+ * @note   Function does not wait for last DMA2D transfer to finish.
+ *         Next DMA2D operation or @ref TM_WATERFALL_AddRow waits for it automatically
+ * @param  *Waterfall: Pointer to @ref TM_WATERFALL_t structure
+ * @retval None
+ */
+void TM_WATERFALL_Draw(TM_WATERFALL_t* Waterfall);
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+
+/**
+ * @}
+ */
+
+/* C++ detection */
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,18 @@
+/*
+ * Project defines for host build of FatFs sector cache benchmark
+ */
+#ifndef TM_DEFINES_H
+#define TM_DEFINES_H
+
+/* Types from stm32f4xx.h on target */
+#include <stdint.h>
+
+/* No hardware drivers on host, RAM disk is added as USER1 */
+#define FATFS_USE_SDIO			2
+
+/* Disable FatFs time from RTC */
+#define TM_FATFS_CUSTOM_FATTIME	0
+
+/* Sector cache is enabled with -DFATFS_USE_CACHE=1 on command line */
+
+#endif
@@ -0,0 +1,229 @@
+/*
+ * FatFs sector cache benchmark on host computer
+ *
+ * Copyright (C) Tilen MAJERLE, 2015
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Runs the same file workload on RAM disk with and without sector cache in diskio.c
+ * and counts commands and sectors which reach low level driver.
+ * Time is estimated with simple SD card model, see SD_CMD_US, SD_SECTOR_US and SD_WRITE_US.
+ *
+ * Build and run from 00-STM32F429_LIBRARIES folder:
+ *   gcc -O2 -Itools/fatfs_cache_bench -I. -Ifatfs -DFATFS_USE_CACHE=0 -o bench0 tools/fatfs_cache_bench/main.c fatfs/ff.c fatfs/diskio.c fatfs/option/syscall.c fatfs/option/unicode.c
+ *   gcc -O2 -Itools/fatfs_cache_bench -I. -Ifatfs -DFATFS_USE_CACHE=1 -o bench1 tools/fatfs_cache_bench/main.c fatfs/ff.c fatfs/diskio.c fatfs/option/syscall.c fatfs/option/unicode.c
+ *   ./bench0 && ./bench1
+ */
+#include "diskio.h"
+#include "ff.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+/* RAM disk size, 8MB */
+#define DISK_SECTORS		16384
+
+/* SD card model: command overhead, transfer of one sector and programming after write command */
+#define SD_CMD_US			100
+#define SD_SECTOR_US		25
+#define SD_WRITE_US			1000
+
+/* Workload */
+#define BENCH_FILES			16
+#define BENCH_RECORDS		256
+#define BENCH_SYNC_EVERY	16
+
+static BYTE Disk[DISK_SECTORS * 512];
+
+/* Driver counters */
+static struct {
+	DWORD ReadCmds;
+	DWORD WriteCmds;
+	DWORD ReadSectors;
+	DWORD WriteSectors;
+} Counters;
+
+static DSTATUS RAM_disk_initialize(void) {
+	return 0;
+}
+
+static DSTATUS RAM_disk_status(void) {
+	return 0;
+}
+
+static DRESULT RAM_disk_ioctl(BYTE cmd, void* buff) {
+	switch (cmd) {
+		case GET_SECTOR_COUNT:
+			*(DWORD *)buff = DISK_SECTORS;
+			break;
+		case GET_SECTOR_SIZE:
+			*(WORD *)buff = 512;
+			break;
+		case GET_BLOCK_SIZE:
+			*(DWORD *)buff = 1;
+			break;
+		default:
+			break;
+	}
+	return RES_OK;
+}
+
+static DRESULT RAM_disk_write(const BYTE* buff, DWORD sector, UINT count) {
+	if (sector + count > DISK_SECTORS) {
+		return RES_PARERR;
+	}
+	memcpy(&Disk[sector * 512], buff, count * 512);
+	Counters.WriteCmds++;
+	Counters.WriteSectors += count;
+	return RES_OK;
+}
+
+static DRESULT RAM_disk_read(BYTE* buff, DWORD sector, UINT count) {
+	if (sector + count > DISK_SECTORS) {
+		return RES_PARERR;
+	}
+	memcpy(buff, &Disk[sector * 512], count * 512);
+	Counters.ReadCmds++;
+	Counters.ReadSectors += count;
+	return RES_OK;
+}
+
+static void Check(FRESULT fres, const char* what) {
+	if (fres != FR_OK) {
+		printf("%s failed: %d\n", what, (int)fres);
+		exit(1);
+	}
+}
+
+static void Report(const char* name) {
+	DWORD us;
+	
+	/* Estimated SD card time */
+	us = (Counters.ReadCmds + Counters.WriteCmds) * SD_CMD_US;
+	us += (Counters.ReadSectors + Counters.WriteSectors) * SD_SECTOR_US;
+	us += Counters.WriteCmds * SD_WRITE_US;
+	
+	printf("%-12s read cmds %6lu sectors %7lu, write cmds %6lu sectors %7lu, SD time ~%lu ms\n",
+		name,
+		(unsigned long)Counters.ReadCmds, (unsigned long)Counters.ReadSectors,
+		(unsigned long)Counters.WriteCmds, (unsigned long)Counters.WriteSectors,
+		(unsigned long)(us / 1000)
+	);
+	memset(&Counters, 0, sizeof(Counters));
+}
+
+int main(void) {
+	DISKIO_LowLevelDriver_t Driver = {
+		RAM_disk_initialize,
+		RAM_disk_status,
+		RAM_disk_ioctl,
+		RAM_disk_write,
+		RAM_disk_read
+	};
+	static BYTE big[64 * 512];
+	FATFS fs;
+	FIL fil;
+	DIR dir;
+	FILINFO fno;
+	char name[32], line[64], lfn[_MAX_LFN + 1];
+	UINT bw, i, j;
+	
+	TM_FATFS_AddDriver(&Driver, TM_FATFS_Driver_USER1);
+	
+	printf("Sector cache %s\n", FATFS_USE_CACHE ? "enabled" : "disabled");
+	
+	/* Format and mount */
+	Check(f_mount(&fs, "USER1:", 0), "f_mount");
+	Check(f_mkfs("USER1:", 0, 0), "f_mkfs");
+	Check(f_mkdir("USER1:/log"), "f_mkdir");
+	Report("format");
+	
+	/* Small appends to many files, like data logger */
+	for (i = 0; i < BENCH_FILES; i++) {
+		sprintf(name, "USER1:/log/file%02u.txt", i);
+		Check(f_open(&fil, name, FA_CREATE_ALWAYS | FA_WRITE), "f_open");
+		for (j = 0; j < BENCH_RECORDS; j++) {
+			sprintf(line, "%05u;%05u;sensor value %08X\r\n", i, j, i * 7919 + j);
+			Check(f_write(&fil, line, strlen(line), &bw), "f_write");
+			if ((j % BENCH_SYNC_EVERY) == BENCH_SYNC_EVERY - 1) {
+				Check(f_sync(&fil), "f_sync");
+			}
+		}
+		Check(f_close(&fil), "f_close");
+	}
+	Report("small writes");
+	
+	/* Directory listing and file info */
+	fno.lfname = lfn;
+	fno.lfsize = sizeof(lfn);
+	for (i = 0; i < 4; i++) {
+		Check(f_opendir(&dir, "USER1:/log"), "f_opendir");
+		while (f_readdir(&dir, &fno) == FR_OK && fno.fname[0]) {
+			sprintf(name, "USER1:/log/%s", fno.fname);
+			Check(f_stat(name, &fno), "f_stat");
+		}
+	}
+	Report("directory");
+	
+	/* Read all files with small reads */
+	for (i = 0; i < BENCH_FILES; i++) {
+		sprintf(name, "USER1:/log/file%02u.txt", i);
+		Check(f_open(&fil, name, FA_READ), "f_open");
+		while (f_read(&fil, line, sizeof(line), &bw) == FR_OK && bw) {}
+		Check(f_close(&fil), "f_close");
+	}
+	Report("small reads");
+	
+	/* Large file, multi-sector transfers bypass cache */
+	Check(f_open(&fil, "USER1:/big.bin", FA_CREATE_ALWAYS | FA_WRITE | FA_READ), "f_open");
+	for (i = 0; i < 32; i++) {
+		memset(big, i, sizeof(big));
+		Check(f_write(&fil, big, sizeof(big), &bw), "f_write");
+	}
+	Check(f_lseek(&fil, 0), "f_lseek");
+	for (i = 0; i < 32; i++) {
+		Check(f_read(&fil, big, sizeof(big), &bw), "f_read");
+		if (big[0] != i || big[sizeof(big) - 1] != i) {
+			printf("Data mismatch in big file\n");
+			return 1;
+		}
+	}
+	Check(f_close(&fil), "f_close");
+	Report("large file");
+	
+#if FATFS_USE_CACHE == 1
+	{
+		TM_FATFS_CacheStats_t Stats;
+		TM_FATFS_CacheGetStats(TM_FATFS_Driver_USER1, &Stats);
+		printf("Cache: read hits %lu, read misses %lu, write hits %lu, write misses %lu, driver reads %lu, driver writes %lu, sectors written %lu\n",
+			(unsigned long)Stats.ReadHits, (unsigned long)Stats.ReadMisses,
+			(unsigned long)Stats.WriteHits, (unsigned long)Stats.WriteMisses,
+			(unsigned long)Stats.DriverReads, (unsigned long)Stats.DriverWrites,
+			(unsigned long)Stats.SectorsWritten
+		);
+	}
+#endif
+	
+	/* Remount and verify content on disk */
+	Check(f_mount(NULL, "USER1:", 0), "f_unmount");
+	Check(f_mount(&fs, "USER1:", 1), "f_mount");
+	for (i = 0; i < BENCH_FILES; i++) {
+		sprintf(name, "USER1:/log/file%02u.txt", i);
+		Check(f_open(&fil, name, FA_READ), "f_open");
+		for (j = 0; j < BENCH_RECORDS; j++) {
+			char exp[64];
+			sprintf(exp, "%05u;%05u;sensor value %08X\r\n", i, j, i * 7919 + j);
+			if (f_gets(line, sizeof(line), &fil) == NULL || strncmp(line, exp, strlen(exp) - 2)) {
+				printf("Data mismatch in %s, record %u\n", name, j);
+				return 1;
+			}
+		}
+		f_close(&fil);
+	}
+	printf("Verify OK\n");
+	
+	return 0;
+}
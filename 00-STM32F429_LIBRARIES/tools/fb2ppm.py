@@ -0,0 +1,93 @@
+#!/usr/bin/env python
+#
+# Converts framebuffer memory dump to PPM image
+#
+# Copyright (C) Tilen MAJERLE, 2015
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+#
+# Usage:
+#   python fb2ppm.py dump.bin image.ppm [options]
+#
+# Dump can be raw binary file or Intel HEX file, for example from Keil debugger:
+#   SAVE fb.hex 0xD0000000,0xD0025800
+#
+# Options:
+#   --width W       Framebuffer width in units of pixels, default 240
+#   --height H      Framebuffer height in units of pixels, default 320
+#   --format F      Pixel format, rgb565 (default), argb8888, rgb888 or argb4444
+#
+import sys
+import struct
+import argparse
+
+
+def read_hex(path):
+	"""Returns bytes from Intel HEX file, starting at lowest address"""
+	data = {}
+	base = 0
+	for line in open(path):
+		line = line.strip()
+		if not line.startswith(':'):
+			continue
+		rec = bytes.fromhex(line[1:])
+		count, addr, kind = rec[0], (rec[1] << 8) | rec[2], rec[3]
+		if kind == 0:
+			for i in range(count):
+				data[base + addr + i] = rec[4 + i]
+		elif kind == 2:
+			base = ((rec[4] << 8) | rec[5]) << 4
+		elif kind == 4:
+			base = ((rec[4] << 8) | rec[5]) << 16
+	if not data:
+		return b''
+	start = min(data)
+	return bytes(data.get(start + i, 0) for i in range(max(data) - start + 1))
+
+
+def to_rgb(data, index, fmt):
+	"""Returns (r, g, b) of pixel, channels are expanded to 8 bits the same way as DMA2D does"""
+	if fmt == 'rgb565':
+		v = struct.unpack_from('<H', data, index * 2)[0]
+		r, g, b = (v >> 11) & 0x1F, (v >> 5) & 0x3F, v & 0x1F
+		return ((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2))
+	if fmt == 'argb4444':
+		v = struct.unpack_from('<H', data, index * 2)[0]
+		return (((v >> 8) & 0x0F) * 0x11, ((v >> 4) & 0x0F) * 0x11, (v & 0x0F) * 0x11)
+	if fmt == 'rgb888':
+		return (data[index * 3 + 2], data[index * 3 + 1], data[index * 3])
+	return (data[index * 4 + 2], data[index * 4 + 1], data[index * 4])
+
+
+def main():
+	parser = argparse.ArgumentParser(description='Converts framebuffer memory dump to PPM image')
+	parser.add_argument('dump')
+	parser.add_argument('ppm')
+	parser.add_argument('--width', type=int, default=240)
+	parser.add_argument('--height', type=int, default=320)
+	parser.add_argument('--format', default='rgb565', choices=['rgb565', 'argb8888', 'rgb888', 'argb4444'])
+	args = parser.parse_args()
+
+	if args.dump.lower().endswith('.hex'):
+		data = read_hex(args.dump)
+	else:
+		data = open(args.dump, 'rb').read()
+
+	size = {'rgb565': 2, 'argb4444': 2, 'rgb888': 3, 'argb8888': 4}[args.format]
+	if len(data) < args.width * args.height * size:
+		sys.stderr.write('Dump has %d bytes, %dx%d %s framebuffer needs %d bytes\n' % (len(data), args.width, args.height, args.format, args.width * args.height * size))
+		sys.exit(1)
+
+	out = bytearray(b'P6\n%d %d\n255\n' % (args.width, args.height))
+	for i in range(args.width * args.height):
+		out += bytes(to_rgb(data, i, args.format))
+	open(args.ppm, 'wb').write(out)
+
+	sys.stdout.write('%s: %dx%d\n' % (args.ppm, args.width, args.height))
+
+
+if __name__ == '__main__':
+	main()
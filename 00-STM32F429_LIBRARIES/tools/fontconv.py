@@ -0,0 +1,275 @@
+#!/usr/bin/env python
+#
+# Converts BDF bitmap font to proportional font for TM FONTS library (TM_FONTS_PropFont_t)
+#
+# Copyright (C) Tilen MAJERLE, 2015
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+#
+# Usage:
+#   python fontconv.py font.bdf TM_Font_Name [options]
+#
+# Options:
+#   --aa N          Font in BDF is N times bigger, scale it down to 4 bits per pixel anti-aliased font
+#   --bpp 1|4       Bits per pixel when --aa is not used, default 1
+#   --rle on|off|auto
+#                   Run length encoding of bitmaps, auto selects smaller one (default)
+#   --first N       First character, default 32
+#   --last N        Last character, default 126
+#   --chars "..."   Only these characters have bitmaps, others are empty with advance of space
+#   --kern file     Kerning pairs, one per line: "<left> <right> <value>", characters or numbers like 0x41
+#   --out dir       Output directory, default current
+#
+# Creates TM_Font_Name.c and TM_Font_Name.h files
+#
+import sys
+import os
+import argparse
+
+
+def parse_bdf(path):
+	"""Returns font ascent, descent and dictionary of characters with advance and bitmap"""
+	ascent = descent = None
+	chars = {}
+	glyph = None
+	rows = None
+	for line in open(path, 'r'):
+		parts = line.split()
+		if not parts:
+			continue
+		key = parts[0]
+		if rows is not None:
+			if key == 'ENDCHAR':
+				glyph['rows'] = rows
+				if glyph['code'] >= 0:
+					chars[glyph['code']] = glyph
+				glyph = rows = None
+			else:
+				rows.append(int(key, 16))
+			continue
+		if key == 'FONT_ASCENT':
+			ascent = int(parts[1])
+		elif key == 'FONT_DESCENT':
+			descent = int(parts[1])
+		elif key == 'STARTCHAR':
+			glyph = {'code': -1, 'advance': 0, 'bbx': (0, 0, 0, 0)}
+		elif key == 'ENCODING' and glyph is not None:
+			glyph['code'] = int(parts[1])
+		elif key == 'DWIDTH' and glyph is not None:
+			glyph['advance'] = int(parts[1])
+		elif key == 'BBX' and glyph is not None:
+			glyph['bbx'] = tuple(int(p) for p in parts[1:5])
+		elif key == 'BITMAP' and glyph is not None:
+			rows = []
+	if ascent is None or descent is None:
+		raise ValueError('FONT_ASCENT and FONT_DESCENT are required')
+	return ascent, descent, chars
+
+
+def render(glyph, ascent, scale, aa):
+	"""Returns (x, y, width, height, pixels) in target size, y from top of line, pixels 0 to 15"""
+	w, h, xoff, yoff = glyph['bbx']
+	if w == 0 or h == 0:
+		return 0, 0, 0, 0, []
+
+	# Source pixels, X from origin and Y from top of line
+	top = ascent - (yoff + h)
+	stride = (w + 7) // 8 * 8
+	src = set()
+	for j, row in enumerate(glyph['rows'][:h]):
+		for i in range(w):
+			if row & (1 << (stride - 1 - i)):
+				src.add((xoff + i, top + j))
+	if not src:
+		return 0, 0, 0, 0, []
+
+	# Coverage of each target pixel
+	cover = {}
+	for (sx, sy) in src:
+		key = (sx // scale, sy // scale)
+		cover[key] = cover.get(key, 0) + 1
+	x0 = min(k[0] for k in cover)
+	x1 = max(k[0] for k in cover)
+	y0 = min(k[1] for k in cover)
+	y1 = max(k[1] for k in cover)
+	width = x1 - x0 + 1
+	height = y1 - y0 + 1
+	area = scale * scale
+	pixels = []
+	for y in range(y0, y1 + 1):
+		for x in range(x0, x1 + 1):
+			c = cover.get((x, y), 0)
+			if aa:
+				pixels.append((c * 15 + area // 2) // area)
+			else:
+				pixels.append(15 if c * 2 >= area else 0)
+	return x0, y0, width, height, pixels
+
+
+def encode(pixels, bpp, rle):
+	"""Encodes pixels 0 to 15 to bytes"""
+	out = []
+	if rle:
+		i = 0
+		limit = 128 if bpp == 1 else 16
+		while i < len(pixels):
+			v = pixels[i]
+			n = 1
+			while i + n < len(pixels) and pixels[i + n] == v and n < limit:
+				n += 1
+			if bpp == 1:
+				out.append((0x80 if v else 0x00) | (n - 1))
+			else:
+				out.append(((n - 1) << 4) | v)
+			i += n
+	elif bpp == 1:
+		for i in range(0, len(pixels), 8):
+			b = 0
+			for k, v in enumerate(pixels[i:i + 8]):
+				if v:
+					b |= 0x80 >> k
+			out.append(b)
+	else:
+		for i in range(0, len(pixels), 2):
+			b = pixels[i] << 4
+			if i + 1 < len(pixels):
+				b |= pixels[i + 1]
+			out.append(b)
+	return out
+
+
+def parse_char(text):
+	"""Character from kerning file, single character or number"""
+	if len(text) == 1:
+		return ord(text)
+	return int(text, 0)
+
+
+def main():
+	parser = argparse.ArgumentParser(description='Converts BDF font to TM FONTS proportional font')
+	parser.add_argument('bdf')
+	parser.add_argument('name')
+	parser.add_argument('--aa', type=int, default=0)
+	parser.add_argument('--bpp', type=int, choices=[1, 4], default=1)
+	parser.add_argument('--rle', choices=['on', 'off', 'auto'], default='auto')
+	parser.add_argument('--first', type=lambda t: int(t, 0), default=32)
+	parser.add_argument('--last', type=lambda t: int(t, 0), default=126)
+	parser.add_argument('--chars', default=None)
+	parser.add_argument('--kern', default=None)
+	parser.add_argument('--out', default='.')
+	args = parser.parse_args()
+
+	ascent, descent, chars = parse_bdf(args.bdf)
+	scale = args.aa if args.aa > 1 else 1
+	bpp = 4 if args.aa > 1 else args.bpp
+
+	def scaled(v):
+		return (v + scale // 2) // scale
+
+	# Render all characters
+	space = chars.get(32, {'advance': scale * 4})['advance']
+	glyphs = []
+	for code in range(args.first, args.last + 1):
+		glyph = chars.get(code)
+		if glyph is None or (args.chars is not None and chr(code) not in args.chars and code != 32):
+			glyphs.append((0, 0, 0, 0, [], scaled(space)))
+			continue
+		x, y, w, h, pixels = render(glyph, ascent, scale, bpp == 4)
+		if w > 255 or h > 255:
+			raise ValueError('Character %d is too big' % code)
+		glyphs.append((x, y, w, h, pixels, scaled(glyph['advance'])))
+
+	# Encode, select smaller format for auto
+	variants = []
+	if args.rle in ('off', 'auto'):
+		variants.append(False)
+	if args.rle in ('on', 'auto'):
+		variants.append(True)
+	best = None
+	for rle in variants:
+		data = []
+		offsets = []
+		for g in glyphs:
+			offsets.append(len(data))
+			data.extend(encode(g[4], bpp, rle))
+		if best is None or len(data) < len(best[1]):
+			best = (rle, data, offsets)
+	rle, data, offsets = best
+	fmt = 'TM_FONTS_PropFormat_%dBPP%s' % (bpp, '_RLE' if rle else '')
+
+	# Kerning pairs, sorted for binary search
+	pairs = []
+	if args.kern:
+		for line in open(args.kern, 'r'):
+			parts = line.split()
+			if len(parts) == 3 and not parts[0].startswith('#'):
+				pairs.append((parse_char(parts[0]), parse_char(parts[1]), int(parts[2])))
+	pairs.sort()
+
+	# Write files
+	name = args.name
+	height = scaled(ascent + descent)
+	baseline = scaled(ascent)
+	c = []
+	c.append('/**')
+	c.append(' * Proportional font for TM FONTS library, made with fontconv.py')
+	c.append(' * Source: %s' % os.path.basename(args.bdf))
+	c.append(' * Format: %s, %d bytes of bitmap data' % (fmt, len(data)))
+	c.append(' */')
+	c.append('#include "%s.h"' % name)
+	c.append('')
+	c.append('static const uint8_t %s_Data[] = {' % name)
+	for i in range(0, len(data), 16):
+		c.append('\t' + ', '.join('0x%02X' % b for b in data[i:i + 16]) + ',')
+	if not data:
+		c.append('\t0x00')
+	c.append('};')
+	c.append('')
+	c.append('static const TM_FONTS_PropGlyph_t %s_Glyphs[] = {' % name)
+	for code, (g, off) in enumerate(zip(glyphs, offsets), args.first):
+		x, y, w, h, pixels, adv = g
+		ch = chr(code) if 32 < code < 127 and chr(code) not in '\\*/' else ' '
+		c.append('\t{%6d, %3d, %3d, %3d, %4d, %4d}, /* 0x%02X %s */' % (off, w, h, adv, x, y, code, ch))
+	c.append('};')
+	c.append('')
+	if pairs:
+		c.append('static const TM_FONTS_Kerning_t %s_Kerning[] = {' % name)
+		for l, r, v in pairs:
+			c.append('\t{0x%02X, 0x%02X, %d},' % (l, r, v))
+		c.append('};')
+		c.append('')
+	c.append('const TM_FONTS_PropFont_t %s = {' % name)
+	c.append('\t%d,' % height)
+	c.append('\t%d,' % baseline)
+	c.append('\t%d,' % args.first)
+	c.append('\t%d,' % args.last)
+	c.append('\t%s,' % fmt)
+	c.append('\t%s_Glyphs,' % name)
+	c.append('\t%s_Data,' % name)
+	c.append('\t%s,' % ((name + '_Kerning') if pairs else '0'))
+	c.append('\t%d' % len(pairs))
+	c.append('};')
+
+	h = []
+	h.append('/**')
+	h.append(' * Proportional font for TM FONTS library, made with fontconv.py')
+	h.append(' */')
+	h.append('#ifndef %s_H' % name.upper())
+	h.append('#define %s_H' % name.upper())
+	h.append('')
+	h.append('#include "tm_stm32f4_fonts.h"')
+	h.append('')
+	h.append('extern const TM_FONTS_PropFont_t %s;' % name)
+	h.append('')
+	h.append('#endif')
+
+	open(os.path.join(args.out, name + '.c'), 'w').write('\n'.join(c) + '\n')
+	open(os.path.join(args.out, name + '.h'), 'w').write('\n'.join(h) + '\n')
+	sys.stdout.write('%s: %d characters, %s, %d bytes of bitmap data, %d kerning pairs\n' % (name, len(glyphs), fmt, len(data), len(pairs)))
+
+
+if __name__ == '__main__':
+	main()
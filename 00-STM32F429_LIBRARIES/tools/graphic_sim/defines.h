@@ -0,0 +1,21 @@
+/*
+ * Project defines for host build of graphic libraries
+ */
+#ifndef TM_DEFINES_H
+#define TM_DEFINES_H
+
+/* Simulated LCD controllers and replacements for hardware libraries */
+#include "sim.h"
+
+/* DMA2D operations are done with CPU model, there is no DMA2D interrupt and no DWT counter on PC */
+#define DMA2D_GRAPHIC_SOFTWARE		1
+#define DMA2D_GRAPHIC_USE_IRQ		0
+#define DMA2D_GRAPHIC_USE_DWT		0
+
+/* ILI9341 framebuffer is array in PC memory instead of SDRAM */
+#define DMA2D_GRAPHIC_RAM_ADDR		((uintptr_t)SIM_ILI9341_Framebuffer)
+
+/* SSD1306 is updated with blocking I2C functions */
+#define SSD1306_USE_DMA				0
+
+#endif
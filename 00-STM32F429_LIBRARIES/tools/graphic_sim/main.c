@@ -0,0 +1,567 @@
+/*
+ * Graphic libraries on simulated displays, golden image tests and benchmark
+ *
+ * Copyright (C) Tilen MAJERLE, 2015
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * DMA2D graphic (with AA and span libraries), SSD1306 and PCD8544 libraries are compiled for PC
+ * and draw to simulated displays, see sim.h. DMA2D operations are done with software DMA2D model.
+ *
+ * Each test draws one scene and compares what panel shows with golden image in tools/graphic_sim/golden
+ * folder, pixel by pixel. When test fails, its image is saved to <name>.ppm and differences
+ * (changed pixels in red) to <name>_diff.ppm in current folder.
+ * After intended change of drawing, check new images and save them as golden images with -u.
+ *
+ * Benchmark draws each primitive many times and reports primitives per second on PC.
+ * Numbers do not tell speed on STM32F4, compare them before and after change of drawing code.
+ *
+ * Build and run from 00-STM32F429_LIBRARIES folder:
+ *   gcc -O2 -DSTM32F429_439xx -Itools/graphic_sim -I. -I../00-STM32F4xx_STANDARD_PERIPHERAL_DRIVERS/CMSIS/Include -I../00-STM32F4xx_STANDARD_PERIPHERAL_DRIVERS/CMSIS/Device/ST/STM32F4xx/Include -I../00-STM32F4xx_STANDARD_PERIPHERAL_DRIVERS/STM32F4xx_StdPeriph_Driver/inc -o graphicsim tools/graphic_sim/main.c tools/graphic_sim/sim.c tm_stm32f4_dma2d_graphic.c tm_stm32f4_span.c tm_stm32f4_aa.c tm_stm32f4_fonts.c tm_stm32f4_mono.c tm_stm32f4_ssd1306.c tm_stm32f4_pcd8544.c -lm
+ *   ./graphicsim          run tests and benchmark
+ *   ./graphicsim -t       run tests only
+ *   ./graphicsim -b       run benchmark only
+ *   ./graphicsim -u       save images of all tests as new golden images
+ */
+#include "sim.h"
+#include "tm_stm32f4_dma2d_graphic.h"
+#include "tm_stm32f4_ssd1306.h"
+#include "tm_stm32f4_pcd8544.h"
+#include "tm_stm32f4_mono.h"
+#include "tm_stm32f4_fonts.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Folder with golden images, relative to 00-STM32F429_LIBRARIES */
+#define GOLDEN_DIR			"tools/graphic_sim/golden"
+
+/* Minimal time of each benchmark in seconds */
+#define BENCH_TIME			0.2
+
+/* Size of test images */
+#define IMG_SIZE			32
+
+/* Test */
+typedef struct {
+	const char* Name;
+	void (*Draw)(SIM_Image_t* Image);
+} Test_t;
+
+/* Benchmark, function draws one primitive, i is used for position */
+typedef struct {
+	const char* Name;
+	void (*Init)(void);
+	void (*Draw)(uint32_t i);
+	void (*Done)(void);
+} Bench_t;
+
+/* Test images */
+static uint16_t ImgRGB565[IMG_SIZE * IMG_SIZE];
+static uint32_t ImgARGB8888[IMG_SIZE * IMG_SIZE];
+static uint16_t ImgARGB4444[IMG_SIZE * IMG_SIZE];
+static uint8_t ImgL8[IMG_SIZE * IMG_SIZE];
+static uint32_t ImgCLUT[16];
+static uint8_t ImgA8[IMG_SIZE * IMG_SIZE];
+
+static const TM_DMA2DGRAPHIC_Image_t ImageRGB565 = {ImgRGB565, IMG_SIZE, IMG_SIZE, TM_DMA2DGRAPHIC_ImageFormat_RGB565, NULL, 0, 0};
+static const TM_DMA2DGRAPHIC_Image_t ImageARGB8888 = {ImgARGB8888, IMG_SIZE, IMG_SIZE, TM_DMA2DGRAPHIC_ImageFormat_ARGB8888, NULL, 0, 0};
+static const TM_DMA2DGRAPHIC_Image_t ImageARGB4444 = {ImgARGB4444, IMG_SIZE, IMG_SIZE, TM_DMA2DGRAPHIC_ImageFormat_ARGB4444, NULL, 0, 0};
+static const TM_DMA2DGRAPHIC_Image_t ImageL8 = {ImgL8, IMG_SIZE, IMG_SIZE, TM_DMA2DGRAPHIC_ImageFormat_L8, ImgCLUT, 16, 0};
+static const TM_DMA2DGRAPHIC_Image_t ImageA8 = {ImgA8, IMG_SIZE, IMG_SIZE, TM_DMA2DGRAPHIC_ImageFormat_A8, NULL, 0, GRAPHIC_COLOR_RED};
+static const TM_DMA2DGRAPHIC_Image_t ImageL8NoCLUT = {ImgL8, IMG_SIZE, IMG_SIZE, TM_DMA2DGRAPHIC_ImageFormat_L8, ImgCLUT, 0, 0};
+
+/* 16x16 sprite for mono displays, with mask */
+static const uint8_t MonoSprite[32] = {
+	0x00, 0xE0, 0x18, 0x04, 0x64, 0x62, 0x02, 0x02, 0x02, 0x02, 0x62, 0x64, 0x04, 0x18, 0xE0, 0x00,
+	0x00, 0x07, 0x18, 0x20, 0x22, 0x44, 0x48, 0x48, 0x48, 0x48, 0x44, 0x22, 0x20, 0x18, 0x07, 0x00
+};
+static const uint8_t MonoSpriteMask[32] = {
+	0x00, 0xE0, 0xF8, 0xFC, 0xFC, 0xFE, 0xFE, 0xFE, 0xFE, 0xFE, 0xFE, 0xFC, 0xFC, 0xF8, 0xE0, 0x00,
+	0x00, 0x07, 0x1F, 0x3F, 0x3F, 0x7F, 0x7F, 0x7F, 0x7F, 0x7F, 0x7F, 0x3F, 0x3F, 0x1F, 0x07, 0x00
+};
+
+/* Private functions */
+static void MakeImages(void);
+static uint32_t Hash(uint32_t x);
+static double Now(void);
+static int RunTest(const Test_t* Test, uint8_t update);
+static void RunBench(const Bench_t* Bench);
+
+/* Scenes */
+static void ILI9341_Begin(uint8_t orientation, uint16_t background) {
+	SIM_Reset();
+	TM_DMA2DGRAPHIC_Init();
+	TM_DMA2DGRAPHIC_SetOrientation(orientation);
+	TM_DMA2DGRAPHIC_SetLayer(1);
+	TM_DMA2DGRAPHIC_Fill(background);
+}
+
+static void ILI9341_End(SIM_Image_t* Image) {
+	TM_DMA2DGRAPHIC_Flush();
+	SIM_ILI9341_GetImage(Image, 1);
+}
+
+static void Scene_ILI9341_Shapes(SIM_Image_t* Image) {
+	TM_DMA2DRAPHIC_Poly_t zigzag[6] = {{120, 290}, {140, 310}, {160, 290}, {180, 310}, {200, 290}, {220, 310}};
+	TM_DMA2DRAPHIC_Poly_t star[10] = {
+		{180, 210}, {187, 230}, {209, 231}, {191, 244}, {198, 264},
+		{180, 252}, {162, 264}, {169, 244}, {151, 231}, {173, 230}
+	};
+	uint8_t i;
+
+	ILI9341_Begin(1, 0x0010);
+
+	TM_DMA2DGRAPHIC_DrawFilledRectangle(10, 10, 60, 40, GRAPHIC_COLOR_RED);
+	TM_DMA2DGRAPHIC_DrawRectangle(80, 10, 60, 40, GRAPHIC_COLOR_GREEN);
+	TM_DMA2DGRAPHIC_DrawRoundedRectangle(150, 10, 80, 40, 8, GRAPHIC_COLOR_YELLOW);
+	TM_DMA2DGRAPHIC_DrawFilledRoundedRectangle(10, 60, 100, 50, 12, GRAPHIC_COLOR_CYAN);
+	TM_DMA2DGRAPHIC_DrawCircle(170, 85, 30, GRAPHIC_COLOR_WHITE);
+	TM_DMA2DGRAPHIC_DrawFilledCircle(60, 150, 30, GRAPHIC_COLOR_ORANGE);
+	TM_DMA2DGRAPHIC_DrawTriangle(110, 125, 200, 130, 150, 190, GRAPHIC_COLOR_MAGENTA);
+	TM_DMA2DGRAPHIC_DrawFilledTriangle(15, 195, 100, 205, 55, 260, GRAPHIC_COLOR_GREEN2);
+
+	/* Lines in all directions */
+	for (i = 0; i < 16; i++) {
+		TM_DMA2DGRAPHIC_DrawLine(60, 290, 60 + ((int16_t)(i & 3) - 2) * 14 * ((i & 4) ? 1 : -1), 290 + ((int16_t)(i >> 2) - 2) * 12, GRAPHIC_COLOR_WHITE);
+	}
+	TM_DMA2DGRAPHIC_DrawPolyLine(zigzag, 6, GRAPHIC_COLOR_YELLOW);
+	TM_DMA2DGRAPHIC_DrawFilledPolygon(star, 10, GRAPHIC_COLOR_BLUE2);
+
+	/* Lines clipped at edges */
+	TM_DMA2DGRAPHIC_DrawHorizontalLine(-20, 0, 100, GRAPHIC_COLOR_RED);
+	TM_DMA2DGRAPHIC_DrawHorizontalLine(200, 319, 100, GRAPHIC_COLOR_RED);
+	TM_DMA2DGRAPHIC_DrawVerticalLine(0, -20, 100, GRAPHIC_COLOR_GREEN);
+	TM_DMA2DGRAPHIC_DrawVerticalLine(239, 280, 100, GRAPHIC_COLOR_GREEN);
+	for (i = 0; i < 20; i++) {
+		TM_DMA2DGRAPHIC_DrawPixel(120 + i * 2, 316, GRAPHIC_COLOR_WHITE);
+	}
+
+	ILI9341_End(Image);
+}
+
+static void Scene_ILI9341_AA(SIM_Image_t* Image) {
+	TM_DMA2DRAPHIC_Poly_t poly[6] = {{130, 230}, {225, 220}, {210, 270}, {170, 250}, {150, 310}, {120, 280}};
+	uint8_t i;
+
+	ILI9341_Begin(1, GRAPHIC_COLOR_WHITE);
+
+	/* Lines with all slopes */
+	for (i = 0; i < 24; i++) {
+		TM_DMA2DGRAPHIC_DrawLineAA(60, 60, 60 + (Hash(i) % 101) - 50, 60 + (Hash(i + 100) % 101) - 50, GRAPHIC_COLOR_BLACK);
+	}
+	for (i = 0; i < 5; i++) {
+		TM_DMA2DGRAPHIC_DrawThickLineAA(130, 20 + i * 18, 230, 30 + i * 25, 1 + i * 2, GRAPHIC_COLOR_BLUE);
+	}
+	TM_DMA2DGRAPHIC_DrawCircleAA(60, 170, 45, GRAPHIC_COLOR_RED);
+	TM_DMA2DGRAPHIC_DrawFilledCircleAA(60, 170, 25, GRAPHIC_COLOR_GREEN);
+	TM_DMA2DGRAPHIC_DrawArcAA(175, 170, 45, 8, 30, 300, GRAPHIC_COLOR_ORANGE);
+	TM_DMA2DGRAPHIC_DrawArcAA(175, 170, 25, 3, 200, 100, GRAPHIC_COLOR_MAGENTA);
+	TM_DMA2DGRAPHIC_DrawPolygonAA(poly, 6, GRAPHIC_COLOR_BLUE2);
+	TM_DMA2DGRAPHIC_DrawFilledCircleAA(50, 270, 35, GRAPHIC_COLOR_GRAY);
+
+	ILI9341_End(Image);
+}
+
+static void Scene_ILI9341_Images(SIM_Image_t* Image) {
+	uint16_t* fb = SIM_ILI9341_Framebuffer;
+	uint16_t y;
+
+	ILI9341_Begin(1, 0);
+
+	/* Background gradient, so blending is visible */
+	for (y = 0; y < 320; y++) {
+		TM_DMA2DGRAPHIC_DrawHorizontalLine(0, y, 240, ((y * 31 / 319) << 11) | (((319 - y) * 63 / 319) << 5) | 0x0008);
+	}
+
+	/* All image formats, with DMA2D */
+	TM_DMA2DGRAPHIC_DrawImage(10, 10, &ImageRGB565);
+	TM_DMA2DGRAPHIC_DrawImage(50, 10, &ImageARGB8888);
+	TM_DMA2DGRAPHIC_DrawImage(90, 10, &ImageARGB4444);
+	TM_DMA2DGRAPHIC_DrawImage(130, 10, &ImageL8);
+	TM_DMA2DGRAPHIC_DrawImage(170, 10, &ImageA8);
+
+	/* Clipped at all edges */
+	TM_DMA2DGRAPHIC_DrawImage(-10, 60, &ImageARGB8888);
+	TM_DMA2DGRAPHIC_DrawImage(220, 60, &ImageL8);
+	TM_DMA2DGRAPHIC_DrawImage(100, -16, &ImageRGB565);
+	TM_DMA2DGRAPHIC_DrawImage(100, 300, &ImageA8);
+
+	/* L8 image without lookup table is not drawn */
+	TM_DMA2DGRAPHIC_DrawImage(200, 100, &ImageL8NoCLUT);
+	TM_DMA2DGRAPHIC_DrawSprite(200, 140, &ImageL8NoCLUT, 0);
+
+	/* Colour keyed sprite, with CPU */
+	TM_DMA2DGRAPHIC_DrawSprite(10, 100, &ImageRGB565, ImgRGB565[0]);
+	TM_DMA2DGRAPHIC_DrawSprite(50, 100, &ImageARGB8888, 0);
+
+	/* Raw buffer operations: fill, copy, conversion and blending */
+	TM_DMA2DGRAPHIC_FillBufferIT(&fb[150 * 240 + 10], 60, 40, 240 - 60, GRAPHIC_COLOR_YELLOW);
+	TM_DMA2DGRAPHIC_CopyBufferIT(&fb[10 * 240 + 10], &fb[150 * 240 + 90], 72, 32, 240 - 72, 240 - 72);
+	TM_DMA2DGRAPHIC_ConvertBufferIT(ImgARGB8888, &fb[200 * 240 + 10], IMG_SIZE, IMG_SIZE, 0, 240 - IMG_SIZE, CM_ARGB8888, CM_RGB565);
+	TM_DMA2DGRAPHIC_BlendBufferIT(ImgARGB4444, &fb[150 * 240 + 20], &fb[200 * 240 + 50], IMG_SIZE, IMG_SIZE, 0, 240 - IMG_SIZE, 240 - IMG_SIZE, CM_ARGB4444, 0);
+	TM_DMA2DGRAPHIC_BlendBufferIT(ImgA8, &fb[200 * 240 + 90], &fb[200 * 240 + 90], IMG_SIZE, IMG_SIZE, 0, 240 - IMG_SIZE, 240 - IMG_SIZE, CM_A8, 0x00FF00);
+
+	ILI9341_End(Image);
+}
+
+static void Scene_ILI9341_Rotated(SIM_Image_t* Image) {
+	uint8_t o;
+
+	/* Each orientation draws to one quarter of landscape or portrait screen, images are drawn with CPU when rotated */
+	ILI9341_Begin(0, GRAPHIC_COLOR_BLACK);
+	for (o = 0; o < 4; o++) {
+		TM_DMA2DGRAPHIC_SetOrientation(o);
+		TM_DMA2DGRAPHIC_DrawRectangle(2 + o * 4, 2 + o * 4, 100, 60, GRAPHIC_COLOR_RED + o * 0x0101);
+		TM_DMA2DGRAPHIC_DrawFilledRectangle(10 + o * 4, 10 + o * 4, 20, 10, GRAPHIC_COLOR_GREEN);
+		TM_DMA2DGRAPHIC_DrawLine(10, 70, 90, 30, GRAPHIC_COLOR_WHITE);
+		TM_DMA2DGRAPHIC_DrawLineAA(10, 75, 90, 35, GRAPHIC_COLOR_CYAN);
+		TM_DMA2DGRAPHIC_DrawFilledCircleAA(60, 40, 8, GRAPHIC_COLOR_YELLOW);
+		TM_DMA2DGRAPHIC_DrawImage(40 + o * 8, 20, &ImageARGB8888);
+		TM_DMA2DGRAPHIC_DrawSprite(70, 10, &ImageL8, ImgCLUT[0]);
+	}
+
+	ILI9341_End(Image);
+}
+
+static void Scene_SSD1306(SIM_Image_t* Image) {
+	SIM_Reset();
+	TM_SSD1306_Init();
+
+	TM_SSD1306_GotoXY(2, 2);
+	TM_SSD1306_Puts("SSD1306", &TM_Font_11x18, SSD1306_COLOR_WHITE);
+	TM_SSD1306_GotoXY(2, 24);
+	TM_SSD1306_Puts("Hello 7x10", &TM_Font_7x10, SSD1306_COLOR_WHITE);
+	TM_SSD1306_DrawRectangle(84, 2, 40, 20, SSD1306_COLOR_WHITE);
+	TM_SSD1306_DrawFilledRectangle(88, 6, 10, 12, SSD1306_COLOR_WHITE);
+	TM_SSD1306_DrawCircle(110, 44, 14, SSD1306_COLOR_WHITE);
+	TM_SSD1306_DrawFilledCircle(110, 44, 6, SSD1306_COLOR_WHITE);
+	TM_SSD1306_DrawLine(0, 63, 80, 38, SSD1306_COLOR_WHITE);
+	TM_SSD1306_DrawTriangle(40, 40, 70, 60, 20, 60, SSD1306_COLOR_WHITE);
+	TM_SSD1306_UpdateScreen();
+
+	/* Second update sends only changed columns */
+	TM_MONO_DrawSprite(TM_SSD1306_GetMono(), 60, 40, MonoSprite, MonoSpriteMask, 16, 16, TM_MONO_Op_Xor);
+	TM_MONO_FillRectangle(TM_SSD1306_GetMono(), 0, 36, 30, 10, TM_MONO_Op_Xor);
+	TM_SSD1306_DrawPixel(127, 0, SSD1306_COLOR_WHITE);
+	TM_SSD1306_UpdateScreen();
+
+	SIM_SSD1306_GetImage(Image);
+}
+
+static void Scene_PCD8544(SIM_Image_t* Image) {
+	SIM_Reset();
+	PCD8544_Init(0x38);
+
+	PCD8544_GotoXY(1, 1);
+	PCD8544_Puts("PCD8544", PCD8544_Pixel_Set, PCD8544_FontSize_5x7);
+	PCD8544_GotoXY(1, 10);
+	PCD8544_Puts("small 3x5", PCD8544_Pixel_Set, PCD8544_FontSize_3x5);
+	PCD8544_DrawRectangle(50, 0, 83, 20, PCD8544_Pixel_Set);
+	PCD8544_DrawFilledRectangle(54, 4, 60, 10, PCD8544_Pixel_Set);
+	PCD8544_DrawCircle(20, 34, 10, PCD8544_Pixel_Set);
+	PCD8544_DrawFilledCircle(20, 34, 4, PCD8544_Pixel_Set);
+	PCD8544_DrawLine(40, 24, 83, 47, PCD8544_Pixel_Set);
+	PCD8544_Refresh();
+
+	/* Partial refresh */
+	TM_MONO_DrawSprite(PCD8544_GetMono(), 60, 28, MonoSprite, MonoSpriteMask, 16, 16, TM_MONO_Op_Xor);
+	PCD8544_Refresh();
+
+	SIM_PCD8544_GetImage(Image);
+}
+
+static const Test_t Tests[] = {
+	{"ili9341_shapes", Scene_ILI9341_Shapes},
+	{"ili9341_aa", Scene_ILI9341_AA},
+	{"ili9341_images", Scene_ILI9341_Images},
+	{"ili9341_rotated", Scene_ILI9341_Rotated},
+	{"ssd1306", Scene_SSD1306},
+	{"pcd8544", Scene_PCD8544},
+};
+
+/* Benchmarks */
+static void Bench_ILI9341_Init(void) {
+	ILI9341_Begin(1, GRAPHIC_COLOR_BLACK);
+}
+
+static void Bench_ILI9341_Done(void) {
+	TM_DMA2DGRAPHIC_Flush();
+}
+
+static void Bench_Pixel(uint32_t i) {
+	TM_DMA2DGRAPHIC_DrawPixel(Hash(i) % 240, Hash(i + 1) % 320, i);
+}
+
+static void Bench_Line(uint32_t i) {
+	TM_DMA2DGRAPHIC_DrawLine(Hash(i) % 240, Hash(i + 1) % 320, Hash(i + 2) % 240, Hash(i + 3) % 320, i);
+}
+
+static void Bench_LineAA(uint32_t i) {
+	TM_DMA2DGRAPHIC_DrawLineAA(Hash(i) % 240, Hash(i + 1) % 320, Hash(i + 2) % 240, Hash(i + 3) % 320, i);
+}
+
+static void Bench_ThickLineAA(uint32_t i) {
+	TM_DMA2DGRAPHIC_DrawThickLineAA(Hash(i) % 240, Hash(i + 1) % 320, Hash(i + 2) % 240, Hash(i + 3) % 320, 5, i);
+}
+
+static void Bench_Rectangle(uint32_t i) {
+	TM_DMA2DGRAPHIC_DrawFilledRectangle(Hash(i) % 200, Hash(i + 1) % 280, 40, 40, i);
+}
+
+static void Bench_Circle(uint32_t i) {
+	TM_DMA2DGRAPHIC_DrawFilledCircle(20 + Hash(i) % 200, 20 + Hash(i + 1) % 280, 20, i);
+}
+
+static void Bench_CircleAA(uint32_t i) {
+	TM_DMA2DGRAPHIC_DrawFilledCircleAA(20 + Hash(i) % 200, 20 + Hash(i + 1) % 280, 20, i);
+}
+
+static void Bench_Triangle(uint32_t i) {
+	TM_DMA2DGRAPHIC_DrawFilledTriangle(Hash(i) % 240, Hash(i + 1) % 320, Hash(i + 2) % 240, Hash(i + 3) % 320, Hash(i + 4) % 240, Hash(i + 5) % 320, i);
+}
+
+static void Bench_ImageARGB8888(uint32_t i) {
+	TM_DMA2DGRAPHIC_DrawImage(Hash(i) % 208, Hash(i + 1) % 288, &ImageARGB8888);
+}
+
+static void Bench_ImageL8(uint32_t i) {
+	TM_DMA2DGRAPHIC_DrawImage(Hash(i) % 208, Hash(i + 1) % 288, &ImageL8);
+}
+
+static void Bench_Sprite(uint32_t i) {
+	TM_DMA2DGRAPHIC_DrawSprite(Hash(i) % 208, Hash(i + 1) % 288, &ImageRGB565, ImgRGB565[0]);
+}
+
+static void Bench_Fill(uint32_t i) {
+	TM_DMA2DGRAPHIC_Fill(i);
+}
+
+static void Bench_SSD1306_Init(void) {
+	SIM_Reset();
+	TM_SSD1306_Init();
+}
+
+static void Bench_SSD1306_Text(uint32_t i) {
+	TM_SSD1306_GotoXY(Hash(i) % 60, Hash(i + 1) % 54);
+	TM_SSD1306_Puts("Text 7x10", &TM_Font_7x10, (SSD1306_COLOR_t)(i & 1));
+}
+
+static void Bench_SSD1306_Update(uint32_t i) {
+	/* Small change, only dirty columns are sent */
+	TM_MONO_DrawSprite(TM_SSD1306_GetMono(), Hash(i) % 112, Hash(i + 1) % 48, MonoSprite, MonoSpriteMask, 16, 16, TM_MONO_Op_Xor);
+	TM_SSD1306_UpdateScreen();
+}
+
+static void Bench_PCD8544_Init(void) {
+	SIM_Reset();
+	PCD8544_Init(0x38);
+}
+
+static void Bench_PCD8544_Text(uint32_t i) {
+	PCD8544_GotoXY(Hash(i) % 40, Hash(i + 1) % 40);
+	PCD8544_Puts("Text", (PCD8544_Pixel_t)(i & 1), PCD8544_FontSize_5x7);
+}
+
+static void Bench_PCD8544_Refresh(uint32_t i) {
+	TM_MONO_DrawSprite(PCD8544_GetMono(), Hash(i) % 68, Hash(i + 1) % 32, MonoSprite, MonoSpriteMask, 16, 16, TM_MONO_Op_Xor);
+	PCD8544_Refresh();
+}
+
+static const Bench_t Benchs[] = {
+	{"ILI9341 pixel", Bench_ILI9341_Init, Bench_Pixel, Bench_ILI9341_Done},
+	{"ILI9341 line", Bench_ILI9341_Init, Bench_Line, Bench_ILI9341_Done},
+	{"ILI9341 AA line", Bench_ILI9341_Init, Bench_LineAA, Bench_ILI9341_Done},
+	{"ILI9341 AA thick line 5px", Bench_ILI9341_Init, Bench_ThickLineAA, Bench_ILI9341_Done},
+	{"ILI9341 filled rect 40x40", Bench_ILI9341_Init, Bench_Rectangle, Bench_ILI9341_Done},
+	{"ILI9341 filled circle r20", Bench_ILI9341_Init, Bench_Circle, Bench_ILI9341_Done},
+	{"ILI9341 AA filled circle r20", Bench_ILI9341_Init, Bench_CircleAA, Bench_ILI9341_Done},
+	{"ILI9341 filled triangle", Bench_ILI9341_Init, Bench_Triangle, Bench_ILI9341_Done},
+	{"ILI9341 ARGB8888 image 32x32", Bench_ILI9341_Init, Bench_ImageARGB8888, Bench_ILI9341_Done},
+	{"ILI9341 L8 image 32x32", Bench_ILI9341_Init, Bench_ImageL8, Bench_ILI9341_Done},
+	{"ILI9341 keyed sprite 32x32", Bench_ILI9341_Init, Bench_Sprite, Bench_ILI9341_Done},
+	{"ILI9341 full screen fill", Bench_ILI9341_Init, Bench_Fill, Bench_ILI9341_Done},
+	{"SSD1306 text 9 chars", Bench_SSD1306_Init, Bench_SSD1306_Text, NULL},
+	{"SSD1306 sprite + update", Bench_SSD1306_Init, Bench_SSD1306_Update, NULL},
+	{"PCD8544 text 4 chars", Bench_PCD8544_Init, Bench_PCD8544_Text, NULL},
+	{"PCD8544 sprite + refresh", Bench_PCD8544_Init, Bench_PCD8544_Refresh, NULL},
+};
+
+int main(int argc, char** argv) {
+	uint8_t tests = 1, bench = 1, update = 0;
+	uint32_t i, failed = 0;
+
+	if (argc > 1 && !strcmp(argv[1], "-t")) {
+		bench = 0;
+	} else if (argc > 1 && !strcmp(argv[1], "-b")) {
+		tests = 0;
+	} else if (argc > 1 && !strcmp(argv[1], "-u")) {
+		bench = 0;
+		update = 1;
+	} else if (argc > 1) {
+		printf("Usage: %s [-t | -b | -u]\n", argv[0]);
+		return 2;
+	}
+
+	MakeImages();
+
+	if (tests) {
+		printf("Golden image tests\n");
+		for (i = 0; i < sizeof(Tests) / sizeof(Tests[0]); i++) {
+			failed += !RunTest(&Tests[i], update);
+		}
+		printf("%u of %u tests failed\n\n", (unsigned)failed, (unsigned)(sizeof(Tests) / sizeof(Tests[0])));
+	}
+
+	if (bench) {
+		printf("%-30s %12s %14s\n", "Benchmark", "prims/s", "bus bytes/prim");
+		for (i = 0; i < sizeof(Benchs) / sizeof(Benchs[0]); i++) {
+			RunBench(&Benchs[i]);
+		}
+	}
+
+	return failed ? 1 : 0;
+}
+
+/* Private functions */
+static void MakeImages(void) {
+	uint16_t x, y, i;
+	int32_t dx, dy, d;
+
+	for (i = 0; i < 16; i++) {
+		ImgCLUT[i] = 0xFF000000 | ((uint32_t)(i * 17) << 16) | ((uint32_t)(255 - i * 17) << 8) | (Hash(i) & 0xFF);
+	}
+	for (y = 0; y < IMG_SIZE; y++) {
+		for (x = 0; x < IMG_SIZE; x++) {
+			i = y * IMG_SIZE + x;
+			dx = x * 2 - IMG_SIZE + 1;
+			dy = y * 2 - IMG_SIZE + 1;
+			d = dx * dx + dy * dy;
+
+			/* Gradient with black corner for colour key */
+			ImgRGB565[i] = (x && y) ? ((x << 11) | ((y * 2) << 5) | (31 - x)) : 0;
+
+			/* Disc with soft edge */
+			d = d >= IMG_SIZE * IMG_SIZE ? 0 : 255 - d * 255 / (IMG_SIZE * IMG_SIZE);
+			ImgARGB8888[i] = ((uint32_t)d << 24) | ((uint32_t)(x * 8) << 16) | 0x8000 | (y * 8);
+
+			/* Checker with half transparent squares */
+			ImgARGB4444[i] = (((x >> 3) ^ (y >> 3)) & 1) ? 0xFF0F : 0x80F0;
+
+			/* Rings of palette colours, index 0 is outside */
+			ImgL8[i] = (x && y) ? ((x + y) / 4) & 0x0F : 0;
+
+			/* Diagonal alpha ramp */
+			ImgA8[i] = (x + y) * 255 / (2 * IMG_SIZE - 2);
+		}
+	}
+}
+
+static uint32_t Hash(uint32_t x) {
+	x ^= x >> 16;
+	x *= 0x7FEB352D;
+	x ^= x >> 15;
+	x *= 0x846CA68B;
+	x ^= x >> 16;
+	return x;
+}
+
+static double Now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int RunTest(const Test_t* Test, uint8_t update) {
+	SIM_Image_t actual, golden;
+	char path[256];
+	uint32_t x, y, diff = 0, first = 0;
+	uint8_t* p;
+
+	Test->Draw(&actual);
+	snprintf(path, sizeof(path), "%s/%s.ppm", GOLDEN_DIR, Test->Name);
+
+	/* Save new golden image */
+	if (update) {
+		if (!SIM_SavePPM(&actual, path)) {
+			printf("  %-20s can not write %s\n", Test->Name, path);
+			SIM_FreeImage(&actual);
+			return 0;
+		}
+		printf("  %-20s saved %s\n", Test->Name, path);
+		SIM_FreeImage(&actual);
+		return 1;
+	}
+
+	if (!SIM_LoadPPM(&golden, path)) {
+		printf("  %-20s FAIL, can not read %s\n", Test->Name, path);
+		SIM_FreeImage(&actual);
+		return 0;
+	}
+	if (golden.Width != actual.Width || golden.Height != actual.Height) {
+		printf("  %-20s FAIL, golden image is %ux%u, display is %ux%u\n", Test->Name, golden.Width, golden.Height, actual.Width, actual.Height);
+		SIM_FreeImage(&actual);
+		SIM_FreeImage(&golden);
+		return 0;
+	}
+
+	/* Compare pixels, golden image is changed to difference image */
+	for (y = 0; y < actual.Height; y++) {
+		for (x = 0; x < actual.Width; x++) {
+			p = &golden.Pixels[(y * actual.Width + x) * 3];
+			if (memcmp(p, &actual.Pixels[(y * actual.Width + x) * 3], 3)) {
+				if (!diff++) {
+					first = y * actual.Width + x;
+				}
+				p[0] = 0xFF;
+				p[1] = 0;
+				p[2] = 0;
+			} else {
+				p[0] = p[1] = p[2] = (p[0] + p[1] + p[2]) / 12;
+			}
+		}
+	}
+
+	if (diff) {
+		printf("  %-20s FAIL, %u pixels differ, first at x = %u, y = %u\n", Test->Name, (unsigned)diff, (unsigned)(first % actual.Width), (unsigned)(first / actual.Width));
+		snprintf(path, sizeof(path), "%s.ppm", Test->Name);
+		SIM_SavePPM(&actual, path);
+		snprintf(path, sizeof(path), "%s_diff.ppm", Test->Name);
+		SIM_SavePPM(&golden, path);
+	} else {
+		printf("  %-20s OK\n", Test->Name);
+	}
+
+	SIM_FreeImage(&actual);
+	SIM_FreeImage(&golden);
+	return diff == 0;
+}
+
+static void RunBench(const Bench_t* Bench) {
+	uint32_t i = 0, n, batch = 16, bytes;
+	double start, elapsed;
+
+	Bench->Init();
+	bytes = SIM_GetBusBytes();
+
+	/* Batches are doubled until benchmark takes long enough */
+	start = Now();
+	do {
+		for (n = 0; n < batch; n++) {
+			Bench->Draw(i++);
+		}
+		if (Bench->Done) {
+			Bench->Done();
+		}
+		batch *= 2;
+		elapsed = Now() - start;
+	} while (elapsed < BENCH_TIME);
+
+	bytes = SIM_GetBusBytes() - bytes;
+	printf("%-30s %12.0f %14.1f\n", Bench->Name, i / elapsed, (double)bytes / i);
+}
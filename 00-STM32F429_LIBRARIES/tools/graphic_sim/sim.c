@@ -0,0 +1,471 @@
+/*
+ * Simulated LCD controllers for host build of graphic libraries
+ *
+ * Copyright (C) Tilen MAJERLE, 2015
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ */
+#include "sim.h"
+#include "tm_stm32f4_i2c.h"
+#include "tm_stm32f4_ssd1306.h"
+#include "tm_stm32f4_pcd8544.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Colours of pixels on panels */
+#define SSD1306_ON_RGB		0xFFFFFF
+#define SSD1306_OFF_RGB		0x000000
+#define PCD8544_ON_RGB		0x203020
+#define PCD8544_OFF_RGB		0xB4C8A0
+
+/* ILI9341 framebuffer */
+uint16_t SIM_ILI9341_Framebuffer[2 * SIM_ILI9341_WIDTH * SIM_ILI9341_HEIGHT];
+
+/* SSD1306 controller */
+static struct {
+	uint8_t RAM[SIM_SSD1306_HEIGHT / 8][SIM_SSD1306_WIDTH];
+	uint8_t Page;
+	uint8_t Column;
+	uint8_t Mode;           /* 0 = horizontal, 1 = vertical, 2 = page addressing */
+	uint8_t ColumnStart;
+	uint8_t ColumnEnd;
+	uint8_t PageStart;
+	uint8_t PageEnd;
+	uint8_t Command[8];     /* Command with arguments */
+	uint8_t CommandCount;
+	uint8_t CommandLength;
+	uint8_t SegmentRemap;
+	uint8_t ComReverse;
+	uint8_t Inverse;
+	uint8_t AllOn;
+	uint8_t On;
+} SSD1306_Sim;
+
+/* PCD8544 controller */
+static struct {
+	uint8_t RAM[SIM_PCD8544_HEIGHT / 8][SIM_PCD8544_WIDTH];
+	uint8_t X;
+	uint8_t Y;
+	uint8_t Extended;
+	uint8_t Vertical;
+	uint8_t PowerDown;
+	uint8_t Display;        /* D bit 2 and E bit 0 of display control */
+	uint8_t Vop;
+	uint8_t DC;
+	uint8_t CE;
+} PCD8544_Sim;
+
+/* Number of bytes on I2C and SPI */
+static uint32_t SIM_BusBytes;
+
+/* Private functions */
+static void SIM_INT_SSD1306_Reset(void);
+static void SIM_INT_SSD1306_Transfer(uint8_t reg, const uint8_t* data, uint16_t count);
+static void SIM_INT_SSD1306_Command(uint8_t command);
+static void SIM_INT_SSD1306_Data(uint8_t data);
+static void SIM_INT_PCD8544_Reset(void);
+static void SIM_INT_PCD8544_Byte(uint8_t data);
+static void SIM_INT_SetPin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin, uint8_t state);
+static void SIM_INT_NewImage(SIM_Image_t* Image, uint16_t width, uint16_t height);
+static void SIM_INT_SetRGB(SIM_Image_t* Image, uint16_t x, uint16_t y, uint32_t rgb);
+
+void SIM_Reset(void) {
+	memset(SIM_ILI9341_Framebuffer, 0, sizeof(SIM_ILI9341_Framebuffer));
+	SIM_INT_SSD1306_Reset();
+	SIM_INT_PCD8544_Reset();
+	PCD8544_Sim.CE = 1;
+	SIM_BusBytes = 0;
+}
+
+uint32_t SIM_GetBusBytes(void) {
+	return SIM_BusBytes;
+}
+
+void SIM_ILI9341_GetImage(SIM_Image_t* Image, uint8_t layer) {
+	const uint16_t* fb = &SIM_ILI9341_Framebuffer[(layer - 1) * SIM_ILI9341_WIDTH * SIM_ILI9341_HEIGHT];
+	uint16_t x, y, v;
+
+	SIM_INT_NewImage(Image, SIM_ILI9341_WIDTH, SIM_ILI9341_HEIGHT);
+	for (y = 0; y < SIM_ILI9341_HEIGHT; y++) {
+		for (x = 0; x < SIM_ILI9341_WIDTH; x++) {
+			/* RGB565 to RGB888, upper bits are repeated in lower bits */
+			v = *fb++;
+			SIM_INT_SetRGB(Image, x, y,
+				((uint32_t)(((v >> 8) & 0xF8) | (v >> 13)) << 16) |
+				((uint32_t)(((v >> 3) & 0xFC) | ((v >> 9) & 0x03)) << 8) |
+				(((v << 3) & 0xF8) | ((v >> 2) & 0x07))
+			);
+		}
+	}
+}
+
+void SIM_SSD1306_GetImage(SIM_Image_t* Image) {
+	uint16_t x, y, column, row;
+	uint8_t on;
+
+	SIM_INT_NewImage(Image, SIM_SSD1306_WIDTH, SIM_SSD1306_HEIGHT);
+	for (y = 0; y < SIM_SSD1306_HEIGHT; y++) {
+		for (x = 0; x < SIM_SSD1306_WIDTH; x++) {
+			/* Module is upright with segment remap (0xA1) and reversed COM scan (0xC8) */
+			column = SSD1306_Sim.SegmentRemap ? x : SIM_SSD1306_WIDTH - 1 - x;
+			row = SSD1306_Sim.ComReverse ? y : SIM_SSD1306_HEIGHT - 1 - y;
+
+			on = (SSD1306_Sim.RAM[row / 8][column] >> (row % 8)) & 1;
+			if (SSD1306_Sim.AllOn) {
+				on = 1;
+			}
+			if (SSD1306_Sim.Inverse) {
+				on ^= 1;
+			}
+			if (!SSD1306_Sim.On) {
+				on = 0;
+			}
+			SIM_INT_SetRGB(Image, x, y, on ? SSD1306_ON_RGB : SSD1306_OFF_RGB);
+		}
+	}
+}
+
+void SIM_PCD8544_GetImage(SIM_Image_t* Image) {
+	uint16_t x, y;
+	uint8_t on;
+
+	SIM_INT_NewImage(Image, SIM_PCD8544_WIDTH, SIM_PCD8544_HEIGHT);
+	for (y = 0; y < SIM_PCD8544_HEIGHT; y++) {
+		for (x = 0; x < SIM_PCD8544_WIDTH; x++) {
+			on = (PCD8544_Sim.RAM[y / 8][x] >> (y % 8)) & 1;
+
+			/* Display control: blank, all on, normal or inverse */
+			if (PCD8544_Sim.PowerDown || PCD8544_Sim.Display == 0x00) {
+				on = 0;
+			} else if (PCD8544_Sim.Display == 0x01) {
+				on = 1;
+			} else if (PCD8544_Sim.Display == 0x05) {
+				on ^= 1;
+			}
+			SIM_INT_SetRGB(Image, x, y, on ? PCD8544_ON_RGB : PCD8544_OFF_RGB);
+		}
+	}
+}
+
+void SIM_FreeImage(SIM_Image_t* Image) {
+	free(Image->Pixels);
+	Image->Pixels = NULL;
+}
+
+int SIM_SavePPM(const SIM_Image_t* Image, const char* filename) {
+	FILE* f;
+	size_t size = (size_t)Image->Width * Image->Height * 3;
+
+	f = fopen(filename, "wb");
+	if (!f) {
+		return 0;
+	}
+	fprintf(f, "P6\n%u %u\n255\n", Image->Width, Image->Height);
+	if (fwrite(Image->Pixels, 1, size, f) != size) {
+		fclose(f);
+		return 0;
+	}
+	return fclose(f) == 0;
+}
+
+int SIM_LoadPPM(SIM_Image_t* Image, const char* filename) {
+	FILE* f;
+	unsigned int width, height, max;
+	size_t size;
+
+	f = fopen(filename, "rb");
+	if (!f) {
+		return 0;
+	}
+
+	/* Header written by SIM_SavePPM, single whitespace after maximal value */
+	if (fscanf(f, "P6 %u %u %u", &width, &height, &max) != 3 || max != 255 || fgetc(f) == EOF) {
+		fclose(f);
+		return 0;
+	}
+
+	SIM_INT_NewImage(Image, width, height);
+	size = (size_t)width * height * 3;
+	if (fread(Image->Pixels, 1, size, f) != size) {
+		SIM_FreeImage(Image);
+		fclose(f);
+		return 0;
+	}
+	fclose(f);
+	return 1;
+}
+
+/* Replacement for TM I2C, only SSD1306 is connected */
+void TM_I2C_Init(I2C_TypeDef* I2Cx, TM_I2C_PinsPack_t pinspack, uint32_t clockSpeed) {
+
+}
+
+uint8_t TM_I2C_IsDeviceConnected(I2C_TypeDef* I2Cx, uint8_t address) {
+	return I2Cx == SSD1306_I2C && address == SSD1306_I2C_ADDR;
+}
+
+void TM_I2C_Write(I2C_TypeDef* I2Cx, uint8_t address, uint8_t reg, uint8_t data) {
+	TM_I2C_WriteMulti(I2Cx, address, reg, &data, 1);
+}
+
+void TM_I2C_WriteMulti(I2C_TypeDef* I2Cx, uint8_t address, uint8_t reg, uint8_t* data, uint16_t count) {
+	/* Address, register and data bytes */
+	SIM_BusBytes += 2 + count;
+	if (TM_I2C_IsDeviceConnected(I2Cx, address)) {
+		SIM_INT_SSD1306_Transfer(reg, data, count);
+	}
+}
+
+/* Replacement for TM SPI, only PCD8544 is connected */
+void TM_SPI_Init(SPI_TypeDef* SPIx, TM_SPI_PinsPack_t pinspack) {
+
+}
+
+uint8_t TM_SPI_Send(SPI_TypeDef* SPIx, uint8_t data) {
+	SIM_BusBytes++;
+	if (SPIx == PCD8544_SPI && !PCD8544_Sim.CE) {
+		SIM_INT_PCD8544_Byte(data);
+	}
+	return 0xFF;
+}
+
+/* Replacement for TM DELAY, time is not simulated */
+void TM_DELAY_Init(void) {
+
+}
+
+void Delayms(uint32_t millis) {
+
+}
+
+/* Replacement for standard peripheral GPIO and RCC functions */
+void GPIO_Init(GPIO_TypeDef* GPIOx, GPIO_InitTypeDef* GPIO_InitStruct) {
+
+}
+
+void GPIO_SetBits(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin) {
+	SIM_INT_SetPin(GPIOx, GPIO_Pin, 1);
+}
+
+void GPIO_ResetBits(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin) {
+	SIM_INT_SetPin(GPIOx, GPIO_Pin, 0);
+}
+
+void RCC_AHB1PeriphClockCmd(uint32_t RCC_AHB1Periph, FunctionalState NewState) {
+
+}
+
+/* Private functions */
+static void SIM_INT_SSD1306_Reset(void) {
+	memset(&SSD1306_Sim, 0, sizeof(SSD1306_Sim));
+
+	/* Reset values from datasheet */
+	SSD1306_Sim.Mode = 2;
+	SSD1306_Sim.ColumnEnd = SIM_SSD1306_WIDTH - 1;
+	SSD1306_Sim.PageEnd = SIM_SSD1306_HEIGHT / 8 - 1;
+}
+
+static void SIM_INT_SSD1306_Transfer(uint8_t reg, const uint8_t* data, uint16_t count) {
+	uint8_t control = reg;
+	uint16_t i = 0;
+
+	for (;;) {
+		if (control & 0x80) {
+			/* Co bit set, one byte follows and then new control byte */
+			if (i >= count) {
+				return;
+			}
+			if (control & 0x40) {
+				SIM_INT_SSD1306_Data(data[i++]);
+			} else {
+				SIM_INT_SSD1306_Command(data[i++]);
+			}
+			if (i >= count) {
+				return;
+			}
+			control = data[i++];
+		} else {
+			/* All remaining bytes are data or commands */
+			while (i < count) {
+				if (control & 0x40) {
+					SIM_INT_SSD1306_Data(data[i++]);
+				} else {
+					SIM_INT_SSD1306_Command(data[i++]);
+				}
+			}
+			return;
+		}
+	}
+}
+
+static void SIM_INT_SSD1306_Command(uint8_t command) {
+	uint8_t* c = SSD1306_Sim.Command;
+
+	/* First byte gives number of arguments */
+	if (SSD1306_Sim.CommandCount == 0) {
+		switch (command) {
+			case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xD3:
+			case 0xD5: case 0xD9: case 0xDA: case 0xDB:
+				SSD1306_Sim.CommandLength = 2;
+				break;
+			case 0x21: case 0x22: case 0xA3:
+				SSD1306_Sim.CommandLength = 3;
+				break;
+			case 0x29: case 0x2A:
+				SSD1306_Sim.CommandLength = 6;
+				break;
+			case 0x26: case 0x27:
+				SSD1306_Sim.CommandLength = 7;
+				break;
+			default:
+				SSD1306_Sim.CommandLength = 1;
+				break;
+		}
+	}
+	c[SSD1306_Sim.CommandCount++] = command;
+	if (SSD1306_Sim.CommandCount < SSD1306_Sim.CommandLength) {
+		return;
+	}
+	SSD1306_Sim.CommandCount = 0;
+
+	/* Execute command, scrolling, contrast and timing are not simulated */
+	if (c[0] <= 0x0F) {
+		SSD1306_Sim.Column = (SSD1306_Sim.Column & 0xF0) | c[0];
+	} else if (c[0] <= 0x1F) {
+		SSD1306_Sim.Column = ((SSD1306_Sim.Column & 0x0F) | (c[0] << 4)) & 0x7F;
+	} else if (c[0] == 0x20) {
+		SSD1306_Sim.Mode = c[1] & 0x03;
+	} else if (c[0] == 0x21) {
+		SSD1306_Sim.ColumnStart = c[1] & 0x7F;
+		SSD1306_Sim.ColumnEnd = c[2] & 0x7F;
+		SSD1306_Sim.Column = SSD1306_Sim.ColumnStart;
+	} else if (c[0] == 0x22) {
+		SSD1306_Sim.PageStart = c[1] & 0x07;
+		SSD1306_Sim.PageEnd = c[2] & 0x07;
+		SSD1306_Sim.Page = SSD1306_Sim.PageStart;
+	} else if (c[0] == 0xA0 || c[0] == 0xA1) {
+		SSD1306_Sim.SegmentRemap = c[0] & 0x01;
+	} else if (c[0] == 0xA4 || c[0] == 0xA5) {
+		SSD1306_Sim.AllOn = c[0] & 0x01;
+	} else if (c[0] == 0xA6 || c[0] == 0xA7) {
+		SSD1306_Sim.Inverse = c[0] & 0x01;
+	} else if (c[0] == 0xAE || c[0] == 0xAF) {
+		SSD1306_Sim.On = c[0] & 0x01;
+	} else if (c[0] >= 0xB0 && c[0] <= 0xB7) {
+		SSD1306_Sim.Page = c[0] & 0x07;
+	} else if (c[0] == 0xC0 || c[0] == 0xC8) {
+		SSD1306_Sim.ComReverse = c[0] == 0xC8;
+	}
+}
+
+static void SIM_INT_SSD1306_Data(uint8_t data) {
+	SSD1306_Sim.RAM[SSD1306_Sim.Page][SSD1306_Sim.Column] = data;
+
+	/* Move address pointer */
+	if (SSD1306_Sim.Mode == 2) {
+		/* Page addressing, column wraps in the same page */
+		SSD1306_Sim.Column = (SSD1306_Sim.Column + 1) & 0x7F;
+	} else if (SSD1306_Sim.Mode == 0) {
+		/* Horizontal addressing */
+		if (SSD1306_Sim.Column++ >= SSD1306_Sim.ColumnEnd) {
+			SSD1306_Sim.Column = SSD1306_Sim.ColumnStart;
+			if (SSD1306_Sim.Page++ >= SSD1306_Sim.PageEnd) {
+				SSD1306_Sim.Page = SSD1306_Sim.PageStart;
+			}
+		}
+	} else {
+		/* Vertical addressing */
+		if (SSD1306_Sim.Page++ >= SSD1306_Sim.PageEnd) {
+			SSD1306_Sim.Page = SSD1306_Sim.PageStart;
+			if (SSD1306_Sim.Column++ >= SSD1306_Sim.ColumnEnd) {
+				SSD1306_Sim.Column = SSD1306_Sim.ColumnStart;
+			}
+		}
+	}
+}
+
+static void SIM_INT_PCD8544_Reset(void) {
+	uint8_t ce = PCD8544_Sim.CE, dc = PCD8544_Sim.DC;
+
+	/* Pins are not changed by reset */
+	memset(&PCD8544_Sim, 0, sizeof(PCD8544_Sim));
+	PCD8544_Sim.PowerDown = 1;
+	PCD8544_Sim.CE = ce;
+	PCD8544_Sim.DC = dc;
+}
+
+static void SIM_INT_PCD8544_Byte(uint8_t data) {
+	if (PCD8544_Sim.DC) {
+		/* Data to RAM */
+		PCD8544_Sim.RAM[PCD8544_Sim.Y][PCD8544_Sim.X] = data;
+		if (PCD8544_Sim.Vertical) {
+			if (++PCD8544_Sim.Y >= SIM_PCD8544_HEIGHT / 8) {
+				PCD8544_Sim.Y = 0;
+				if (++PCD8544_Sim.X >= SIM_PCD8544_WIDTH) {
+					PCD8544_Sim.X = 0;
+				}
+			}
+		} else {
+			if (++PCD8544_Sim.X >= SIM_PCD8544_WIDTH) {
+				PCD8544_Sim.X = 0;
+				if (++PCD8544_Sim.Y >= SIM_PCD8544_HEIGHT / 8) {
+					PCD8544_Sim.Y = 0;
+				}
+			}
+		}
+	} else if ((data & 0xF8) == 0x20) {
+		/* Function set: power down, vertical addressing, extended instructions */
+		PCD8544_Sim.PowerDown = (data >> 2) & 1;
+		PCD8544_Sim.Vertical = (data >> 1) & 1;
+		PCD8544_Sim.Extended = data & 1;
+	} else if (PCD8544_Sim.Extended) {
+		/* Temperature coefficient and bias are not simulated */
+		if (data & 0x80) {
+			PCD8544_Sim.Vop = data & 0x7F;
+		}
+	} else if (data & 0x80) {
+		if ((data & 0x7F) < SIM_PCD8544_WIDTH) {
+			PCD8544_Sim.X = data & 0x7F;
+		}
+	} else if ((data & 0xF8) == 0x40) {
+		if ((data & 0x07) < SIM_PCD8544_HEIGHT / 8) {
+			PCD8544_Sim.Y = data & 0x07;
+		}
+	} else if ((data & 0xF8) == 0x08) {
+		PCD8544_Sim.Display = data & 0x05;
+	}
+}
+
+static void SIM_INT_SetPin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin, uint8_t state) {
+	if (GPIOx == PCD8544_DC_PORT && (GPIO_Pin & PCD8544_DC_PIN)) {
+		PCD8544_Sim.DC = state;
+	}
+	if (GPIOx == PCD8544_CE_PORT && (GPIO_Pin & PCD8544_CE_PIN)) {
+		PCD8544_Sim.CE = state;
+	}
+	if (GPIOx == PCD8544_RST_PORT && (GPIO_Pin & PCD8544_RST_PIN) && !state) {
+		SIM_INT_PCD8544_Reset();
+	}
+}
+
+static void SIM_INT_NewImage(SIM_Image_t* Image, uint16_t width, uint16_t height) {
+	Image->Width = width;
+	Image->Height = height;
+	Image->Pixels = calloc((size_t)width * height, 3);
+	if (!Image->Pixels) {
+		fprintf(stderr, "Out of memory\n");
+		exit(2);
+	}
+}
+
+static void SIM_INT_SetRGB(SIM_Image_t* Image, uint16_t x, uint16_t y, uint32_t rgb) {
+	uint8_t* p = &Image->Pixels[((size_t)y * Image->Width + x) * 3];
+
+	p[0] = rgb >> 16;
+	p[1] = rgb >> 8;
+	p[2] = rgb;
+}
@@ -0,0 +1,105 @@
+/*
+ * Simulated LCD controllers for host build of graphic libraries
+ *
+ * Copyright (C) Tilen MAJERLE, 2015
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Libraries are compiled unchanged. Functions of TM I2C, TM SPI, TM DELAY and
+ * standard peripheral GPIO and RCC libraries are replaced with functions in sim.c:
+ *  - Bytes sent to SSD1306 over I2C and to PCD8544 over SPI go to controller models
+ *    which execute commands and write display RAM, as real controllers do
+ *  - ILI9341 on STM32F429-Discovery is driven by LTDC from framebuffer in SDRAM,
+ *    so it is simulated with framebuffer in RAM which is drawn with software DMA2D
+ *
+ * Content of each display can be saved to PPM image as it would be seen on panel.
+ */
+#ifndef SIM_H
+#define SIM_H
+
+#include "stm32f4xx.h"
+#include "stm32f4xx_gpio.h"
+#include "stm32f4xx_rcc.h"
+
+/* CMSIS intrinsics are ARM instructions, they are replaced with C functions */
+#define __get_PRIMASK()		0
+#define __disable_irq()
+#define __enable_irq()
+#define __SADD16			SIM_SADD16
+#define __SSUB16			SIM_SSUB16
+#define __SMLAD				SIM_SMLAD
+#define __SMUSDX			SIM_SMUSDX
+
+static inline uint32_t SIM_SADD16(uint32_t x, uint32_t y) {
+	return ((x + y) & 0xFFFF) | (((x >> 16) + (y >> 16)) << 16);
+}
+
+static inline uint32_t SIM_SSUB16(uint32_t x, uint32_t y) {
+	return ((x - y) & 0xFFFF) | (((x >> 16) - (y >> 16)) << 16);
+}
+
+static inline uint32_t SIM_SMLAD(uint32_t x, uint32_t y, uint32_t sum) {
+	return sum + (int32_t)(int16_t)x * (int16_t)y + (int32_t)(int16_t)(x >> 16) * (int16_t)(y >> 16);
+}
+
+static inline uint32_t SIM_SMUSDX(uint32_t x, uint32_t y) {
+	return (int32_t)(int16_t)x * (int16_t)(y >> 16) - (int32_t)(int16_t)(x >> 16) * (int16_t)y;
+}
+
+/* TM SPI and TM DELAY have inline functions which access hardware, they are replaced below */
+#define TM_SPI_H			200
+#define TM_DELAY_H			240
+
+/* ILI9341 size and 2 layers in RGB565 format */
+#define SIM_ILI9341_WIDTH	240
+#define SIM_ILI9341_HEIGHT	320
+
+/* SSD1306 and PCD8544 display sizes */
+#define SIM_SSD1306_WIDTH	128
+#define SIM_SSD1306_HEIGHT	64
+#define SIM_PCD8544_WIDTH	84
+#define SIM_PCD8544_HEIGHT	48
+
+/* Image in RGB888 format, 3 bytes per pixel */
+typedef struct {
+	uint16_t Width;
+	uint16_t Height;
+	uint8_t* Pixels;
+} SIM_Image_t;
+
+/* Replacement for TM SPI */
+typedef enum {
+	TM_SPI_PinsPack_1,
+	TM_SPI_PinsPack_2,
+	TM_SPI_PinsPack_3,
+	TM_SPI_PinsPack_Custom
+} TM_SPI_PinsPack_t;
+
+void TM_SPI_Init(SPI_TypeDef* SPIx, TM_SPI_PinsPack_t pinspack);
+uint8_t TM_SPI_Send(SPI_TypeDef* SPIx, uint8_t data);
+
+/* Replacement for TM DELAY */
+void TM_DELAY_Init(void);
+void Delayms(uint32_t millis);
+
+/* ILI9341 framebuffer, layer 2 follows layer 1 */
+extern uint16_t SIM_ILI9341_Framebuffer[2 * SIM_ILI9341_WIDTH * SIM_ILI9341_HEIGHT];
+
+/* Controller state */
+void SIM_Reset(void);
+uint32_t SIM_GetBusBytes(void);
+
+/* Gets what panel shows, image must be freed with SIM_FreeImage */
+void SIM_ILI9341_GetImage(SIM_Image_t* Image, uint8_t layer);
+void SIM_SSD1306_GetImage(SIM_Image_t* Image);
+void SIM_PCD8544_GetImage(SIM_Image_t* Image);
+void SIM_FreeImage(SIM_Image_t* Image);
+
+/* PPM files */
+int SIM_SavePPM(const SIM_Image_t* Image, const char* filename);
+int SIM_LoadPPM(SIM_Image_t* Image, const char* filename);
+
+#endif
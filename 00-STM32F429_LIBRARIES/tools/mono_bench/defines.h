@@ -0,0 +1,9 @@
+/*
+ * Project defines for host build of monochrome drawing benchmark
+ */
+#ifndef TM_DEFINES_H
+#define TM_DEFINES_H
+
+/* TM MONO and TM FONTS need no settings */
+
+#endif
@@ -0,0 +1,278 @@
+/*
+ * Monochrome drawing benchmark on host computer, page-packed TM MONO against per-pixel drawing
+ *
+ * Copyright (C) Tilen MAJERLE, 2015
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Per-pixel functions below draw the same way as SSD1306 and PCD8544 libraries did before TM MONO:
+ * each pixel goes through DrawPixel with bounds check, read-modify-write of a byte and changed column mark.
+ * Each primitive is drawn once with both ways on the same buffer first and results must be equal,
+ * then each way is repeated for at least BENCH_TIME seconds.
+ *
+ * Numbers do not tell speed on STM32F4, only ratio between both ways is interesting.
+ *
+ * Build and run from 00-STM32F429_LIBRARIES folder:
+ *   gcc -O2 -DSTM32F429_439xx -Itools/mono_bench -I. -I../00-STM32F4xx_STANDARD_PERIPHERAL_DRIVERS/CMSIS/Include -I../00-STM32F4xx_STANDARD_PERIPHERAL_DRIVERS/CMSIS/Device/ST/STM32F4xx/Include -o monobench tools/mono_bench/main.c tm_stm32f4_mono.c tm_stm32f4_fonts.c
+ *   ./monobench
+ */
+#include "tm_stm32f4_mono.h"
+#include "tm_stm32f4_fonts.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Buffer size, the same as SSD1306 */
+#define MONO_WIDTH			128
+#define MONO_HEIGHT			64
+
+/* Minimal time of each benchmark in seconds */
+#define BENCH_TIME			0.2
+
+/* Benchmark, both functions draw the same primitive, i is used for position */
+typedef struct {
+	const char* Name;
+	void (*Pixel)(uint32_t i);
+	void (*Mono)(uint32_t i);
+} Bench_t;
+
+static uint8_t Buffer[MONO_WIDTH * MONO_HEIGHT / 8];
+static uint8_t Start[MONO_WIDTH * MONO_HEIGHT / 8];
+static uint32_t ChangedCount;
+
+static void Changed(uint16_t page, uint16_t start, uint16_t end);
+static const TM_MONO_t Mono = {Buffer, MONO_WIDTH, MONO_HEIGHT, Changed};
+
+/* 16x16 sprite with mask, LCD buffer format */
+static const uint8_t Sprite[32] = {
+	0x00, 0xE0, 0x18, 0x04, 0x64, 0x62, 0x02, 0x02, 0x02, 0x02, 0x62, 0x64, 0x04, 0x18, 0xE0, 0x00,
+	0x00, 0x07, 0x18, 0x20, 0x22, 0x44, 0x48, 0x48, 0x48, 0x48, 0x44, 0x22, 0x20, 0x18, 0x07, 0x00
+};
+static const uint8_t SpriteMask[32] = {
+	0x00, 0xE0, 0xF8, 0xFC, 0xFC, 0xFE, 0xFE, 0xFE, 0xFE, 0xFE, 0xFE, 0xFC, 0xFC, 0xF8, 0xE0, 0x00,
+	0x00, 0x07, 0x1F, 0x3F, 0x3F, 0x7F, 0x7F, 0x7F, 0x7F, 0x7F, 0x7F, 0x3F, 0x3F, 0x1F, 0x07, 0x00
+};
+
+/* Private functions */
+static double Now(void);
+static double Measure(void (*Draw)(uint32_t i));
+static int RunBench(const Bench_t* Bench);
+
+/* Per-pixel drawing */
+static uint8_t Pixel_Get(int16_t x, int16_t y) {
+	if (x < 0 || y < 0 || x >= MONO_WIDTH || y >= MONO_HEIGHT) {
+		return 0;
+	}
+	return (Buffer[x + (y / 8) * MONO_WIDTH] >> (y % 8)) & 0x01;
+}
+
+static void Pixel_Draw(int16_t x, int16_t y, TM_MONO_Op_t op, uint8_t foreground) {
+	uint8_t old, color;
+
+	if (x < 0 || y < 0 || x >= MONO_WIDTH || y >= MONO_HEIGHT) {
+		/* Error */
+		return;
+	}
+
+	/* Background is drawn only with copy operations */
+	switch (op) {
+		case TM_MONO_Op_Set:          if (!foreground) return; color = 1; break;
+		case TM_MONO_Op_Clear:        if (!foreground) return; color = 0; break;
+		case TM_MONO_Op_Xor:          if (!foreground) return; color = !Pixel_Get(x, y); break;
+		case TM_MONO_Op_Copy:         color = foreground; break;
+		default:                      color = !foreground; break;
+	}
+
+	/* Set color */
+	old = Buffer[x + (y / 8) * MONO_WIDTH];
+	if (color) {
+		Buffer[x + (y / 8) * MONO_WIDTH] |= 1 << (y % 8);
+	} else {
+		Buffer[x + (y / 8) * MONO_WIDTH] &= ~(1 << (y % 8));
+	}
+
+	/* Column is sent on next update only if it changed */
+	if (Buffer[x + (y / 8) * MONO_WIDTH] != old) {
+		Changed(y / 8, x, x + 1);
+	}
+}
+
+static void Pixel_FillRectangle(int16_t x, int16_t y, uint16_t width, uint16_t height, TM_MONO_Op_t op) {
+	uint16_t i, j;
+
+	for (i = 0; i < height; i++) {
+		for (j = 0; j < width; j++) {
+			Pixel_Draw(x + j, y + i, op, 1);
+		}
+	}
+}
+
+static int16_t Pixel_Puts(int16_t x, int16_t y, const char* str, TM_FontDef_t* Font, TM_MONO_Op_t op) {
+	uint32_t i, b, j;
+
+	while (*str) {
+		for (i = 0; i < Font->FontHeight; i++) {
+			b = Font->data[(*str - 32) * Font->FontHeight + i];
+			for (j = 0; j < Font->FontWidth; j++) {
+				Pixel_Draw(x + j, y + i, op, ((b << j) & 0x8000) ? 1 : 0);
+			}
+		}
+		x += Font->FontWidth;
+		str++;
+	}
+	return x;
+}
+
+static void Pixel_DrawSprite(int16_t x, int16_t y, const uint8_t* data, const uint8_t* mask, uint16_t width, uint16_t height, TM_MONO_Op_t op) {
+	uint16_t i, j;
+	uint32_t index;
+
+	for (i = 0; i < height; i++) {
+		for (j = 0; j < width; j++) {
+			index = (i / 8) * width + j;
+			if (mask && !((mask[index] >> (i % 8)) & 0x01)) {
+				continue;
+			}
+			Pixel_Draw(x + j, y + i, op, (data[index] >> (i % 8)) & 0x01);
+		}
+	}
+}
+
+static void Pixel_Invert(void) {
+	Pixel_FillRectangle(0, 0, MONO_WIDTH, MONO_HEIGHT, TM_MONO_Op_Xor);
+}
+
+static void Pixel_Scroll(int16_t dx, int16_t dy) {
+	static uint8_t copy[sizeof(Buffer)];
+	int16_t x, y, sx, sy;
+	uint8_t value;
+
+	/* Read from copy, so sources are not overwritten */
+	memcpy(copy, Buffer, sizeof(Buffer));
+	for (y = 0; y < MONO_HEIGHT; y++) {
+		for (x = 0; x < MONO_WIDTH; x++) {
+			sx = x - dx;
+			sy = y - dy;
+			value = 0;
+			if (sx >= 0 && sy >= 0 && sx < MONO_WIDTH && sy < MONO_HEIGHT) {
+				value = (copy[sx + (sy / 8) * MONO_WIDTH] >> (sy % 8)) & 0x01;
+			}
+			Pixel_Draw(x, y, TM_MONO_Op_Copy, value);
+		}
+	}
+}
+
+/* Benchmarks, positions move so clipping and all bit offsets are included */
+static void Pixel_Rect(uint32_t i) { Pixel_FillRectangle((i % 100) - 10, (i % 47) - 5, 40, 20, TM_MONO_Op_Set); }
+static void Mono_Rect(uint32_t i) { TM_MONO_FillRectangle(&Mono, (i % 100) - 10, (i % 47) - 5, 40, 20, TM_MONO_Op_Set); }
+static void Pixel_XorRect(uint32_t i) { Pixel_FillRectangle((i % 64) - 8, (i % 29) - 3, 64, 32, TM_MONO_Op_Xor); }
+static void Mono_XorRect(uint32_t i) { TM_MONO_FillRectangle(&Mono, (i % 64) - 8, (i % 29) - 3, 64, 32, TM_MONO_Op_Xor); }
+static void Pixel_HLine(uint32_t i) { Pixel_FillRectangle(i % 20, i % 64, 100, 1, TM_MONO_Op_Xor); }
+static void Mono_HLine(uint32_t i) { TM_MONO_FillRectangle(&Mono, i % 20, i % 64, 100, 1, TM_MONO_Op_Xor); }
+static void Pixel_VLine(uint32_t i) { Pixel_FillRectangle(i % 128, i % 7, 1, 50, TM_MONO_Op_Xor); }
+static void Mono_VLine(uint32_t i) { TM_MONO_FillRectangle(&Mono, i % 128, i % 7, 1, 50, TM_MONO_Op_Xor); }
+static void Pixel_Text7(uint32_t i) { Pixel_Puts((i % 50) - 2, (i % 57) - 3, "Hello 123", &TM_Font_7x10, TM_MONO_Op_Copy); }
+static void Mono_Text7(uint32_t i) { TM_MONO_Puts(&Mono, (i % 50) - 2, (i % 57) - 3, "Hello 123", &TM_Font_7x10, TM_MONO_Op_Copy); }
+static void Pixel_Text11(uint32_t i) { Pixel_Puts((i % 70) - 2, (i % 49) - 3, "Abc", &TM_Font_11x18, TM_MONO_Op_Xor); }
+static void Mono_Text11(uint32_t i) { TM_MONO_Puts(&Mono, (i % 70) - 2, (i % 49) - 3, "Abc", &TM_Font_11x18, TM_MONO_Op_Xor); }
+static void Pixel_Sprite(uint32_t i) { Pixel_DrawSprite((i % 120) - 4, (i % 59) - 4, Sprite, SpriteMask, 16, 16, TM_MONO_Op_Copy); }
+static void Mono_Sprite(uint32_t i) { TM_MONO_DrawSprite(&Mono, (i % 120) - 4, (i % 59) - 4, Sprite, SpriteMask, 16, 16, TM_MONO_Op_Copy); }
+static void Pixel_InvertAll(uint32_t i) { Pixel_Invert(); }
+static void Mono_InvertAll(uint32_t i) { TM_MONO_Invert(&Mono); }
+static void Pixel_ScrollUp(uint32_t i) { Pixel_Scroll(0, -3); }
+static void Mono_ScrollUp(uint32_t i) { TM_MONO_Scroll(&Mono, 0, -3); }
+static void Pixel_ScrollPage(uint32_t i) { Pixel_Scroll(0, 8); }
+static void Mono_ScrollPage(uint32_t i) { TM_MONO_Scroll(&Mono, 0, 8); }
+static void Pixel_ScrollLeft(uint32_t i) { Pixel_Scroll(-5, 0); }
+static void Mono_ScrollLeft(uint32_t i) { TM_MONO_Scroll(&Mono, -5, 0); }
+
+static const Bench_t Benchs[] = {
+	{"Filled rectangle 40x20",      Pixel_Rect,       Mono_Rect},
+	{"XOR rectangle 64x32",         Pixel_XorRect,    Mono_XorRect},
+	{"Horizontal line 100px",       Pixel_HLine,      Mono_HLine},
+	{"Vertical line 50px",          Pixel_VLine,      Mono_VLine},
+	{"Text 7x10, 9 chars",          Pixel_Text7,      Mono_Text7},
+	{"Text 11x18 XOR, 3 chars",     Pixel_Text11,     Mono_Text11},
+	{"Sprite 16x16 with mask",      Pixel_Sprite,     Mono_Sprite},
+	{"Invert buffer",               Pixel_InvertAll,  Mono_InvertAll},
+	{"Scroll up 3px",               Pixel_ScrollUp,   Mono_ScrollUp},
+	{"Scroll down 8px",             Pixel_ScrollPage, Mono_ScrollPage},
+	{"Scroll left 5px",             Pixel_ScrollLeft, Mono_ScrollLeft},
+};
+
+int main(void) {
+	uint32_t i, failed = 0;
+
+	/* Start with random content, so all operations change something */
+	srand(1);
+	for (i = 0; i < sizeof(Start); i++) {
+		Start[i] = rand();
+	}
+
+	printf("Buffer %dx%d, time per primitive\n", MONO_WIDTH, MONO_HEIGHT);
+	printf("%-28s %12s %12s %8s %6s\n", "Primitive", "per-pixel", "TM MONO", "speedup", "check");
+	for (i = 0; i < sizeof(Benchs) / sizeof(Benchs[0]); i++) {
+		failed += RunBench(&Benchs[i]);
+	}
+	printf("%u of %u checks failed\n", (unsigned)failed, (unsigned)(sizeof(Benchs) / sizeof(Benchs[0])));
+
+	return failed ? 1 : 0;
+}
+
+static void Changed(uint16_t page, uint16_t start, uint16_t end) {
+	/* Driver would extend its changed area here */
+	ChangedCount++;
+}
+
+static double Now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Time of one primitive in nanoseconds */
+static double Measure(void (*Draw)(uint32_t i)) {
+	uint32_t i, count = 0, batch = 64;
+	double start, elapsed;
+
+	memcpy(Buffer, Start, sizeof(Buffer));
+	start = Now();
+	do {
+		for (i = 0; i < batch; i++) {
+			Draw(count + i);
+		}
+		count += batch;
+		elapsed = Now() - start;
+	} while (elapsed < BENCH_TIME);
+
+	return elapsed * 1e9 / count;
+}
+
+static int RunBench(const Bench_t* Bench) {
+	static uint8_t expected[sizeof(Buffer)];
+	double pixel, mono;
+	uint32_t i;
+	int ok = 1;
+
+	/* Both ways must draw the same pixels, at a few positions */
+	for (i = 0; i < 64 && ok; i++) {
+		memcpy(Buffer, Start, sizeof(Buffer));
+		Bench->Pixel(i * 7);
+		memcpy(expected, Buffer, sizeof(Buffer));
+
+		memcpy(Buffer, Start, sizeof(Buffer));
+		Bench->Mono(i * 7);
+		ok = memcmp(expected, Buffer, sizeof(Buffer)) == 0;
+	}
+
+	pixel = Measure(Bench->Pixel);
+	mono = Measure(Bench->Mono);
+	printf("%-28s %9.0f ns %9.0f ns %7.1fx %6s\n", Bench->Name, pixel, mono, pixel / mono, ok ? "OK" : "FAIL");
+
+	return !ok;
+}
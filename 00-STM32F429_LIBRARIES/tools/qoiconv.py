@@ -0,0 +1,121 @@
+#!/usr/bin/env python
+#
+# Converts BMP image to QOI image for TM QOI library
+#
+# Copyright (C) Tilen MAJERLE, 2015
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+#
+# Usage:
+#   python qoiconv.py image.bmp image.qoi [options]
+#
+# Options:
+#   --alpha         Keep alpha channel of 32-bit BMP, image is then blended over LCD content
+#   --keep-colors   Do not round colours to RGB565, file is bigger but the same as original
+#
+# Prints size of QOI file and how much space is saved compared to RGB565 file
+#
+import sys
+import struct
+import argparse
+
+
+def read_bmp(path):
+	"""Returns width, height and list of (r, g, b, a) pixels from top left corner"""
+	data = open(path, 'rb').read()
+	if data[:2] != b'BM':
+		raise ValueError('Not BMP file')
+	offset = struct.unpack_from('<I', data, 10)[0]
+	width, height, planes, bpp, compression = struct.unpack_from('<iiHHI', data, 18)
+	if bpp not in (24, 32) or compression not in (0, 3):
+		raise ValueError('Only uncompressed 24-bit and 32-bit BMP files are supported')
+	top_down = height < 0
+	height = abs(height)
+	stride = (width * bpp // 8 + 3) & ~3
+	pixels = []
+	for y in range(height):
+		row = y if top_down else height - 1 - y
+		pos = offset + row * stride
+		for x in range(width):
+			b, g, r = data[pos], data[pos + 1], data[pos + 2]
+			a = data[pos + 3] if bpp == 32 else 255
+			pixels.append((r, g, b, a))
+			pos += bpp // 8
+	return width, height, pixels
+
+
+def round_rgb565(p):
+	"""Rounds colour to RGB565 and expands it back to 8 bits, same as LCD shows it"""
+	r, g, b, a = p
+	r5, g6, b5 = r >> 3, g >> 2, b >> 3
+	return ((r5 << 3) | (r5 >> 2), (g6 << 2) | (g6 >> 4), (b5 << 3) | (b5 >> 2), a)
+
+
+def encode_qoi(width, height, pixels, channels):
+	"""Encodes pixels to QOI file"""
+	out = bytearray(b'qoif')
+	out += struct.pack('>IIBB', width, height, channels, 0)
+	index = [(0, 0, 0, 0)] * 64
+	prev = (0, 0, 0, 255)
+	run = 0
+	for i, px in enumerate(pixels):
+		if px == prev:
+			run += 1
+			if run == 62 or i == len(pixels) - 1:
+				out.append(0xC0 | (run - 1))
+				run = 0
+			continue
+		if run:
+			out.append(0xC0 | (run - 1))
+			run = 0
+		r, g, b, a = px
+		h = (r * 3 + g * 5 + b * 7 + a * 11) % 64
+		if index[h] == px:
+			out.append(h)
+		else:
+			index[h] = px
+			if a == prev[3]:
+				dr = (r - prev[0] + 128) % 256 - 128
+				dg = (g - prev[1] + 128) % 256 - 128
+				db = (b - prev[2] + 128) % 256 - 128
+				dr_dg = dr - dg
+				db_dg = db - dg
+				if -2 <= dr <= 1 and -2 <= dg <= 1 and -2 <= db <= 1:
+					out.append(0x40 | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2))
+				elif -32 <= dg <= 31 and -8 <= dr_dg <= 7 and -8 <= db_dg <= 7:
+					out.append(0x80 | (dg + 32))
+					out.append(((dr_dg + 8) << 4) | (db_dg + 8))
+				else:
+					out += bytes([0xFE, r, g, b])
+			else:
+				out += bytes([0xFF, r, g, b, a])
+		prev = px
+	out += b'\x00' * 7 + b'\x01'
+	return bytes(out)
+
+
+def main():
+	parser = argparse.ArgumentParser(description='Converts BMP image to QOI image for TM QOI library')
+	parser.add_argument('bmp')
+	parser.add_argument('qoi')
+	parser.add_argument('--alpha', action='store_true')
+	parser.add_argument('--keep-colors', action='store_true')
+	args = parser.parse_args()
+
+	width, height, pixels = read_bmp(args.bmp)
+	if not args.alpha:
+		pixels = [(r, g, b, 255) for (r, g, b, a) in pixels]
+	if not args.keep_colors:
+		pixels = [round_rgb565(p) for p in pixels]
+	data = encode_qoi(width, height, pixels, 4 if args.alpha else 3)
+	open(args.qoi, 'wb').write(data)
+
+	raw = width * height * 2
+	sys.stdout.write('%s: %dx%d, %d bytes, RGB565 is %d bytes, %d%% saved\n' % (args.qoi, width, height, len(data), raw, 100 - len(data) * 100 // raw))
+
+
+if __name__ == '__main__':
+	main()
@@ -0,0 +1,21 @@
+/*
+ * Project defines for host build of SPI flash FTL benchmark
+ */
+#ifndef TM_DEFINES_H
+#define TM_DEFINES_H
+
+/* Types from stm32f4xx.h on target */
+#include <stdint.h>
+
+/* No hardware drivers on host, simulated flash is added as USER1 */
+#define FATFS_USE_SDIO			2
+
+/* Disable FatFs time from RTC */
+#define TM_FATFS_CUSTOM_FATTIME	0
+
+/* Simulated flash is 4MB */
+#define FATFS_SPI_FLASH_MEMORY_SIZE	(4 * 1024 * 1024)
+
+/* Trim is enabled with -D_USE_TRIM=1 on command line */
+
+#endif
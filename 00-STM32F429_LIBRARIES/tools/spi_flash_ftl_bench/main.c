@@ -0,0 +1,460 @@
+/*
+ * SPI flash FTL test and benchmark on host computer
+ *
+ * Copyright (C) Tilen MAJERLE, 2015
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Runs FTL from fatfs/drivers/fatfs_spi_flash_ftl.c on simulated NOR flash image.
+ * Simulated flash behaves like real one: program can only clear bits, must not cross 256-byte page
+ * and erase sets 4kB block to 0xFF. Time is estimated with simple SPI NOR model, see FLASH_* defines.
+ *
+ * Tests:
+ *  - Raw sector writes: sequential, uniform random, hot/cold and random with half of sectors trimmed
+ *  - FATFS data logger workload with trim
+ *  - Power fail: flash stops in the middle of random program or erase, after remount
+ *    each sector must have old or new data
+ *
+ * For each workload, write amplification (sectors programmed / sectors written), erase counts and throughput are printed.
+ *
+ * Build and run from 00-STM32F429_LIBRARIES folder:
+ *   gcc -O2 -Itools/spi_flash_ftl_bench -I. -Ifatfs -Ifatfs/drivers -D_USE_TRIM=1 -o ftlbench tools/spi_flash_ftl_bench/main.c fatfs/drivers/fatfs_spi_flash_ftl.c fatfs/ff.c fatfs/diskio.c fatfs/option/syscall.c fatfs/option/unicode.c
+ *   ./ftlbench
+ */
+#include "diskio.h"
+#include "ff.h"
+#include "fatfs_spi_flash_ftl.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+/* Simulated flash, 4MB */
+#define FLASH_SIZE			(4 * 1024 * 1024)
+#define FLASH_PAGE			256
+#define FLASH_BLOCK			4096
+
+/* SPI NOR model: SPI clock, page program and erase times */
+#define FLASH_SPI_HZ		45000000
+#define FLASH_PROGRAM_US	20
+#define FLASH_BYTE_NS		1500
+#define FLASH_ERASE_US		45000
+
+/* Number of power fail cycles */
+#define POWER_FAIL_CYCLES	300
+
+static uint8_t Flash[FLASH_SIZE];
+
+/* Expected version of each sector, 0 for sector without data */
+static uint32_t Version[FLASH_SIZE / 512];
+
+/* Simulated time in units of nanoseconds */
+static unsigned long long FlashTime;
+
+/* Power fail simulation, flash stops after this number of program and erase operations */
+static long FlashOpsLeft = -1;
+static int FlashDead;
+
+static void Time(uint32_t bytes) {
+	/* Command, address and data bytes on SPI */
+	FlashTime += (unsigned long long)(bytes + 5) * 8 * 1000000000ULL / FLASH_SPI_HZ;
+}
+
+static int PowerFail(void) {
+	if (FlashDead) {
+		return 1;
+	}
+	if (FlashOpsLeft > 0 && --FlashOpsLeft == 0) {
+		FlashDead = 1;
+	}
+	return 0;
+}
+
+static DRESULT SIM_Read(uint32_t address, uint8_t* data, uint32_t count) {
+	if (FlashDead || address + count > FLASH_SIZE) {
+		return RES_ERROR;
+	}
+	memcpy(data, &Flash[address], count);
+	Time(count + 1);
+	return RES_OK;
+}
+
+static DRESULT SIM_Program(uint32_t address, const uint8_t* data, uint32_t count) {
+	uint32_t n, i;
+
+	if (address + count > FLASH_SIZE) {
+		return RES_ERROR;
+	}
+	while (count) {
+		/* Split to pages like driver does */
+		n = FLASH_PAGE - (address % FLASH_PAGE);
+		if (n > count) {
+			n = count;
+		}
+		if (PowerFail()) {
+			return RES_ERROR;
+		}
+
+		/* Program can only clear bits, last operation before power fail is torn */
+		for (i = 0; i < n; i++) {
+			if (FlashDead && (i >= n / 2 || (rand() & 1))) {
+				Flash[address + i] &= data[i] | (uint8_t)rand();
+			} else {
+				Flash[address + i] &= data[i];
+			}
+		}
+		Time(n);
+		FlashTime += FLASH_PROGRAM_US * 1000ULL + (unsigned long long)n * FLASH_BYTE_NS;
+		if (FlashDead) {
+			return RES_ERROR;
+		}
+
+		address += n;
+		data += n;
+		count -= n;
+	}
+	return RES_OK;
+}
+
+static DRESULT SIM_Erase(uint32_t address) {
+	uint32_t i;
+
+	if (address % FLASH_BLOCK || address >= FLASH_SIZE || PowerFail()) {
+		return RES_ERROR;
+	}
+
+	/* Interrupted erase leaves part of block with old data */
+	for (i = 0; i < FLASH_BLOCK; i++) {
+		if (!FlashDead || (rand() & 3)) {
+			Flash[address + i] = 0xFF;
+		}
+	}
+	Time(0);
+	FlashTime += FLASH_ERASE_US * 1000ULL;
+	return FlashDead ? RES_ERROR : RES_OK;
+}
+
+static const TM_FATFS_FTL_Flash_t SimFlash = {
+	SIM_Read,
+	SIM_Program,
+	SIM_Erase,
+	FLASH_SIZE
+};
+
+/* FATFS driver on top of FTL */
+static DSTATUS FTL_disk_initialize(void) {
+	return 0;
+}
+
+static DSTATUS FTL_disk_status(void) {
+	return 0;
+}
+
+static DRESULT FTL_disk_ioctl(BYTE cmd, void* buff) {
+	switch (cmd) {
+		case GET_SECTOR_COUNT:
+			*(DWORD *)buff = TM_FATFS_FTL_GetSectorCount();
+			break;
+		case GET_SECTOR_SIZE:
+			*(WORD *)buff = 512;
+			break;
+		case GET_BLOCK_SIZE:
+			*(DWORD *)buff = 1;
+			break;
+		case CTRL_TRIM:
+			return TM_FATFS_FTL_Trim(((DWORD *)buff)[0], ((DWORD *)buff)[1]);
+		default:
+			break;
+	}
+	return RES_OK;
+}
+
+static DRESULT FTL_disk_write(const BYTE* buff, DWORD sector, UINT count) {
+	return TM_FATFS_FTL_Write(buff, sector, count);
+}
+
+static DRESULT FTL_disk_read(BYTE* buff, DWORD sector, UINT count) {
+	return TM_FATFS_FTL_Read(buff, sector, count);
+}
+
+static void Fail(const char* what) {
+	printf("%s failed\n", what);
+	exit(1);
+}
+
+static void Check(FRESULT fres, const char* what) {
+	if (fres != FR_OK) {
+		printf("%s failed: %d\n", what, (int)fres);
+		exit(1);
+	}
+}
+
+/* Sector content from sector number and version, version 0 is erased sector */
+static void Fill(BYTE* buff, DWORD sector, uint32_t version) {
+	uint32_t i, x = sector * 2654435761U + version * 40503U;
+
+	if (version == 0) {
+		memset(buff, 0xFF, 512);
+		return;
+	}
+	for (i = 0; i < 512; i++) {
+		x = x * 1103515245 + 12345;
+		buff[i] = x >> 16;
+	}
+}
+
+static void Mount(void) {
+	FlashDead = 0;
+	FlashOpsLeft = -1;
+	if (TM_FATFS_FTL_Init(&SimFlash) != RES_OK) {
+		Fail("TM_FATFS_FTL_Init");
+	}
+}
+
+static void Format(void) {
+	memset(Flash, 0xFF, sizeof(Flash));
+	Mount();
+	TM_FATFS_FTL_ResetStats();
+}
+
+static void Report(const char* name) {
+	TM_FATFS_FTL_Stats_t Stats;
+
+	TM_FATFS_FTL_GetStats(&Stats);
+	printf("%-18s host %6.1f MB, flash %6.1f MB, WA %5.2f, erases %6lu, erase count min %4lu max %4lu, write %6.1f kB/s\n",
+		name,
+		Stats.HostWrites / 2048.0,
+		Stats.FlashWrites / 2048.0,
+		Stats.HostWrites ? (double)Stats.FlashWrites / Stats.HostWrites : 0,
+		(unsigned long)Stats.Erases,
+		(unsigned long)Stats.MinErase, (unsigned long)Stats.MaxErase,
+		FlashTime ? Stats.HostWrites * 512.0 / 1024 / (FlashTime / 1e9) : 0
+	);
+	TM_FATFS_FTL_ResetStats();
+	FlashTime = 0;
+}
+
+static DRESULT WriteSector(DWORD sector, uint32_t version) {
+	BYTE buff[512];
+
+	Fill(buff, sector, version);
+	if (TM_FATFS_FTL_Write(buff, sector, 1) != RES_OK) {
+		return RES_ERROR;
+	}
+	Version[sector] = version;
+	return RES_OK;
+}
+
+static void Verify(const char* name) {
+	BYTE buff[512], exp[512];
+	DWORD s;
+
+	for (s = 0; s < TM_FATFS_FTL_GetSectorCount(); s++) {
+		if (TM_FATFS_FTL_Read(buff, s, 1) != RES_OK) {
+			Fail("read");
+		}
+		Fill(exp, s, Version[s]);
+		if (memcmp(buff, exp, 512)) {
+			printf("%s: sector %lu has wrong data\n", name, (unsigned long)s);
+			exit(1);
+		}
+	}
+}
+
+static void RawWrites(void) {
+	static BYTE buff[8 * 512];
+	DWORD sectors, s, i;
+
+	/* Sequential fill, 8 sectors at a time */
+	Format();
+	sectors = TM_FATFS_FTL_GetSectorCount();
+	printf("Flash %u kB, %lu sectors for FATFS\n", FLASH_SIZE / 1024, (unsigned long)sectors);
+	for (s = 0; s + 8 <= sectors; s += 8) {
+		for (i = 0; i < 8; i++) {
+			Fill(&buff[i * 512], s + i, 1);
+			Version[s + i] = 1;
+		}
+		if (TM_FATFS_FTL_Write(buff, s, 8) != RES_OK) {
+			Fail("sequential write");
+		}
+	}
+	Report("sequential fill");
+
+	/* Uniform random overwrites on full flash */
+	for (i = 0; i < sectors * 4; i++) {
+		if (WriteSector(rand() % sectors, 2) != RES_OK) {
+			Fail("random write");
+		}
+	}
+	Report("random, full");
+
+	/* 90% of writes to 10% of sectors */
+	for (i = 0; i < sectors * 4; i++) {
+		if (rand() % 10) {
+			s = rand() % (sectors / 10);
+		} else {
+			s = sectors / 10 + rand() % (sectors - sectors / 10);
+		}
+		if (WriteSector(s, 3) != RES_OK) {
+			Fail("hot/cold write");
+		}
+	}
+	Report("hot/cold 90/10");
+
+	/* Half of sectors trimmed */
+	if (TM_FATFS_FTL_Trim(sectors / 2, sectors - 1) != RES_OK) {
+		Fail("trim");
+	}
+	for (s = sectors / 2; s < sectors; s++) {
+		Version[s] = 0;
+	}
+	for (i = 0; i < sectors * 4; i++) {
+		if (WriteSector(rand() % (sectors / 2), 4) != RES_OK) {
+			Fail("random write after trim");
+		}
+	}
+	Report("random, 50% trim");
+
+	/* Check content after remount */
+	Mount();
+	Verify("Remount");
+	printf("Remount OK\n");
+}
+
+static void FatfsWrites(void) {
+	DISKIO_LowLevelDriver_t Driver = {
+		FTL_disk_initialize,
+		FTL_disk_status,
+		FTL_disk_ioctl,
+		FTL_disk_write,
+		FTL_disk_read
+	};
+	FATFS fs;
+	FIL fil;
+	char name[32], line[64];
+	UINT bw, round, i, j;
+
+	Format();
+	TM_FATFS_AddDriver(&Driver, TM_FATFS_Driver_USER1);
+	Check(f_mount(&fs, "USER1:", 0), "f_mount");
+	Check(f_mkfs("USER1:", 0, 0), "f_mkfs");
+	Report("f_mkfs");
+
+	/* Data logger: 8 files of 256kB, oldest file is deleted when next one is created */
+	for (round = 0; round < 48; round++) {
+		sprintf(name, "USER1:/log%02u.txt", round % 8);
+		f_unlink(name);
+		Check(f_open(&fil, name, FA_CREATE_ALWAYS | FA_WRITE), "f_open");
+		for (i = 0; i < 256 * 1024 / 32; i++) {
+			sprintf(line, "%05u;%05u;value %08X\r\n", round, i, round * 7919 + i);
+			Check(f_write(&fil, line, 32, &bw), "f_write");
+			if ((i % 64) == 63) {
+				Check(f_sync(&fil), "f_sync");
+			}
+		}
+		Check(f_close(&fil), "f_close");
+	}
+	Report("FATFS logger");
+
+	/* Check last files */
+	for (round = 40; round < 48; round++) {
+		sprintf(name, "USER1:/log%02u.txt", round % 8);
+		Check(f_open(&fil, name, FA_READ), "f_open");
+		for (i = 0; i < 256 * 1024 / 32; i++) {
+			Check(f_read(&fil, line, 32, &bw), "f_read");
+			sprintf(&line[32], "%05u;%05u;value %08X\r\n", round, i, round * 7919 + i);
+			for (j = 0; j < 32; j++) {
+				if (line[j] != line[32 + j]) {
+					Fail("FATFS data check");
+				}
+			}
+		}
+		Check(f_close(&fil), "f_close");
+	}
+	printf("FATFS data OK\n");
+	f_mount(NULL, "USER1:", 0);
+}
+
+static void PowerFailTest(void) {
+	BYTE buff[512], exp[512];
+	DWORD sectors, s = 0, t, cnt = 0;
+	uint32_t cycle, next = 1, trim = 0, ok;
+
+	Format();
+	sectors = TM_FATFS_FTL_GetSectorCount();
+	memset(Version, 0, sizeof(Version));
+
+	for (cycle = 0; cycle < POWER_FAIL_CYCLES; cycle++) {
+		/* Power fails after random number of program and erase operations */
+		FlashOpsLeft = 1 + rand() % 3000;
+
+		while (1) {
+			s = rand() % sectors;
+			if (rand() % 16 == 0) {
+				/* Trim few sectors */
+				trim = 1;
+				cnt = 1 + rand() % 8;
+				if (s + cnt > sectors) {
+					cnt = sectors - s;
+				}
+				if (TM_FATFS_FTL_Trim(s, s + cnt - 1) != RES_OK) {
+					break;
+				}
+				for (t = s; t < s + cnt; t++) {
+					Version[t] = 0;
+				}
+			} else {
+				/* Write sector with new version */
+				trim = 0;
+				cnt = 1;
+				if (WriteSector(s, next) != RES_OK) {
+					break;
+				}
+				next++;
+			}
+		}
+
+		/* Power on again, sometimes power fails again while mounting */
+		if (rand() % 4 == 0) {
+			FlashDead = 0;
+			FlashOpsLeft = 1 + rand() % 4;
+			TM_FATFS_FTL_Init(&SimFlash);
+		}
+		Mount();
+
+		/* All sectors have last data, interrupted operation can be finished or not */
+		for (t = 0; t < sectors; t++) {
+			if (TM_FATFS_FTL_Read(buff, t, 1) != RES_OK) {
+				Fail("read after power fail");
+			}
+			Fill(exp, t, Version[t]);
+			ok = memcmp(buff, exp, 512) == 0;
+			if (!ok && t >= s && t < s + cnt) {
+				Fill(exp, t, trim ? 0 : next);
+				ok = memcmp(buff, exp, 512) == 0;
+				if (ok) {
+					Version[t] = trim ? 0 : next;
+				}
+			}
+			if (!ok) {
+				printf("Power fail cycle %u: sector %lu has wrong data\n", cycle, (unsigned long)t);
+				exit(1);
+			}
+		}
+		next++;
+	}
+	printf("Power fail: %u cycles OK\n", POWER_FAIL_CYCLES);
+	Report("power fail test");
+}
+
+int main(void) {
+	srand(1);
+
+	RawWrites();
+	FatfsWrites();
+	PowerFailTest();
+
+	return 0;
+}
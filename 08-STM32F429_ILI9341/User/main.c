@@ -51,6 +51,9 @@ int main(void) {
 	TM_ILI9341_Puts(60, 150, "ILI9341 LCD Module", &TM_Font_11x18, ILI9341_COLOR_BLACK, ILI9341_COLOR_BLUE2);
 	/* Put string with black foreground color and red background with 11x18px font */
 	TM_ILI9341_Puts(45, 229, "stm32f4-discovery.net", &TM_Font_7x10, ILI9341_COLOR_BLACK, ILI9341_COLOR_ORANGE);
+	
+	/* Send changes to LCD, needed only when shadow framebuffer is enabled in defines.h */
+	TM_ILI9341_Flush();
 
 	/* While loop */
 	while (1) {
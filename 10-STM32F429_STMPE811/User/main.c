@@ -20,10 +20,18 @@
 #include "tm_stm32f4_stmpe811.h"
 #include <stdio.h>
 
+/* Called on STMPE811 INT line */
+void TM_EXTI_Handler(uint16_t GPIO_Pin) {
+	if (GPIO_Pin == STMPE811_INT_PIN) {
+		TM_STMPE811_InterruptHandler();
+	}
+}
+
 int main(void) {
 	char str[30];
-	/* Create TouchData struct */
-	TM_STMPE811_TouchData touchData;
+	/* Create event struct */
+	TM_STMPE811_Event_t event;
+	uint16_t lastx = 0, lasty = 0;
 	
 	/* Initialize system */
 	SystemInit();
@@ -37,33 +45,39 @@ int main(void) {
 	/* Fill with orange color */
 	TM_ILI9341_Fill(ILI9341_COLOR_ORANGE);
 	
-	/* Initialize Touch */
-	if (TM_STMPE811_Init() != TM_STMPE811_State_Ok) {
+	/* Initialize Touch in interrupt mode, events in portrait orientation */
+	if (TM_STMPE811_InitIT(TM_STMPE811_Orientation_Portrait_2) != TM_STMPE811_State_Ok) {
 		TM_ILI9341_Puts(20, 20, "STMPE811 Error", &TM_Font_11x18, ILI9341_COLOR_ORANGE, ILI9341_COLOR_BLACK);
 		
 		while (1);
 	}
 	
-	/* Select touch screen orientation */
-	touchData.orientation = TM_STMPE811_Orientation_Portrait_2;
-	
 	/* Print some text */
 	TM_ILI9341_Puts(20, 20, "Press on LCD", &TM_Font_11x18, ILI9341_COLOR_ORANGE, ILI9341_COLOR_BLACK);
 	TM_ILI9341_Puts(93, 310, "stm32f4-discovery.net", &TM_Font_7x10, ILI9341_COLOR_GREEN, ILI9341_COLOR_BLACK);
 	
 	while (1) {
-		/* If touch pressed */
-		if (TM_STMPE811_ReadTouch(&touchData) == TM_STMPE811_State_Pressed) {
-			/* Touch valid */
-			sprintf(str, "Pressed    \n\nX: %03d\nY: %03d", touchData.x, touchData.y);
-			TM_ILI9341_Puts(20, 80, str, &TM_Font_11x18, ILI9341_COLOR_BLACK, ILI9341_COLOR_ORANGE);
-		
-			/* Draw pixel on touch location */
-			TM_ILI9341_DrawPixel(touchData.x, touchData.y, 0x0000);
-		} else {
-			/* Touch not pressed */
-			sprintf(str, "Not Pressed\n\n       \n      ");
+		/* Check all touch events, I2C is used only when touch is pressed */
+		while (TM_STMPE811_GetEvent(&event)) {
+			if (event.Type == TM_STMPE811_EventType_Up) {
+				/* Touch released */
+				sprintf(str, "Not Pressed\n\n       \n      ");
+				TM_ILI9341_Puts(20, 80, str, &TM_Font_11x18, ILI9341_COLOR_BLACK, ILI9341_COLOR_ORANGE);
+				continue;
+			}
+			
+			/* Touch pressed or moved */
+			sprintf(str, "Pressed    \n\nX: %03d\nY: %03d", event.x, event.y);
 			TM_ILI9341_Puts(20, 80, str, &TM_Font_11x18, ILI9341_COLOR_BLACK, ILI9341_COLOR_ORANGE);
+			
+			/* Draw line from last position */
+			if (event.Type == TM_STMPE811_EventType_Move) {
+				TM_ILI9341_DrawLine(lastx, lasty, event.x, event.y, 0x0000);
+			} else {
+				TM_ILI9341_DrawPixel(event.x, event.y, 0x0000);
+			}
+			lastx = event.x;
+			lasty = event.y;
 		}
 	}
 }
@@ -16,8 +16,11 @@
 #include "defines.h"
 #include "tm_stm32f4_delay.h"
 #include "tm_stm32f4_hd44780.h"
+#include <stdio.h>
 
 int main(void) {
+	char str[21];
+	uint32_t counter = 0;
 	/* Rectangle for custom character */
 	/* xxx means doesn't care, lower 5 bits are important for LCD */
 	uint8_t customChar[] = {
@@ -70,6 +73,11 @@ int main(void) {
 	TM_HD44780_PutCustom(1, 2, 0);
 
 	while (1) {
-	
+		/* Show counter, only changed digits are sent to LCD in timer interrupt */
+		sprintf(str, "Counter: %lu", (unsigned long)counter++);
+		TM_HD44780_BufferPuts(3, 3, str);
+		TM_HD44780_UpdateIT();
+		
+		Delayms(100);
 	}
 }
@@ -20,7 +20,34 @@
 #include "tm_stm32f4_disco.h"
 #include <stdio.h>
 
+/* Text throughput benchmark, returns number of characters per second */
+uint32_t TextBenchmark(void) {
+	char line[46];
+	uint32_t start, chars = 0;
+	uint16_t i, y;
+	
+	/* Line with 45 characters, fits to landscape width with 7x10 font */
+	for (i = 0; i < 45; i++) {
+		line[i] = 'A' + (i % 26);
+	}
+	line[45] = 0;
+	
+	/* Draw full screens of text for 1 second */
+	start = TM_DELAY_Time();
+	while ((TM_DELAY_Time() - start) < 1000) {
+		for (y = 0; y < 240; y += 10) {
+			TM_ILI9341_Puts(0, y, line, &TM_Font_7x10, ILI9341_COLOR_WHITE, ILI9341_COLOR_BLACK);
+			chars += 45;
+		}
+	}
+	
+	/* Return characters per second */
+	return chars * 1000 / (TM_DELAY_Time() - start);
+}
+
 int main(void) {
+	char str[40];
+	
 	/* Initialize system */
 	SystemInit();
 	
@@ -34,6 +61,13 @@ int main(void) {
 	/* Rotate LCD for 90 degrees */
 	TM_ILI9341_Rotate(TM_ILI9341_Orientation_Landscape_2);
 	
+	/* Measure text speed on layer 1 and show result */
+	TM_ILI9341_SetLayer1();
+	sprintf(str, "Text: %u chars/s", TextBenchmark());
+	TM_ILI9341_Fill(ILI9341_COLOR_BLACK);
+	TM_ILI9341_Puts(10, 10, str, &TM_Font_11x18, ILI9341_COLOR_WHITE, ILI9341_COLOR_BLACK);
+	Delayms(3000);
+	
 	/* Go to layer 1 */
 	TM_ILI9341_SetLayer1();
 	
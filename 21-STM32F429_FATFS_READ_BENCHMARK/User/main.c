@@ -1,5 +1,6 @@
 /**
  *	Keil project for FatFS for SD cards with benchmark for READ SPEED
+ *	and for logging with small f_write calls and with log writer
  *
  *	Before you start, select your target, on the right of the "Load" button
  *
@@ -29,6 +30,61 @@ FIL fil;
 /* Create buffer of 20 512bytes long sector */
 uint8_t SD_Buffer[512 * 20];
 
+/* Log writer with 32 sectors buffer, aligned for DMA */
+TM_FATFS_Log_t Log;
+uint32_t Log_Buffer[32 * 512 / 4];
+
+/* Log benchmark, 4MB of 32 bytes records */
+#define LOG_SIZE		(4 * 1024 * 1024)
+#define LOG_RECORD		32
+
+/* Compares small f_write calls with log writer */
+void LogBenchmark(void) {
+	char record[LOG_RECORD + 1];
+	uint32_t i, cnt, time, start, max = 0;
+	FRESULT fres;
+	
+	/* Enable cycle counter for latency */
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	
+	/* Write records with f_write */
+	if ((fres = f_open(&fil, "SD:log1.txt", FA_CREATE_ALWAYS | FA_WRITE)) == FR_OK) {
+		TM_DELAY_SetTime(0);
+		for (i = 0; i < LOG_SIZE / LOG_RECORD; i++) {
+			sprintf(record, "%08u;%022u\n", i, i * 7);
+			start = DWT->CYCCNT;
+			f_write(&fil, record, LOG_RECORD, &cnt);
+			time = DWT->CYCCNT - start;
+			if (time > max) {
+				max = time;
+			}
+		}
+		f_close(&fil);
+		time = TM_DELAY_Time();
+		printf("f_write: %u bytes in %u ms = %u kB/s, worst write %u us\n", LOG_SIZE, time, LOG_SIZE / time, max / (SystemCoreClock / 1000000));
+	} else {
+		printf("Could not open file for write; FRES = %d\n", fres);
+	}
+	
+	/* Write the same records with log writer */
+	if ((fres = TM_FATFS_LogOpen(&Log, "SD:log2.txt", LOG_SIZE, (uint8_t *)Log_Buffer, sizeof(Log_Buffer))) == FR_OK) {
+		/* Update file size every 256kB */
+		Log.CheckpointInterval = 256 * 1024;
+		
+		TM_DELAY_SetTime(0);
+		for (i = 0; i < LOG_SIZE / LOG_RECORD; i++) {
+			sprintf(record, "%08u;%022u\n", i, i * 7);
+			TM_FATFS_LogWrite(&Log, record, LOG_RECORD);
+		}
+		TM_FATFS_LogClose(&Log);
+		time = TM_DELAY_Time();
+		printf("Log writer: %u bytes in %u ms = %u kB/s, %u writes, worst write %u us\n", LOG_SIZE, time, LOG_SIZE / time, Log.Writes, Log.MaxWriteTime);
+	} else {
+		printf("Could not create log; FRES = %d\n", fres);
+	}
+}
+
 int main(void) {
 	/* Free and total space */
 	uint32_t write_ok = 0, cnt = 0;
@@ -86,6 +142,9 @@ int main(void) {
 					/* Close file, don't forget this! */
 					f_close(&fil);
 					
+					/* Test logging speed */
+					LogBenchmark();
+					
 					/* GREEN LED on */
 					TM_DISCO_LedOn(LED_GREEN);
 					
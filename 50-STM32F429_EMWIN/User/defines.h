@@ -30,4 +30,7 @@
 
 /* Put your global defines for all libraries here used in your project */
 
+/* emWin uses DMA2D interrupt, DMA2D graphic library must not */
+#define DMA2D_GRAPHIC_USE_IRQ      0
+
 #endif
@@ -24,6 +24,7 @@
 int main(void) {
 	BUTTON_Handle hButton, hB1, hB2, hB3, hB4;
 	PROGBAR_Handle hProgbar;
+	TM_EMWIN_Benchmark_t Benchmark;
 	uint8_t i;
 	
 	/* Initialize system */
@@ -47,6 +48,16 @@ int main(void) {
 		}
 	}
 	
+	/* Draw benchmark screen for 5 seconds and show frame rate */
+	TM_EMWIN_Benchmark(5000, &Benchmark);
+	GUI_Delay(3000);
+	
+	/* Clear screen */
+	GUI_MULTIBUF_Begin();
+	GUI_SetBkColor(GUI_BLACK);
+	GUI_Clear();
+	GUI_MULTIBUF_End();
+	
 	/* Create progress bar at location x = 10, y = 10, length = 219, height = 30 */
 	hProgbar = PROGBAR_CreateEx(10, 10, 219, 30, 0, WM_CF_SHOW, 0, GUI_ID_PROGBAR0);
 	/* Set progress bar font */
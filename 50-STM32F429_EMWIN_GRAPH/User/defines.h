@@ -30,6 +30,9 @@
 
 /* Put your global defines for all libraries here used in your project */
 
+/* emWin uses DMA2D interrupt, DMA2D graphic library must not */
+#define DMA2D_GRAPHIC_USE_IRQ      0
+
 #define TM_EMWIN_ROTATE_LCD				1
 
 #endif
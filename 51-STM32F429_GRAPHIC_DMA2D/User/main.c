@@ -18,9 +18,65 @@
 #include "tm_stm32f4_ili9341_ltdc.h"
 #include "tm_stm32f4_fonts.h"
 #include "tm_stm32f4_delay.h"
+#include "tm_stm32f4_aa.h"
 #include <stdio.h>
 
+/* Anti-aliased primitives for benchmark */
+typedef enum {
+	Shape_Line = 0,
+	Shape_ThickLine,
+	Shape_Circle,
+	Shape_FilledCircle,
+	Shape_Arc
+} Shape_t;
+
+/* Draws shape count times and prints pixels per second on LCD */
+void Benchmark(Shape_t shape, char* name, uint16_t y) {
+	uint32_t start, cycles, pixels;
+	uint16_t i;
+	char str[40];
+	
+	/* Reset pixel counter */
+	TM_AA_ResetPixelCount();
+	
+	/* Draw shapes and count CPU cycles */
+	start = DWT->CYCCNT;
+	for (i = 0; i < 32; i++) {
+		switch (shape) {
+			case Shape_Line:
+				TM_DMA2DGRAPHIC_DrawLineAA(10, 170 + i, 230, 210 - i, GRAPHIC_COLOR_WHITE);
+				break;
+			case Shape_ThickLine:
+				TM_DMA2DGRAPHIC_DrawThickLineAA(20, 170 + i, 220, 210 - i, 6, GRAPHIC_COLOR_WHITE);
+				break;
+			case Shape_Circle:
+				TM_DMA2DGRAPHIC_DrawCircleAA(120, 200, 10 + i, GRAPHIC_COLOR_WHITE);
+				break;
+			case Shape_FilledCircle:
+				TM_DMA2DGRAPHIC_DrawFilledCircleAA(120, 200, 10 + i, GRAPHIC_COLOR_WHITE);
+				break;
+			case Shape_Arc:
+				TM_DMA2DGRAPHIC_DrawArcAA(120, 200, 10 + i, 4, i * 10, 200 + i * 10, GRAPHIC_COLOR_WHITE);
+				break;
+		}
+	}
+	cycles = DWT->CYCCNT - start;
+	pixels = TM_AA_GetPixelCount();
+	
+	/* Print result in thousands of pixels per second */
+	sprintf(str, "%-12s %6u kpx/s", name, (unsigned int)((uint64_t)pixels * (SystemCoreClock / 1000) / (cycles ? cycles : 1)));
+	TM_ILI9341_Puts(5, y, str, &TM_Font_7x10, ILI9341_COLOR_WHITE, ILI9341_COLOR_BLACK);
+}
+
+/* 16x16 icon with 8-bit indexes to 4 colour lookup table, pixels are made at startup */
+uint8_t IconPixels[16 * 16];
+const uint32_t IconCLUT[] = {0x00000000, 0xFF000000, 0xFFFFFFFF, 0x80FF0000};
+TM_DMA2DGRAPHIC_Image_t Icon = {IconPixels, 16, 16, TM_DMA2DGRAPHIC_ImageFormat_L8, IconCLUT, 4, 0};
+
 int main(void) {
+	uint16_t i;
+	int16_t dx, dy;
+	
 	/* Set coordinates for poly line */
 	TM_DMA2DRAPHIC_Poly_t Coordinates[] = {
 		{10, 10},
@@ -69,6 +125,39 @@ int main(void) {
 	/* Draw filled circle */
 	TM_DMA2DGRAPHIC_DrawFilledCircle(100, 170, 40, GRAPHIC_COLOR_CYAN);
 	
+	/* Draw anti-aliased shapes */
+	TM_DMA2DGRAPHIC_DrawThickLineAA(20, 240, 220, 280, 5, GRAPHIC_COLOR_RED);
+	TM_DMA2DGRAPHIC_DrawArcAA(180, 80, 40, 8, 135, 45, GRAPHIC_COLOR_BLUE);
+	
+	/* Make icon: transparent corners, black ring, white inside and half transparent red center */
+	for (i = 0; i < 16 * 16; i++) {
+		dx = 2 * (i % 16) - 15;
+		dy = 2 * (i / 16) - 15;
+		if (dx * dx + dy * dy > 225) {
+			IconPixels[i] = 0;
+		} else if (dx * dx + dy * dy > 144) {
+			IconPixels[i] = 1;
+		} else if (dx * dx + dy * dy > 36) {
+			IconPixels[i] = 2;
+		} else {
+			IconPixels[i] = 3;
+		}
+	}
+	
+	/* Draw row of icons, each one is one DMA2D operation with CLUT load and blending */
+	for (i = 0; i < 8; i++) {
+		TM_DMA2DGRAPHIC_DrawImage(i * 30 + 4, 296, &Icon);
+	}
+	
+	/* Go back to layer 1 and run anti-aliasing benchmark on bottom part of screen */
+	TM_DMA2DGRAPHIC_SetLayer(1);
+	TM_DMA2DGRAPHIC_DrawFilledRectangle(0, 160, 240, 160, GRAPHIC_COLOR_BLACK);
+	Benchmark(Shape_Line, "Line", 250);
+	Benchmark(Shape_ThickLine, "Thick line", 262);
+	Benchmark(Shape_Circle, "Circle", 274);
+	Benchmark(Shape_FilledCircle, "Filled circle", 286);
+	Benchmark(Shape_Arc, "Arc", 298);
+	
 	while (1) {
 		/* Change display layer on LCD using LTDC transfer */
 		TM_ILI9341_ChangeLayers();
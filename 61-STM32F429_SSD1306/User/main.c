@@ -57,8 +57,8 @@ int main(void) {
 		/* Invert pixels */
 		TM_SSD1306_ToggleInvert();
 		
-		/* Update screen */
-		TM_SSD1306_UpdateScreen();
+		/* Update screen with DMA, CPU does not wait for I2C */
+		TM_SSD1306_UpdateScreenDMA();
 		
 		/* Make a little delay */
 		Delayms(500);
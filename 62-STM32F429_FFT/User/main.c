@@ -26,6 +26,7 @@
 #include "tm_stm32f4_sdram.h"
 #include "tm_stm32f4_dac_signal.h"
 #include "tm_stm32f4_fft.h"
+#include "tm_stm32f4_waterfall.h"
 
 #include <stdio.h>
 
@@ -36,28 +37,23 @@
 #define SAMPLES					(512)         /* 256 real party and 256 imaginary parts */
 #define FFT_SIZE				(SAMPLES / 2) /* FFT size is always the same size as we have samples, so 256 in our case */
 
-#define FFT_BAR_MAX_HEIGHT		120           /* 120 px on the LCD */
+/* Waterfall settings, in LCD memory coordinates (240 pixels per line) */
+/* In landscape mode, waterfall is below text and scrolls from right to left */
+#define WATERFALL_X				60
+#define WATERFALL_Y				0
+#define WATERFALL_WIDTH			180
+#define WATERFALL_HEIGHT		320
+
+/* Ring buffer for waterfall in SDRAM, after LCD layers and back buffers */
+#define WATERFALL_RING_ADDR		ILI9341_SDRAM_END
 
 /* Global variables */
 float32_t Input[SAMPLES];   /*!< Input buffer is always 2 * FFT_SIZE */
 float32_t Output[FFT_SIZE]; /*!< Output buffer is always FFT_SIZE */
-
-/* Draw bar for LCD */
-/* Simple library to draw bars */
-void DrawBar(uint16_t bottomX, uint16_t bottomY, uint16_t maxHeight, uint16_t maxValue, float32_t value, uint16_t foreground, uint16_t background) {
-	uint16_t height;
-	height = (uint16_t)((float32_t)value / (float32_t)maxValue * (float32_t)maxHeight);
-	if (height == maxHeight) {
-		TM_ILI9341_DrawLine(bottomX, bottomY, bottomX, bottomY - height, foreground);
-	} else if (height < maxHeight) {
-		TM_ILI9341_DrawLine(bottomX, bottomY, bottomX, bottomY - height, foreground);
-		TM_ILI9341_DrawLine(bottomX, bottomY - height, bottomX, bottomY - maxHeight, background);
-	}
-}
+TM_WATERFALL_t Waterfall;   /*!< Waterfall structure */
 
 int main(void) {
 	TM_FFT_F32_t FFT;    /*!< FFT structure */
-	uint16_t i;
 	uint32_t frequency = 10000;
 	
 	/* Initialize system */
@@ -93,6 +89,9 @@ int main(void) {
 	/* Output buffer must be FFT_SIZE in length */
 	TM_FFT_SetBuffers_F32(&FFT, Input, Output);
 	
+	/* Init waterfall on layer 1, ring buffer is in SDRAM */
+	TM_WATERFALL_Init(&Waterfall, WATERFALL_X, WATERFALL_Y, WATERFALL_WIDTH, WATERFALL_HEIGHT, SDRAM_START_ADR, (uint16_t *)WATERFALL_RING_ADDR);
+	
 	while (1) {
 		/* This part should be done with DMA and timer for ADC treshold */
 		/* Actually, best solution is double buffered DMA with timer for ADC treshold */
@@ -106,17 +105,10 @@ int main(void) {
 		/* Do FFT on signal, values at each bin and calculate max value and index where max value happened */
 		TM_FFT_Process_F32(&FFT);
 
-		/* Display data on LCD */
-		for (i = 0; i < TM_FFT_GetFFTSize(&FFT); i++) {
-			/* Draw FFT results */
-			DrawBar(30 + 2 * i,
-					220,
-					FFT_BAR_MAX_HEIGHT,
-					TM_FFT_GetMaxValue(&FFT),
-					TM_FFT_GetFromBuffer(&FFT, i),
-					0x1234,
-					0xFFFF
-			);
-		}
+		/* Add new row to waterfall, only first half of bins is useful for real signal */
+		TM_WATERFALL_AddRowF32(&Waterfall, Output, TM_FFT_GetFFTSize(&FFT) / 2, TM_FFT_GetMaxValue(&FFT));
+		
+		/* Display data on LCD, DMA2D does the scrolling, CPU can continue with sampling */
+		TM_WATERFALL_Draw(&Waterfall);
 	}
 }